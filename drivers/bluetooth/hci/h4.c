@@ -37,12 +37,23 @@
 #define H4_SCO  0x03
 #define H4_EVT  0x04
 
+#if defined(CONFIG_BT_HCI_ACL_FLOW_CONTROL)
+#define H4_RX_BUF_COUNT (CONFIG_BT_RX_BUF_COUNT + CONFIG_BT_ACL_RX_COUNT)
+#else
+#define H4_RX_BUF_COUNT CONFIG_BT_RX_BUF_COUNT
+#endif
+
 static BT_STACK_NOINIT(rx_thread_stack, CONFIG_BT_RX_STACK_SIZE);
 static struct k_thread rx_thread_data;
 
+/* Buffers received by the ISR for the RX thread. The channel can hold
+ * all the RX buffers, so the ISR never finds it full.
+ */
+static struct net_buf *rx_slots[H4_RX_BUF_COUNT + 1];
+
 static struct {
 	struct net_buf *buf;
-	struct k_fifo   fifo;
+	struct net_buf_spsc spsc;
 
 	u16_t    remaining;
 	u16_t    discard;
@@ -59,7 +70,7 @@ static struct {
 		u8_t hdr[4];
 	};
 } rx = {
-	.fifo = _K_FIFO_INITIALIZER(rx.fifo),
+	.spsc = NET_BUF_SPSC_INITIALIZER(rx.spsc, rx_slots),
 };
 
 static struct {
@@ -208,7 +219,7 @@ static void rx_thread(void *p1, void *p2, void *p3)
 		/* Let the ISR continue receiving new packets */
 		uart_irq_rx_enable(h4_dev);
 
-		buf = net_buf_get(&rx.fifo, K_FOREVER);
+		buf = net_buf_spsc_get(&rx.spsc, K_FOREVER);
 		do {
 			uart_irq_rx_enable(h4_dev);
 
@@ -216,13 +227,13 @@ static void rx_thread(void *p1, void *p2, void *p3)
 			bt_recv(buf);
 
 			/* Give other threads a chance to run if the ISR
-			 * is receiving data so fast that rx.fifo never
+			 * is receiving data so fast that rx.spsc never
 			 * or very rarely goes empty.
 			 */
 			k_yield();
 
 			uart_irq_rx_disable(h4_dev);
-			buf = net_buf_get(&rx.fifo, K_NO_WAIT);
+			buf = net_buf_spsc_get(&rx.spsc, K_NO_WAIT);
 		} while (buf);
 	}
 }
@@ -296,8 +307,11 @@ static inline void read_payload(void)
 		BT_DBG("Calling bt_recv_prio(%p)", buf);
 		bt_recv_prio(buf);
 	} else {
-		BT_DBG("Putting buf %p to rx fifo", buf);
-		net_buf_put(&rx.fifo, buf);
+		BT_DBG("Putting buf %p to rx channel", buf);
+		if (net_buf_spsc_put(&rx.spsc, buf)) {
+			BT_ERR("RX channel full, dropping buf %p", buf);
+			net_buf_unref(buf);
+		}
 	}
 }
 
@@ -72,25 +72,58 @@ static struct eth_context *get_context(struct net_if *iface)
 	return net_if_get_device(iface)->driver_data;
 }
 
-static int eth_send(struct net_if *iface, struct net_pkt *pkt)
+/* Write the frame directly from the fragments of the packet. It is only
+ * copied if it has more fragments than can be written in one call.
+ */
+static int eth_write_pkt(struct eth_context *ctx, struct net_pkt *pkt)
 {
-	struct eth_context *ctx = get_context(iface);
+	struct eth_iov iov[ETH_IOV_MAX];
 	struct net_buf *frag;
-	int count = 0;
+	int count;
+	int i;
 
 	/* First fragment contains link layer (Ethernet) headers.
 	 */
+	iov[0].base = net_pkt_ll(pkt);
+	iov[0].len = net_pkt_ll_reserve(pkt) + pkt->frags->len;
+	count = iov[0].len;
+
+	/* Then the remaining data */
+	for (frag = pkt->frags->frags, i = 1; frag; frag = frag->frags, i++) {
+		if (i == ETH_IOV_MAX) {
+			break;
+		}
+
+		iov[i].base = frag->data;
+		iov[i].len = frag->len;
+		count += frag->len;
+	}
+
+	if (!frag) {
+		eth_write_iov(ctx->dev_fd, iov, i);
+		return count;
+	}
+
 	count = net_pkt_ll_reserve(pkt) + pkt->frags->len;
 	memcpy(ctx->send, net_pkt_ll(pkt), count);
 
-	/* Then the remaining data */
-	frag = pkt->frags->frags;
-	while (frag) {
+	for (frag = pkt->frags->frags; frag; frag = frag->frags) {
 		memcpy(ctx->send + count, frag->data, frag->len);
 		count += frag->len;
-		frag = frag->frags;
 	}
 
+	eth_write_data(ctx->dev_fd, ctx->send, count);
+
+	return count;
+}
+
+static void eth_send_pkt(struct net_if *iface, struct net_pkt *pkt)
+{
+	struct eth_context *ctx = get_context(iface);
+	int count;
+
+	count = eth_write_pkt(ctx, pkt);
+
 	eth_stats_update_bytes_tx(iface, count);
 	eth_stats_update_pkts_tx(iface);
 
@@ -107,13 +140,28 @@ static int eth_send(struct net_if *iface, struct net_pkt *pkt)
 
 	SYS_LOG_DBG("Send pkt %p len %d", pkt, count);
 
-	eth_write_data(ctx->dev_fd, ctx->send, count);
-
 	net_pkt_unref(pkt);
+}
+
+static int eth_send(struct net_if *iface, struct net_pkt *pkt)
+{
+	eth_send_pkt(iface, pkt);
 
 	return 0;
 }
 
+static int eth_send_batch(struct net_if *iface, struct net_pkt **pkts,
+			  int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		eth_send_pkt(iface, pkts[i]);
+	}
+
+	return count;
+}
+
 static int eth_init(struct device *dev)
 {
 	ARG_UNUSED(dev);
@@ -159,7 +207,7 @@ static int read_data(struct eth_context *ctx, int fd)
 
 	ret = eth_read_data(fd, ctx->recv, sizeof(ctx->recv));
 	if (ret <= 0) {
-		return 0;
+		return -EAGAIN;
 	}
 
 	pkt = net_pkt_get_reserve_rx(0, NET_BUF_TIMEOUT);
@@ -229,10 +277,17 @@ static void eth_rx(struct eth_context *ctx)
 	SYS_LOG_DBG("Starting ZETH RX thread");
 
 	while (1) {
-		if (net_if_is_up(ctx->iface)) {
+		/* Read everything that is pending so that the stack gets
+		 * the frames as one burst.
+		 */
+		while (net_if_is_up(ctx->iface)) {
 			ret = eth_wait_data(ctx->dev_fd);
-			if (!ret) {
-				read_data(ctx, ctx->dev_fd);
+			if (ret) {
+				break;
+			}
+
+			if (read_data(ctx, ctx->dev_fd) < 0) {
+				break;
 			}
 		}
 
@@ -319,6 +374,7 @@ static const struct ethernet_api eth_if_api = {
 	.iface_api.send = eth_send,
 
 	.get_capabilities = eth_posix_native_get_capabilities,
+	.send_batch = eth_send_batch,
 
 #if defined(CONFIG_NET_STATISTICS_ETHERNET)
 	.stats = &eth_context_data.stats,
@@ -22,6 +22,7 @@
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <net/if.h>
 
 #ifdef __linux
@@ -138,3 +139,20 @@ ssize_t eth_write_data(int fd, void *buf, size_t buf_len)
 {
 	return write(fd, buf, buf_len);
 }
+
+ssize_t eth_write_iov(int fd, const struct eth_iov *iov, int iovcnt)
+{
+	struct iovec host_iov[ETH_IOV_MAX];
+	int i;
+
+	if (iovcnt > ETH_IOV_MAX) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		host_iov[i].iov_base = iov[i].base;
+		host_iov[i].iov_len = iov[i].len;
+	}
+
+	return writev(fd, host_iov, iovcnt);
+}
@@ -11,11 +11,21 @@
 #ifndef _ETH_NATIVE_POSIX_PRIV_H
 #define _ETH_NATIVE_POSIX_PRIV_H
 
+/* Max number of buffers written to the host interface in one call */
+#define ETH_IOV_MAX 32
+
+/* Same as struct iovec of the host, which is not visible here */
+struct eth_iov {
+	void *base;
+	size_t len;
+};
+
 int eth_iface_create(const char *if_name, bool tun_only);
 int eth_iface_remove(int fd);
 int eth_setup_host(const char *if_name);
 int eth_wait_data(int fd);
 ssize_t eth_read_data(int fd, void *buf, size_t buf_len);
 ssize_t eth_write_data(int fd, void *buf, size_t buf_len);
+ssize_t eth_write_iov(int fd, const struct eth_iov *iov, int iovcnt);
 
 #endif /* _ETH_NATIVE_POSIX_PRIV_H */
@@ -693,6 +693,129 @@ extern const struct net_buf_data_cb net_buf_var_cb;
 		NET_BUF_POOL_INITIALIZER(_name, &net_buf_data_alloc_##_name,  \
 					 _net_buf_##_name, _count, _destroy)
 
+/** Size of the header in front of the data of a size class block */
+#define NET_BUF_DATA_CLASS_HDR sizeof(void *)
+
+/** Size of one block of a data size class, including the header */
+#define NET_BUF_DATA_CLASS_STRIDE(_size) \
+	ROUND_UP((_size) + NET_BUF_DATA_CLASS_HDR, sizeof(void *))
+
+/**
+ * @brief Data size class of a pool defined with NET_BUF_POOL_CLASS_DEFINE.
+ *
+ * The counters can be read to see how well the classes match the
+ * traffic, for example to size the pool.
+ */
+struct net_buf_data_class {
+	/** Size of the data blocks of the class */
+	const u16_t size;
+
+	/** Number of data blocks */
+	const u16_t count;
+
+	/** Number of data blocks never allocated */
+	u16_t uninit_count;
+
+	/** Number of data blocks in use */
+	u16_t used;
+
+	/** Highest number of data blocks in use at the same time */
+	u16_t max_used;
+
+	/** Number of allocations from this class */
+	u32_t allocs;
+
+	/** Number of allocations that fitted this class but were served
+	 * by a larger class because this one was used up.
+	 */
+	u32_t overflows;
+
+	/** Free data blocks, linked through their first word */
+	void *free;
+
+	/** Storage of the data blocks */
+	u8_t * const blocks;
+};
+
+struct net_buf_pool_class {
+	struct net_buf_data_class *classes;
+	u8_t count;
+};
+
+extern const struct net_buf_data_cb net_buf_class_cb;
+
+/** @def NET_BUF_DATA_CLASS
+ *  @brief Define a data size class for NET_BUF_POOL_CLASS_DEFINE.
+ *
+ *  @param _size      Size of the data blocks of the class.
+ *  @param _count     Number of data blocks in the class.
+ */
+#define NET_BUF_DATA_CLASS(_size, _count)                                     \
+	{                                                                     \
+		.size = _size,                                                \
+		.count = _count,                                              \
+		.uninit_count = _count,                                       \
+		.blocks = (u8_t *)(void *[(_count) *                          \
+					  NET_BUF_DATA_CLASS_STRIDE(_size) /  \
+					  sizeof(void *)]){ NULL },           \
+	}
+
+/** @def NET_BUF_POOL_CLASS_DEFINE
+ *  @brief Define a new pool for buffers with size class based payloads
+ *
+ *  Defines a net_buf_pool struct and the necessary memory storage (array of
+ *  structs) for the needed amount of buffers. After this, the buffers can be
+ *  accessed from the pool through net_buf_alloc_len. The pool is defined as
+ *  a static variable, so if it needs to be exported outside the current
+ *  module this needs to happen with the help of a separate pointer rather
+ *  than an extern declaration.
+ *
+ *  The data payload of the buffers will be taken from the smallest size
+ *  class, defined with NET_BUF_DATA_CLASS, that fits the requested size
+ *  and has free blocks. Requests larger than the largest class get a block
+ *  of the largest class. The classes must be listed in increasing size.
+ *  This kind of pool does not support blocking on the data allocation, so
+ *  the timeout passed to net_buf_alloc_len will be always treated as
+ *  K_NO_WAIT when trying to allocate the data.
+ *
+ *  If provided with a custom destroy callback, this callback is
+ *  responsible for eventually calling net_buf_destroy() to complete the
+ *  process of returning the buffer to the pool.
+ *
+ *  @param _name      Name of the pool variable.
+ *  @param _count     Number of buffers in the pool.
+ *  @param _destroy   Optional destroy callback when buffer is freed.
+ *  @param ...        Data size classes, at most 255.
+ */
+#define NET_BUF_POOL_CLASS_DEFINE(_name, _count, _destroy, ...)               \
+	static struct net_buf net_buf_##_name[_count] __noinit;               \
+	static struct net_buf_data_class net_buf_classes_##_name[] = {        \
+		__VA_ARGS__                                                   \
+	};                                                                    \
+	static const struct net_buf_pool_class net_buf_class_##_name = {      \
+		.classes = net_buf_classes_##_name,                           \
+		.count = ARRAY_SIZE(net_buf_classes_##_name),                 \
+	};                                                                    \
+	static const struct net_buf_data_alloc net_buf_class_alloc_##_name = {\
+		.cb = &net_buf_class_cb,                                      \
+		.alloc_data = (void *)&net_buf_class_##_name,                 \
+	};                                                                    \
+	struct net_buf_pool _name __net_buf_align                             \
+			__in_section(_net_buf_pool, static, _name) =          \
+		NET_BUF_POOL_INITIALIZER(_name, &net_buf_class_alloc_##_name, \
+					 net_buf_##_name, _count, _destroy)
+
+/**
+ *  @brief Get the data size classes of a pool.
+ *
+ *  @param pool Pool defined with NET_BUF_POOL_CLASS_DEFINE.
+ *  @param classes Set to point to the classes of the pool.
+ *
+ *  @return Number of classes, 0 if the pool does not use size classes.
+ */
+int net_buf_pool_get_classes(struct net_buf_pool *pool,
+			     const struct net_buf_data_class **classes);
+
 /** @def NET_BUF_POOL_DEFINE
  *  @brief Define a new pool for buffers
  *
@@ -924,6 +1047,98 @@ struct net_buf *net_buf_slist_get(sys_slist_t *list);
  */
 void net_buf_put(struct k_fifo *fifo, struct net_buf *buf);
 
+/**
+ *  @brief Single producer, single consumer buffer channel
+ *
+ *  A ring of buffer pointers for passing buffers from one context, for
+ *  example an ISR, to one thread. Putting and getting a buffer does not
+ *  lock interrupts or touch a wait queue, the consumer only blocks on a
+ *  semaphore when the channel is empty. Fragments stay linked to the
+ *  buffer they belong to.
+ */
+struct net_buf_spsc {
+	/** Next slot to write, only changed by the producer */
+	atomic_t head;
+
+	/** Next slot to read, only changed by the consumer */
+	atomic_t tail;
+
+	/** Set when the consumer waits for a buffer */
+	atomic_t waiting;
+
+	/** Semaphore the consumer waits on */
+	struct k_sem sem;
+
+	/** Number of slots, one more than the channel can hold */
+	u16_t size;
+
+	/** Slot storage */
+	struct net_buf **slots;
+};
+
+/** @def NET_BUF_SPSC_INITIALIZER
+ *  @brief Statically initialize a buffer channel.
+ *
+ *  @param _obj   The channel being initialized.
+ *  @param _slots Array of buffer pointers, one more than the number of
+ *                buffers the channel can hold.
+ */
+#define NET_BUF_SPSC_INITIALIZER(_obj, _slots)                                \
+	{                                                                     \
+		.sem = _K_SEM_INITIALIZER(_obj.sem, 0, 1),                    \
+		.size = ARRAY_SIZE(_slots),                                   \
+		.slots = _slots,                                              \
+	}
+
+/** @def NET_BUF_SPSC_DEFINE
+ *  @brief Define a buffer channel.
+ *
+ *  @param _name  Name of the channel variable.
+ *  @param _count Number of buffers the channel can hold.
+ */
+#define NET_BUF_SPSC_DEFINE(_name, _count)                                    \
+	static struct net_buf *_net_buf_spsc_##_name[(_count) + 1];           \
+	struct net_buf_spsc _name =                                           \
+		NET_BUF_SPSC_INITIALIZER(_name, _net_buf_spsc_##_name)
+
+/**
+ *  @brief Initialize a buffer channel.
+ *
+ *  @param spsc Channel to initialize.
+ *  @param slots Array of count + 1 buffer pointers.
+ *  @param count Number of buffers the channel can hold.
+ */
+void net_buf_spsc_init(struct net_buf_spsc *spsc, struct net_buf **slots,
+		       u16_t count);
+
+/**
+ *  @brief Put a buffer into a channel.
+ *
+ *  Must only be called by the producer of the channel, which can be an
+ *  ISR. The buffer is added with its fragments.
+ *
+ *  @param spsc Which channel to put the buffer to.
+ *  @param buf Buffer.
+ *
+ *  @return 0 if ok, -ENOBUFS if the channel is full.
+ */
+int net_buf_spsc_put(struct net_buf_spsc *spsc, struct net_buf *buf);
+
+/**
+ *  @brief Get a buffer from a channel.
+ *
+ *  Must only be called by the consumer of the channel.
+ *
+ *  @param spsc Which channel to take the buffer from.
+ *  @param timeout Affects the action taken should the channel be empty.
+ *         If K_NO_WAIT, then return immediately. If K_FOREVER, then wait as
+ *         long as necessary. Otherwise, wait up to the specified number of
+ *         milliseconds before timing out.
+ *
+ *  @return Buffer with its fragments or NULL if the channel is empty.
+ */
+struct net_buf *net_buf_spsc_get(struct net_buf_spsc *spsc, s32_t timeout);
+
 /**
  *  @brief Decrements the reference count of a buffer.
  *
@@ -185,6 +185,37 @@ struct coap_resource {
 	int age;
 };
 
+/**
+ * @brief Node of a CoAP resource tree, one per distinct path prefix.
+ */
+struct coap_resource_node {
+	/** Path segment, points to the path of a resource */
+	const char *segment;
+	/** Index of the parent node, COAP_RESOURCE_NODE_NONE for the root */
+	u16_t parent;
+	/** Index of the resource with this path, or COAP_RESOURCE_NODE_NONE */
+	u16_t resource;
+	/** Length of the path segment */
+	u8_t len;
+};
+
+#define COAP_RESOURCE_NODE_NONE 0xffff
+
+/**
+ * @brief Resource tree for dispatching requests by their URI path.
+ *
+ * The nodes are kept in a hash table keyed by the parent node and the
+ * path segment, so finding the resource of a request takes one lookup
+ * per Uri-Path option, independent of the number of resources.
+ */
+struct coap_resource_tree {
+	struct coap_resource *resources;
+	struct coap_resource_node *nodes;
+	u16_t node_count;
+	/** Index of the resource with an empty path */
+	u16_t root;
+};
+
 /**
  * @brief Represents a remote device that is observing a local resource.
  */
@@ -195,6 +226,15 @@ struct coap_observer {
 	u8_t tkl;
 };
 
+/**
+ * @brief Location of an option in a parsed CoAP packet.
+ */
+struct coap_option_index {
+	u16_t delta; /* Option number */
+	u16_t offset; /* Offset of the value from the start of the header */
+	u16_t len; /* Length of the value */
+};
+
 /**
  * @brief Representation of a CoAP packet.
  */
@@ -205,6 +245,12 @@ struct coap_packet {
 	u8_t hdr_len; /* CoAP header length */
 	u8_t opt_len; /* Total options length (delta + len + value) */
 	u16_t last_delta; /* Used only when preparing CoAP packet */
+#if defined(CONFIG_COAP_OPTION_INDEX_SIZE) && CONFIG_COAP_OPTION_INDEX_SIZE > 0
+	/* Options found by coap_packet_parse(), used if opt_indexed is set */
+	struct coap_option_index opt_index[CONFIG_COAP_OPTION_INDEX_SIZE];
+	u8_t opt_count;
+	bool opt_indexed;
+#endif
 };
 
 /**
@@ -224,6 +270,13 @@ struct coap_pending {
 	struct sockaddr addr;
 	s32_t timeout;
 	u16_t id;
+
+	/* Used by the transmission layer, see coap_transmission.h */
+	sys_snode_t node;
+	struct coap_pending *id_next;
+	s64_t deadline;
+	u16_t heap_index;
+	u8_t retries;
 };
 
 /**
@@ -237,6 +290,10 @@ struct coap_reply {
 	u8_t token[8];
 	u16_t id;
 	u8_t tkl;
+
+	/* Used by the transmission layer, see coap_transmission.h */
+	struct coap_reply *id_next;
+	struct coap_reply *token_next;
 };
 
 /**
@@ -491,6 +548,48 @@ int coap_handle_request(struct coap_packet *cpkt,
 			struct coap_option *options,
 			u8_t opt_num);
 
+/**
+ * @brief Build the resource tree of a resource array.
+ *
+ * The tree refers to the paths of the resources, they must not change
+ * while the tree is used. When several resources have the same path,
+ * the first one is used, like coap_handle_request() does.
+ *
+ * @param tree Resource tree to initialize
+ * @param resources Array of known resources, terminated by an entry
+ * without path
+ * @param nodes Storage for the nodes of the tree. Every distinct path
+ * prefix takes a node; lookups are fastest when there are about twice
+ * as many nodes as needed.
+ * @param node_count Number of nodes
+ *
+ * @return 0 in case of success, -ENOMEM if there are not enough nodes,
+ * -EINVAL if a path segment is too long.
+ */
+int coap_resource_tree_init(struct coap_resource_tree *tree,
+			    struct coap_resource *resources,
+			    struct coap_resource_node *nodes,
+			    u16_t node_count);
+
+/**
+ * @brief When a request is received, call the appropriate methods of
+ * the matching resource found from a resource tree.
+ *
+ * This behaves like coap_handle_request(), but the cost does not depend
+ * on the number of resources.
+ *
+ * @param cpkt Packet received
+ * @param tree Resource tree built with coap_resource_tree_init()
+ * @param options Parsed options from coap_packet_parse()
+ * @param opt_num Number of options
+ *
+ * @return 0 in case of success or negative in case of error.
+ */
+int coap_handle_request_tree(struct coap_packet *cpkt,
+			     struct coap_resource_tree *tree,
+			     struct coap_option *options,
+			     u8_t opt_num);
+
 /**
  * @brief Indicates that this resource was updated and that the @a
  * notify callback should be called for every registered observer.
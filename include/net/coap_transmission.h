@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ *
+ * @brief CoAP transmission layer
+ *
+ * Retransmits confirmable messages until they are acknowledged, and
+ * matches the received responses to the pending requests and replies.
+ */
+
+#ifndef __COAP_TRANSMISSION_H__
+#define __COAP_TRANSMISSION_H__
+
+#include <kernel.h>
+#include <net/coap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup coap COAP Library
+ * @{
+ */
+
+#define COAP_TRANSMISSION_HASH_SIZE CONFIG_COAP_TRANSMISSION_HASH_SIZE
+
+struct coap_transmission;
+
+/**
+ * @typedef coap_transmission_send_t
+ * @brief Called to put a message of the transmission layer on the wire.
+ *
+ * The message may be acknowledged while it is being sent, so the
+ * callback gets its own reference of the packet instead of the pending.
+ * It takes over the reference when it succeeds, like net_app_send_pkt()
+ * does.
+ *
+ * @param tx Transmission layer
+ * @param pkt Packet of the message
+ * @param addr Address of the peer
+ *
+ * @return 0 in case of success or negative in case of error.
+ */
+typedef int (*coap_transmission_send_t)(struct coap_transmission *tx,
+					struct net_pkt *pkt,
+					const struct sockaddr *addr);
+
+/**
+ * @typedef coap_transmission_timeout_t
+ * @brief Called when a message was not acknowledged after the last
+ * retransmission.
+ *
+ * The pending has already been removed from the transmission layer,
+ * the callback must release it with coap_pending_clear() or
+ * coap_transmission_cancel().
+ */
+typedef void (*coap_transmission_timeout_t)(struct coap_transmission *tx,
+					    struct coap_pending *pending);
+
+/**
+ * @brief Transmission layer for the confirmable messages of an endpoint.
+ *
+ * The retransmission deadlines are kept in a min-heap served by a single
+ * delayed work item, and the pending requests and the replies are hashed
+ * by message ID and token, so neither the timers nor the received
+ * responses need to scan all the outstanding messages.
+ *
+ * At most CONFIG_COAP_NSTART messages are outstanding to a peer at a time,
+ * the others are queued until one of them is acknowledged or times out.
+ * Retransmissions use the randomized exponential back-off of RFC 7252,
+ * section 4.2.
+ */
+struct coap_transmission {
+	struct coap_pending *pendings;
+	struct coap_pending **heap;
+	u16_t pending_count;
+	u16_t heap_count;
+
+	struct coap_pending *id_hash[COAP_TRANSMISSION_HASH_SIZE];
+	struct coap_reply *reply_id_hash[COAP_TRANSMISSION_HASH_SIZE];
+	struct coap_reply *reply_token_hash[COAP_TRANSMISSION_HASH_SIZE];
+
+	/* Messages waiting for an NSTART slot */
+	sys_slist_t queue;
+
+	struct k_delayed_work timer;
+	/* Deadline the timer is armed for, 0 if it is not armed */
+	s64_t timer_deadline;
+
+	coap_transmission_send_t send;
+	coap_transmission_timeout_t timeout;
+	void *user_data;
+};
+
+/**
+ * @brief Initialize a transmission layer.
+ *
+ * @param tx Transmission layer to initialize
+ * @param pendings Array of pending requests used with the layer
+ * @param heap Storage for the retransmission heap, with as many entries
+ * as @a pendings
+ * @param len Number of pending requests
+ * @param send Called to send and retransmit the messages
+ * @param timeout Called when a message is not acknowledged, may be NULL
+ */
+void coap_transmission_init(struct coap_transmission *tx,
+			    struct coap_pending *pendings,
+			    struct coap_pending **heap, u16_t len,
+			    coap_transmission_send_t send,
+			    coap_transmission_timeout_t timeout);
+
+/**
+ * @brief Returns the next pending struct of the layer that is not used.
+ *
+ * @param tx Transmission layer
+ *
+ * @return pointer to a free #coap_pending structure, NULL in case
+ * none could be found.
+ */
+static inline struct coap_pending *coap_transmission_next_unused(
+	struct coap_transmission *tx)
+{
+	return coap_pending_next_unused(tx->pendings, tx->pending_count);
+}
+
+/**
+ * @brief Send a confirmable message and retransmit it until it is
+ * acknowledged.
+ *
+ * The pending must have been initialized with coap_pending_init(). The
+ * message is queued when CONFIG_COAP_NSTART messages are already
+ * outstanding to pending->addr.
+ *
+ * @param tx Transmission layer
+ * @param pending Pending request of the message
+ *
+ * @return 0 in case of success or negative in case of error. On error
+ * the pending is not part of the layer anymore.
+ */
+int coap_transmission_send(struct coap_transmission *tx,
+			   struct coap_pending *pending);
+
+/**
+ * @brief Stop retransmitting a message and release its pending struct.
+ *
+ * It is safe to call this for a pending that was already removed from
+ * the layer.
+ *
+ * @param tx Transmission layer
+ * @param pending Pending request to cancel
+ */
+void coap_transmission_cancel(struct coap_transmission *tx,
+			      struct coap_pending *pending);
+
+/**
+ * @brief Find the pending request acknowledged by a response and
+ * release it, see coap_pending_received().
+ *
+ * @param tx Transmission layer
+ * @param response Response received
+ *
+ * @return pointer to the released #coap_pending structure, NULL in
+ * case none was found.
+ */
+struct coap_pending *coap_transmission_pending_received(
+	struct coap_transmission *tx,
+	const struct coap_packet *response);
+
+/**
+ * @brief Start matching responses to a reply initialized with
+ * coap_reply_init().
+ *
+ * @param tx Transmission layer
+ * @param reply Reply to add
+ */
+void coap_transmission_reply_add(struct coap_transmission *tx,
+				 struct coap_reply *reply);
+
+/**
+ * @brief Stop matching responses to a reply, and clear it.
+ *
+ * It is safe to call this for a reply that is not part of the layer.
+ *
+ * @param tx Transmission layer
+ * @param reply Reply to remove
+ */
+void coap_transmission_reply_remove(struct coap_transmission *tx,
+				    struct coap_reply *reply);
+
+/**
+ * @brief Call the reply handler matching a response, see
+ * coap_response_received().
+ *
+ * @param tx Transmission layer
+ * @param response Response received
+ * @param from Address from which the response was received
+ *
+ * @return Pointer to the reply matching the response, NULL in case
+ * none was found.
+ */
+struct coap_reply *coap_transmission_response_received(
+	struct coap_transmission *tx,
+	const struct coap_packet *response,
+	const struct sockaddr *from);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __COAP_TRANSMISSION_H__ */
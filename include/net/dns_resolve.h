@@ -118,6 +118,56 @@ typedef void (*dns_resolve_cb_t)(enum dns_resolve_status status,
 				 struct dns_addrinfo *info,
 				 void *user_data);
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+/**
+ * Answer to a DNS query kept in the cache of a DNS context.
+ */
+struct dns_cache_entry {
+	/** Addresses of the answer, none for a negative answer */
+	struct sockaddr addr[CONFIG_DNS_RESOLVER_CACHE_ADDRS];
+
+	/** Uptime in ms when the answer expires, 0 if the entry is unused */
+	s64_t expires;
+
+	/** When the entry was last used, to evict the least recently used */
+	u32_t used;
+
+	/** DNS_EAI_NODATA or DNS_EAI_NONAME for a negative answer */
+	s8_t status;
+
+	/** Number of addresses */
+	u8_t addr_count;
+
+	/** Query type */
+	u8_t query_type;
+
+	/** Name that was resolved */
+	char name[CONFIG_DNS_RESOLVER_CACHE_NAME_LEN + 1];
+};
+
+/**
+ * Cache of the answers received by a DNS context.
+ */
+struct dns_cache {
+	struct dns_cache_entry entries[CONFIG_DNS_RESOLVER_CACHE_ENTRIES];
+
+	/** Incremented each time an entry is used */
+	u32_t clock;
+
+	/** Number of names resolved from the cache */
+	u32_t hits;
+
+	/** Number of names that were not cached */
+	u32_t misses;
+
+	/** Number of misses resolved by a query already in progress */
+	u32_t shared;
+
+	/** Number of entries evicted before they expired */
+	u32_t evictions;
+};
+#endif /* CONFIG_DNS_RESOLVER_CACHE */
+
 /**
  * DNS resolve context structure.
  */
@@ -166,8 +216,19 @@ struct dns_resolve_context {
 
 		/** DNS id of this query */
 		u16_t id;
+
+		/** DNS id of the query sent to the servers. Differs from
+		 * the id when the same name was already being resolved, the
+		 * response to that query is then used for both.
+		 */
+		u16_t wait_id;
 	} queries[CONFIG_DNS_NUM_CONCUR_QUERIES];
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	/** Answers received by the context */
+	struct dns_cache cache;
+#endif
+
 	/** Is this context in use */
 	bool is_used;
 };
@@ -238,6 +299,10 @@ int dns_resolve_cancel(struct dns_resolve_context *ctx,
  * We might send the query to multiple servers (if there are more than one
  * server configured), but we only use the result of the first received
  * response.
+ * If the same name is already being resolved, no new query is sent and
+ * the response to the first one is also passed to this callback. With
+ * CONFIG_DNS_RESOLVER_CACHE, names resolved recently are answered from
+ * the cache, and the callback is called before this function returns.
  *
  * @param ctx DNS context
  * @param query What the caller wants to resolve.
@@ -263,6 +328,19 @@ int dns_resolve_name(struct dns_resolve_context *ctx,
 		     void *user_data,
 		     s32_t timeout);
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+/**
+ * @brief Forget the cached answers of a DNS context.
+ *
+ * @details The answers are kept until their TTL expires, this can be
+ * called when they may not be valid anymore, for example when the
+ * network interface is connected to another network.
+ *
+ * @param ctx DNS context
+ */
+void dns_resolve_cache_flush(struct dns_resolve_context *ctx);
+#endif
+
 /**
  * @brief Get default DNS context.
  *
@@ -71,6 +71,12 @@ enum ethernet_hw_caps {
 
 	/** Changing duplex (half/full) supported */
 	ETHERNET_DUPLEX_SET		= BIT(7),
+
+	/** TCP segmentation offload supported. The driver is given TCP
+	 * packets that are larger than the MTU and splits them into
+	 * frames of net_pkt_gso_size() bytes of payload.
+	 */
+	ETHERNET_HW_GSO			= BIT(8),
 };
 
 enum ethernet_config_type {
@@ -120,6 +126,14 @@ struct ethernet_api {
 			  enum ethernet_config_type type,
 			  const struct ethernet_config *config);
 
+	/** Send several packets in one call. This is optional, if it is
+	 * not set the packets are given to iface_api.send() one by one.
+	 * Returns the number of packets sent, the driver releases those
+	 * like iface_api.send() does. The rest are released by the caller.
+	 */
+	int (*send_batch)(struct net_if *iface, struct net_pkt **pkts,
+			  int count);
+
 #if defined(CONFIG_NET_VLAN)
 	/** The IP stack will call this function when a VLAN tag is enabled
 	 * or disabled. If enable is set to true, then the VLAN tag was added,
@@ -282,6 +296,40 @@ enum ethernet_hw_caps net_eth_get_hw_capabilities(struct net_if *iface)
 	return eth->get_capabilities(net_if_get_device(iface));
 }
 
+/**
+ * @brief Send several packets to the ethernet driver in one call.
+ *
+ * Uses the send_batch() function of the driver if it has one, otherwise
+ * the packets are sent one by one. The packets must have the link layer
+ * header already set. All the packets are consumed.
+ *
+ * @param iface Network interface
+ * @param pkts Packets to send
+ * @param count Number of packets
+ *
+ * @return Number of packets sent, <0 if none could be sent
+ */
+int net_eth_send_batch(struct net_if *iface, struct net_pkt **pkts,
+		       int count);
+
+#if defined(CONFIG_NET_L2_ETHERNET_GSO)
+/**
+ * @brief Send a TCP packet that is larger than the MTU.
+ *
+ * The packet is given as it is to drivers that support
+ * ETHERNET_HW_GSO. For other drivers it is split here into frames
+ * of net_pkt_gso_size() bytes of payload, which are then sent with
+ * net_eth_send_batch(). This is called instead of the send() function
+ * of the driver and follows its conventions.
+ *
+ * @param iface Network interface
+ * @param pkt Network packet
+ *
+ * @return 0 if ok, <0 if error
+ */
+int net_eth_send_gso(struct net_if *iface, struct net_pkt *pkt);
+#endif /* CONFIG_NET_L2_ETHERNET_GSO */
+
 #if defined(CONFIG_NET_VLAN)
 /**
  * @brief Add VLAN tag to the interface.
@@ -124,6 +124,27 @@ typedef enum http_verdict (*http_url_cb_t)(struct http_ctx *ctx,
 					   enum http_connection_type type,
 					   const struct sockaddr *dst);
 
+/* Radix tree node, every registered URL ends at one of the nodes */
+struct http_url_node {
+	/** Label of the edge leading to this node, points to a root URL */
+	const char *label;
+
+	/** Length of the label */
+	u16_t label_len;
+
+	/** Index of the first child node, 0 if there is none */
+	u8_t child;
+
+	/** Index of the next sibling node, 0 if there is none */
+	u8_t sibling;
+
+	/** Index + 1 of the first URL ending at this node, 0 if none */
+	u8_t url;
+};
+
+/* Each added URL creates at most two nodes, plus the root node */
+#define HTTP_URL_NODES (2 * CONFIG_HTTP_SERVER_NUM_URLS + 1)
+
 /* Collection of URLs that this server will handle */
 struct http_server_urls {
 	/* First item is the default handler and it is always there.
@@ -134,6 +155,15 @@ struct http_server_urls {
 	http_url_cb_t default_cb;
 
 	struct http_root_url urls[CONFIG_HTTP_SERVER_NUM_URLS];
+
+	/** Radix tree of the URLs, node 0 is the root */
+	struct http_url_node nodes[HTTP_URL_NODES];
+
+	/** Index + 1 of the next URL ending at the same node, 0 if none */
+	u8_t url_next[CONFIG_HTTP_SERVER_NUM_URLS];
+
+	/** Number of nodes used in the tree */
+	u8_t node_count;
 };
 
 /**
@@ -212,6 +242,36 @@ typedef void (*http_close_cb_t)(struct http_ctx *ctx,
 				int status,
 				void *user_data);
 
+/* Is there more data to come */
+enum http_final_call {
+	HTTP_DATA_MORE = 0,
+	HTTP_DATA_FINAL = 1,
+};
+
+/**
+ * @typedef http_body_cb_t
+ * @brief Request body callback.
+ *
+ * @details The body callback is called for every piece of the request body
+ * as it is received, after the connect callback has accepted the request.
+ * When the request is complete, the callback is called one more time with
+ * no data and final_data set to HTTP_DATA_FINAL. The data is only valid
+ * during the call.
+ *
+ * @param ctx The context to use.
+ * @param data Piece of the request body, NULL for the final call.
+ * @param len Length of the data.
+ * @param final_data Is this the last call for the request.
+ * @param dst Remote socket address from where the request is received.
+ * @param user_data The user data given in init call.
+ */
+typedef void (*http_body_cb_t)(struct http_ctx *ctx,
+			       const u8_t *data,
+			       size_t len,
+			       enum http_final_call final_data,
+			       const struct sockaddr *dst,
+			       void *user_data);
+
 /** Websocket and HTTP callbacks */
 struct http_cb {
 	/** Function that is called when a connection is established.
@@ -229,15 +289,13 @@ struct http_cb {
 	/** Function that is called when connection is shutdown.
 	 */
 	http_close_cb_t close;
-};
 
-#if defined(CONFIG_HTTP_CLIENT)
-/* Is there more data to come */
-enum http_final_call {
-	HTTP_DATA_MORE = 0,
-	HTTP_DATA_FINAL = 1,
+	/** Function that is called when request body data is received.
+	 */
+	http_body_cb_t body;
 };
 
+#if defined(CONFIG_HTTP_CLIENT)
 /* Some generic configuration options, these can be overridden if needed. */
 #if !defined(HTTP_STATUS_STR_SIZE)
 #define HTTP_STATUS_STR_SIZE	32
@@ -427,6 +485,12 @@ struct http_ctx {
 
 		/** Number of header field elements */
 		u16_t field_values_ctr;
+
+		/** Is the body of the current request being received */
+		u8_t in_body : 1;
+
+		/** Was the current request accepted by an URL handler */
+		u8_t dispatched : 1;
 #endif /* CONFIG_HTTP_SERVER */
 
 		/** HTTP Request URL */
@@ -509,8 +573,10 @@ struct http_ctx {
  * listened. The parameter can be left NULL in which case a listener to port 80
  * using IPv4 and IPv6 is created. Note that if IPv4 or IPv6 is disabled, then
  * the corresponding disabled service listener is not created.
- * @param request_buf Caller-supplied buffer where the HTTP request will be
- * stored
+ * @param request_buf Caller-supplied buffer where the HTTP request line and
+ * header fields will be stored. The request body is not stored but passed
+ * to the body callback, see http_server_set_body_cb(). A request whose
+ * header does not fit in the buffer is answered with 400 Bad Request.
  * @param request_buf_len Length of the caller-supplied buffer.
  * @param server_banner Print information about started service. This is only
  * printed if HTTP debugging is activated. The parameter can be set to NULL if
@@ -582,9 +648,31 @@ int http_server_enable(struct http_ctx *ctx);
  */
 int http_server_disable(struct http_ctx *ctx);
 
+/**
+ * @brief Set the callback that receives the request bodies.
+ *
+ * @detail The body is streamed to the callback piece by piece as it is
+ * received, so it does not need to fit in the request buffer. If no body
+ * callback is set, the request body is discarded. With
+ * CONFIG_HTTP_SERVER_KEEPALIVE the connection then stays open for the next
+ * request, which may already be pipelined behind the current one. The
+ * responses must be sent in request order, and the header fields and URL
+ * of a request are only valid until its final body callback returns.
+ *
+ * @param ctx Http context.
+ * @param body_cb Body callback.
+ *
+ * @return 0 if ok, <0 if error.
+ */
+int http_server_set_body_cb(struct http_ctx *ctx, http_body_cb_t body_cb);
+
 /**
  * @brief Add an URL to a list of URLs that are tied to certain webcontext.
  *
+ * @detail The URLs are kept in a radix tree. A request is served by the
+ * longest registered URL that is a prefix of the request URL up to a path
+ * separator, see http_url_find().
+ *
  * @param urls URL struct that will contain all the URLs the user wants to
  * register.
  * @param url URL string.
@@ -693,6 +781,14 @@ static inline int http_server_disable(struct http_ctx *ctx)
 	return -ENOTSUP;
 }
 
+static inline int http_server_set_body_cb(struct http_ctx *ctx,
+					  http_body_cb_t body_cb)
+{
+	ARG_UNUSED(ctx);
+	ARG_UNUSED(body_cb);
+	return -ENOTSUP;
+}
+
 static inline
 struct http_root_url *http_server_add_url(struct http_server_urls *urls,
 					  const char *url, u8_t flags)
@@ -1028,6 +1124,8 @@ int http_add_header_field(struct http_ctx *ctx, const char *name,
  * @brief Find a handler function for a given URL.
  *
  * @details This is internal function, do not call this from application.
+ * The URL tree is walked along the request URL and the deepest matching
+ * URL with the given flags is returned.
  *
  * @param ctx Http context.
  * @param flags Tells if the URL is either HTTP or websocket URL
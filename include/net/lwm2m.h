@@ -10,6 +10,7 @@
 
 #include <net/net_app.h>
 #include <net/coap.h>
+#include <net/coap_transmission.h>
 
 /* LWM2M Objects defined by OMA */
 
@@ -56,7 +57,8 @@ struct lwm2m_ctx {
 	/** Private CoAP and networking structures */
 	struct coap_pending pendings[CONFIG_LWM2M_ENGINE_MAX_PENDING];
 	struct coap_reply replies[CONFIG_LWM2M_ENGINE_MAX_REPLIES];
-	struct k_delayed_work retransmit_work;
+	struct coap_pending *pending_heap[CONFIG_LWM2M_ENGINE_MAX_PENDING];
+	struct coap_transmission transmission;
 
 #if defined(CONFIG_NET_APP_DTLS)
 	/** Pre-Shared Key  Information*/
@@ -198,6 +200,84 @@ int lwm2m_engine_get_bool(char *path, bool *value);
 int lwm2m_engine_get_float32(char *pathstr, float32_value_t *buf);
 int lwm2m_engine_get_float64(char *pathstr, float64_value_t *buf);
 
+/*
+ * Resource handles: a path resolved once with lwm2m_engine_res_handle_get()
+ * can then be read and written without parsing the path and looking up
+ * the object instance and resource again.  A handle becomes invalid when
+ * its object instance is deleted, even if it is created again, or when
+ * its object is unregistered.  The accessors return -ENOENT then.
+ */
+struct lwm2m_engine_obj_inst;
+struct lwm2m_engine_obj_field;
+struct lwm2m_engine_res_inst;
+
+struct lwm2m_engine_res_handle {
+	struct lwm2m_engine_obj_inst *obj_inst;
+	struct lwm2m_engine_obj_field *obj_field;
+	struct lwm2m_engine_res_inst *res;
+	u32_t obj_inst_seq;
+	u16_t obj_id;
+	u16_t obj_inst_id;
+	u16_t res_id;
+};
+
+int lwm2m_engine_res_handle_get(char *pathstr,
+				struct lwm2m_engine_res_handle *handle);
+
+int lwm2m_engine_res_handle_set_opaque(struct lwm2m_engine_res_handle *handle,
+				       char *data_ptr, u16_t data_len);
+int lwm2m_engine_res_handle_set_string(struct lwm2m_engine_res_handle *handle,
+				       char *data_ptr);
+int lwm2m_engine_res_handle_set_u8(struct lwm2m_engine_res_handle *handle,
+				   u8_t value);
+int lwm2m_engine_res_handle_set_u16(struct lwm2m_engine_res_handle *handle,
+				    u16_t value);
+int lwm2m_engine_res_handle_set_u32(struct lwm2m_engine_res_handle *handle,
+				    u32_t value);
+int lwm2m_engine_res_handle_set_u64(struct lwm2m_engine_res_handle *handle,
+				    u64_t value);
+int lwm2m_engine_res_handle_set_s8(struct lwm2m_engine_res_handle *handle,
+				   s8_t value);
+int lwm2m_engine_res_handle_set_s16(struct lwm2m_engine_res_handle *handle,
+				    s16_t value);
+int lwm2m_engine_res_handle_set_s32(struct lwm2m_engine_res_handle *handle,
+				    s32_t value);
+int lwm2m_engine_res_handle_set_s64(struct lwm2m_engine_res_handle *handle,
+				    s64_t value);
+int lwm2m_engine_res_handle_set_bool(struct lwm2m_engine_res_handle *handle,
+				     bool value);
+int lwm2m_engine_res_handle_set_float32(struct lwm2m_engine_res_handle *handle,
+					float32_value_t *value);
+int lwm2m_engine_res_handle_set_float64(struct lwm2m_engine_res_handle *handle,
+					float64_value_t *value);
+
+int lwm2m_engine_res_handle_get_opaque(struct lwm2m_engine_res_handle *handle,
+				       void *buf, u16_t buflen);
+int lwm2m_engine_res_handle_get_string(struct lwm2m_engine_res_handle *handle,
+				       void *buf, u16_t buflen);
+int lwm2m_engine_res_handle_get_u8(struct lwm2m_engine_res_handle *handle,
+				   u8_t *value);
+int lwm2m_engine_res_handle_get_u16(struct lwm2m_engine_res_handle *handle,
+				    u16_t *value);
+int lwm2m_engine_res_handle_get_u32(struct lwm2m_engine_res_handle *handle,
+				    u32_t *value);
+int lwm2m_engine_res_handle_get_u64(struct lwm2m_engine_res_handle *handle,
+				    u64_t *value);
+int lwm2m_engine_res_handle_get_s8(struct lwm2m_engine_res_handle *handle,
+				   s8_t *value);
+int lwm2m_engine_res_handle_get_s16(struct lwm2m_engine_res_handle *handle,
+				    s16_t *value);
+int lwm2m_engine_res_handle_get_s32(struct lwm2m_engine_res_handle *handle,
+				    s32_t *value);
+int lwm2m_engine_res_handle_get_s64(struct lwm2m_engine_res_handle *handle,
+				    s64_t *value);
+int lwm2m_engine_res_handle_get_bool(struct lwm2m_engine_res_handle *handle,
+				     bool *value);
+int lwm2m_engine_res_handle_get_float32(struct lwm2m_engine_res_handle *handle,
+					float32_value_t *buf);
+int lwm2m_engine_res_handle_get_float64(struct lwm2m_engine_res_handle *handle,
+					float64_value_t *buf);
+
 int lwm2m_engine_register_read_callback(char *path,
 					lwm2m_engine_get_data_cb_t cb);
 int lwm2m_engine_register_pre_write_callback(char *path,
@@ -36,6 +36,59 @@ enum mqtt_app {
 	MQTT_APP_SERVER
 };
 
+/**
+ * MQTT publish msg waiting for its acknowledgment, see
+ * CONFIG_MQTT_INFLIGHT_WINDOW
+ */
+struct mqtt_inflight {
+	/** Time the msg was sent, in ms of uptime */
+	u32_t sent;
+	/** Packet Identifier of the msg */
+	u16_t pkt_id;
+	/** QoS of the msg, MQTT_QoS0 if the entry is not used */
+	u8_t qos;
+	/** 1 once a MQTT PUBREC msg was received for a QoS2 msg */
+	u8_t received:1;
+	/** 1 if the msg was sent again, its RTT is not sampled then */
+	u8_t dup:1;
+	/** 1 while the msg waits in the batch, see CONFIG_MQTT_TX_BATCH */
+	u8_t queued:1;
+};
+
+/**
+ * MQTT connection statistics, see CONFIG_MQTT_STATS
+ *
+ * The counters are reset by mqtt_connect(). The throughput of the
+ * connection is tx_bytes or rx_bytes divided by the time elapsed
+ * since connected_at.
+ */
+struct mqtt_stats {
+	/** Time of the last mqtt_connect() call, in ms of uptime */
+	s64_t connected_at;
+	/** Number of MQTT msgs sent */
+	u32_t tx_msgs;
+	/** Number of bytes sent */
+	u32_t tx_bytes;
+	/** Number of packets passed to the network, lower than tx_msgs when
+	 * MQTT PUBLISH msgs are batched
+	 */
+	u32_t tx_sends;
+	/** Number of MQTT msgs that could not be sent */
+	u32_t tx_errors;
+	/** Number of MQTT msgs received */
+	u32_t rx_msgs;
+	/** Number of bytes received */
+	u32_t rx_bytes;
+	/** Round trip time of the acknowledged MQTT PUBLISH msgs, in ms.
+	 * For QoS2 msgs this is the time until the MQTT PUBCOMP msg.
+	 */
+	u32_t rtt_min;
+	u32_t rtt_max;
+	u32_t rtt_sum;
+	/** Number of RTT samples, the mean RTT is rtt_sum / rtt_count */
+	u32_t rtt_count;
+};
+
 /**
  * MQTT context structure
  *
@@ -173,15 +226,73 @@ struct mqtt_ctx {
 	 * validation stage. This callback may be NULL.
 	 * The pkt_type variable may be set to MQTT_INVALID, if the parsing
 	 * stage is aborted before determining the MQTT msg packet type.
+	 * If the received stream cannot be decoded anymore, a MQTT
+	 * DISCONNECT msg is sent and the rest of the stream is discarded
+	 * until the next mqtt_connect() call.
 	 *
 	 * @param [in] ctx	MQTT context
 	 * @param [in] pkt_type	MQTT Packet type
 	 */
 	void (*malformed)(struct mqtt_ctx *ctx, u16_t pkt_type);
 
+	/** Callback executed for each part of the payload of a received MQTT
+	 * PUBLISH msg, as soon as it is received. This callback may be NULL.
+	 *
+	 * If NULL, the whole MQTT PUBLISH msg must fit in
+	 * CONFIG_MQTT_MSG_MAX_SIZE bytes and it is passed to #publish_rx.
+	 * Otherwise only the topic and the Packet Identifier must fit, and
+	 * the payload is passed to this callback from the network buffers,
+	 * without copying it. Once the whole payload is received,
+	 * #publish_rx is called with the msg and msg_len fields set to 0.
+	 * If this callback returns a value other than 0, the rest of the
+	 * payload is dropped and #publish_rx is not called.
+	 *
+	 * @param [in] ctx MQTT context
+	 * @param [in] msg Publish message, without the payload
+	 * @param [in] offset Offset of data in the payload
+	 * @param [in] data Part of the payload, only valid during the call
+	 * @param [in] len Number of bytes in data
+	 * @param [in] total Length of the payload
+	 */
+	int (*publish_rx_payload)(struct mqtt_ctx *ctx,
+				  struct mqtt_publish_msg *msg, u32_t offset,
+				  const u8_t *data, u16_t len, u32_t total);
+
 	/* Internal use only */
 	int (*rcv)(struct mqtt_ctx *ctx, struct net_pkt *);
 
+	/* Internal use only, state of the incremental msg decoder */
+	struct net_buf *rx_buf;
+	struct mqtt_publish_msg rx_publish;
+	u32_t rx_remaining;
+	u32_t rx_offset;
+	u32_t rx_total;
+	u16_t rx_hdr_len;
+	u8_t rx_hdr_byte;
+	u8_t rx_state;
+	u8_t rx_type;
+	u8_t rx_rlen_shift;
+
+#if defined(CONFIG_MQTT_INFLIGHT_WINDOW) && CONFIG_MQTT_INFLIGHT_WINDOW > 0
+	/* Internal use only, MQTT PUBLISH msgs waiting for an acknowledgment */
+	struct mqtt_inflight inflight[CONFIG_MQTT_INFLIGHT_WINDOW];
+	u8_t inflight_count;
+#endif
+
+#if defined(CONFIG_MQTT_TX_BATCH)
+	/* Internal use only, MQTT PUBLISH msgs waiting to be sent together */
+	struct k_mutex tx_batch_lock;
+	struct k_delayed_work tx_batch_work;
+	u16_t tx_batch_len;
+	u16_t tx_batch_msgs;
+	u8_t tx_batch[CONFIG_MQTT_TX_BATCH_SIZE];
+#endif
+
+#if defined(CONFIG_MQTT_STATS)
+	/** Connection statistics, read only */
+	struct mqtt_stats stats;
+#endif
+
 	/** Application type, see: enum mqtt_app */
 	u8_t app_type;
 
@@ -300,6 +411,14 @@ int mqtt_tx_pubrel(struct mqtt_ctx *ctx, u16_t id);
 /**
  * Sends the MQTT PUBLISH message
  *
+ * With CONFIG_MQTT_INFLIGHT_WINDOW, at most that many QoS1 and QoS2 msgs
+ * may wait for their acknowledgment, a msg sent again with the dup flag
+ * set does not take another entry. With CONFIG_MQTT_TX_BATCH, the msg may
+ * be queued and sent later in the same packet as the next MQTT PUBLISH
+ * msgs, see mqtt_tx_flush(). If the queued msgs cannot be sent when the
+ * batch is full, they are dropped and counted in tx_errors, and the msg
+ * is queued in the emptied batch.
+ *
  * @param [in] ctx MQTT context structure
  * @param [in] msg MQTT PUBLISH msg
  *
@@ -307,9 +426,28 @@ int mqtt_tx_pubrel(struct mqtt_ctx *ctx, u16_t id);
  * @retval -EINVAL
  * @retval -ENOMEM
  * @retval -EIO
+ * @retval -EAGAIN if the in-flight window is full
  */
 int mqtt_tx_publish(struct mqtt_ctx *ctx, struct mqtt_publish_msg *msg);
 
+/**
+ * Sends the MQTT PUBLISH messages queued by mqtt_tx_publish()
+ *
+ * This is done when CONFIG_MQTT_TX_BATCH_DELAY_MS elapsed since the
+ * first msg was queued, when the queue is full and before any other MQTT
+ * msg is sent. The application may call it to send the msgs right away.
+ *
+ * @param [in] ctx MQTT context structure
+ *
+ * If the msgs cannot be sent, they are dropped and their entries of the
+ * in-flight window are released.
+ *
+ * @retval 0 on success
+ * @retval -ENOMEM
+ * @retval -EIO
+ */
+int mqtt_tx_flush(struct mqtt_ctx *ctx);
+
 /**
  * Sends the MQTT PINGREQ message
  *
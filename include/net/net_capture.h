@@ -0,0 +1,118 @@
+/** @file
+ * @brief Network packet capture
+ *
+ * Records the packets of selected network interfaces in pcapng format.
+ */
+
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __NET_CAPTURE_H
+#define __NET_CAPTURE_H
+
+#include <zephyr/types.h>
+#include <net/net_ip.h>
+#include <net/net_if.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Network packet capture library
+ * @defgroup net_capture Network Packet Capture Library
+ * @ingroup networking
+ * @{
+ */
+
+/**
+ * @brief Capture filter.
+ *
+ * A packet is captured if it matches all the fields that are set.
+ */
+struct net_capture_filter {
+	/** Address family, AF_INET or AF_INET6, 0 for any */
+	sa_family_t family;
+
+	/** IP protocol, for example IPPROTO_UDP, 0 for any */
+	u8_t proto;
+
+	/** UDP or TCP source or destination port, 0 for any */
+	u16_t port;
+};
+
+/**
+ * @brief Capture counters.
+ */
+struct net_capture_stats {
+	/** Packets queued for output */
+	u32_t captured;
+
+	/** Packets that did not match the filter */
+	u32_t filtered;
+
+	/** Packets lost because the output could not keep up */
+	u32_t dropped;
+
+	/** Bytes written out, including the pcapng framing */
+	u32_t written;
+};
+
+/**
+ * @brief Start capturing the packets of a network interface.
+ *
+ * @param iface Network interface
+ *
+ * @return 0 if ok, <0 if the capture output could not be opened.
+ */
+int net_capture_enable(struct net_if *iface);
+
+/**
+ * @brief Stop capturing the packets of a network interface.
+ *
+ * @param iface Network interface
+ */
+void net_capture_disable(struct net_if *iface);
+
+/**
+ * @brief Check if the packets of a network interface are captured.
+ *
+ * @param iface Network interface
+ *
+ * @return True if capturing is enabled for the interface.
+ */
+bool net_capture_is_enabled(struct net_if *iface);
+
+/**
+ * @brief Set the capture filter.
+ *
+ * @param filter New filter, NULL captures every packet.
+ */
+void net_capture_set_filter(const struct net_capture_filter *filter);
+
+/**
+ * @brief Get the capture filter.
+ *
+ * @param filter Filled with the current filter.
+ */
+void net_capture_get_filter(struct net_capture_filter *filter);
+
+/**
+ * @brief Get the capture counters.
+ *
+ * @param stats Filled with the current counters.
+ */
+void net_capture_get_stats(struct net_capture_stats *stats);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NET_CAPTURE_H */
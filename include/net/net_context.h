@@ -253,6 +253,11 @@ struct net_context {
 	struct k_sem recv_data_wait;
 #endif /* CONFIG_NET_CONTEXT_SYNC_RECV */
 
+#if defined(CONFIG_NET_QUOTA)
+	/** Network buffers held by this context */
+	struct net_quota quota;
+#endif /* CONFIG_NET_QUOTA */
+
 	/** Network interface assigned to this context */
 	u8_t iface;
 
@@ -779,6 +784,10 @@ int net_context_update_recv_wnd(struct net_context *context,
 
 enum net_context_option {
 	NET_OPT_PRIORITY = 1,
+	/** Disable Nagle's algorithm, value is an int */
+	NET_OPT_TCP_NODELAY,
+	/** Only send full-sized segments until cleared, value is an int */
+	NET_OPT_TCP_CORK,
 };
 
 /**
@@ -240,6 +240,27 @@ static inline void net_analyze_stack(const char *name,
 #define NET_TC_COUNT 1
 #endif /* CONFIG_NET_TC_TX_COUNT && CONFIG_NET_TC_RX_COUNT */
 
+#if defined(CONFIG_NET_QUOTA)
+/**
+ * @brief Network buffer usage of a network context or interface.
+ */
+struct net_quota {
+	/** Number of TX packets that can still be sent */
+	struct k_sem tx_free;
+
+	/** Number of TX packets held */
+	atomic_t tx;
+
+	/** Number of RX buffers held */
+	atomic_t rx;
+
+	/** Number of times an allocation or a received packet was
+	 * refused because the quota was used up.
+	 */
+	atomic_t exceeded;
+};
+#endif /* CONFIG_NET_QUOTA */
+
 /**
  * @}
  */
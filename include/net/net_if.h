@@ -379,6 +379,11 @@ struct net_if {
 
 	/** Network interface instance configuration */
 	struct net_if_config config;
+
+#if defined(CONFIG_NET_QUOTA)
+	/** Network buffers held by this network interface */
+	struct net_quota quota;
+#endif /* CONFIG_NET_QUOTA */
 } __net_if_align;
 
 /**
@@ -88,6 +88,24 @@ struct net_pkt {
 	 */
 	u16_t total_pkt_len;
 #endif
+
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+	/* Cycle counter value when the packet passed the latest point
+	 * of the packet path, and the point + 1. Zero if none.
+	 */
+	u32_t latency_stamp;
+	u8_t latency_point;
+#endif
+
+#if defined(CONFIG_NET_QUOTA)
+	/* Context and interface the packet is charged to, and the number
+	 * of RX buffers charged. A TX packet has no buffers charged.
+	 */
+	struct net_context *quota_context;
+	struct net_if *quota_iface;
+	u8_t quota_context_bufs;
+	u8_t quota_iface_bufs;
+#endif
 	u16_t data_len;         /* amount of payload data that can be added */
 
 	u16_t appdatalen;
@@ -111,7 +129,10 @@ struct net_pkt {
 				 * Used only if defined(CONFIG_NET_ROUTE)
 				 */
 	u8_t family     : 4;	/* IPv4 vs IPv6 */
-	u8_t _unused    : 1;
+	u8_t chksum_ok  : 1;	/* For incoming packet: the TCP checksum
+				 * was already verified.
+				 * Used only if defined(CONFIG_NET_GRO)
+				 */
 
 	union {
 		/* IPv6 hop limit or IPv4 ttl for this network packet.
@@ -159,6 +180,13 @@ struct net_pkt {
 	 */
 	u16_t vlan_tci;
 #endif /* CONFIG_NET_VLAN */
+
+#if defined(CONFIG_NET_L2_ETHERNET_GSO)
+	/* Amount of TCP data in each segment when this packet is split
+	 * by the L2 before sending. Zero if the packet is sent as it is.
+	 */
+	u16_t gso_size;
+#endif
 	/* @endcond */
 
 	/** Reference counter */
@@ -295,6 +323,23 @@ static inline void net_pkt_set_eof(struct net_pkt *pkt, bool eof)
 }
 #endif
 
+#if defined(CONFIG_NET_GRO)
+static inline bool net_pkt_chksum_ok(struct net_pkt *pkt)
+{
+	return pkt->chksum_ok;
+}
+
+static inline void net_pkt_set_chksum_ok(struct net_pkt *pkt, bool ok)
+{
+	pkt->chksum_ok = ok;
+}
+#else
+static inline bool net_pkt_chksum_ok(struct net_pkt *pkt)
+{
+	return false;
+}
+#endif
+
 #if defined(CONFIG_NET_ROUTE)
 static inline bool net_pkt_forwarding(struct net_pkt *pkt)
 {
@@ -511,6 +556,26 @@ static inline void net_pkt_set_vlan_tci(struct net_pkt *pkt, u16_t tci)
 }
 #endif
 
+#if defined(CONFIG_NET_L2_ETHERNET_GSO)
+static inline u16_t net_pkt_gso_size(struct net_pkt *pkt)
+{
+	return pkt->gso_size;
+}
+
+static inline void net_pkt_set_gso_size(struct net_pkt *pkt, u16_t size)
+{
+	pkt->gso_size = size;
+}
+#else
+static inline u16_t net_pkt_gso_size(struct net_pkt *pkt)
+{
+	ARG_UNUSED(pkt);
+	return 0;
+}
+
+#define net_pkt_set_gso_size(...)
+#endif
+
 static inline size_t net_pkt_get_len(struct net_pkt *pkt)
 {
 	return net_buf_frags_len(pkt->frags);
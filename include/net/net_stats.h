@@ -155,6 +155,31 @@ struct net_stats_ipv6_nd {
 	net_stats_t sent;
 };
 
+struct net_stats_ipv6_nbr {
+	/** Number of neighbor cache lookups that found an entry. */
+	net_stats_t hit;
+
+	/** Number of neighbor cache lookups that found nothing. */
+	net_stats_t miss;
+
+	/** Number of stale entries evicted to make room for new ones. */
+	net_stats_t evicted;
+};
+
+struct net_stats_reass {
+	/** Number of packets reassembled. */
+	net_stats_t done;
+
+	/** Number of reassemblies cancelled because of a timeout. */
+	net_stats_t timeout;
+
+	/** Number of dropped fragments. */
+	net_stats_t drop;
+
+	/** Number of fragment bytes waiting for reassembly. */
+	net_stats_t pending;
+};
+
 struct net_stats_rpl_dis {
 	/** Number of received DIS packets. */
 	net_stats_t recv;
@@ -250,6 +275,55 @@ struct net_stats_tc {
 	} recv[NET_TC_RX_COUNT];
 };
 
+/**
+ * Number of buckets in the latency histograms. Bucket 0 counts the
+ * latencies below 1 microsecond, bucket n the latencies below 2^n
+ * microseconds and the last bucket all the longer ones.
+ */
+#define NET_STATS_LATENCY_BUCKETS 16
+
+/** Points of the packet path where packets are timestamped */
+enum net_stats_latency_point {
+	/** Packet received from the driver */
+	NET_STATS_LATENCY_RX_DRIVER,
+	/** Packet passed from L2 to the IP layer */
+	NET_STATS_LATENCY_RX_L2,
+	/** Packet entered the IP layer */
+	NET_STATS_LATENCY_RX_L3,
+	/** Packet demultiplexed to a connection */
+	NET_STATS_LATENCY_RX_CONN,
+	/** Packet queued to a socket */
+	NET_STATS_LATENCY_RX_SOCKET,
+	/** Packet read by the application */
+	NET_STATS_LATENCY_RX_APP,
+	/** Packet sent by the application */
+	NET_STATS_LATENCY_TX_APP,
+	/** Packet passed to the IP layer */
+	NET_STATS_LATENCY_TX_L3,
+	/** Packet queued to the TX thread by L2 */
+	NET_STATS_LATENCY_TX_L2,
+	/** Packet passed to the driver */
+	NET_STATS_LATENCY_TX_DRIVER,
+};
+
+#define NET_STATS_LATENCY_RX_STAGES					\
+	(NET_STATS_LATENCY_RX_APP - NET_STATS_LATENCY_RX_DRIVER)
+#define NET_STATS_LATENCY_TX_STAGES					\
+	(NET_STATS_LATENCY_TX_DRIVER - NET_STATS_LATENCY_TX_APP)
+
+struct net_stats_latency {
+	/** Histograms of the time between two consecutive RX points,
+	 * stage n ends at point n + 1.
+	 */
+	net_stats_t rx[NET_TC_RX_COUNT][NET_STATS_LATENCY_RX_STAGES]
+		[NET_STATS_LATENCY_BUCKETS];
+
+	/** Histograms of the time between two consecutive TX points,
+	 * stage n ends at point NET_STATS_LATENCY_TX_APP + n + 1.
+	 */
+	net_stats_t tx[NET_TC_TX_COUNT][NET_STATS_LATENCY_TX_STAGES]
+		[NET_STATS_LATENCY_BUCKETS];
+};
 
 struct net_stats {
 	net_stats_t processing_error;
@@ -286,6 +360,18 @@ struct net_stats {
 	struct net_stats_ipv6_nd ipv6_nd;
 #endif
 
+#if defined(CONFIG_NET_STATISTICS_IPV6_NBR)
+	struct net_stats_ipv6_nbr ipv6_nbr;
+#endif
+
+#if defined(CONFIG_NET_STATISTICS_IPV6_FRAGMENT)
+	struct net_stats_reass ipv6_reass;
+#endif
+
+#if defined(CONFIG_NET_STATISTICS_IEEE802154_FRAGMENT)
+	struct net_stats_reass ieee802154_reass;
+#endif
+
 #if defined(CONFIG_NET_STATISTICS_RPL)
 	struct net_stats_rpl rpl;
 #endif
@@ -297,6 +383,10 @@ struct net_stats {
 #if NET_TC_COUNT > 1
 	struct net_stats_tc tc;
 #endif
+
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+	struct net_stats_latency latency;
+#endif
 };
 
 struct net_stats_eth_errors {
@@ -358,6 +448,24 @@ struct net_stats_eth {
 	net_stats_t tx_restart_queue;
 };
 
+struct net_pkt;
+
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+/**
+ * @brief Timestamp a packet at a point of the packet path.
+ *
+ * If the packet passed the previous point of the same direction, the
+ * time since then is added to the latency histogram of the stage.
+ *
+ * @param pkt Network packet
+ * @param point Point of the packet path
+ */
+void net_stats_update_latency(struct net_pkt *pkt,
+			      enum net_stats_latency_point point);
+#else
+#define net_stats_update_latency(pkt, point)
+#endif /* CONFIG_NET_STATISTICS_LATENCY */
+
 #if defined(CONFIG_NET_STATISTICS_USER_API)
 /* Management part definitions */
 
@@ -381,6 +489,8 @@ enum net_request_stats_cmd {
 	NET_REQUEST_STATS_CMD_GET_TCP,
 	NET_REQUEST_STATS_CMD_GET_RPL,
 	NET_REQUEST_STATS_CMD_GET_ETHERNET,
+	NET_REQUEST_STATS_CMD_GET_IPV6_NBR,
+	NET_REQUEST_STATS_CMD_GET_LATENCY,
 };
 
 #define NET_REQUEST_STATS_GET_ALL				\
@@ -424,6 +534,13 @@ NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_STATS_GET_IPV6);
 NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_STATS_GET_IPV6_ND);
 #endif /* CONFIG_NET_STATISTICS_IPV6_ND */
 
+#if defined(CONFIG_NET_STATISTICS_IPV6_NBR)
+#define NET_REQUEST_STATS_GET_IPV6_NBR				\
+	(_NET_STATS_BASE | NET_REQUEST_STATS_CMD_GET_IPV6_NBR)
+
+NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_STATS_GET_IPV6_NBR);
+#endif /* CONFIG_NET_STATISTICS_IPV6_NBR */
+
 #if defined(CONFIG_NET_STATISTICS_ICMP)
 #define NET_REQUEST_STATS_GET_ICMP				\
 	(_NET_STATS_BASE | NET_REQUEST_STATS_CMD_GET_ICMP)
@@ -459,6 +576,13 @@ NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_STATS_GET_RPL);
 NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_STATS_GET_ETHERNET);
 #endif /* CONFIG_NET_STATISTICS_ETHERNET */
 
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+#define NET_REQUEST_STATS_GET_LATENCY				\
+	(_NET_STATS_BASE | NET_REQUEST_STATS_CMD_GET_LATENCY)
+
+NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_STATS_GET_LATENCY);
+#endif /* CONFIG_NET_STATISTICS_LATENCY */
+
 #endif /* CONFIG_NET_STATISTICS_USER_API */
 
 /**
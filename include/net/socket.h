@@ -30,6 +30,8 @@
 extern "C" {
 #endif
 
+struct net_pkt;
+
 struct zsock_pollfd {
 	int fd;
 	short events;
@@ -41,8 +43,36 @@ struct zsock_pollfd {
 #define ZSOCK_POLLOUT 4
 
 #define ZSOCK_MSG_PEEK 0x02
+#define ZSOCK_MSG_TRUNC 0x20
 #define ZSOCK_MSG_DONTWAIT 0x40
 
+/* Socket options for IPPROTO_TCP level */
+#define ZSOCK_TCP_NODELAY 1
+#define ZSOCK_TCP_CORK 3
+
+struct zsock_iovec {
+	void *iov_base;
+	size_t iov_len;
+};
+
+struct zsock_msghdr {
+	void *msg_name;
+	socklen_t msg_namelen;
+	struct zsock_iovec *msg_iov;
+	size_t msg_iovlen;
+	void *msg_control;
+	size_t msg_controllen;
+	int msg_flags;
+};
+
+/* Element of the message arrays passed to zsock_sendmmsg() and
+ * zsock_recvmmsg(), msg_len is set to the number of bytes transferred.
+ */
+struct zsock_mmsghdr {
+	struct zsock_msghdr msg_hdr;
+	unsigned int msg_len;
+};
+
 struct zsock_addrinfo {
 	struct zsock_addrinfo *ai_next;
 	int ai_flags;
@@ -69,7 +99,86 @@ ssize_t zsock_sendto(int sock, const void *buf, size_t len, int flags,
 		     const struct sockaddr *dest_addr, socklen_t addrlen);
 ssize_t zsock_recvfrom(int sock, void *buf, size_t max_len, int flags,
 		       struct sockaddr *src_addr, socklen_t *addrlen);
+ssize_t zsock_sendmsg(int sock, const struct zsock_msghdr *msg, int flags);
+ssize_t zsock_recvmsg(int sock, struct zsock_msghdr *msg, int flags);
+
+/* Send up to vlen messages, returns the number of messages sent. An
+ * error is only reported if the first message could not be sent.
+ * This is a convenience wrapper: each message is still sent as its
+ * own packet, in the same way as zsock_sendmsg().
+ */
+int zsock_sendmmsg(int sock, struct zsock_mmsghdr *msgvec, unsigned int vlen,
+		   int flags);
+
+/* Receive up to vlen messages, returns the number of messages received.
+ * Only the first message is waited for, the rest are taken if they are
+ * already queued. Datagrams are taken from the receive queue in batches
+ * under a single lock.
+ */
+int zsock_recvmmsg(int sock, struct zsock_mmsghdr *msgvec, unsigned int vlen,
+		   int flags);
 int zsock_fcntl(int sock, int cmd, int flags);
+
+/**
+ * @brief Allocate a packet for zsock_send_pkt()
+ *
+ * @details The data to send is added to the returned packet as
+ * fragments, e.g. with net_pkt_get_frag() and net_pkt_frag_add(), or
+ * by moving the fragments of a received packet to it. The packet must
+ * be released with net_pkt_unref() if it is not sent.
+ *
+ * @param sock Socket the packet will be sent on
+ * @param flags ZSOCK_MSG_DONTWAIT to not wait for a free packet
+ *
+ * @return Packet, or NULL with errno set if none is available
+ */
+struct net_pkt *zsock_pkt_alloc(int sock, int flags);
+
+/**
+ * @brief Send a packet without copying its data
+ *
+ * @details On success the stack takes ownership of the packet. On
+ * error it stays with the caller. On a stream socket, data that does
+ * not fit into one TCP segment is split at fragment boundaries.
+ *
+ * @param sock Socket to send on
+ * @param pkt Packet allocated with zsock_pkt_alloc() for this socket
+ * @param flags ZSOCK_MSG_DONTWAIT
+ *
+ * @return Number of bytes sent, or -1 with errno set
+ */
+ssize_t zsock_send_pkt(int sock, struct net_pkt *pkt, int flags);
+
+/**
+ * @brief Send a packet to a given address without copying its data
+ *
+ * @details See zsock_send_pkt().
+ */
+ssize_t zsock_sendto_pkt(int sock, struct net_pkt *pkt, int flags,
+			 const struct sockaddr *dest_addr, socklen_t addrlen);
+
+/**
+ * @brief Receive a packet without copying its data
+ *
+ * @details The caller takes ownership of the received packet and must
+ * release it with net_pkt_unref(). On a stream socket the packet only
+ * contains the received data. On a datagram socket it still contains
+ * the protocol headers, the payload is found with net_pkt_appdata()
+ * and the sender with net_pkt_get_src_addr(). ZSOCK_MSG_PEEK is not
+ * supported.
+ *
+ * @param sock Socket to receive from
+ * @param pkt Received packet, NULL if none
+ * @param flags ZSOCK_MSG_DONTWAIT
+ *
+ * @return Number of data bytes in the packet, 0 when a stream socket
+ * was closed by the peer, or -1 with errno set
+ */
+ssize_t zsock_recv_pkt(int sock, struct net_pkt **pkt, int flags);
+int zsock_setsockopt(int sock, int level, int optname,
+		     const void *optval, socklen_t optlen);
+int zsock_getsockopt(int sock, int level, int optname,
+		     void *optval, socklen_t *optlen);
 int zsock_poll(struct zsock_pollfd *fds, int nfds, int timeout);
 int zsock_inet_pton(sa_family_t family, const char *src, void *dst);
 int zsock_getaddrinfo(const char *host, const char *service,
@@ -139,13 +248,43 @@ static inline int poll(struct zsock_pollfd *fds, int nfds, int timeout)
 	return zsock_poll(fds, nfds, timeout);
 }
 
+static inline ssize_t sendmsg(int sock, const struct zsock_msghdr *msg,
+			      int flags)
+{
+	return zsock_sendmsg(sock, msg, flags);
+}
+
+static inline ssize_t recvmsg(int sock, struct zsock_msghdr *msg, int flags)
+{
+	return zsock_recvmsg(sock, msg, flags);
+}
+
+static inline int setsockopt(int sock, int level, int optname,
+			     const void *optval, socklen_t optlen)
+{
+	return zsock_setsockopt(sock, level, optname, optval, optlen);
+}
+
+static inline int getsockopt(int sock, int level, int optname,
+			     void *optval, socklen_t *optlen)
+{
+	return zsock_getsockopt(sock, level, optname, optval, optlen);
+}
+
 #define pollfd zsock_pollfd
 #define POLLIN ZSOCK_POLLIN
 #define POLLOUT ZSOCK_POLLOUT
 
+#define iovec zsock_iovec
+#define msghdr zsock_msghdr
+
 #define MSG_PEEK ZSOCK_MSG_PEEK
+#define MSG_TRUNC ZSOCK_MSG_TRUNC
 #define MSG_DONTWAIT ZSOCK_MSG_DONTWAIT
 
+#define TCP_NODELAY ZSOCK_TCP_NODELAY
+#define TCP_CORK ZSOCK_TCP_CORK
+
 static inline char *inet_ntop(sa_family_t family, const void *src, char *dst,
 			      size_t size)
 {
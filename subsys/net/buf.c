@@ -158,6 +158,127 @@ const struct net_buf_data_cb net_buf_fixed_cb = {
 	.unref = fixed_data_unref,
 };
 
+static u8_t *class_block_get(struct net_buf_data_class *class)
+{
+	u8_t *block = class->free;
+
+	if (block) {
+		class->free = *(void **)block;
+		return block;
+	}
+
+	if (class->uninit_count) {
+		return class->blocks + NET_BUF_DATA_CLASS_STRIDE(class->size) *
+			(class->count - class->uninit_count--);
+	}
+
+	return NULL;
+}
+
+static u8_t *class_data_alloc(struct net_buf *buf, size_t *size,
+			      s32_t timeout)
+{
+	struct net_buf_pool *pool = net_buf_pool_get(buf->pool_id);
+	const struct net_buf_pool_class *pc = pool->alloc->alloc_data;
+	struct net_buf_data_class *class = NULL;
+	u8_t *block = NULL;
+	unsigned int key;
+	int fit = -1;
+	u8_t i;
+
+	key = irq_lock();
+
+	/* Use the smallest class that fits and has free blocks. The
+	 * largest class is used for anything that does not fit at all.
+	 */
+	for (i = 0; i < pc->count; i++) {
+		class = &pc->classes[i];
+
+		if (class->size < *size && i < pc->count - 1) {
+			continue;
+		}
+
+		if (fit < 0) {
+			fit = i;
+		}
+
+		block = class_block_get(class);
+		if (block) {
+			break;
+		}
+	}
+
+	if (!block) {
+		irq_unlock(key);
+		return NULL;
+	}
+
+	if (i != fit) {
+		pc->classes[fit].overflows++;
+	}
+
+	class->allocs++;
+	if (++class->used > class->max_used) {
+		class->max_used = class->used;
+	}
+
+	irq_unlock(key);
+
+	*size = class->size;
+
+	/* The header holds the class index and the ref count */
+	block += NET_BUF_DATA_CLASS_HDR;
+	block[-2] = i;
+	block[-1] = 1;
+
+	return block;
+}
+
+static void class_data_unref(struct net_buf *buf, u8_t *data)
+{
+	struct net_buf_pool *pool = net_buf_pool_get(buf->pool_id);
+	const struct net_buf_pool_class *pc = pool->alloc->alloc_data;
+	struct net_buf_data_class *class;
+	unsigned int key;
+	u8_t *block;
+
+	if (--data[-1]) {
+		return;
+	}
+
+	class = &pc->classes[data[-2]];
+	block = data - NET_BUF_DATA_CLASS_HDR;
+
+	key = irq_lock();
+
+	*(void **)block = class->free;
+	class->free = block;
+	class->used--;
+
+	irq_unlock(key);
+}
+
+const struct net_buf_data_cb net_buf_class_cb = {
+	.alloc = class_data_alloc,
+	.ref   = generic_data_ref,
+	.unref = class_data_unref,
+};
+
+int net_buf_pool_get_classes(struct net_buf_pool *pool,
+			     const struct net_buf_data_class **classes)
+{
+	const struct net_buf_pool_class *pc;
+
+	if (pool->alloc->cb != &net_buf_class_cb) {
+		return 0;
+	}
+
+	pc = pool->alloc->alloc_data;
+	*classes = pc->classes;
+
+	return pc->count;
+}
+
 #if (CONFIG_HEAP_MEM_POOL_SIZE > 0)
 
 static u8_t *heap_data_alloc(struct net_buf *buf, size_t *size, s32_t timeout)
@@ -498,6 +619,83 @@ void net_buf_put(struct k_fifo *fifo, struct net_buf *buf)
 	k_fifo_put_list(fifo, buf, tail);
 }
 
+void net_buf_spsc_init(struct net_buf_spsc *spsc, struct net_buf **slots,
+		       u16_t count)
+{
+	atomic_clear(&spsc->head);
+	atomic_clear(&spsc->tail);
+	atomic_clear(&spsc->waiting);
+	k_sem_init(&spsc->sem, 0, 1);
+
+	spsc->size = count + 1;
+	spsc->slots = slots;
+}
+
+static inline atomic_val_t spsc_next(struct net_buf_spsc *spsc,
+				     atomic_val_t pos)
+{
+	return (pos + 1 == spsc->size) ? 0 : pos + 1;
+}
+
+int net_buf_spsc_put(struct net_buf_spsc *spsc, struct net_buf *buf)
+{
+	atomic_val_t head = atomic_get(&spsc->head);
+	atomic_val_t next = spsc_next(spsc, head);
+
+	NET_BUF_ASSERT(buf);
+
+	if (next == atomic_get(&spsc->tail)) {
+		NET_BUF_WARN("Channel %p full, buf %p not added", spsc, buf);
+		return -ENOBUFS;
+	}
+
+	spsc->slots[head] = buf;
+	atomic_set(&spsc->head, next);
+
+	if (atomic_get(&spsc->waiting) && atomic_cas(&spsc->waiting, 1, 0)) {
+		k_sem_give(&spsc->sem);
+	}
+
+	return 0;
+}
+
+struct net_buf *net_buf_spsc_get(struct net_buf_spsc *spsc, s32_t timeout)
+{
+	atomic_val_t tail = atomic_get(&spsc->tail);
+	struct net_buf *buf;
+
+	while (tail == atomic_get(&spsc->head)) {
+		if (timeout == K_NO_WAIT) {
+			return NULL;
+		}
+
+		atomic_set(&spsc->waiting, 1);
+
+		/* The producer may have added a buffer before it could
+		 * see the flag.
+		 */
+		if (tail != atomic_get(&spsc->head)) {
+			atomic_clear(&spsc->waiting);
+			break;
+		}
+
+		/* A wake up left over from an earlier wait only causes
+		 * another round, the head is checked again in any case.
+		 */
+		if (k_sem_take(&spsc->sem, timeout)) {
+			atomic_clear(&spsc->waiting);
+			timeout = K_NO_WAIT;
+		}
+	}
+
+	buf = spsc->slots[tail];
+	atomic_set(&spsc->tail, spsc_next(spsc, tail));
+
+	NET_BUF_DBG("buf %p channel %p", buf, spsc);
+
+	return buf;
+}
+
 #if defined(CONFIG_NET_BUF_LOG)
 void net_buf_unref_debug(struct net_buf *buf, const char *func, int line)
 #else
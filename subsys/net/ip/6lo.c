@@ -47,6 +47,58 @@ static inline u8_t get_6co_cid(struct net_icmpv6_nd_opt_6co *opt)
 static struct net_6lo_context ctx_6co[CONFIG_NET_MAX_6LO_CONTEXTS];
 #endif
 
+#if defined(CONFIG_NET_6LO_FLOW_CACHE)
+/* Dispatch, IPHC, CID, TF, next header, hop limit, full source and
+ * destination addresses, UDP NHC, ports and checksum.
+ */
+#define NET_6LO_FLOW_HDR_MAX 48
+
+/* Everything the compressed header depends on. The link layer
+ * addresses are part of it because the addresses derived from them
+ * are elided completely.
+ */
+struct net_6lo_flow_key {
+	struct net_if *iface;
+	struct in6_addr src;
+	struct in6_addr dst;
+	u8_t tcflow[4];
+	u16_t src_port;
+	u16_t dst_port;
+	u8_t nexthdr;
+	u8_t hop_limit;
+	u8_t ll_src_type;
+	u8_t ll_src_len;
+	u8_t ll_dst_type;
+	u8_t ll_dst_len;
+	u8_t ll_src[8];
+	u8_t ll_dst[8];
+};
+
+struct net_6lo_flow {
+	struct net_6lo_flow_key key;
+
+	/* Compressed header, the UDP checksum is always the last
+	 * two bytes if the flow is UDP.
+	 */
+	u8_t hdr[NET_6LO_FLOW_HDR_MAX];
+
+	/* Length of the compressed header, 0 if the entry is unused */
+	u8_t len;
+};
+
+static struct net_6lo_flow flows[CONFIG_NET_6LO_FLOW_CACHE_SIZE];
+static u8_t flow_next;
+
+static inline void flow_cache_flush(void)
+{
+	u8_t i;
+
+	for (i = 0; i < CONFIG_NET_6LO_FLOW_CACHE_SIZE; i++) {
+		flows[i].len = 0;
+	}
+}
+#endif
+
 /* TODO: Unicast-Prefix based IPv6 Multicast(dst) address compression
  *       Mesh header compression
  */
@@ -109,6 +161,11 @@ void net_6lo_set_context(struct net_if *iface,
 	int unused = -1;
 	u8_t i;
 
+#if defined(CONFIG_NET_6LO_FLOW_CACHE)
+	/* Cached headers may depend on the old contexts */
+	flow_cache_flush();
+#endif
+
 	/* If the context information already exists, update or remove
 	 * as per data.
 	 */
@@ -676,35 +733,16 @@ static inline bool is_src_and_dst_addr_ctx_based(struct net_ipv6_hdr *ipv6,
  * | 0 | 1 | 1 |  TF   |NH | HLIM  |CID|SAC|  SAM  | M |DAC|  DAM  |
  * +---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+
  */
-static inline bool compress_IPHC_header(struct net_pkt *pkt,
-					fragment_handler_t fragment)
+static inline u8_t compress_headers(struct net_pkt *pkt,
+				    struct net_ipv6_hdr *ipv6,
+				    struct net_udp_hdr *udp,
+				    struct net_buf *frag)
 {
 #if defined(CONFIG_NET_6LO_CONTEXT)
 	struct net_6lo_context *src = NULL;
 	struct net_6lo_context *dst = NULL;
 #endif
-	struct net_ipv6_hdr *ipv6 = NET_IPV6_HDR(pkt);
 	u8_t offset = 0;
-	struct net_buf *frag;
-	u8_t compressed;
-
-	if (pkt->frags->len < NET_IPV6H_LEN) {
-		NET_ERR("Invalid length %d, min %d",
-			pkt->frags->len, NET_IPV6H_LEN);
-		return false;
-	}
-
-	if (ipv6->nexthdr == IPPROTO_UDP &&
-	    pkt->frags->len < NET_IPV6UDPH_LEN) {
-		NET_ERR("Invalid length %d, min %d",
-			pkt->frags->len, NET_IPV6UDPH_LEN);
-		return false;
-	}
-
-	frag = net_pkt_get_frag(pkt, K_FOREVER);
-	if (!frag) {
-		return false;
-	}
 
 	IPHC[offset++] = NET_6LO_DISPATCH_IPHC;
 	IPHC[offset++] = 0;
@@ -731,8 +769,7 @@ static inline bool compress_IPHC_header(struct net_pkt *pkt,
 	offset = compress_sa(ipv6, pkt, frag, offset);
 #endif
 	if (!offset) {
-		net_pkt_frag_unref(frag);
-		return false;
+		return 0;
 	}
 
 	/* Destination Address Compression */
@@ -741,38 +778,191 @@ static inline bool compress_IPHC_header(struct net_pkt *pkt,
 #else
 	offset = compress_da(ipv6, pkt, frag, offset);
 #endif
-
 	if (!offset) {
-		net_pkt_frag_unref(frag);
-		return false;
+		return 0;
 	}
 
-	compressed = NET_IPV6H_LEN;
-
-	if (ipv6->nexthdr != IPPROTO_UDP) {
+	if (!udp) {
 		NET_DBG("next header is not UDP (%u)", ipv6->nexthdr);
-		goto end;
+		return offset;
 	}
 
 	/* UDP header compression */
-	if (IS_ENABLED(CONFIG_NET_UDP)) {
-		struct net_udp_hdr hdr, *udp;
+	IPHC[offset] = NET_6LO_NHC_UDP_BARE;
+
+	return compress_nh_udp(udp, frag, offset);
+}
+
+#if defined(CONFIG_NET_6LO_FLOW_CACHE)
+static inline bool flow_key_init(struct net_6lo_flow_key *key,
+				 struct net_pkt *pkt,
+				 struct net_ipv6_hdr *ipv6,
+				 struct net_udp_hdr *udp)
+{
+	struct net_linkaddr *ll_src = net_pkt_ll_src(pkt);
+	struct net_linkaddr *ll_dst = net_pkt_ll_dst(pkt);
+
+	if (ll_src->len > sizeof(key->ll_src) ||
+	    ll_dst->len > sizeof(key->ll_dst)) {
+		return false;
+	}
+
+	/* The key is compared with memcmp() so padding must be zero */
+	memset(key, 0, sizeof(*key));
+
+	key->iface = net_pkt_iface(pkt);
+	net_ipaddr_copy(&key->src, &ipv6->src);
+	net_ipaddr_copy(&key->dst, &ipv6->dst);
+	memcpy(key->tcflow, &ipv6->vtc, sizeof(key->tcflow));
+	key->nexthdr = ipv6->nexthdr;
+	key->hop_limit = ipv6->hop_limit;
+
+	if (udp) {
+		key->src_port = udp->src_port;
+		key->dst_port = udp->dst_port;
+	}
+
+	key->ll_src_type = ll_src->type;
+	key->ll_dst_type = ll_dst->type;
+
+	if (ll_src->addr) {
+		key->ll_src_len = ll_src->len;
+		memcpy(key->ll_src, ll_src->addr, ll_src->len);
+	}
+
+	if (ll_dst->addr) {
+		key->ll_dst_len = ll_dst->len;
+		memcpy(key->ll_dst, ll_dst->addr, ll_dst->len);
+	}
+
+	return true;
+}
+
+/* Copy the cached header of the flow and fill in the per packet fields.
+ * Returns the header length or 0 if the flow is not cached.
+ */
+static inline u8_t flow_cache_get(struct net_6lo_flow_key *key,
+				  struct net_udp_hdr *udp,
+				  struct net_buf *frag)
+{
+	unsigned int irq_key;
+	u8_t offset = 0;
+	u8_t i;
+
+	irq_key = irq_lock();
+
+	for (i = 0; i < CONFIG_NET_6LO_FLOW_CACHE_SIZE; i++) {
+		if (!flows[i].len ||
+		    memcmp(&flows[i].key, key, sizeof(*key))) {
+			continue;
+		}
+
+		offset = flows[i].len;
+		memcpy(IPHC, flows[i].hdr, offset);
+		break;
+	}
+
+	irq_unlock(irq_key);
+
+	if (offset && udp) {
+		memcpy(&IPHC[offset - 2], &udp->chksum, 2);
+	}
+
+	return offset;
+}
+
+static inline void flow_cache_add(struct net_6lo_flow_key *key,
+				  struct net_buf *frag, u8_t offset)
+{
+	struct net_6lo_flow *flow;
+	unsigned int irq_key;
+
+	if (offset > NET_6LO_FLOW_HDR_MAX) {
+		return;
+	}
+
+	irq_key = irq_lock();
+
+	flow = &flows[flow_next];
+	flow_next = (flow_next + 1) % CONFIG_NET_6LO_FLOW_CACHE_SIZE;
+
+	memcpy(&flow->key, key, sizeof(*key));
+	memcpy(flow->hdr, IPHC, offset);
+	flow->len = offset;
+
+	irq_unlock(irq_key);
+}
+#endif /* CONFIG_NET_6LO_FLOW_CACHE */
+
+static inline bool compress_IPHC_header(struct net_pkt *pkt,
+					fragment_handler_t fragment)
+{
+	struct net_ipv6_hdr *ipv6 = NET_IPV6_HDR(pkt);
+	struct net_udp_hdr hdr, *udp = NULL;
+#if defined(CONFIG_NET_6LO_FLOW_CACHE)
+	struct net_6lo_flow_key key;
+	bool cacheable;
+#endif
+	u8_t offset = 0;
+	struct net_buf *frag;
+	u8_t compressed;
 
+	if (pkt->frags->len < NET_IPV6H_LEN) {
+		NET_ERR("Invalid length %d, min %d",
+			pkt->frags->len, NET_IPV6H_LEN);
+		return false;
+	}
+
+	if (ipv6->nexthdr == IPPROTO_UDP &&
+	    pkt->frags->len < NET_IPV6UDPH_LEN) {
+		NET_ERR("Invalid length %d, min %d",
+			pkt->frags->len, NET_IPV6UDPH_LEN);
+		return false;
+	}
+
+	if (IS_ENABLED(CONFIG_NET_UDP) && ipv6->nexthdr == IPPROTO_UDP) {
 		udp = net_udp_get_hdr(pkt, &hdr);
 		if (!udp) {
 			NET_ERR("could not get UDP header");
 			return false;
 		}
+	}
+
+	frag = net_pkt_get_frag(pkt, K_FOREVER);
+	if (!frag) {
+		return false;
+	}
+
+#if defined(CONFIG_NET_6LO_FLOW_CACHE)
+	/* Packets of the same flow compress to the same header apart
+	 * from the UDP checksum, so reuse it if the flow has been seen.
+	 */
+	cacheable = flow_key_init(&key, pkt, ipv6, udp);
+	if (cacheable) {
+		offset = flow_cache_get(&key, udp, frag);
+	}
+
+	if (!offset) {
+		offset = compress_headers(pkt, ipv6, udp, frag);
+		if (offset && cacheable) {
+			flow_cache_add(&key, frag, offset);
+		}
+	}
+#else
+	offset = compress_headers(pkt, ipv6, udp, frag);
+#endif
 
-		IPHC[offset] = NET_6LO_NHC_UDP_BARE;
-		offset = compress_nh_udp(udp, frag, offset);
+	if (!offset) {
+		net_pkt_frag_unref(frag);
+		return false;
+	}
 
-		compressed += NET_UDPH_LEN;
+	compressed = NET_IPV6H_LEN;
 
-		net_udp_set_hdr(pkt, udp);
+	if (udp) {
+		compressed += NET_UDPH_LEN;
 	}
 
-end:
 	net_buf_add(frag, offset);
 
 	/* Copy the rest of the data to compressed fragment */
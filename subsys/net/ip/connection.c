@@ -815,7 +815,11 @@ enum net_verdict net_conn_input(enum net_ip_protocol proto, struct net_pkt *pkt)
 	enum net_verdict verdict;
 	u32_t cache_value = 0;
 	s32_t pos;
+#endif
+
+	net_stats_update_latency(pkt, NET_STATS_LATENCY_RX_CONN);
 
+#if defined(CONFIG_NET_CONN_CACHE)
 	verdict = cache_check(proto, pkt, &cache_value, &pos);
 	if (verdict != NET_CONTINUE) {
 		return verdict;
@@ -957,6 +961,7 @@ enum net_verdict net_conn_input(enum net_ip_protocol proto, struct net_pkt *pkt)
 
 		} else if (IS_ENABLED(CONFIG_NET_TCP_CHECKSUM) &&
 			   proto == IPPROTO_TCP &&
+			   !net_pkt_chksum_ok(pkt) &&
 			   net_if_need_calc_rx_checksum(net_pkt_iface(pkt))) {
 			u16_t chksum_calc;
 
@@ -82,6 +82,14 @@ NET_NBR_TABLE_INIT(NET_NBR_GLOBAL,
 		   net_neighbor_pool,
 		   net_neighbor_table_clear);
 
+/* Neighbors in use, hashed by their IPv6 address. The chains are linked
+ * through net_ipv6_nbr_data::hash_next.
+ */
+static struct net_nbr *nbr_hash[CONFIG_NET_IPV6_NBR_CACHE_BUCKETS];
+
+/* Position of the clock hand used when evicting neighbors */
+static int nbr_evict_hand;
+
 const char *net_ipv6_nbr_state2str(enum net_ipv6_nbr_state state)
 {
 	switch (state) {
@@ -241,26 +249,78 @@ void nbr_print(void)
 #define nbr_print(...)
 #endif
 
+static inline struct net_nbr **nbr_hash_bucket(const struct in6_addr *addr)
+{
+	u32_t hash;
+
+	/* The interface identifier carries most of the entropy, but fold
+	 * the prefix in too so that the link-local and global addresses of
+	 * a neighbor do not always collide.
+	 */
+	hash = UNALIGNED_GET(&addr->s6_addr32[0]) ^
+		UNALIGNED_GET(&addr->s6_addr32[1]) ^
+		UNALIGNED_GET(&addr->s6_addr32[2]) ^
+		UNALIGNED_GET(&addr->s6_addr32[3]);
+	hash ^= hash >> 16;
+	hash ^= hash >> 8;
+
+	return &nbr_hash[hash % CONFIG_NET_IPV6_NBR_CACHE_BUCKETS];
+}
+
+static void nbr_hash_add(struct net_nbr *nbr)
+{
+	struct net_nbr **bucket;
+
+	bucket = nbr_hash_bucket(&net_ipv6_nbr_data(nbr)->addr);
+
+	net_ipv6_nbr_data(nbr)->hash_next = *bucket;
+	*bucket = nbr;
+}
+
+static void nbr_hash_del(struct net_nbr *nbr)
+{
+	struct net_nbr **prev;
+
+	prev = nbr_hash_bucket(&net_ipv6_nbr_data(nbr)->addr);
+
+	while (*prev) {
+		if (*prev == nbr) {
+			*prev = net_ipv6_nbr_data(nbr)->hash_next;
+			net_ipv6_nbr_data(nbr)->hash_next = NULL;
+			return;
+		}
+
+		prev = &net_ipv6_nbr_data(*prev)->hash_next;
+	}
+}
+
 static struct net_nbr *nbr_lookup(struct net_nbr_table *table,
 				  struct net_if *iface,
 				  struct in6_addr *addr)
 {
-	int i;
+	struct net_nbr *nbr = *nbr_hash_bucket(addr);
 
-	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
-		struct net_nbr *nbr = get_nbr(i);
+	ARG_UNUSED(table);
 
-		if (!nbr->ref) {
-			continue;
-		}
+	while (nbr) {
+		struct net_ipv6_nbr_data *data = net_ipv6_nbr_data(nbr);
 
-		if (iface && nbr->iface != iface) {
-			continue;
-		}
+		if ((!iface || nbr->iface == iface) &&
+		    net_ipv6_addr_cmp(&data->addr, addr)) {
+			data->referenced = true;
+
+			if (iface) {
+				net_stats_update_ipv6_nbr_hit(iface);
+			}
 
-		if (net_ipv6_addr_cmp(&net_ipv6_nbr_data(nbr)->addr, addr)) {
 			return nbr;
 		}
+
+		nbr = data->hash_next;
+	}
+
+	if (iface) {
+		net_stats_update_ipv6_nbr_miss(iface);
 	}
 
 	return NULL;
@@ -288,18 +348,13 @@ static inline void nbr_free(struct net_nbr *nbr)
 	net_nbr_unlink(nbr, NULL);
 }
 
-bool net_ipv6_nbr_rm(struct net_if *iface, struct in6_addr *addr)
+static void nbr_rm(struct net_nbr *nbr, struct net_if *iface,
+		   struct in6_addr *addr)
 {
-	struct net_nbr *nbr;
 #if defined(CONFIG_NET_MGMT_EVENT_INFO)
 	struct net_event_ipv6_nbr info;
 #endif
 
-	nbr = nbr_lookup(&net_neighbor.table, iface, addr);
-	if (!nbr) {
-		return false;
-	}
-
 	/* Remove any routes with nbr as nexthop in first place */
 	net_route_del_by_nexthop(iface, addr);
 
@@ -314,6 +369,18 @@ bool net_ipv6_nbr_rm(struct net_if *iface, struct in6_addr *addr)
 #else
 	net_mgmt_event_notify(NET_EVENT_IPV6_NBR_DEL, iface);
 #endif
+}
+
+bool net_ipv6_nbr_rm(struct net_if *iface, struct in6_addr *addr)
+{
+	struct net_nbr *nbr;
+
+	nbr = nbr_lookup(&net_neighbor.table, iface, addr);
+	if (!nbr) {
+		return false;
+	}
+
+	nbr_rm(nbr, iface, addr);
 
 	return true;
 }
@@ -366,6 +433,9 @@ static void nbr_init(struct net_nbr *nbr, struct net_if *iface,
 	ipv6_nbr_set_state(nbr, state);
 	net_ipv6_nbr_data(nbr)->is_router = is_router;
 	net_ipv6_nbr_data(nbr)->pending = NULL;
+	net_ipv6_nbr_data(nbr)->referenced = true;
+
+	nbr_hash_add(nbr);
 
 #if defined(CONFIG_NET_IPV6_ND)
 	k_delayed_work_init(&net_ipv6_nbr_data(nbr)->reachable,
@@ -375,17 +445,62 @@ static void nbr_init(struct net_nbr *nbr, struct net_if *iface,
 			    ns_reply_timeout);
 }
 
+/* Make room for a new neighbor when the cache is full. Only STALE
+ * entries that nobody else holds a reference to are candidates, and an
+ * entry that was looked up since the clock hand last passed it gets a
+ * second chance.
+ */
+static bool nbr_evict(void)
+{
+	int i;
+
+	for (i = 0; i < 2 * CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		struct net_nbr *nbr = get_nbr(nbr_evict_hand);
+		struct net_ipv6_nbr_data *data = net_ipv6_nbr_data(nbr);
+		struct in6_addr addr;
+
+		nbr_evict_hand = (nbr_evict_hand + 1) %
+			CONFIG_NET_IPV6_MAX_NEIGHBORS;
+
+		if (nbr->ref != 1 || data->is_router ||
+		    data->state != NET_IPV6_NBR_STATE_STALE) {
+			continue;
+		}
+
+		if (data->referenced) {
+			data->referenced = false;
+			continue;
+		}
+
+		NET_DBG("nbr %p evicting %s", nbr,
+			net_sprint_ipv6_addr(&data->addr));
+
+		net_stats_update_ipv6_nbr_evicted(nbr->iface);
+
+		net_ipaddr_copy(&addr, &data->addr);
+		nbr_rm(nbr, nbr->iface, &addr);
+
+		return true;
+	}
+
+	return false;
+}
+
 static struct net_nbr *nbr_new(struct net_if *iface,
 			       struct in6_addr *addr, bool is_router,
 			       enum net_ipv6_nbr_state state)
 {
 	struct net_nbr *nbr = net_nbr_get(&net_neighbor.table);
 
+	if (!nbr && nbr_evict()) {
+		nbr = net_nbr_get(&net_neighbor.table);
+	}
+
 	if (!nbr) {
 		return NULL;
 	}
 
-	nbr_init(nbr, iface, addr, true, state);
+	nbr_init(nbr, iface, addr, is_router, state);
 
 	NET_DBG("nbr %p iface %p state %d IPv6 %s",
 		nbr, iface, state, net_sprint_ipv6_addr(addr));
@@ -556,7 +671,7 @@ void net_neighbor_data_remove(struct net_nbr *nbr)
 {
 	NET_DBG("Neighbor %p removed", nbr);
 
-	return;
+	nbr_hash_del(nbr);
 }
 
 void net_neighbor_table_clear(struct net_nbr_table *table)
@@ -1000,7 +1115,8 @@ struct net_pkt *net_ipv6_prepare_for_send(struct net_pkt *pkt)
 	if (net_pkt_ipv6_fragment_id(pkt) == 0) {
 		size_t pkt_len = net_pkt_get_len(pkt);
 
-		if (pkt_len > NET_IPV6_MTU) {
+		/* TCP segments built for GSO are split by the L2 */
+		if (pkt_len > NET_IPV6_MTU && !net_pkt_gso_size(pkt)) {
 			ret = net_ipv6_send_fragmented_pkt(net_pkt_iface(pkt),
 							   pkt, pkt_len);
 			if (ret < 0) {
@@ -3097,7 +3213,8 @@ reassembly[CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT];
 
 static struct net_ipv6_reassembly *reassembly_get(u32_t id,
 						  struct in6_addr *src,
-						  struct in6_addr *dst)
+						  struct in6_addr *dst,
+						  struct net_if *iface)
 {
 	int i, avail = -1;
 
@@ -3130,74 +3247,68 @@ static struct net_ipv6_reassembly *reassembly_get(u32_t id,
 	net_ipaddr_copy(&reassembly[avail].dst, dst);
 
 	reassembly[avail].id = id;
+	reassembly[avail].iface = iface;
+	reassembly[avail].pkt = NULL;
+	net_reass_init(&reassembly[avail].frags);
 
 	return &reassembly[avail];
 }
 
-static bool reassembly_cancel(u32_t id,
-			      struct in6_addr *src,
-			      struct in6_addr *dst)
+/* How many bytes of fragments from this source are waiting reassembly */
+static u32_t reassembly_source_bytes(struct in6_addr *src)
 {
-	int i, j;
-
-	NET_DBG("Cancel 0x%x", id);
+	u32_t bytes = 0;
+	int i;
 
 	for (i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT; i++) {
-		s32_t remaining;
-
-		if (reassembly[i].id != id ||
-		    !net_ipv6_addr_cmp(src, &reassembly[i].src) ||
-		    !net_ipv6_addr_cmp(dst, &reassembly[i].dst)) {
+		if (!k_delayed_work_remaining_get(&reassembly[i].timer) ||
+		    !net_ipv6_addr_cmp(src, &reassembly[i].src)) {
 			continue;
 		}
 
-		remaining = k_delayed_work_remaining_get(&reassembly[i].timer);
-		if (remaining) {
-			k_delayed_work_cancel(&reassembly[i].timer);
-		}
+		bytes += reassembly[i].frags.received;
+	}
 
-		NET_DBG("IPv6 reassembly id 0x%x remaining %d ms",
-			reassembly[i].id, remaining);
+	return bytes;
+}
 
-		reassembly[i].id = 0;
+static void reassembly_cancel(struct net_ipv6_reassembly *reass)
+{
+	s32_t remaining;
 
-		for (j = 0; j < NET_IPV6_FRAGMENTS_MAX_PKT; j++) {
-			if (!reassembly[i].pkt[j]) {
-				continue;
-			}
+	NET_DBG("Cancel 0x%x", reass->id);
 
-			NET_DBG("[%d] IPv6 reassembly pkt %p %zd bytes data",
-				j, reassembly[i].pkt[j],
-				net_pkt_get_len(reassembly[i].pkt[j]));
+	remaining = k_delayed_work_remaining_get(&reass->timer);
+	if (remaining) {
+		k_delayed_work_cancel(&reass->timer);
+	}
 
-			net_pkt_unref(reassembly[i].pkt[j]);
-			reassembly[i].pkt[j] = NULL;
-		}
+	NET_DBG("IPv6 reassembly id 0x%x remaining %d ms",
+		reass->id, remaining);
 
-		return true;
-	}
+	net_stats_update_ipv6_reass_pending(reass->iface,
+					    -(int)reass->frags.received);
 
-	return false;
+	reass->id = 0;
+
+	net_reass_clear(&reass->frags);
+
+	if (reass->pkt) {
+		net_pkt_unref(reass->pkt);
+		reass->pkt = NULL;
+	}
 }
 
 static void reassembly_info(char *str, struct net_ipv6_reassembly *reass)
 {
 	char out[NET_IPV6_ADDR_LEN];
-	int i, len;
 
 	snprintk(out, sizeof(out), "%s", net_sprint_ipv6_addr(&reass->dst));
 
-	for (i = 0, len = 0; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		if (!reass->pkt[i]) {
-			continue;
-		}
-
-		len += net_pkt_get_len(reass->pkt[i]);
-	}
-
-	NET_DBG("%s id 0x%x src %s dst %s remain %d ms len %d",
+	NET_DBG("%s id 0x%x src %s dst %s remain %d ms len %d/%d",
 		str, reass->id, net_sprint_ipv6_addr(&reass->src), out,
-		k_delayed_work_remaining_get(&reass->timer), len);
+		k_delayed_work_remaining_get(&reass->timer),
+		reass->frags.received, reass->frags.size);
 }
 
 static void reassembly_timeout(struct k_work *work)
@@ -3207,87 +3318,52 @@ static void reassembly_timeout(struct k_work *work)
 
 	reassembly_info("Reassembly cancelled", reass);
 
-	reassembly_cancel(reass->id, &reass->src, &reass->dst);
+	net_stats_update_ipv6_reass_timeout(reass->iface);
+
+	reassembly_cancel(reass);
 }
 
 static void reassemble_packet(struct net_ipv6_reassembly *reass)
 {
 	struct net_pkt *pkt;
-	struct net_buf *last;
+	u8_t *frag_hdr;
 	u8_t next_hdr;
-	int i, len, ret;
+	int len, ret;
 	u16_t pos;
 
 	k_delayed_work_cancel(&reass->timer);
 
-	NET_ASSERT(reass->pkt[0]);
+	net_stats_update_ipv6_reass_done(reass->iface);
+	net_stats_update_ipv6_reass_pending(reass->iface,
+					    -(int)reass->frags.received);
 
-	last = net_buf_frag_last(reass->pkt[0]->frags);
+	NET_ASSERT(reass->pkt);
 
-	/* We start from 2nd packet which is then appended to
-	 * the first one.
+	/* The fragments are in order, link their buffers after the
+	 * first one that still contains the IPv6 headers.
 	 */
-	for (i = 1; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		int removed_len;
-
-		pkt = reass->pkt[i];
+	pkt = reass->pkt;
+	reass->pkt = NULL;
 
-		/* Get rid of IPv6 and fragment header which are at
-		 * the beginning of the fragment.
-		 */
-		removed_len = net_pkt_ipv6_fragment_start(pkt) +
-			sizeof(struct net_ipv6_frag_hdr) -
-			pkt->frags->data;
-
-		NET_DBG("Removing %d bytes from start of pkt %p",
-			removed_len, pkt->frags);
-
-		NET_ASSERT(removed_len >= (sizeof(struct net_ipv6_hdr) +
-					   sizeof(struct net_ipv6_frag_hdr)));
-
-		net_buf_pull(pkt->frags, removed_len);
-
-		/* Attach the data to previous pkt */
-		last->frags = pkt->frags;
-		last = net_buf_frag_last(pkt->frags);
-
-		pkt->frags = NULL;
-		reass->pkt[i] = NULL;
+	pkt->frags = net_reass_splice(&reass->frags);
 
-		net_pkt_unref(pkt);
-	}
-
-	pkt = reass->pkt[0];
-	reass->pkt[0] = NULL;
-
-	/* Next we need to strip away the fragment header from the first packet
-	 * and set the various pointers and values in packet.
+	/* Get rid of the fragment header by moving the headers in front
+	 * of it, the payload data is not touched.
 	 */
+	frag_hdr = net_pkt_ipv6_fragment_start(pkt);
+	next_hdr = frag_hdr[0];
+	len = frag_hdr - pkt->frags->data;
 
-	next_hdr = net_pkt_ipv6_fragment_start(pkt)[0];
-
-	/* How much data we need to move in order to get rid of the
-	 * fragmentation header.
-	 */
-	len = pkt->frags->len - sizeof(struct net_ipv6_frag_hdr) -
-		(net_pkt_ipv6_fragment_start(pkt) - pkt->frags->data);
+	memmove(pkt->frags->data + sizeof(struct net_ipv6_frag_hdr),
+		pkt->frags->data, len);
+	net_buf_pull(pkt->frags, sizeof(struct net_ipv6_frag_hdr));
 
-	memmove(net_pkt_ipv6_fragment_start(pkt),
-		net_pkt_ipv6_fragment_start(pkt) +
-		sizeof(struct net_ipv6_frag_hdr), len);
+	net_pkt_set_ipv6_fragment_start(pkt, pkt->frags->data + len);
 
 	/* This one updates the previous header's nexthdr value */
 	net_pkt_write_u8(pkt, pkt->frags, net_pkt_ipv6_hdr_prev(pkt),
 			  &pos, next_hdr);
 
-	pkt->frags->len -= sizeof(struct net_ipv6_frag_hdr);
-
-	if (!net_pkt_compact(pkt)) {
-		NET_ERR("Cannot compact reassembly packet %p", pkt);
-		net_pkt_unref(pkt);
-		return;
-	}
-
 	/* Fix the total length of the IPv6 packet. */
 	len = net_pkt_ipv6_ext_len(pkt);
 	if (len > 0) {
@@ -3329,81 +3405,22 @@ void net_ipv6_frag_foreach(net_ipv6_frag_cb_t cb, void *user_data)
 	}
 }
 
-/* Verify that we have all the fragments received and in correct order.
- */
-static bool fragment_verify(struct net_ipv6_reassembly *reass)
-{
-	u16_t offset;
-	int i, prev_len;
-
-	prev_len = net_pkt_get_len(reass->pkt[0]);
-	offset = net_pkt_ipv6_fragment_offset(reass->pkt[0]);
-
-	NET_DBG("pkt %p offset %u", reass->pkt[0], offset);
-
-	if (offset != 0) {
-		return false;
-	}
-
-	for (i = 1; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		offset = net_pkt_ipv6_fragment_offset(reass->pkt[i]);
-
-		NET_DBG("pkt %p offset %u prev_len %d", reass->pkt[i],
-			offset, prev_len);
-
-		if (prev_len < offset) {
-			/* Something wrong with the offset value */
-			return false;
-		}
-
-		prev_len = net_pkt_get_len(reass->pkt[i]);
-	}
-
-	return true;
-}
-
-static int shift_packets(struct net_ipv6_reassembly *reass, int pos)
-{
-	int i;
-
-	for (i = pos + 1; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		if (!reass->pkt[i]) {
-			NET_DBG("Moving [%d] %p (offset 0x%x) to [%d]",
-				pos, reass->pkt[pos],
-				net_pkt_ipv6_fragment_offset(reass->pkt[pos]),
-				i);
-
-			/* Do we have enough space in packet array to make
-			 * the move?
-			 */
-			if (((i - pos) + 1) >
-			    (NET_IPV6_FRAGMENTS_MAX_PKT - i)) {
-				return -ENOMEM;
-			}
-
-			memmove(&reass->pkt[i], &reass->pkt[pos],
-				sizeof(void *) * (i - pos));
-
-			return 0;
-		}
-	}
-
-	return -EINVAL;
-}
-
 static enum net_verdict handle_fragment_hdr(struct net_pkt *pkt,
 					    struct net_buf *frag,
 					    int total_len,
 					    u16_t buf_offset)
 {
-	struct net_ipv6_reassembly *reass = NULL;
+	struct net_ipv6_reassembly *reass;
+	struct net_buf *buf;
 	u32_t id;
 	u16_t loc;
 	u16_t offset;
 	u16_t flag;
+	u16_t hdr_len;
+	u16_t len;
 	u8_t nexthdr;
 	u8_t more;
-	bool found;
+	int ret;
 	int i;
 
 	if (!reassembly_init_done) {
@@ -3418,6 +3435,16 @@ static enum net_verdict handle_fragment_hdr(struct net_pkt *pkt,
 		reassembly_init_done = true;
 	}
 
+	/* The headers up to and including the fragment header are pulled
+	 * away from the fragments, so they must all be in the first buffer.
+	 */
+	hdr_len = buf_offset + sizeof(struct net_ipv6_frag_hdr);
+	if (frag != pkt->frags || hdr_len > frag->len) {
+		NET_DBG("Fragment header not in first buffer, dropping pkt %p",
+			pkt);
+		goto drop;
+	}
+
 	net_pkt_set_ipv6_fragment_start(pkt, frag->data + buf_offset);
 
 	/* Each fragment has a fragment header. */
@@ -3429,110 +3456,95 @@ static enum net_verdict handle_fragment_hdr(struct net_pkt *pkt,
 		goto drop;
 	}
 
+	offset = flag & 0xfff8;
+	more = flag & 0x01;
+	len = total_len - hdr_len;
+
+	if (!len || (u32_t)offset + len > UINT16_MAX) {
+		NET_DBG("Invalid fragment offset 0x%x len %u", offset, len);
+		goto drop;
+	}
+
+	if (more && (len % 8)) {
+		/* Fragment length is not multiple of 8, discard
+		 * the packet and send parameter problem error.
+		 */
+		net_icmpv6_send_error(pkt, NET_ICMPV6_PARAM_PROBLEM,
+				      NET_ICMPV6_PARAM_PROB_OPTION, 0);
+		goto drop;
+	}
+
+	if (reassembly_source_bytes(&NET_IPV6_HDR(pkt)->src) + len >
+	    CONFIG_NET_REASSEMBLY_SOURCE_MAX_BYTES) {
+		NET_DBG("Too much pending data from %s, dropping pkt %p",
+			net_sprint_ipv6_addr(&NET_IPV6_HDR(pkt)->src), pkt);
+		goto drop;
+	}
+
 	reass = reassembly_get(id, &NET_IPV6_HDR(pkt)->src,
-			       &NET_IPV6_HDR(pkt)->dst);
+			       &NET_IPV6_HDR(pkt)->dst, net_pkt_iface(pkt));
 	if (!reass) {
 		NET_DBG("Cannot get reassembly slot, dropping pkt %p", pkt);
 		goto drop;
 	}
 
-	offset = flag & 0xfff8;
-	more = flag & 0x01;
-
 	net_pkt_set_ipv6_fragment_offset(pkt, offset);
 
-	if (!reass->pkt[0]) {
-		NET_DBG("Storing pkt %p to slot %d offset 0x%x", pkt, 0,
-			offset);
-		reass->pkt[0] = pkt;
-
-		reassembly_info("Reassembly 1st pkt", reass);
-
-		/* Wait for more fragments to receive. */
-		goto accept;
+	if (!more && net_reass_set_size(&reass->frags, offset + len) < 0) {
+		NET_DBG("Last fragment of 0x%x does not match, dropping it",
+			reass->id);
+		reassembly_cancel(reass);
+		goto drop;
 	}
 
-	/* The fragments might come in wrong order so place them
-	 * in reassembly chain in correct order.
+	/* The first fragment keeps its headers, they are needed for the
+	 * reassembled packet. Only the payload is kept from the others.
 	 */
-	for (i = 0, found = false; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		if (!reass->pkt[i]) {
-			NET_DBG("Storing pkt %p to slot %d offset 0x%x", pkt,
-				i, offset);
-			reass->pkt[i] = pkt;
-			found = true;
-			break;
-		}
-
-		if (net_pkt_ipv6_fragment_offset(reass->pkt[i]) < offset) {
-			continue;
-		}
-
-		/* Make room for this fragment, if there is no room, then
-		 * discard the whole reassembly.
-		 */
-		if (shift_packets(reass, i)) {
-			break;
-		}
+	buf = pkt->frags;
+	if (offset) {
+		net_buf_pull(buf, hdr_len);
+	}
 
-		NET_DBG("Storing %p (offset 0x%x) to [%d]", pkt, offset, i);
-		reass->pkt[i] = pkt;
-		found = true;
-		break;
+	ret = net_reass_add(&reass->frags, buf, offset, len);
+	if (ret == -EALREADY) {
+		NET_DBG("Duplicate fragment offset 0x%x of 0x%x", offset,
+			reass->id);
+		goto drop;
 	}
 
-	if (!found) {
-		/* We could not add this fragment into our saved fragment
-		 * list. We must discard the whole packet at this point.
+	if (ret < 0) {
+		/* Overlapping fragments cause the whole packet to be
+		 * discarded (RFC 5722).
 		 */
-		NET_DBG("No slots available for 0x%x", reass->id);
-		net_pkt_unref(pkt);
+		NET_DBG("Cannot add fragment offset 0x%x to 0x%x (%d)",
+			offset, reass->id, ret);
+		reassembly_cancel(reass);
 		goto drop;
 	}
 
-	if (more) {
-		if (net_pkt_get_len(pkt) % 8) {
-			/* Fragment length is not multiple of 8, discard
-			 * the packet and send parameter problem error.
-			 */
-			net_icmpv6_send_error(pkt, NET_ICMPV6_PARAM_PROBLEM,
-					      NET_ICMPV6_PARAM_PROB_OPTION, 0);
-			goto drop;
-		}
+	net_stats_update_ipv6_reass_pending(reass->iface, len);
 
-		reassembly_info("Reassembly nth pkt", reass);
+	pkt->frags = NULL;
 
-		NET_DBG("More fragments to be received");
-		goto accept;
+	if (offset) {
+		net_pkt_unref(pkt);
+	} else {
+		reass->pkt = pkt;
 	}
 
-	reassembly_info("Reassembly last pkt", reass);
-
-	if (!fragment_verify(reass)) {
-		NET_DBG("Reassembled IPv6 verify failed, dropping id %u",
-			reass->id);
-
-		/* Let the caller release the already inserted pkt */
-		if (i < NET_IPV6_FRAGMENTS_MAX_PKT) {
-			reass->pkt[i] = NULL;
-		}
-
-		net_pkt_unref(pkt);
-		goto drop;
+	if (!net_reass_complete(&reass->frags)) {
+		reassembly_info("Reassembly pkt", reass);
+		return NET_OK;
 	}
 
-	/* The last fragment received, reassemble the packet */
+	reassembly_info("Reassembly last pkt", reass);
+
 	reassemble_packet(reass);
 
-accept:
 	return NET_OK;
 
 drop:
-	if (reass) {
-		if (reassembly_cancel(reass->id, &reass->src, &reass->dst)) {
-			return NET_OK;
-		}
-	}
+	net_stats_update_ipv6_reass_drop(net_pkt_iface(pkt));
 
 	return NET_DROP;
 }
@@ -23,6 +23,10 @@
 #include "icmpv6.h"
 #include "nbr.h"
 
+#if defined(CONFIG_NET_IPV6_FRAGMENT)
+#include "reassembly.h"
+#endif
+
 #define NET_IPV6_ND_HOP_LIMIT 255
 #define NET_IPV6_ND_INFINITE_LIFETIME 0xFFFFFFFF
 
@@ -103,6 +107,12 @@ struct net_ipv6_nbr_data {
 
 	/** Is the neighbor a router */
 	bool is_router;
+
+	/** Entry was looked up since the last eviction sweep passed it */
+	bool referenced;
+
+	/** Next neighbor in the same lookup hash bucket */
+	struct net_nbr *hash_next;
 };
 
 static inline struct net_ipv6_nbr_data *net_ipv6_nbr_data(struct net_nbr *nbr)
@@ -362,14 +372,6 @@ static inline void net_ipv6_nbr_set_reachable_timer(struct net_if *iface,
 #endif
 
 #if defined(CONFIG_NET_IPV6_FRAGMENT)
-/* We do not have to accept larger than 1500 byte IPv6 packet (RFC 2460 ch 5).
- * This means that we should receive everything within first two fragments.
- * The first one being 1280 bytes and the second one 220 bytes.
- */
-#if !defined(NET_IPV6_FRAGMENTS_MAX_PKT)
-#define NET_IPV6_FRAGMENTS_MAX_PKT 2
-#endif
-
 /** Store pending IPv6 fragment information that is needed for reassembly. */
 struct net_ipv6_reassembly {
 	/** IPv6 source address of the fragment */
@@ -384,8 +386,16 @@ struct net_ipv6_reassembly {
 	 */
 	struct k_delayed_work timer;
 
-	/** Pointers to pending fragments */
-	struct net_pkt *pkt[NET_IPV6_FRAGMENTS_MAX_PKT];
+	/** Packet of the first fragment, its headers are used for the
+	 * reassembled packet.
+	 */
+	struct net_pkt *pkt;
+
+	/** Network interface the fragments are received from */
+	struct net_if *iface;
+
+	/** Received fragments */
+	struct net_reass frags;
 
 	/** IPv6 fragment identification */
 	u32_t id;
@@ -20,6 +20,11 @@
 #include "net_private.h"
 #include "ipv6.h"
 
+#if defined(CONFIG_NET_L2_ETHERNET_GSO)
+#include <net/tcp.h>
+#include "tcp_internal.h"
+#endif
+
 #if defined(CONFIG_NET_IPV6)
 static const struct net_eth_addr multicast_eth_addr = {
 	{ 0x33, 0x33, 0x00, 0x00, 0x00, 0x00 } };
@@ -511,6 +516,261 @@ send:
 	return NET_OK;
 }
 
+int net_eth_send_batch(struct net_if *iface, struct net_pkt **pkts,
+		       int count)
+{
+	const struct ethernet_api *api = net_if_get_device(iface)->driver_api;
+	int sent = 0;
+	int ret = 0;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		net_capture_pkt(iface, pkts[i], NET_CAPTURE_TX_LL);
+	}
+
+	if (api->send_batch) {
+		ret = api->send_batch(iface, pkts, count);
+		if (ret > 0) {
+			sent = ret;
+		}
+	} else {
+		while (sent < count) {
+			ret = api->iface_api.send(iface, pkts[sent]);
+			if (ret < 0) {
+				break;
+			}
+
+			sent++;
+		}
+	}
+
+	if (sent < count) {
+		NET_DBG("Sent %d of %d pkts (%d)", sent, count, ret);
+
+		for (i = sent; i < count; i++) {
+			net_pkt_unref(pkts[i]);
+		}
+
+		if (!sent) {
+			return ret < 0 ? ret : -EIO;
+		}
+	}
+
+	return sent;
+}
+
+#if defined(CONFIG_NET_L2_ETHERNET_GSO)
+/* Sent packets are released in the TX thread that runs this, so there
+ * is no point in waiting for buffers.
+ */
+#define GSO_ALLOC_TIMEOUT K_NO_WAIT
+
+/* Append len bytes of data to a segment, starting from position pos of
+ * fragment src of the original packet. Both are advanced past the data.
+ */
+static int gso_copy_data(struct net_pkt *seg, struct net_buf **src,
+			 u16_t *pos, u16_t len)
+{
+	struct net_buf *frag = net_buf_frag_last(seg->frags);
+
+	while (len) {
+		u16_t count;
+
+		if (!*src) {
+			return -EINVAL;
+		}
+
+		if (*pos == (*src)->len) {
+			*src = (*src)->frags;
+			*pos = 0;
+			continue;
+		}
+
+		if (!net_buf_tailroom(frag)) {
+			frag = net_pkt_get_frag(seg, GSO_ALLOC_TIMEOUT);
+			if (!frag) {
+				return -ENOMEM;
+			}
+
+			net_pkt_frag_add(seg, frag);
+		}
+
+		count = min(len, min(net_buf_tailroom(frag),
+				     (*src)->len - *pos));
+		net_buf_add_mem(frag, (*src)->data + *pos, count);
+
+		*pos += count;
+		len -= count;
+	}
+
+	return 0;
+}
+
+static void gso_fix_headers(struct net_if *iface, struct net_pkt *seg,
+			    u16_t hdr_len, u16_t len, u32_t seq, u16_t index,
+			    bool last)
+{
+	struct net_tcp_hdr *tcp_hdr = net_pkt_tcp_data(seg);
+
+	sys_put_be32(seq, tcp_hdr->seq);
+
+	/* FIN and PSH belong to the end of the data only */
+	if (!last) {
+		tcp_hdr->flags &= ~(NET_TCP_FIN | NET_TCP_PSH);
+	}
+
+#if defined(CONFIG_NET_IPV4)
+	if (net_pkt_family(seg) == AF_INET) {
+		struct net_ipv4_hdr *hdr = NET_IPV4_HDR(seg);
+
+		sys_put_be16(hdr_len + len, hdr->len);
+		sys_put_be16(sys_get_be16(hdr->id) + index, hdr->id);
+
+		hdr->chksum = 0;
+		if (net_if_need_calc_tx_checksum(iface)) {
+			hdr->chksum = ~net_calc_chksum_ipv4(seg);
+		}
+	}
+#endif
+#if defined(CONFIG_NET_IPV6)
+	if (net_pkt_family(seg) == AF_INET6) {
+		sys_put_be16(hdr_len + len - sizeof(struct net_ipv6_hdr),
+			     NET_IPV6_HDR(seg)->len);
+	}
+#endif
+
+	if (net_if_need_calc_tx_checksum(iface)) {
+		net_tcp_set_chksum(seg, seg->frags);
+	}
+}
+
+/* Build one frame from the headers of the original packet and the next
+ * len bytes of its data.
+ */
+static struct net_pkt *gso_segment(struct net_pkt *pkt, u16_t hdr_len,
+				   struct net_buf **src, u16_t *pos,
+				   u16_t len)
+{
+	struct net_pkt *seg;
+	struct net_buf *frag;
+
+	seg = net_pkt_get_reserve_tx(net_pkt_ll_reserve(pkt),
+				     GSO_ALLOC_TIMEOUT);
+	if (!seg) {
+		return NULL;
+	}
+
+	net_pkt_set_iface(seg, net_pkt_iface(pkt));
+	net_pkt_set_family(seg, net_pkt_family(pkt));
+	net_pkt_set_ip_hdr_len(seg, net_pkt_ip_hdr_len(pkt));
+	net_pkt_set_ipv6_ext_len(seg, net_pkt_ipv6_ext_len(pkt));
+	net_pkt_set_vlan_tci(seg, net_pkt_vlan_tci(pkt));
+
+	frag = net_pkt_get_frag(seg, GSO_ALLOC_TIMEOUT);
+	if (!frag) {
+		goto fail;
+	}
+
+	net_pkt_frag_add(seg, frag);
+
+	if (net_frag_linearize(frag->data, net_buf_tailroom(frag), pkt, 0,
+			       hdr_len) < 0) {
+		goto fail;
+	}
+
+	net_buf_add(frag, hdr_len);
+
+	memcpy(net_pkt_ll(seg), net_pkt_ll(pkt), net_pkt_ll_reserve(pkt));
+
+	net_pkt_ll_src(seg)->addr = (u8_t *)&NET_ETH_HDR(seg)->src;
+	net_pkt_ll_src(seg)->len = sizeof(struct net_eth_addr);
+	net_pkt_ll_dst(seg)->addr = (u8_t *)&NET_ETH_HDR(seg)->dst;
+	net_pkt_ll_dst(seg)->len = sizeof(struct net_eth_addr);
+
+	if (gso_copy_data(seg, src, pos, len) < 0) {
+		goto fail;
+	}
+
+	return seg;
+
+fail:
+	net_pkt_unref(seg);
+	return NULL;
+}
+
+int net_eth_send_gso(struct net_if *iface, struct net_pkt *pkt)
+{
+	const struct ethernet_api *api = net_if_get_device(iface)->driver_api;
+	struct net_pkt *segs[CONFIG_NET_L2_ETHERNET_GSO_SEGS];
+	u16_t gso_size = net_pkt_gso_size(pkt);
+	struct net_tcp_hdr hdr, *tcp_hdr;
+	struct net_buf *frag;
+	size_t data_len;
+	u16_t hdr_len;
+	u16_t pos;
+	u32_t seq;
+	int count;
+	int i;
+
+	if (net_eth_get_hw_capabilities(iface) & ETHERNET_HW_GSO) {
+		return api->iface_api.send(iface, pkt);
+	}
+
+	tcp_hdr = net_tcp_get_hdr(pkt, &hdr);
+	if (!tcp_hdr) {
+		return -EINVAL;
+	}
+
+	hdr_len = net_pkt_ip_hdr_len(pkt) + net_pkt_ipv6_ext_len(pkt) +
+		NET_TCP_HDR_LEN(tcp_hdr);
+	data_len = net_pkt_get_len(pkt) - hdr_len;
+	seq = sys_get_be32(tcp_hdr->seq);
+
+	count = (data_len + gso_size - 1) / gso_size;
+	if (count <= 1) {
+		return api->iface_api.send(iface, pkt);
+	}
+
+	if (count > ARRAY_SIZE(segs)) {
+		NET_DBG("Too many segments (%d) in pkt %p", count, pkt);
+		return -EMSGSIZE;
+	}
+
+	frag = net_frag_get_pos(pkt, hdr_len, &pos);
+
+	for (i = 0; i < count; i++) {
+		u16_t len = min(data_len - i * gso_size, gso_size);
+
+		segs[i] = gso_segment(pkt, hdr_len, &frag, &pos, len);
+		if (!segs[i]) {
+			NET_DBG("Cannot split pkt %p into %d segments",
+				pkt, count);
+
+			while (i--) {
+				net_pkt_unref(segs[i]);
+			}
+
+			return -ENOMEM;
+		}
+
+		gso_fix_headers(iface, segs[i], hdr_len, len,
+				seq + i * gso_size, i, i == count - 1);
+	}
+
+	NET_DBG("Sending pkt %p as %d segments of %u bytes", pkt, count,
+		gso_size);
+
+	i = net_eth_send_batch(iface, segs, count);
+	if (i < 0) {
+		return i;
+	}
+
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+#endif /* CONFIG_NET_L2_ETHERNET_GSO */
+
 static inline u16_t ethernet_reserve(struct net_if *iface, void *unused)
 {
 #if defined(CONFIG_NET_VLAN)
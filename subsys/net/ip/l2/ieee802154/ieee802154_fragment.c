@@ -23,6 +23,8 @@
 #include "ieee802154_fragment.h"
 
 #include "net_private.h"
+#include "net_stats.h"
+#include "reassembly.h"
 #include "6lo.h"
 #include "6lo_private.h"
 
@@ -34,11 +36,14 @@ static u16_t datagram_tag;
 
 /**
  *  Reassemble cache : Depends on cache size it used for reassemble
- *  IPv6 packets simultaneously.
+ *  IPv6 packets simultaneously. The received fragments are linked
+ *  together when the datagram is complete, their data is not copied.
  */
 struct frag_cache {
 	struct k_delayed_work timer;	/* Reassemble timer */
-	struct net_pkt *pkt;		/* Reassemble packet */
+	struct net_reass frags;		/* Received fragments */
+	struct net_if *iface;		/* Receiving interface */
+	struct net_linkaddr_storage src;	/* Sender of the datagram */
 	u16_t size;			/* Datagram size */
 	u16_t tag;			/* Datagram tag */
 	bool used;
@@ -307,12 +312,6 @@ static inline u16_t get_datagram_tag(u8_t *ptr)
 	return (ptr[0] << 8) | ptr[1];
 }
 
-static inline void remove_frag_header(struct net_buf *frag, u8_t hdr_len)
-{
-	memmove(frag->data, frag->data + hdr_len, frag->len - hdr_len);
-	frag->len -= hdr_len;
-}
-
 static void update_protocol_header_lengths(struct net_pkt *pkt, u16_t size)
 {
 	net_pkt_set_ip_hdr_len(pkt, NET_IPV6H_LEN);
@@ -334,25 +333,17 @@ static void update_protocol_header_lengths(struct net_pkt *pkt, u16_t size)
 	}
 }
 
-static inline void clear_reass_cache(u16_t size, u16_t tag)
+static void clear_reass_cache(struct frag_cache *cache)
 {
-	u8_t i;
+	net_stats_update_ieee802154_reass_pending(cache->iface,
+						  -(int)cache->frags.received);
 
-	for (i = 0; i < REASS_CACHE_SIZE; i++) {
-		if (!(cache[i].size == size && cache[i].tag == tag)) {
-			continue;
-		}
+	net_reass_clear(&cache->frags);
 
-		if (cache[i].pkt) {
-			net_pkt_unref(cache[i].pkt);
-		}
-
-		cache[i].pkt = NULL;
-		cache[i].size = 0;
-		cache[i].tag = 0;
-		cache[i].used = false;
-		k_delayed_work_cancel(&cache[i].timer);
-	}
+	cache->size = 0;
+	cache->tag = 0;
+	cache->used = false;
+	k_delayed_work_cancel(&cache->timer);
 }
 
 /**
@@ -363,14 +354,23 @@ static void reass_timeout(struct k_work *work)
 {
 	struct frag_cache *cache = CONTAINER_OF(work, struct frag_cache, timer);
 
-	if (cache->pkt) {
-		net_pkt_unref(cache->pkt);
+	NET_DBG("Reassembly of tag 0x%x timed out", cache->tag);
+
+	net_stats_update_ieee802154_reass_timeout(cache->iface);
+
+	clear_reass_cache(cache);
+}
+
+static inline bool same_src(struct frag_cache *cache, struct net_pkt *pkt)
+{
+	struct net_linkaddr *src = net_pkt_ll_src(pkt);
+
+	if (!src->addr) {
+		return !cache->src.len;
 	}
 
-	cache->pkt = NULL;
-	cache->size = 0;
-	cache->tag = 0;
-	cache->used = false;
+	return cache->src.len == src->len &&
+		!memcmp(cache->src.addr, src->addr, src->len);
 }
 
 /**
@@ -388,7 +388,13 @@ static inline struct frag_cache *set_reass_cache(struct net_pkt *pkt,
 			continue;
 		}
 
-		cache[i].pkt = pkt;
+		net_reass_init(&cache[i].frags);
+		net_reass_set_size(&cache[i].frags, size);
+
+		cache[i].src.len = 0;
+		net_linkaddr_set(&cache[i].src, net_pkt_ll_src(pkt)->addr,
+				 net_pkt_ll_src(pkt)->len);
+		cache[i].iface = net_pkt_iface(pkt);
 		cache[i].size = size;
 		cache[i].tag = tag;
 		cache[i].used = true;
@@ -402,17 +408,19 @@ static inline struct frag_cache *set_reass_cache(struct net_pkt *pkt,
 }
 
 /**
- *  Return cache if it matches with size and tag of stored caches,
+ *  Return cache if it matches with sender, size and tag of stored caches,
  *  otherwise return NULL.
  */
-static inline struct frag_cache *get_reass_cache(u16_t size, u16_t tag)
+static inline struct frag_cache *get_reass_cache(struct net_pkt *pkt,
+						 u16_t size, u16_t tag)
 {
 	u8_t i;
 
 	for (i = 0; i < REASS_CACHE_SIZE; i++) {
 		if (cache[i].used) {
 			if (cache[i].size == size &&
-			    cache[i].tag == tag) {
+			    cache[i].tag == tag &&
+			    same_src(&cache[i], pkt)) {
 				return &cache[i];
 			}
 		}
@@ -421,55 +429,40 @@ static inline struct frag_cache *get_reass_cache(u16_t size, u16_t tag)
 	return NULL;
 }
 
-/* Helper function to write fragment data to Rx packet based on offset. */
-static inline bool copy_frag(struct net_pkt *pkt,
-			     struct net_buf *frag,
-			     u16_t offset)
+/* How many bytes of fragments from this sender are waiting reassembly */
+static u32_t source_bytes(struct net_pkt *pkt)
 {
-	struct net_buf *input = frag;
-	struct net_buf *write;
-	u16_t pos = offset;
-
-	write = pkt->frags;
-
-	while (input) {
-		write = net_pkt_write(pkt, write, pos, &pos, input->len,
-				       input->data, NET_6LO_RX_PKT_TIMEOUT);
-		if (!write && pos == 0xffff) {
-			/* Free the new bufs we tried to get, we need to discard
-			 * the whole fragment chain.
-			 */
-			net_pkt_frag_unref(pkt->frags);
-			pkt->frags = NULL;
-
-			return false;
-		}
+	u32_t bytes = 0;
+	u8_t i;
 
-		input = input->frags;
+	for (i = 0; i < REASS_CACHE_SIZE; i++) {
+		if (cache[i].used && same_src(&cache[i], pkt)) {
+			bytes += cache[i].frags.received;
+		}
 	}
 
-	net_pkt_frag_unref(frag);
-
-	return true;
+	return bytes;
 }
 
 /**
  *  Parse size and tag from the fragment, check if we have any cache
  *  related to it. If not create a new cache.
  *  Remove the fragmentation header and uncompress IPv6 and related headers.
- *  Cache Rx part of fragment along with data buf for the first fragment
- *  in the cache, remaining fragments just cache data fragment, unref
- *  RX pkt. So in both the cases caller can assume packet is consumed.
+ *  The data buffers of the fragment are moved to the cache and the RX pkt
+ *  is released, so the caller can assume packet is consumed. When the last
+ *  missing fragment arrives, the buffers of all the fragments are attached
+ *  to its pkt.
  */
 static inline enum net_verdict add_frag_to_cache(struct net_pkt *pkt,
 						 bool first)
 {
 	struct frag_cache *cache;
-	struct net_buf *frag;
 	u16_t size;
 	u16_t tag;
 	u16_t offset = 0;
+	u16_t len;
 	u8_t pos = 0;
+	int ret;
 
 	/* Parse total size of packet */
 	size = get_datagram_size(pkt->frags->data);
@@ -484,88 +477,86 @@ static inline enum net_verdict add_frag_to_cache(struct net_pkt *pkt,
 		pos++;
 	}
 
-	/* Remove frag header and update data */
-	remove_frag_header(pkt->frags, pos);
+	/* Remove frag header */
+	net_buf_pull(pkt->frags, pos);
+
+	cache = get_reass_cache(pkt, size, tag);
 
 	/* Uncompress the IP headers */
 	if (first && !net_6lo_uncompress(pkt)) {
 		NET_ERR("Could not uncompress first frag's 6lo hdr");
-		clear_reass_cache(size, tag);
 
-		return NET_DROP;
-	}
+		if (cache) {
+			clear_reass_cache(cache);
+		}
 
-	/* If there are no fragments in the cache means this frag
-	 * is the first one. So cache Rx pkt otherwise not.
-	 * Write data fragment data to cached Rx based on offset parameter.
-	 * (Detach data fragment from incoming Rx and copy that data).
-	 */
+		goto drop;
+	}
 
-	frag = pkt->frags;
-	pkt->frags = NULL;
+	len = net_pkt_get_len(pkt);
 
-	cache = get_reass_cache(size, tag);
 	if (!cache) {
+		if (source_bytes(pkt) + size >
+		    CONFIG_NET_REASSEMBLY_SOURCE_MAX_BYTES) {
+			NET_DBG("Too much pending data from sender");
+			goto drop;
+		}
+
 		cache = set_reass_cache(pkt, size, tag);
 		if (!cache) {
 			NET_ERR("Could not get a cache entry");
-			pkt->frags = frag;
-			return NET_DROP;
-		}
-
-		/* If write failed, then attach frag back to incoming packet
-		 * and return NET_DROP, caller will take care of freeing it.
-		 */
-		if (!copy_frag(cache->pkt, frag, offset)) {
-			pkt->frags = frag;
-
-			/* Initialize to NULL to prevent duble free. It's only
-			 * needed here because this is the first fragment.
-			 */
-			cache->pkt = NULL;
-
-			clear_reass_cache(size, tag);
-
-			NET_ERR("Copying frag failed");
-
-			return NET_DROP;
+			goto drop;
 		}
+	}
 
-		NET_DBG("packet inserted into cache");
-
-		return NET_OK;
+	ret = net_reass_add(&cache->frags, pkt->frags, offset, len);
+	if (ret == -EALREADY) {
+		NET_DBG("Duplicate fragment offset %u tag 0x%x", offset, tag);
+		goto drop;
 	}
 
-	/* Add data packet to reassembly packet */
-	if (!copy_frag(cache->pkt, frag, offset)) {
-		pkt->frags = frag;
+	if (ret < 0) {
+		NET_DBG("Cannot add fragment offset %u tag 0x%x (%d)",
+			offset, tag, ret);
+		clear_reass_cache(cache);
+		goto drop;
+	}
 
-		clear_reass_cache(size, tag);
+	net_stats_update_ieee802154_reass_pending(cache->iface, len);
 
-		return NET_DROP;
-	}
+	pkt->frags = NULL;
 
 	/* Check if all the fragments are received or not */
-	if (net_pkt_get_len(cache->pkt) == size) {
+	if (net_reass_complete(&cache->frags)) {
+		net_stats_update_ieee802154_reass_done(cache->iface);
+		net_stats_update_ieee802154_reass_pending(cache->iface,
+							  -(int)size);
+
 		/* Assign frags back to input packet. */
-		pkt->frags = cache->pkt->frags;
-		cache->pkt->frags = NULL;
+		pkt->frags = net_reass_splice(&cache->frags);
 
 		/* Lengths are elided in compression, so calculate it. */
 		update_protocol_header_lengths(pkt, cache->size);
 
 		/* Once reassemble is done, cache is no longer needed. */
-		clear_reass_cache(size, tag);
+		clear_reass_cache(cache);
 
 		NET_DBG("All fragments received and reassembled");
 
 		return NET_CONTINUE;
 	}
 
+	NET_DBG("packet inserted into cache");
+
 	/* Unref Rx part of original packet */
 	net_pkt_unref(pkt);
 
 	return NET_OK;
+
+drop:
+	net_stats_update_ieee802154_reass_drop(net_pkt_iface(pkt));
+
+	return NET_DROP;
 }
 
 enum net_verdict ieee802154_reassemble(struct net_pkt *pkt)
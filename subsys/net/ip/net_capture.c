@@ -0,0 +1,662 @@
+/** @file
+ * @brief Network packet capture
+ *
+ * Packets are written as pcapng Enhanced Packet Blocks to a ring buffer
+ * by the network threads and drivers, and a low priority thread writes
+ * them to the capture output.
+ */
+
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(CONFIG_NET_DEBUG_CORE)
+#define SYS_LOG_DOMAIN "net/capture"
+#define NET_LOG_ENABLED 1
+#endif
+
+#include <kernel.h>
+#include <string.h>
+#include <errno.h>
+#include <atomic.h>
+
+#include <net/net_core.h>
+#include <net/net_pkt.h>
+#include <net/net_if.h>
+#include <net/net_l2.h>
+#include <net/net_context.h>
+#include <net/ethernet.h>
+#include <net/net_capture.h>
+
+#if defined(CONFIG_NET_CAPTURE_OUTPUT_UART)
+#include <uart.h>
+#endif
+
+#include "net_private.h"
+
+#if defined(CONFIG_NET_CAPTURE_OUTPUT_FILE)
+#include "net_capture_posix_priv.h"
+#endif
+
+BUILD_ASSERT_MSG((CONFIG_NET_CAPTURE_BUF_SIZE &
+		  (CONFIG_NET_CAPTURE_BUF_SIZE - 1)) == 0,
+		 "CONFIG_NET_CAPTURE_BUF_SIZE must be a power of two");
+
+/* pcapng block types and link types */
+#define PCAPNG_SHB		0x0A0D0D0A
+#define PCAPNG_IDB		0x00000001
+#define PCAPNG_EPB		0x00000006
+#define PCAPNG_BYTE_ORDER	0x1A2B3C4D
+#define PCAPNG_OPT_END		0
+#define PCAPNG_OPT_EPB_FLAGS	2
+#define PCAPNG_EPB_INBOUND	1
+#define PCAPNG_EPB_OUTBOUND	2
+
+#define LINKTYPE_ETHERNET	1
+#define LINKTYPE_RAW		101
+
+struct pcapng_shb {
+	u32_t type;
+	u32_t len;
+	u32_t byte_order;
+	u16_t major;
+	u16_t minor;
+	u32_t section_len[2];
+	u32_t len_trailer;
+};
+
+struct pcapng_idb {
+	u32_t type;
+	u32_t len;
+	u16_t link_type;
+	u16_t reserved;
+	u32_t snap_len;
+	u32_t len_trailer;
+};
+
+struct pcapng_epb {
+	u32_t type;
+	u32_t len;
+	u32_t if_id;
+	u32_t ts_high;
+	u32_t ts_low;
+	u32_t cap_len;
+	u32_t orig_len;
+};
+
+struct pcapng_epb_trailer {
+	u16_t flags_code;
+	u16_t flags_len;
+	u32_t flags;
+	u16_t end_code;
+	u16_t end_len;
+	u32_t len;
+};
+
+#define EPB_LEN(cap_len) (sizeof(struct pcapng_epb) +			\
+			  ROUND_UP(cap_len, 4) +			\
+			  sizeof(struct pcapng_epb_trailer))
+
+BUILD_ASSERT_MSG(EPB_LEN(CONFIG_NET_CAPTURE_SNAPLEN) + 4 <=
+		 CONFIG_NET_CAPTURE_BUF_SIZE / 2,
+		 "CONFIG_NET_CAPTURE_BUF_SIZE too small for the snap length");
+
+/* Enough of the packet to find the ports behind an Ethernet and VLAN
+ * header and an IPv6 header.
+ */
+#define FILTER_HDR_LEN 64
+
+/* Every record in the ring starts with a word that tells its length,
+ * including the word itself. The word stays zero until the record has
+ * been written completely, so the output thread stops there. The
+ * output thread zeroes the records it has written out, so the free part
+ * of the ring is all zeroes. Records are not split at the end of the
+ * ring, the end is skipped with a pad record instead.
+ */
+#define REC_VALID	BIT(31)
+#define REC_PAD		BIT(30)
+#define REC_LEN_MASK	0xffffff
+
+#define RING_SIZE	CONFIG_NET_CAPTURE_BUF_SIZE
+#define RING_MASK	(RING_SIZE - 1)
+
+static atomic_t ring[RING_SIZE / sizeof(atomic_t)];
+
+/* Free running byte counters. The head is advanced by any number of
+ * producers with compare and swap, the tail only by the output thread.
+ */
+static atomic_t ring_head;
+static atomic_t ring_tail;
+
+static K_SEM_DEFINE(ring_sem, 0, 1);
+
+/* Bit per network interface index */
+static atomic_t capture_ifaces;
+static bool header_sent;
+
+static struct net_capture_filter filter;
+
+static atomic_t captured;
+static atomic_t filtered;
+static atomic_t dropped;
+static u32_t written;
+
+NET_STACK_DEFINE(CAPTURE, capture_stack, CONFIG_NET_CAPTURE_STACK_SIZE,
+		 CONFIG_NET_CAPTURE_STACK_SIZE);
+static struct k_thread capture_thread_data;
+
+#if defined(CONFIG_NET_CAPTURE_OUTPUT_FILE)
+static int output_fd = -1;
+
+static int output_open(void)
+{
+	if (output_fd >= 0) {
+		return 0;
+	}
+
+	output_fd = net_capture_file_open(CONFIG_NET_CAPTURE_FILE_NAME);
+	if (output_fd < 0) {
+		NET_ERR("Cannot open %s (%d)", CONFIG_NET_CAPTURE_FILE_NAME,
+			output_fd);
+		return output_fd;
+	}
+
+	return 0;
+}
+
+static int output_write(const void *data, size_t len)
+{
+	return net_capture_file_write(output_fd, data, len);
+}
+
+#define output_is_own_pkt(pkt) false
+
+#elif defined(CONFIG_NET_CAPTURE_OUTPUT_UART)
+static struct device *output_dev;
+
+static int output_open(void)
+{
+	if (output_dev) {
+		return 0;
+	}
+
+	output_dev = device_get_binding(CONFIG_NET_CAPTURE_UART_DEV_NAME);
+	if (!output_dev) {
+		NET_ERR("Cannot find %s", CONFIG_NET_CAPTURE_UART_DEV_NAME);
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+static int output_write(const void *data, size_t len)
+{
+	const u8_t *ptr = data;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		uart_poll_out(output_dev, ptr[i]);
+	}
+
+	return 0;
+}
+
+#define output_is_own_pkt(pkt) false
+
+#elif defined(CONFIG_NET_CAPTURE_OUTPUT_UDP)
+static struct net_context *output_ctx;
+static struct sockaddr output_peer;
+
+static int output_open(void)
+{
+	sa_family_t family;
+	int ret;
+
+	if (output_ctx) {
+		return 0;
+	}
+
+	memset(&output_peer, 0, sizeof(output_peer));
+
+	if (strchr(CONFIG_NET_CAPTURE_PEER_ADDR, ':')) {
+		family = AF_INET6;
+		net_sin6(&output_peer)->sin6_port =
+			htons(CONFIG_NET_CAPTURE_PEER_PORT);
+		ret = net_addr_pton(AF_INET6, CONFIG_NET_CAPTURE_PEER_ADDR,
+				    &net_sin6(&output_peer)->sin6_addr);
+	} else {
+		family = AF_INET;
+		net_sin(&output_peer)->sin_port =
+			htons(CONFIG_NET_CAPTURE_PEER_PORT);
+		ret = net_addr_pton(AF_INET, CONFIG_NET_CAPTURE_PEER_ADDR,
+				    &net_sin(&output_peer)->sin_addr);
+	}
+
+	if (ret < 0) {
+		NET_ERR("Invalid capture peer %s",
+			CONFIG_NET_CAPTURE_PEER_ADDR);
+		return ret;
+	}
+
+	output_peer.sa_family = family;
+
+	ret = net_context_get(family, SOCK_DGRAM, IPPROTO_UDP, &output_ctx);
+	if (ret < 0) {
+		NET_ERR("Cannot get capture context (%d)", ret);
+		output_ctx = NULL;
+		return ret;
+	}
+
+	return 0;
+}
+
+/* Every block is sent in its own datagram */
+static int output_write(const void *data, size_t len)
+{
+	struct net_pkt *pkt;
+	int ret;
+
+	pkt = net_pkt_get_tx(output_ctx, K_MSEC(100));
+	if (!pkt) {
+		return -ENOMEM;
+	}
+
+	if (!net_pkt_append_all(pkt, len, data, K_MSEC(100))) {
+		net_pkt_unref(pkt);
+		return -ENOMEM;
+	}
+
+	ret = net_context_sendto(pkt, &output_peer, sizeof(output_peer),
+				 NULL, K_NO_WAIT, NULL, NULL);
+	if (ret < 0) {
+		net_pkt_unref(pkt);
+		return ret;
+	}
+
+	return 0;
+}
+
+/* Do not capture the packets carrying the capture */
+#define output_is_own_pkt(pkt) \
+	(output_ctx && net_pkt_context(pkt) == output_ctx)
+#endif
+
+static inline bool iface_has_ll(struct net_if *iface)
+{
+#if defined(CONFIG_NET_L2_ETHERNET)
+	return net_if_l2(iface) == &NET_L2_GET_NAME(ETHERNET);
+#else
+	ARG_UNUSED(iface);
+
+	return false;
+#endif
+}
+
+static void write_idb(struct net_if *iface, void *user_data)
+{
+	struct pcapng_idb idb = {
+		.type = PCAPNG_IDB,
+		.len = sizeof(idb),
+		.link_type = iface_has_ll(iface) ? LINKTYPE_ETHERNET :
+			LINKTYPE_RAW,
+		.snap_len = CONFIG_NET_CAPTURE_SNAPLEN,
+		.len_trailer = sizeof(idb),
+	};
+
+	ARG_UNUSED(user_data);
+
+	if (output_write(&idb, sizeof(idb)) == 0) {
+		written += sizeof(idb);
+	}
+}
+
+/* The interface ids of the packet blocks are the network interface
+ * indexes, so describe all the interfaces in index order.
+ */
+static void write_header(void)
+{
+	struct pcapng_shb shb = {
+		.type = PCAPNG_SHB,
+		.len = sizeof(shb),
+		.byte_order = PCAPNG_BYTE_ORDER,
+		.major = 1,
+		.minor = 0,
+		.section_len = { 0xffffffff, 0xffffffff },
+		.len_trailer = sizeof(shb),
+	};
+
+	if (output_write(&shb, sizeof(shb)) == 0) {
+		written += sizeof(shb);
+	}
+
+	net_if_foreach(write_idb, NULL);
+
+	header_sent = true;
+}
+
+static void capture_thread(void)
+{
+	u32_t tail;
+	u32_t hdr;
+	u32_t len;
+
+	while (true) {
+		k_sem_take(&ring_sem, K_FOREVER);
+
+		if (!header_sent) {
+			write_header();
+		}
+
+		tail = atomic_get(&ring_tail);
+
+		while (tail != (u32_t)atomic_get(&ring_head)) {
+			atomic_t *rec = &ring[(tail & RING_MASK) /
+					      sizeof(atomic_t)];
+
+			hdr = atomic_get(rec);
+			if (!(hdr & REC_VALID)) {
+				/* Still being written, the producer
+				 * wakes us up when it is done.
+				 */
+				break;
+			}
+
+			len = hdr & REC_LEN_MASK;
+
+			if (!(hdr & REC_PAD) &&
+			    output_write(rec + 1, len - sizeof(*rec)) == 0) {
+				written += len - sizeof(*rec);
+			}
+
+			/* A later record can start anywhere in this one,
+			 * so none of its words may look like a header.
+			 */
+			memset(rec, 0, len);
+
+			tail += len;
+			atomic_set(&ring_tail, tail);
+		}
+	}
+}
+
+/* Reserve len bytes from the ring, returns the offset of the record or
+ * a negative value if there is no room.
+ */
+static int ring_reserve(u32_t len)
+{
+	atomic_val_t head;
+	u32_t pos;
+	u32_t need;
+
+	do {
+		head = atomic_get(&ring_head);
+		pos = head & RING_MASK;
+		need = len;
+
+		if (pos + len > RING_SIZE) {
+			need += RING_SIZE - pos;
+		}
+
+		if ((u32_t)head + need - (u32_t)atomic_get(&ring_tail) >
+		    RING_SIZE) {
+			return -ENOMEM;
+		}
+	} while (!atomic_cas(&ring_head, head, head + need));
+
+	if (need != len) {
+		atomic_set(&ring[pos / sizeof(atomic_t)],
+			   REC_VALID | REC_PAD | (RING_SIZE - pos));
+		pos = 0;
+	}
+
+	return pos;
+}
+
+static u16_t copy_pkt(struct net_pkt *pkt, u16_t ll_len, u8_t *dst,
+		      u16_t len)
+{
+	struct net_buf *frag;
+	u16_t copied = min(ll_len, len);
+
+	memcpy(dst, net_pkt_ll(pkt), copied);
+
+	for (frag = pkt->frags; frag && copied < len; frag = frag->frags) {
+		u16_t count = min(frag->len, len - copied);
+
+		memcpy(dst + copied, frag->data, count);
+		copied += count;
+	}
+
+	return copied;
+}
+
+static bool filter_match(struct net_pkt *pkt, u16_t ll_len, bool has_ll)
+{
+	u8_t hdr[FILTER_HDR_LEN];
+	u16_t len = copy_pkt(pkt, ll_len, hdr, sizeof(hdr));
+	u16_t offset = 0;
+	sa_family_t family;
+	u8_t proto;
+	u16_t port;
+
+	if (has_ll) {
+		u16_t type;
+
+		if (len < sizeof(struct net_eth_hdr)) {
+			return false;
+		}
+
+		type = (hdr[12] << 8) | hdr[13];
+		offset = sizeof(struct net_eth_hdr);
+
+		if (type == NET_ETH_PTYPE_VLAN && len >= offset + 4) {
+			type = (hdr[16] << 8) | hdr[17];
+			offset += 4;
+		}
+
+		if (type != NET_ETH_PTYPE_IP && type != NET_ETH_PTYPE_IPV6) {
+			return false;
+		}
+	}
+
+	if (len <= offset) {
+		return false;
+	}
+
+	switch (hdr[offset] >> 4) {
+	case 4:
+		if (len < offset + NET_IPV4H_LEN) {
+			return false;
+		}
+
+		family = AF_INET;
+		proto = hdr[offset + 9];
+		offset += (hdr[offset] & 0x0f) * 4;
+		break;
+	case 6:
+		if (len < offset + NET_IPV6H_LEN) {
+			return false;
+		}
+
+		family = AF_INET6;
+		proto = hdr[offset + 6];
+		offset += NET_IPV6H_LEN;
+		break;
+	default:
+		return false;
+	}
+
+	if (filter.family && filter.family != family) {
+		return false;
+	}
+
+	if (filter.proto && filter.proto != proto) {
+		return false;
+	}
+
+	if (!filter.port) {
+		return true;
+	}
+
+	if ((proto != IPPROTO_UDP && proto != IPPROTO_TCP) ||
+	    len < offset + 4) {
+		return false;
+	}
+
+	port = htons(filter.port);
+
+	return !memcmp(&hdr[offset], &port, 2) ||
+		!memcmp(&hdr[offset + 2], &port, 2);
+}
+
+void net_capture_pkt(struct net_if *iface, struct net_pkt *pkt,
+		     enum net_capture_point point)
+{
+	struct pcapng_epb_trailer trailer;
+	struct pcapng_epb epb;
+	u8_t idx = net_if_get_by_iface(iface);
+	bool outbound;
+	bool has_ll;
+	u16_t ll_len;
+	u32_t len;
+	u8_t *rec;
+	u64_t ts;
+	int pos;
+
+	if (idx >= 32 || !atomic_test_bit(&capture_ifaces, idx) ||
+	    !pkt->frags) {
+		return;
+	}
+
+	/* Link layer interfaces are captured with their link layer
+	 * headers, others as IP packets.
+	 */
+	has_ll = iface_has_ll(iface);
+	if (has_ll != (point == NET_CAPTURE_RX_LL ||
+		       point == NET_CAPTURE_TX_LL)) {
+		return;
+	}
+
+	if (output_is_own_pkt(pkt)) {
+		return;
+	}
+
+	ll_len = has_ll ? net_pkt_ll_reserve(pkt) : 0;
+
+	if ((filter.family || filter.proto || filter.port) &&
+	    !filter_match(pkt, ll_len, has_ll)) {
+		atomic_inc(&filtered);
+		return;
+	}
+
+	outbound = point == NET_CAPTURE_TX_LL || point == NET_CAPTURE_TX_IP;
+	ts = (u64_t)k_uptime_get() * USEC_PER_MSEC;
+
+	epb.type = PCAPNG_EPB;
+	epb.if_id = idx;
+	epb.ts_high = ts >> 32;
+	epb.ts_low = (u32_t)ts;
+	epb.orig_len = ll_len + net_pkt_get_len(pkt);
+	epb.cap_len = min(epb.orig_len, CONFIG_NET_CAPTURE_SNAPLEN);
+	epb.len = EPB_LEN(epb.cap_len);
+
+	len = sizeof(atomic_t) + epb.len;
+
+	pos = ring_reserve(len);
+	if (pos < 0) {
+		atomic_inc(&dropped);
+		return;
+	}
+
+	rec = (u8_t *)ring + pos + sizeof(atomic_t);
+
+	memcpy(rec, &epb, sizeof(epb));
+	rec += sizeof(epb);
+
+	copy_pkt(pkt, ll_len, rec, epb.cap_len);
+	memset(rec + epb.cap_len, 0, ROUND_UP(epb.cap_len, 4) - epb.cap_len);
+	rec += ROUND_UP(epb.cap_len, 4);
+
+	trailer.flags_code = PCAPNG_OPT_EPB_FLAGS;
+	trailer.flags_len = sizeof(trailer.flags);
+	trailer.flags = outbound ? PCAPNG_EPB_OUTBOUND : PCAPNG_EPB_INBOUND;
+	trailer.end_code = PCAPNG_OPT_END;
+	trailer.end_len = 0;
+	trailer.len = epb.len;
+	memcpy(rec, &trailer, sizeof(trailer));
+
+	atomic_set(&ring[pos / sizeof(atomic_t)], REC_VALID | len);
+	atomic_inc(&captured);
+
+	k_sem_give(&ring_sem);
+}
+
+int net_capture_enable(struct net_if *iface)
+{
+	u8_t idx = net_if_get_by_iface(iface);
+	int ret;
+
+	if (idx >= 32) {
+		return -EINVAL;
+	}
+
+	ret = output_open();
+	if (ret < 0) {
+		return ret;
+	}
+
+	atomic_set_bit(&capture_ifaces, idx);
+
+	/* Write the section header even if nothing is captured yet */
+	k_sem_give(&ring_sem);
+
+	return 0;
+}
+
+void net_capture_disable(struct net_if *iface)
+{
+	u8_t idx = net_if_get_by_iface(iface);
+
+	if (idx < 32) {
+		atomic_clear_bit(&capture_ifaces, idx);
+	}
+}
+
+bool net_capture_is_enabled(struct net_if *iface)
+{
+	u8_t idx = net_if_get_by_iface(iface);
+
+	return idx < 32 && atomic_test_bit(&capture_ifaces, idx);
+}
+
+void net_capture_set_filter(const struct net_capture_filter *new_filter)
+{
+	if (new_filter) {
+		filter = *new_filter;
+	} else {
+		memset(&filter, 0, sizeof(filter));
+	}
+}
+
+void net_capture_get_filter(struct net_capture_filter *current)
+{
+	*current = filter;
+}
+
+void net_capture_get_stats(struct net_capture_stats *stats)
+{
+	stats->captured = atomic_get(&captured);
+	stats->filtered = atomic_get(&filtered);
+	stats->dropped = atomic_get(&dropped);
+	stats->written = written;
+}
+
+void net_capture_init(void)
+{
+	k_thread_create(&capture_thread_data, capture_stack,
+			K_THREAD_STACK_SIZEOF(capture_stack),
+			(k_thread_entry_t)capture_thread, NULL, NULL, NULL,
+			K_PRIO_PREEMPT(CONFIG_NET_CAPTURE_THREAD_PRIO), 0, 0);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ *
+ * Routines writing the packet capture to a host file. Those are placed in
+ * separate file because there is naming conflicts between host and zephyr
+ * network stacks.
+ */
+
+#define _DEFAULT_SOURCE
+
+/* Host include files */
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "net_capture_posix_priv.h"
+
+int net_capture_file_open(const char *name)
+{
+	int fd;
+
+	fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		return -errno;
+	}
+
+	return fd;
+}
+
+int net_capture_file_write(int fd, const void *buf, size_t buf_len)
+{
+	const char *ptr = buf;
+	ssize_t ret;
+
+	while (buf_len) {
+		ret = write(fd, ptr, buf_len);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return -errno;
+		}
+
+		ptr += ret;
+		buf_len -= ret;
+	}
+
+	return 0;
+}
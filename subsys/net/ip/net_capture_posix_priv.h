@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/** @file
+ * @brief Private functions for writing the packet capture to a host file.
+ */
+
+#ifndef _NET_CAPTURE_POSIX_PRIV_H
+#define _NET_CAPTURE_POSIX_PRIV_H
+
+int net_capture_file_open(const char *name);
+int net_capture_file_write(int fd, const void *buf, size_t buf_len);
+
+#endif /* _NET_CAPTURE_POSIX_PRIV_H */
@@ -892,6 +892,8 @@ static int sendto(struct net_pkt *pkt,
 		return -EDESTADDRREQ;
 	}
 
+	net_stats_update_latency(pkt, NET_STATS_LATENCY_TX_APP);
+
 #if defined(CONFIG_NET_IPV6)
 	if (net_pkt_family(pkt) == AF_INET6) {
 		struct sockaddr_in6 *addr6 = (struct sockaddr_in6 *)dst_addr;
@@ -942,6 +944,15 @@ static int sendto(struct net_pkt *pkt,
 			return ret;
 		}
 
+		/* UDP has no flow control of its own, so the packets
+		 * waiting to be sent are limited by the TX quota. TCP
+		 * is limited by its send window instead.
+		 */
+		ret = net_quota_charge_tx(pkt);
+		if (ret) {
+			return ret;
+		}
+
 		ret = create_udp_packet(context, pkt, dst_addr, &pkt);
 #endif /* CONFIG_NET_UDP */
 		break;
@@ -1105,6 +1116,13 @@ enum net_verdict net_context_packet_received(struct net_conn *conn,
 		return NET_DROP;
 	}
 
+	/* TCP packets are charged earlier in tcp_established(), before
+	 * the data is acknowledged.
+	 */
+	if (!net_quota_charge_rx_context(context, pkt)) {
+		return NET_DROP;
+	}
+
 	if (net_context_get_ip_proto(context) != IPPROTO_TCP) {
 		/* TCP packets get appdata earlier in tcp_established(). */
 		net_context_set_appdata_values(pkt, IPPROTO_UDP);
@@ -1308,6 +1326,10 @@ int net_context_set_option(struct net_context *context,
 	case NET_OPT_PRIORITY:
 		ret = set_context_priority(context, value, len);
 		break;
+	case NET_OPT_TCP_NODELAY:
+	case NET_OPT_TCP_CORK:
+		ret = net_tcp_set_option(context, option, value, len);
+		break;
 	}
 
 	return ret;
@@ -1329,6 +1351,10 @@ int net_context_get_option(struct net_context *context,
 	case NET_OPT_PRIORITY:
 		ret = get_context_priority(context, value, len);
 		break;
+	case NET_OPT_TCP_NODELAY:
+	case NET_OPT_TCP_CORK:
+		ret = net_tcp_get_option(context, option, value, len);
+		break;
 	}
 
 	return ret;
@@ -1353,5 +1379,17 @@ void net_context_foreach(net_context_cb_t cb, void *user_data)
 
 void net_context_init(void)
 {
+#if defined(CONFIG_NET_QUOTA)
+	int i;
+
+	/* The quotas are not reset when a context is reused, as the
+	 * packets of the previous user may still be queued.
+	 */
+	for (i = 0; i < NET_MAX_CONTEXT; i++) {
+		net_quota_init(&contexts[i].quota,
+			       CONFIG_NET_QUOTA_CONTEXT_TX);
+	}
+#endif
+
 	k_sem_init(&contexts_lock, 1, UINT_MAX);
 }
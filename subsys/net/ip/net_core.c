@@ -52,6 +52,296 @@
 
 #include "net_stats.h"
 
+static enum net_verdict process_ip(struct net_pkt *pkt)
+{
+	net_stats_update_latency(pkt, NET_STATS_LATENCY_RX_L3);
+
+	/* IP version and header length. */
+	switch (NET_IPV6_HDR(pkt)->vtc & 0xf0) {
+#if defined(CONFIG_NET_IPV6)
+	case 0x60:
+		net_stats_update_ipv6_recv(net_pkt_iface(pkt));
+		net_pkt_set_family(pkt, PF_INET6);
+		return net_ipv6_process_pkt(pkt);
+#endif
+#if defined(CONFIG_NET_IPV4)
+	case 0x40:
+		net_stats_update_ipv4_recv(net_pkt_iface(pkt));
+		net_pkt_set_family(pkt, PF_INET);
+		return net_ipv4_process_pkt(pkt);
+#endif
+	}
+
+	NET_DBG("Unknown IP family packet (0x%x)",
+		NET_IPV6_HDR(pkt)->vtc & 0xf0);
+	net_stats_update_ip_errors_protoerr(net_pkt_iface(pkt));
+	net_stats_update_ip_errors_vhlerr(net_pkt_iface(pkt));
+
+	return NET_DROP;
+}
+
+#if defined(CONFIG_NET_GRO)
+/* Receive offload. In-order TCP segments of one connection that are
+ * received back to back are merged into the first of them before the
+ * IP layer sees them. The merged packet is passed on when a segment
+ * arrives that cannot be merged, or when the RX queue runs empty at
+ * the end of the burst. Each traffic class is run by its own thread so
+ * the state needs no locking.
+ */
+struct net_gro {
+	/** Packet that the following segments are merged into */
+	struct net_pkt *pkt;
+
+	/** Sequence number of the next in-order segment */
+	u32_t next_seq;
+
+	/** Length of the merged IP packet */
+	u16_t len;
+
+	/** Length of the IP and TCP headers */
+	u16_t hdr_len;
+
+	/** Number of segments merged */
+	u8_t count;
+};
+
+static struct net_gro gro_state[NET_TC_RX_COUNT];
+
+/* Return the TCP header of a segment sent to us that could be merged,
+ * NULL if the packet is something else. All the headers must be in the
+ * first fragment.
+ */
+static struct net_tcp_hdr *gro_get_tcp_hdr(struct net_pkt *pkt,
+					   u16_t *len, u16_t *hdr_len)
+{
+	struct net_buf *frag = pkt->frags;
+	struct net_tcp_hdr *tcp_hdr;
+	u16_t ip_hdr_len;
+
+	switch (NET_IPV6_HDR(pkt)->vtc & 0xf0) {
+#if defined(CONFIG_NET_IPV6)
+	case 0x60: {
+		struct net_ipv6_hdr *hdr = NET_IPV6_HDR(pkt);
+
+		ip_hdr_len = sizeof(*hdr);
+		if (frag->len < ip_hdr_len || hdr->nexthdr != IPPROTO_TCP ||
+		    !net_is_my_ipv6_addr(&hdr->dst)) {
+			return NULL;
+		}
+
+		*len = sys_get_be16(hdr->len) + ip_hdr_len;
+		net_pkt_set_family(pkt, AF_INET6);
+		break;
+	}
+#endif
+#if defined(CONFIG_NET_IPV4)
+	case 0x40: {
+		struct net_ipv4_hdr *hdr = NET_IPV4_HDR(pkt);
+
+		ip_hdr_len = sizeof(*hdr);
+		if (frag->len < ip_hdr_len || hdr->vhl != 0x45 ||
+		    hdr->proto != IPPROTO_TCP ||
+		    (sys_get_be16(hdr->offset) & 0x3fff) ||
+		    !net_is_my_ipv4_addr(&hdr->dst)) {
+			return NULL;
+		}
+
+		*len = sys_get_be16(hdr->len);
+		net_pkt_set_family(pkt, AF_INET);
+		break;
+	}
+#endif
+	default:
+		return NULL;
+	}
+
+	if (frag->len < ip_hdr_len + NET_TCPH_LEN) {
+		return NULL;
+	}
+
+	tcp_hdr = (struct net_tcp_hdr *)(frag->data + ip_hdr_len);
+	*hdr_len = ip_hdr_len + NET_TCP_HDR_LEN(tcp_hdr);
+
+	/* Only plain data segments, with PSH at most */
+	if ((tcp_hdr->flags & ~NET_TCP_PSH) != NET_TCP_ACK ||
+	    NET_TCP_HDR_LEN(tcp_hdr) < NET_TCPH_LEN ||
+	    frag->len < *hdr_len || *len <= *hdr_len ||
+	    *len != net_pkt_get_len(pkt)) {
+		return NULL;
+	}
+
+	net_pkt_set_ip_hdr_len(pkt, ip_hdr_len);
+	net_pkt_set_ipv6_ext_len(pkt, 0);
+
+	return tcp_hdr;
+}
+
+static bool gro_check_chksum(struct net_pkt *pkt)
+{
+	if (!IS_ENABLED(CONFIG_NET_TCP_CHECKSUM) ||
+	    !net_if_need_calc_rx_checksum(net_pkt_iface(pkt))) {
+		return true;
+	}
+
+	/* The sum over a valid segment, checksum included, is 0xffff */
+	if (net_calc_chksum_tcp(pkt) != 0xffff) {
+		return false;
+	}
+
+	net_pkt_set_chksum_ok(pkt, true);
+
+	return true;
+}
+
+/* Segments of the same flow have the same IP header apart from the
+ * length and id, and the same TCP header apart from the sequence
+ * number, flags and checksum.
+ */
+static bool gro_same_flow(struct net_gro *gro, struct net_pkt *pkt,
+			  struct net_tcp_hdr *tcp_hdr, u16_t hdr_len)
+{
+	struct net_tcp_hdr *held = net_pkt_tcp_data(gro->pkt);
+	u8_t *ip = net_pkt_ip_data(pkt);
+	u8_t *held_ip = net_pkt_ip_data(gro->pkt);
+
+	if (hdr_len != gro->hdr_len ||
+	    net_pkt_family(pkt) != net_pkt_family(gro->pkt) ||
+	    net_pkt_iface(pkt) != net_pkt_iface(gro->pkt)) {
+		return false;
+	}
+
+	if (net_pkt_family(pkt) == AF_INET6) {
+		/* Version, traffic class, flow label */
+		if (memcmp(ip, held_ip, 4) ||
+		    NET_IPV6_HDR(pkt)->hop_limit !=
+		    NET_IPV6_HDR(gro->pkt)->hop_limit ||
+		    memcmp(&NET_IPV6_HDR(pkt)->src,
+			   &NET_IPV6_HDR(gro->pkt)->src,
+			   2 * sizeof(struct in6_addr))) {
+			return false;
+		}
+	} else {
+		if (NET_IPV4_HDR(pkt)->tos != NET_IPV4_HDR(gro->pkt)->tos ||
+		    NET_IPV4_HDR(pkt)->ttl != NET_IPV4_HDR(gro->pkt)->ttl ||
+		    memcmp(NET_IPV4_HDR(pkt)->offset,
+			   NET_IPV4_HDR(gro->pkt)->offset,
+			   sizeof(NET_IPV4_HDR(pkt)->offset)) ||
+		    memcmp(&NET_IPV4_HDR(pkt)->src,
+			   &NET_IPV4_HDR(gro->pkt)->src,
+			   2 * sizeof(struct in_addr))) {
+			return false;
+		}
+	}
+
+	return tcp_hdr->src_port == held->src_port &&
+		tcp_hdr->dst_port == held->dst_port &&
+		!memcmp(tcp_hdr->ack, held->ack, sizeof(held->ack)) &&
+		!memcmp(tcp_hdr->wnd, held->wnd, sizeof(held->wnd)) &&
+		!memcmp(tcp_hdr->optdata, held->optdata,
+			NET_TCP_HDR_LEN(tcp_hdr) - NET_TCPH_LEN);
+}
+
+static void gro_flush(struct net_gro *gro)
+{
+	struct net_pkt *pkt = gro->pkt;
+
+	if (!pkt) {
+		return;
+	}
+
+	gro->pkt = NULL;
+
+	if (gro->count > 1) {
+		NET_DBG("Merged %d segments into pkt %p len %u",
+			gro->count, pkt, gro->len);
+
+		if (net_pkt_family(pkt) == AF_INET6) {
+			sys_put_be16(gro->len - sizeof(struct net_ipv6_hdr),
+				     NET_IPV6_HDR(pkt)->len);
+		}
+#if defined(CONFIG_NET_IPV4)
+		else {
+			sys_put_be16(gro->len, NET_IPV4_HDR(pkt)->len);
+
+			NET_IPV4_HDR(pkt)->chksum = 0;
+			NET_IPV4_HDR(pkt)->chksum =
+				~net_calc_chksum_ipv4(pkt);
+		}
+#endif
+	}
+
+	if (process_ip(pkt) == NET_DROP) {
+		NET_DBG("Dropping pkt %p", pkt);
+		net_pkt_unref(pkt);
+	}
+}
+
+/* Returns NET_OK if the packet was held or merged, NET_CONTINUE if it
+ * must be processed as it is.
+ */
+static enum net_verdict gro_receive(struct net_pkt *pkt)
+{
+	struct net_gro *gro =
+		&gro_state[net_rx_priority2tc(net_pkt_priority(pkt))];
+	struct net_tcp_hdr *tcp_hdr;
+	u16_t hdr_len;
+	u16_t len;
+
+	tcp_hdr = gro_get_tcp_hdr(pkt, &len, &hdr_len);
+	if (!tcp_hdr) {
+		gro_flush(gro);
+		return NET_CONTINUE;
+	}
+
+	if (gro->pkt && sys_get_be32(tcp_hdr->seq) == gro->next_seq &&
+	    (u32_t)gro->len + len - hdr_len <= 0xffff &&
+	    gro_same_flow(gro, pkt, tcp_hdr, hdr_len)) {
+		if (!gro_check_chksum(pkt)) {
+			gro_flush(gro);
+			return NET_CONTINUE;
+		}
+
+		net_pkt_tcp_data(gro->pkt)->flags |= tcp_hdr->flags;
+
+		/* Only the data of the segment is kept */
+		net_buf_pull(pkt->frags, hdr_len);
+		if (!pkt->frags->len) {
+			pkt->frags = net_pkt_frag_del(pkt, NULL, pkt->frags);
+		}
+
+		net_pkt_frag_add(gro->pkt, pkt->frags);
+		pkt->frags = NULL;
+		net_pkt_unref(pkt);
+
+		gro->next_seq += len - hdr_len;
+		gro->len += len - hdr_len;
+		gro->count++;
+
+		/* The sender wants the data delivered now */
+		if ((tcp_hdr->flags & NET_TCP_PSH) ||
+		    gro->count == CONFIG_NET_GRO_MAX_SEGS) {
+			gro_flush(gro);
+		}
+
+		return NET_OK;
+	}
+
+	gro_flush(gro);
+
+	if ((tcp_hdr->flags & NET_TCP_PSH) || !gro_check_chksum(pkt)) {
+		return NET_CONTINUE;
+	}
+
+	gro->pkt = pkt;
+	gro->next_seq = sys_get_be32(tcp_hdr->seq) + len - hdr_len;
+	gro->len = len;
+	gro->hdr_len = hdr_len;
+	gro->count = 1;
+
+	return NET_OK;
+}
+#endif /* CONFIG_NET_GRO */
+
 static inline enum net_verdict process_data(struct net_pkt *pkt,
 					    bool is_loopback)
 {
@@ -87,30 +377,18 @@ static inline enum net_verdict process_data(struct net_pkt *pkt,
 
 			return ret;
 		}
-	}
 
-	/* IP version and header length. */
-	switch (NET_IPV6_HDR(pkt)->vtc & 0xf0) {
-#if defined(CONFIG_NET_IPV6)
-	case 0x60:
-		net_stats_update_ipv6_recv(net_pkt_iface(pkt));
-		net_pkt_set_family(pkt, PF_INET6);
-		return net_ipv6_process_pkt(pkt);
-#endif
-#if defined(CONFIG_NET_IPV4)
-	case 0x40:
-		net_stats_update_ipv4_recv(net_pkt_iface(pkt));
-		net_pkt_set_family(pkt, PF_INET);
-		return net_ipv4_process_pkt(pkt);
+		net_capture_pkt(net_pkt_iface(pkt), pkt, NET_CAPTURE_RX_IP);
+		net_stats_update_latency(pkt, NET_STATS_LATENCY_RX_L2);
+
+#if defined(CONFIG_NET_GRO)
+		if (gro_receive(pkt) == NET_OK) {
+			return NET_OK;
+		}
 #endif
 	}
 
-	NET_DBG("Unknown IP family packet (0x%x)",
-		NET_IPV6_HDR(pkt)->vtc & 0xf0);
-	net_stats_update_ip_errors_protoerr(net_pkt_iface(pkt));
-	net_stats_update_ip_errors_vhlerr(net_pkt_iface(pkt));
-
-	return NET_DROP;
+	return process_ip(pkt);
 }
 
 static void processing_data(struct net_pkt *pkt, bool is_loopback)
@@ -276,6 +554,9 @@ int net_send_data(struct net_pkt *pkt)
 		return 0;
 	}
 
+	net_capture_pkt(net_pkt_iface(pkt), pkt, NET_CAPTURE_TX_IP);
+	net_stats_update_latency(pkt, NET_STATS_LATENCY_TX_L3);
+
 	if (net_if_send_data(net_pkt_iface(pkt), pkt) == NET_DROP) {
 		return -EIO;
 	}
@@ -307,10 +588,24 @@ static void net_rx(struct net_if *iface, struct net_pkt *pkt)
 static void process_rx_packet(struct k_work *work)
 {
 	struct net_pkt *pkt;
+#if defined(CONFIG_NET_GRO)
+	u8_t tc;
+#endif
 
 	pkt = CONTAINER_OF(work, struct net_pkt, work);
 
+#if defined(CONFIG_NET_GRO)
+	tc = net_rx_priority2tc(net_pkt_priority(pkt));
+#endif
+
 	net_rx(net_pkt_iface(pkt), pkt);
+
+#if defined(CONFIG_NET_GRO)
+	/* The RX burst of the driver ends when nothing more is queued */
+	if (net_tc_rx_queue_is_empty(tc)) {
+		gro_flush(&gro_state[tc]);
+	}
+#endif
 }
 
 static void net_queue_rx(struct net_if *iface, struct net_pkt *pkt)
@@ -350,6 +645,11 @@ int net_recv_data(struct net_if *iface, struct net_pkt *pkt)
 		return -ENETDOWN;
 	}
 
+	if (!net_quota_charge_rx_iface(iface, pkt)) {
+		NET_DBG("iface %p RX quota exceeded", iface);
+		return -ENOBUFS;
+	}
+
 	NET_DBG("prio %d iface %p pkt %p len %zu", net_pkt_priority(pkt),
 		iface, pkt, net_pkt_get_len(pkt));
 
@@ -359,6 +659,9 @@ int net_recv_data(struct net_if *iface, struct net_pkt *pkt)
 
 	net_pkt_set_iface(pkt, iface);
 
+	net_capture_pkt(iface, pkt, NET_CAPTURE_RX_LL);
+	net_stats_update_latency(pkt, NET_STATS_LATENCY_RX_DRIVER);
+
 	net_queue_rx(iface, pkt);
 
 	return 0;
@@ -407,6 +710,8 @@ static int net_init(struct device *unused)
 
 	net_mgmt_event_init();
 
+	net_capture_init();
+
 	init_rx_queues();
 
 #if CONFIG_NET_DHCPV4
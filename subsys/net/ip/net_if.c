@@ -142,7 +142,19 @@ static bool net_if_tx(struct net_if *iface, struct net_pkt *pkt)
 			net_pkt_set_queued(pkt, false);
 		}
 
-		status = api->send(iface, pkt);
+		net_stats_update_latency(pkt, NET_STATS_LATENCY_TX_DRIVER);
+
+#if defined(CONFIG_NET_L2_ETHERNET_GSO)
+		if (net_pkt_gso_size(pkt) &&
+		    net_if_l2(iface) == &NET_L2_GET_NAME(ETHERNET)) {
+			status = net_eth_send_gso(iface, pkt);
+		} else
+#endif
+		{
+			net_capture_pkt(iface, pkt, NET_CAPTURE_TX_LL);
+
+			status = api->send(iface, pkt);
+		}
 	} else {
 		/* Drop packet if interface is not up */
 		NET_WARN("iface %p is down", iface);
@@ -189,6 +201,8 @@ void net_if_queue_tx(struct net_if *iface, struct net_pkt *pkt)
 
 	k_work_init(net_pkt_work(pkt), process_tx_packet);
 
+	net_stats_update_latency(pkt, NET_STATS_LATENCY_TX_L2);
+
 #if defined(CONFIG_NET_STATISTICS)
 	pkt->total_pkt_len = net_pkt_get_len(pkt);
 
@@ -212,6 +226,8 @@ static inline void init_iface(struct net_if *iface)
 
 	NET_DBG("On iface %p", iface);
 
+	net_quota_init(&iface->quota, CONFIG_NET_QUOTA_IFACE_TX);
+
 	api->init(iface);
 }
 
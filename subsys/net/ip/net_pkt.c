@@ -486,6 +486,172 @@ struct net_buf *net_pkt_get_reserve_tx_data(u16_t reserve_head,
 #endif /* CONFIG_NET_DEBUG_NET_PKT */
 
 
+#if defined(CONFIG_NET_QUOTA)
+void net_quota_init(struct net_quota *quota, int tx_limit)
+{
+	if (tx_limit) {
+		k_sem_init(&quota->tx_free, tx_limit, tx_limit);
+	}
+
+	atomic_clear(&quota->tx);
+	atomic_clear(&quota->rx);
+	atomic_clear(&quota->exceeded);
+}
+
+static bool quota_take_tx(struct net_quota *quota, int limit)
+{
+	if (limit && k_sem_take(&quota->tx_free, K_NO_WAIT)) {
+		atomic_inc(&quota->exceeded);
+		return false;
+	}
+
+	atomic_inc(&quota->tx);
+
+	return true;
+}
+
+static void quota_give_tx(struct net_quota *quota, int limit)
+{
+	atomic_dec(&quota->tx);
+
+	if (limit) {
+		k_sem_give(&quota->tx_free);
+	}
+}
+
+int net_quota_charge_tx(struct net_pkt *pkt)
+{
+	struct net_context *context = net_pkt_context(pkt);
+	struct net_if *iface = net_pkt_iface(pkt);
+
+	if (!context || !iface || pkt->quota_context || pkt->quota_iface) {
+		return 0;
+	}
+
+	if (!quota_take_tx(&context->quota, CONFIG_NET_QUOTA_CONTEXT_TX)) {
+		NET_DBG("Context %p TX quota exceeded", context);
+		return -EAGAIN;
+	}
+
+	if (!quota_take_tx(&iface->quota, CONFIG_NET_QUOTA_IFACE_TX)) {
+		NET_DBG("iface %p TX quota exceeded", iface);
+		quota_give_tx(&context->quota, CONFIG_NET_QUOTA_CONTEXT_TX);
+		return -EAGAIN;
+	}
+
+	pkt->quota_context = context;
+	pkt->quota_iface = iface;
+
+	return 0;
+}
+
+static bool quota_charge_rx(struct net_quota *quota, int limit, u8_t bufs)
+{
+	atomic_val_t held = atomic_get(&quota->rx);
+
+	/* A packet is always accepted when nothing else is held, so that
+	 * packets larger than the quota can still be received.
+	 */
+	if (limit && held && held + bufs > limit) {
+		atomic_inc(&quota->exceeded);
+		return false;
+	}
+
+	atomic_add(&quota->rx, bufs);
+
+	return true;
+}
+
+static u8_t quota_count_bufs(struct net_pkt *pkt)
+{
+	struct net_buf *frag;
+	u8_t count = 0;
+
+	for (frag = pkt->frags; frag && count < UINT8_MAX;
+	     frag = frag->frags) {
+		count++;
+	}
+
+	return count;
+}
+
+bool net_quota_charge_rx_iface(struct net_if *iface, struct net_pkt *pkt)
+{
+	u8_t bufs;
+
+	/* Packets looped back by the stack stay charged as TX packets */
+	if (pkt->quota_iface) {
+		return true;
+	}
+
+	bufs = quota_count_bufs(pkt);
+	if (!bufs) {
+		return true;
+	}
+
+	if (!quota_charge_rx(&iface->quota, CONFIG_NET_QUOTA_IFACE_RX, bufs)) {
+		return false;
+	}
+
+	pkt->quota_iface = iface;
+	pkt->quota_iface_bufs = bufs;
+
+	return true;
+}
+
+bool net_quota_charge_rx_context(struct net_context *context,
+				 struct net_pkt *pkt)
+{
+	u8_t bufs;
+
+	if (pkt->quota_context) {
+		return true;
+	}
+
+	bufs = quota_count_bufs(pkt);
+	if (!bufs) {
+		return true;
+	}
+
+	if (!quota_charge_rx(&context->quota, CONFIG_NET_QUOTA_CONTEXT_RX,
+			     bufs)) {
+		NET_DBG("Context %p RX quota exceeded, pkt %p dropped",
+			context, pkt);
+		return false;
+	}
+
+	pkt->quota_context = context;
+	pkt->quota_context_bufs = bufs;
+
+	return true;
+}
+
+static void quota_release(struct net_pkt *pkt)
+{
+	if (pkt->quota_context) {
+		if (pkt->quota_context_bufs) {
+			atomic_sub(&pkt->quota_context->quota.rx,
+				   pkt->quota_context_bufs);
+		} else {
+			quota_give_tx(&pkt->quota_context->quota,
+				      CONFIG_NET_QUOTA_CONTEXT_TX);
+		}
+	}
+
+	if (pkt->quota_iface) {
+		if (pkt->quota_iface_bufs) {
+			atomic_sub(&pkt->quota_iface->quota.rx,
+				   pkt->quota_iface_bufs);
+		} else {
+			quota_give_tx(&pkt->quota_iface->quota,
+				      CONFIG_NET_QUOTA_IFACE_TX);
+		}
+	}
+}
+#else
+#define quota_release(...)
+#endif /* CONFIG_NET_QUOTA */
+
 #if defined(CONFIG_NET_DEBUG_NET_PKT)
 static struct net_pkt *net_pkt_get_debug(struct k_mem_slab *slab,
 					 struct net_context *context,
@@ -798,6 +964,8 @@ done:
 		net_pkt_frag_unref(pkt->frags);
 	}
 
+	quota_release(pkt);
+
 	k_mem_slab_free(pkt->slab, (void **)&pkt);
 }
 
@@ -1246,8 +1414,9 @@ u16_t net_pkt_append(struct net_pkt *pkt, u16_t len, const u8_t *data,
 		max_len = pkt->data_len;
 
 #if defined(CONFIG_NET_TCP)
-		if (ctx->tcp && (ctx->tcp->send_mss < max_len)) {
-			max_len = ctx->tcp->send_mss;
+		if (ctx->tcp &&
+		    net_tcp_get_send_data_len(ctx->tcp) < max_len) {
+			max_len = net_tcp_get_send_data_len(ctx->tcp);
 		}
 #endif
 
@@ -2012,6 +2181,7 @@ struct net_pkt *net_pkt_clone(struct net_pkt *pkt, s32_t timeout)
 	net_pkt_set_next_hdr(clone, NULL);
 	net_pkt_set_ip_hdr_len(clone, net_pkt_ip_hdr_len(pkt));
 	net_pkt_set_vlan_tag(clone, net_pkt_vlan_tag(pkt));
+	net_pkt_set_gso_size(clone, net_pkt_gso_size(pkt));
 
 	net_pkt_set_family(clone, net_pkt_family(pkt));
 
@@ -50,6 +50,55 @@ extern void net_tc_tx_init(void);
 extern void net_tc_rx_init(void);
 extern void net_tc_submit_to_tx_queue(u8_t tc, struct net_pkt *pkt);
 extern void net_tc_submit_to_rx_queue(u8_t tc, struct net_pkt *pkt);
+extern bool net_tc_rx_queue_is_empty(u8_t tc);
+
+/* Points of the packet path where packets are captured */
+enum net_capture_point {
+	/* Frame received from the driver */
+	NET_CAPTURE_RX_LL,
+	/* Packet passed from L2 to the IP layer */
+	NET_CAPTURE_RX_IP,
+	/* Packet passed from the IP layer to L2 */
+	NET_CAPTURE_TX_IP,
+	/* Frame passed to the driver */
+	NET_CAPTURE_TX_LL,
+};
+
+#if defined(CONFIG_NET_CAPTURE)
+extern void net_capture_init(void);
+extern void net_capture_pkt(struct net_if *iface, struct net_pkt *pkt,
+			    enum net_capture_point point);
+#else
+#define net_capture_init(...)
+#define net_capture_pkt(...)
+#endif
+
+#if defined(CONFIG_NET_QUOTA)
+extern void net_quota_init(struct net_quota *quota, int tx_limit);
+extern int net_quota_charge_tx(struct net_pkt *pkt);
+extern bool net_quota_charge_rx_iface(struct net_if *iface,
+				      struct net_pkt *pkt);
+extern bool net_quota_charge_rx_context(struct net_context *context,
+					struct net_pkt *pkt);
+#else
+#define net_quota_init(...)
+static inline int net_quota_charge_tx(struct net_pkt *pkt)
+{
+	return 0;
+}
+
+static inline bool net_quota_charge_rx_iface(struct net_if *iface,
+					     struct net_pkt *pkt)
+{
+	return true;
+}
+
+static inline bool net_quota_charge_rx_context(struct net_context *context,
+					       struct net_pkt *pkt)
+{
+	return true;
+}
+#endif /* CONFIG_NET_QUOTA */
 
 #if defined(CONFIG_NET_IPV6_FRAGMENT)
 int net_ipv6_send_fragmented_pkt(struct net_if *iface, struct net_pkt *pkt,
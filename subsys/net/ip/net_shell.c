@@ -52,6 +52,10 @@
 #include <net/ethernet.h>
 #endif
 
+#if defined(CONFIG_NET_CAPTURE)
+#include <net/net_capture.h>
+#endif
+
 #include "net_shell.h"
 #include "net_stats.h"
 
@@ -520,6 +524,87 @@ static void print_eth_stats(struct net_if *iface, struct net_stats_eth *data)
 }
 #endif /* CONFIG_NET_STATISTICS_ETHERNET && CONFIG_NET_STATISTICS_USER_API */
 
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+static const char *latency_stage2str(int point)
+{
+	switch (point) {
+	case NET_STATS_LATENCY_RX_L2:
+		return "driver->L2";
+	case NET_STATS_LATENCY_RX_L3:
+		return "L2->L3";
+	case NET_STATS_LATENCY_RX_CONN:
+		return "L3->conn";
+	case NET_STATS_LATENCY_RX_SOCKET:
+		return "conn->socket";
+	case NET_STATS_LATENCY_RX_APP:
+		return "socket->app";
+	case NET_STATS_LATENCY_TX_L3:
+		return "app->L3";
+	case NET_STATS_LATENCY_TX_L2:
+		return "L3->L2";
+	case NET_STATS_LATENCY_TX_DRIVER:
+		return "L2->driver";
+	}
+
+	return "??";
+}
+
+static void print_latency_histogram(int tc, int point,
+				    const net_stats_t *buckets)
+{
+	bool found = false;
+	int i;
+
+	for (i = 0; i < NET_STATS_LATENCY_BUCKETS; i++) {
+		if (!buckets[i]) {
+			continue;
+		}
+
+		if (!found) {
+			printk("[%d] %-12s", tc, latency_stage2str(point));
+			found = true;
+		}
+
+		if (i == NET_STATS_LATENCY_BUCKETS - 1) {
+			printk(" >=%uus:%u", 1U << (i - 1), buckets[i]);
+		} else {
+			printk(" <%uus:%u", 1U << i, buckets[i]);
+		}
+	}
+
+	if (found) {
+		printk("\n");
+	}
+}
+
+static void print_latency_stats(struct net_if *iface)
+{
+	int tc, stage;
+
+	printk("RX latency per traffic class and stage:\n");
+
+	for (tc = 0; tc < NET_TC_RX_COUNT; tc++) {
+		for (stage = 0; stage < NET_STATS_LATENCY_RX_STAGES;
+		     stage++) {
+			print_latency_histogram(tc,
+				NET_STATS_LATENCY_RX_DRIVER + stage + 1,
+				GET_STAT_ADDR(iface, latency.rx[tc][stage][0]));
+		}
+	}
+
+	printk("TX latency per traffic class and stage:\n");
+
+	for (tc = 0; tc < NET_TC_TX_COUNT; tc++) {
+		for (stage = 0; stage < NET_STATS_LATENCY_TX_STAGES;
+		     stage++) {
+			print_latency_histogram(tc,
+				NET_STATS_LATENCY_TX_APP + stage + 1,
+				GET_STAT_ADDR(iface, latency.tx[tc][stage][0]));
+		}
+	}
+}
+#endif /* CONFIG_NET_STATISTICS_LATENCY */
+
 static void net_shell_print_statistics(struct net_if *iface, void *user_data)
 {
 	ARG_UNUSED(user_data);
@@ -548,6 +633,19 @@ static void net_shell_print_statistics(struct net_if *iface, void *user_data)
 	       GET_STAT(iface, ipv6_nd.sent),
 	       GET_STAT(iface, ipv6_nd.drop));
 #endif /* CONFIG_NET_IPV6_ND */
+#if defined(CONFIG_NET_STATISTICS_IPV6_NBR)
+	printk("IPv6 NBR hit   %d\tmiss\t%d\tevicted\t%d\n",
+	       GET_STAT(iface, ipv6_nbr.hit),
+	       GET_STAT(iface, ipv6_nbr.miss),
+	       GET_STAT(iface, ipv6_nbr.evicted));
+#endif /* CONFIG_NET_STATISTICS_IPV6_NBR */
+#if defined(CONFIG_NET_STATISTICS_IPV6_FRAGMENT)
+	printk("IPv6 reass     %d\ttimeout\t%d\tdrop\t%d\tpending\t%d\n",
+	       GET_STAT(iface, ipv6_reass.done),
+	       GET_STAT(iface, ipv6_reass.timeout),
+	       GET_STAT(iface, ipv6_reass.drop),
+	       GET_STAT(iface, ipv6_reass.pending));
+#endif /* CONFIG_NET_STATISTICS_IPV6_FRAGMENT */
 #if defined(CONFIG_NET_STATISTICS_MLD)
 	printk("IPv6 MLD recv  %d\tsent\t%d\tdrop\t%d\n",
 	       GET_STAT(iface, ipv6_mld.recv),
@@ -556,6 +654,14 @@ static void net_shell_print_statistics(struct net_if *iface, void *user_data)
 #endif /* CONFIG_NET_STATISTICS_MLD */
 #endif /* CONFIG_NET_IPV6 */
 
+#if defined(CONFIG_NET_STATISTICS_IEEE802154_FRAGMENT)
+	printk("15.4 reass     %d\ttimeout\t%d\tdrop\t%d\tpending\t%d\n",
+	       GET_STAT(iface, ieee802154_reass.done),
+	       GET_STAT(iface, ieee802154_reass.timeout),
+	       GET_STAT(iface, ieee802154_reass.drop),
+	       GET_STAT(iface, ieee802154_reass.pending));
+#endif /* CONFIG_NET_STATISTICS_IEEE802154_FRAGMENT */
+
 #if defined(CONFIG_NET_IPV4)
 	printk("IPv4 recv      %d\tsent\t%d\tdrop\t%d\tforwarded\t%d\n",
 	       GET_STAT(iface, ipv4.recv),
@@ -683,6 +789,10 @@ static void net_shell_print_statistics(struct net_if *iface, void *user_data)
 #endif
 #endif /* NET_TC_COUNT > 1 */
 
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+	print_latency_stats(iface);
+#endif
+
 #if defined(CONFIG_NET_STATISTICS_ETHERNET) && \
 					defined(CONFIG_NET_STATISTICS_USER_API)
 	if (iface && net_if_l2(iface) == &NET_L2_GET_NAME(ETHERNET)) {
@@ -836,6 +946,33 @@ static void tcp_cb(struct net_tcp *tcp, void *user_data)
 	(*count)++;
 }
 
+#if defined(CONFIG_NET_TCP_CONGESTION_CONTROL)
+static void tcp_cc_cb(struct net_tcp *tcp, void *user_data)
+{
+	const struct net_tcp_cc_state *cc = &tcp->cc;
+	const char *phase;
+
+	ARG_UNUSED(user_data);
+
+	if (cc->in_recovery) {
+		phase = "recovery";
+	} else if (cc->cwnd < cc->ssthresh) {
+		phase = "slow start";
+	} else {
+		phase = "cong avoid";
+	}
+
+	if (cc->ssthresh == UINT32_MAX) {
+		printk("%p %-8s %10u          - %5u   %s\n",
+		       tcp, cc->ops->name, cc->cwnd, tcp->send_mss, phase);
+	} else {
+		printk("%p %-8s %10u %10u %5u   %s\n",
+		       tcp, cc->ops->name, cc->cwnd, cc->ssthresh,
+		       tcp->send_mss, phase);
+	}
+}
+#endif /* CONFIG_NET_TCP_CONGESTION_CONTROL */
+
 #if defined(CONFIG_NET_DEBUG_TCP)
 static void tcp_sent_list_cb(struct net_tcp *tcp, void *user_data)
 {
@@ -906,23 +1043,23 @@ static void ipv6_frag_cb(struct net_ipv6_reassembly *reass,
 	       reass, reass->id, k_delayed_work_remaining_get(&reass->timer),
 	       src, net_sprint_ipv6_addr(&reass->dst));
 
-	for (i = 0; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		if (reass->pkt[i]) {
-			struct net_buf *frag = reass->pkt[i]->frags;
+	for (i = 0; i < reass->frags.count; i++) {
+		struct net_buf *frag = reass->frags.frags[i].buf;
 
-			printk("[%d] pkt %p->", i, reass->pkt[i]);
+		printk("[%d] offset %u len %u ", i,
+		       reass->frags.frags[i].offset,
+		       reass->frags.frags[i].len);
 
-			while (frag) {
-				printk("%p", frag);
+		while (frag) {
+			printk("%p", frag);
 
-				frag = frag->frags;
-				if (frag) {
-					printk("->");
-				}
+			frag = frag->frags;
+			if (frag) {
+				printk("->");
 			}
-
-			printk("\n");
 		}
+
+		printk("\n");
 	}
 
 	(*count)++;
@@ -985,6 +1122,41 @@ buf:
 }
 #endif /* CONFIG_NET_DEBUG_NET_PKT */
 
+#if defined(CONFIG_NET_QUOTA)
+static void quota_context_cb(struct net_context *context, void *user_data)
+{
+	printk("[%2d] %p\t%d\t%d\t%d\t\t%s\n", context->iface, context,
+	       (int)atomic_get(&context->quota.tx),
+	       (int)atomic_get(&context->quota.rx),
+	       (int)atomic_get(&context->quota.exceeded),
+	       net_proto2str(net_context_get_ip_proto(context)));
+}
+
+static void quota_iface_cb(struct net_if *iface, void *user_data)
+{
+	printk("[%2d] %p\t%d\t%d\t%d\n", net_if_get_by_iface(iface), iface,
+	       (int)atomic_get(&iface->quota.tx),
+	       (int)atomic_get(&iface->quota.rx),
+	       (int)atomic_get(&iface->quota.exceeded));
+}
+
+static void print_quotas(void)
+{
+	printk("Network buffer quotas (0 is unlimited)\n");
+	printk("Context: %d TX packets, %d RX buffers\n",
+	       CONFIG_NET_QUOTA_CONTEXT_TX, CONFIG_NET_QUOTA_CONTEXT_RX);
+	printk("Interface: %d TX packets, %d RX buffers\n\n",
+	       CONFIG_NET_QUOTA_IFACE_TX, CONFIG_NET_QUOTA_IFACE_RX);
+
+	printk("Iface Context\tTX pkts\tRX bufs\tExceeded\tProto\n");
+	net_context_foreach(quota_context_cb, NULL);
+
+	printk("\nIface Interface\tTX pkts\tRX bufs\tExceeded\n");
+	net_if_foreach(quota_iface_cb, NULL);
+	printk("\n");
+}
+#endif /* CONFIG_NET_QUOTA */
+
 /* Put the actual shell commands after this */
 
 int net_shell_cmd_allocs(int argc, char *argv[])
@@ -992,6 +1164,10 @@ int net_shell_cmd_allocs(int argc, char *argv[])
 	ARG_UNUSED(argc);
 	ARG_UNUSED(argv);
 
+#if defined(CONFIG_NET_QUOTA)
+	print_quotas();
+#endif
+
 #if defined(CONFIG_NET_DEBUG_NET_PKT)
 	printk("Network memory allocations\n\n");
 	printk("memory\t\tStatus\tPool\tFunction alloc -> freed\n");
@@ -1290,6 +1466,149 @@ int net_shell_cmd_arp(int argc, char *argv[])
 	return 0;
 }
 
+#if defined(CONFIG_NET_CAPTURE)
+static void iface_capture_cb(struct net_if *iface, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	printk("Interface %d (%p): %s\n", net_if_get_by_iface(iface), iface,
+	       net_capture_is_enabled(iface) ? "capturing" : "off");
+}
+
+static struct net_if *capture_iface(char *arg)
+{
+	struct net_if *iface;
+	char *endptr = NULL;
+	int idx;
+
+	if (!arg) {
+		printk("Network interface index missing.\n");
+		return NULL;
+	}
+
+	idx = strtol(arg, &endptr, 10);
+	if (*endptr != '\0' || idx < 0 || idx > 255) {
+		printk("Invalid index %s\n", arg);
+		return NULL;
+	}
+
+	iface = net_if_get_by_index(idx);
+	if (!iface) {
+		printk("No such interface in index %d\n", idx);
+	}
+
+	return iface;
+}
+
+static int capture_filter(int argc, char *argv[], int arg)
+{
+	struct net_capture_filter filter;
+
+	memset(&filter, 0, sizeof(filter));
+
+	for (; arg < argc && argv[arg]; arg++) {
+		if (!strcmp(argv[arg], "any")) {
+			continue;
+		} else if (!strcmp(argv[arg], "ipv4")) {
+			filter.family = AF_INET;
+		} else if (!strcmp(argv[arg], "ipv6")) {
+			filter.family = AF_INET6;
+		} else if (!strcmp(argv[arg], "udp")) {
+			filter.proto = IPPROTO_UDP;
+		} else if (!strcmp(argv[arg], "tcp")) {
+			filter.proto = IPPROTO_TCP;
+		} else if (!strcmp(argv[arg], "icmp")) {
+			filter.proto = IPPROTO_ICMP;
+		} else if (!strcmp(argv[arg], "icmpv6")) {
+			filter.proto = IPPROTO_ICMPV6;
+		} else {
+			char *endptr = NULL;
+			long port = strtol(argv[arg], &endptr, 10);
+
+			if (*endptr != '\0' || port <= 0 || port > 65535) {
+				printk("Invalid filter %s\n", argv[arg]);
+				return -EINVAL;
+			}
+
+			filter.port = port;
+		}
+	}
+
+	net_capture_set_filter(&filter);
+
+	return 0;
+}
+#endif /* CONFIG_NET_CAPTURE */
+
+int net_shell_cmd_capture(int argc, char *argv[])
+{
+#if defined(CONFIG_NET_CAPTURE)
+	struct net_capture_filter filter;
+	struct net_capture_stats stats;
+	struct net_if *iface;
+	int arg = 1;
+	int ret;
+
+	if (!argv[arg]) {
+		net_if_foreach(iface_capture_cb, NULL);
+
+		net_capture_get_filter(&filter);
+		printk("Filter: %s proto %d port %d\n",
+		       filter.family == AF_INET ? "IPv4" :
+		       filter.family == AF_INET6 ? "IPv6" : "any",
+		       filter.proto, filter.port);
+
+		net_capture_get_stats(&stats);
+		printk("Captured %u filtered %u dropped %u written %u bytes\n",
+		       stats.captured, stats.filtered, stats.dropped,
+		       stats.written);
+
+		return 0;
+	}
+
+	if (!strcmp(argv[arg], "enable")) {
+		iface = capture_iface(argv[++arg]);
+		if (!iface) {
+			return 0;
+		}
+
+		ret = net_capture_enable(iface);
+		if (ret < 0) {
+			printk("Cannot start capture (%d)\n", ret);
+		} else {
+			printk("Capturing interface %p\n", iface);
+		}
+
+		return 0;
+	}
+
+	if (!strcmp(argv[arg], "disable")) {
+		iface = capture_iface(argv[++arg]);
+		if (iface) {
+			net_capture_disable(iface);
+		}
+
+		return 0;
+	}
+
+	if (!strcmp(argv[arg], "filter")) {
+		capture_filter(argc, argv, arg + 1);
+		return 0;
+	}
+
+	printk("Unknown command '%s'\n", argv[arg]);
+	printk("Usage:\n");
+	printk("\tcapture enable <interface index>\n");
+	printk("\tcapture disable <interface index>\n");
+	printk("\tcapture filter [ipv4|ipv6] [udp|tcp|icmp|icmpv6] "
+	       "[port]\n");
+#else
+	printk("Set CONFIG_NET_CAPTURE to enable packet capture.\n");
+#endif /* CONFIG_NET_CAPTURE */
+
+	return 0;
+}
+
 int net_shell_cmd_conn(int argc, char *argv[])
 {
 	int count = 0;
@@ -1330,6 +1649,13 @@ int net_shell_cmd_conn(int argc, char *argv[])
 	if (count == 0) {
 		printk("No TCP connections\n");
 	} else {
+#if defined(CONFIG_NET_TCP_CONGESTION_CONTROL)
+		printk("\nTCP        Algorithm      Cwnd   Ssthresh  SMSS   "
+		       "Phase\n");
+
+		net_tcp_foreach(tcp_cc_cb, NULL);
+#endif /* CONFIG_NET_TCP_CONGESTION_CONTROL */
+
 #if defined(CONFIG_NET_DEBUG_TCP)
 		/* Print information about pending packets */
 		count = 0;
@@ -2931,12 +3257,20 @@ int net_shell_cmd_vlan(int argc, char *argv[])
 static struct shell_cmd net_commands[] = {
 	/* Keep the commands in alphabetical order */
 	{ "allocs", net_shell_cmd_allocs,
-		"\n\tPrint network memory allocations" },
+		"\n\tPrint network memory allocations and buffer quotas" },
 	{ "app", net_shell_cmd_app,
 		"\n\tPrint network application API usage information" },
 	{ "arp", net_shell_cmd_arp,
 		"\n\tPrint information about IPv4 ARP cache\n"
 		"arp flush\n\tRemove all entries from ARP cache" },
+	{ "capture", net_shell_cmd_capture,
+		"\n\tShow packet capture status\n"
+		"capture enable <interface index>\n"
+		"\tCapture the packets of the network interface\n"
+		"capture disable <interface index>\n"
+		"\tStop capturing the network interface\n"
+		"capture filter [ipv4|ipv6] [udp|tcp|icmp|icmpv6] [port]\n"
+		"\tCapture only matching packets, no arguments for all\n" },
 	{ "conn", net_shell_cmd_conn,
 		"\n\tPrint information about network connections" },
 	{ "dns", net_shell_cmd_dns, "\n\tShow how DNS is configured\n"
@@ -14,6 +14,7 @@
 #define __NET_SHELL_H
 
 int net_shell_cmd_allocs(int argc, char *argv[]);
+int net_shell_cmd_capture(int argc, char *argv[]);
 int net_shell_cmd_conn(int argc, char *argv[]);
 int net_shell_cmd_dns(int argc, char *argv[]);
 int net_shell_cmd_iface(int argc, char *argv[]);
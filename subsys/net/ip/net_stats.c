@@ -14,6 +14,7 @@
 #include <string.h>
 #include <errno.h>
 #include <net/net_core.h>
+#include <net/net_pkt.h>
 
 #include "net_stats.h"
 
@@ -24,6 +25,55 @@
  */
 struct net_stats net_stats = { 0 };
 
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+static inline int latency_bucket(u32_t cycles)
+{
+	u32_t usec = SYS_CLOCK_HW_CYCLES_TO_NS64(cycles) / NSEC_PER_USEC;
+	int bucket;
+
+	if (!usec) {
+		return 0;
+	}
+
+	bucket = 32 - __builtin_clz(usec);
+
+	return min(bucket, NET_STATS_LATENCY_BUCKETS - 1);
+}
+
+void net_stats_update_latency(struct net_pkt *pkt,
+			      enum net_stats_latency_point point)
+{
+	struct net_if *iface = net_pkt_iface(pkt);
+	u32_t now = k_cycle_get_32();
+	int bucket;
+	int tc;
+
+	/* Only account the stage if the packet passed the previous point
+	 * just before this one. Packets that skip points, like locally
+	 * generated replies, start over from this point.
+	 */
+	if (iface && pkt->latency_point == point &&
+	    point != NET_STATS_LATENCY_RX_DRIVER &&
+	    point != NET_STATS_LATENCY_TX_APP) {
+		bucket = latency_bucket(now - pkt->latency_stamp);
+
+		if (point < NET_STATS_LATENCY_TX_APP) {
+			tc = net_rx_priority2tc(net_pkt_priority(pkt));
+			UPDATE_STAT(iface, stats.latency.rx[tc][point - 1]
+				    [bucket]++);
+		} else {
+			tc = net_tx_priority2tc(net_pkt_priority(pkt));
+			UPDATE_STAT(iface, stats.latency.tx[tc]
+				    [point - NET_STATS_LATENCY_TX_APP - 1]
+				    [bucket]++);
+		}
+	}
+
+	pkt->latency_stamp = now;
+	pkt->latency_point = point + 1;
+}
+#endif /* CONFIG_NET_STATISTICS_LATENCY */
+
 #if defined(CONFIG_NET_STATISTICS_PERIODIC_OUTPUT)
 
 #define PRINT_STATISTICS_INTERVAL K_SECONDS(30)
@@ -83,6 +133,19 @@ static inline void stats(struct net_if *iface)
 			 GET_STAT(iface, ipv6_nd.sent),
 			 GET_STAT(iface, ipv6_nd.drop));
 #endif /* CONFIG_NET_STATISTICS_IPV6_ND */
+#if defined(CONFIG_NET_STATISTICS_IPV6_NBR)
+		NET_INFO("IPv6 NBR hit   %d\tmiss\t%d\tevicted\t%d",
+			 GET_STAT(iface, ipv6_nbr.hit),
+			 GET_STAT(iface, ipv6_nbr.miss),
+			 GET_STAT(iface, ipv6_nbr.evicted));
+#endif /* CONFIG_NET_STATISTICS_IPV6_NBR */
+#if defined(CONFIG_NET_STATISTICS_IPV6_FRAGMENT)
+		NET_INFO("IPv6 reass     %d\ttimeout\t%d\tdrop\t%d\tpending\t%d",
+			 GET_STAT(iface, ipv6_reass.done),
+			 GET_STAT(iface, ipv6_reass.timeout),
+			 GET_STAT(iface, ipv6_reass.drop),
+			 GET_STAT(iface, ipv6_reass.pending));
+#endif /* CONFIG_NET_STATISTICS_IPV6_FRAGMENT */
 #if defined(CONFIG_NET_STATISTICS_MLD)
 		NET_INFO("IPv6 MLD recv  %d\tsent\t%d\tdrop\t%d",
 			 GET_STAT(iface, ipv6_mld.recv),
@@ -91,6 +154,14 @@ static inline void stats(struct net_if *iface)
 #endif /* CONFIG_NET_STATISTICS_MLD */
 #endif /* CONFIG_NET_STATISTICS_IPV6 */
 
+#if defined(CONFIG_NET_STATISTICS_IEEE802154_FRAGMENT)
+		NET_INFO("15.4 reass     %d\ttimeout\t%d\tdrop\t%d\tpending\t%d",
+			 GET_STAT(iface, ieee802154_reass.done),
+			 GET_STAT(iface, ieee802154_reass.timeout),
+			 GET_STAT(iface, ieee802154_reass.drop),
+			 GET_STAT(iface, ieee802154_reass.pending));
+#endif /* CONFIG_NET_STATISTICS_IEEE802154_FRAGMENT */
+
 #if defined(CONFIG_NET_STATISTICS_IPV4)
 		NET_INFO("IPv4 recv      %d\tsent\t%d\tdrop\t%d\tforwarded\t%d",
 			 GET_STAT(iface, ipv4.recv),
@@ -300,6 +371,12 @@ static int net_stats_get(u32_t mgmt_request, struct net_if *iface,
 		src = GET_STAT_ADDR(iface, ipv6_nd);
 		break;
 #endif
+#if defined(CONFIG_NET_STATISTICS_IPV6_NBR)
+	case NET_REQUEST_STATS_CMD_GET_IPV6_NBR:
+		len_chk = sizeof(struct net_stats_ipv6_nbr);
+		src = GET_STAT_ADDR(iface, ipv6_nbr);
+		break;
+#endif
 #if defined(CONFIG_NET_STATISTICS_ICMP)
 	case NET_REQUEST_STATS_CMD_GET_ICMP:
 		len_chk = sizeof(struct net_stats_icmp);
@@ -323,6 +400,12 @@ static int net_stats_get(u32_t mgmt_request, struct net_if *iface,
 		len_chk = sizeof(struct net_stats_rpl);
 		src = GET_STAT_ADDR(iface, rpl);
 		break;
+#endif
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+	case NET_REQUEST_STATS_CMD_GET_LATENCY:
+		len_chk = sizeof(struct net_stats_latency);
+		src = GET_STAT_ADDR(iface, latency);
+		break;
 #endif
 	}
 
@@ -362,6 +445,11 @@ NET_MGMT_REGISTER_REQUEST_HANDLER(NET_REQUEST_STATS_GET_IPV6_ND,
 				  net_stats_get);
 #endif
 
+#if defined(CONFIG_NET_STATISTICS_IPV6_NBR)
+NET_MGMT_REGISTER_REQUEST_HANDLER(NET_REQUEST_STATS_GET_IPV6_NBR,
+				  net_stats_get);
+#endif
+
 #if defined(CONFIG_NET_STATISTICS_ICMP)
 NET_MGMT_REGISTER_REQUEST_HANDLER(NET_REQUEST_STATS_GET_ICMP,
 				  net_stats_get);
@@ -382,4 +470,9 @@ NET_MGMT_REGISTER_REQUEST_HANDLER(NET_REQUEST_STATS_GET_RPL,
 				  net_stats_get);
 #endif
 
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+NET_MGMT_REGISTER_REQUEST_HANDLER(NET_REQUEST_STATS_GET_LATENCY,
+				  net_stats_get);
+#endif
+
 #endif /* CONFIG_NET_STATISTICS_USER_API */
@@ -111,6 +111,90 @@ static inline void net_stats_update_ipv6_nd_drop(struct net_if *iface)
 #define net_stats_update_ipv6_nd_drop(iface)
 #endif /* CONFIG_NET_STATISTICS_IPV6_ND */
 
+#if defined(CONFIG_NET_STATISTICS_IPV6_NBR)
+/* IPv6 neighbor cache stats */
+
+static inline void net_stats_update_ipv6_nbr_hit(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ipv6_nbr.hit++);
+}
+
+static inline void net_stats_update_ipv6_nbr_miss(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ipv6_nbr.miss++);
+}
+
+static inline void net_stats_update_ipv6_nbr_evicted(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ipv6_nbr.evicted++);
+}
+#else
+#define net_stats_update_ipv6_nbr_hit(iface)
+#define net_stats_update_ipv6_nbr_miss(iface)
+#define net_stats_update_ipv6_nbr_evicted(iface)
+#endif /* CONFIG_NET_STATISTICS_IPV6_NBR */
+
+#if defined(CONFIG_NET_STATISTICS_IPV6_FRAGMENT)
+/* IPv6 reassembly stats */
+
+static inline void net_stats_update_ipv6_reass_done(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ipv6_reass.done++);
+}
+
+static inline void net_stats_update_ipv6_reass_timeout(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ipv6_reass.timeout++);
+}
+
+static inline void net_stats_update_ipv6_reass_drop(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ipv6_reass.drop++);
+}
+
+static inline void net_stats_update_ipv6_reass_pending(struct net_if *iface,
+						       int bytes)
+{
+	UPDATE_STAT(iface, stats.ipv6_reass.pending += bytes);
+}
+#else
+#define net_stats_update_ipv6_reass_done(iface)
+#define net_stats_update_ipv6_reass_timeout(iface)
+#define net_stats_update_ipv6_reass_drop(iface)
+#define net_stats_update_ipv6_reass_pending(iface, bytes)
+#endif /* CONFIG_NET_STATISTICS_IPV6_FRAGMENT */
+
+#if defined(CONFIG_NET_STATISTICS_IEEE802154_FRAGMENT)
+/* IEEE 802.15.4 reassembly stats */
+
+static inline void net_stats_update_ieee802154_reass_done(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ieee802154_reass.done++);
+}
+
+static inline void
+net_stats_update_ieee802154_reass_timeout(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ieee802154_reass.timeout++);
+}
+
+static inline void net_stats_update_ieee802154_reass_drop(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ieee802154_reass.drop++);
+}
+
+static inline void
+net_stats_update_ieee802154_reass_pending(struct net_if *iface, int bytes)
+{
+	UPDATE_STAT(iface, stats.ieee802154_reass.pending += bytes);
+}
+#else
+#define net_stats_update_ieee802154_reass_done(iface)
+#define net_stats_update_ieee802154_reass_timeout(iface)
+#define net_stats_update_ieee802154_reass_drop(iface)
+#define net_stats_update_ieee802154_reass_pending(iface, bytes)
+#endif /* CONFIG_NET_STATISTICS_IEEE802154_FRAGMENT */
+
 #if defined(CONFIG_NET_STATISTICS_IPV4)
 /* IPv4 stats */
 
@@ -44,6 +44,11 @@ void net_tc_submit_to_rx_queue(u8_t tc, struct net_pkt *pkt)
 	k_work_submit_to_queue(&rx_classes[tc].work_q, net_pkt_work(pkt));
 }
 
+bool net_tc_rx_queue_is_empty(u8_t tc)
+{
+	return k_queue_is_empty(&rx_classes[tc].work_q.queue);
+}
+
 int net_tx_priority2tc(enum net_priority prio)
 {
 	/*
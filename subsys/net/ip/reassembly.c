@@ -0,0 +1,124 @@
+/** @file
+ * @brief Fragment reassembly
+ *
+ * Keeps track of received fragments as non-overlapping intervals and links
+ * their buffers together once the whole packet has been received.
+ */
+
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <net/buf.h>
+
+#include "reassembly.h"
+
+int net_reass_add(struct net_reass *reass, struct net_buf *buf,
+		  u16_t offset, u16_t len)
+{
+	u32_t end = (u32_t)offset + len;
+	int i;
+
+	if (!len || (reass->size && end > reass->size)) {
+		return -EINVAL;
+	}
+
+	/* Find the first fragment that starts after this one */
+	for (i = 0; i < reass->count; i++) {
+		if (reass->frags[i].offset > offset) {
+			break;
+		}
+	}
+
+	if (i > 0) {
+		struct net_reass_frag *prev = &reass->frags[i - 1];
+
+		if (prev->offset == offset && prev->len == len) {
+			return -EALREADY;
+		}
+
+		if (prev->offset + prev->len > offset) {
+			return -EINVAL;
+		}
+	}
+
+	if (i < reass->count && end > reass->frags[i].offset) {
+		return -EINVAL;
+	}
+
+	if (reass->count == ARRAY_SIZE(reass->frags)) {
+		return -ENOMEM;
+	}
+
+	memmove(&reass->frags[i + 1], &reass->frags[i],
+		(reass->count - i) * sizeof(reass->frags[0]));
+
+	reass->frags[i].buf = buf;
+	reass->frags[i].offset = offset;
+	reass->frags[i].len = len;
+
+	reass->count++;
+	reass->received += len;
+
+	return 0;
+}
+
+int net_reass_set_size(struct net_reass *reass, u16_t size)
+{
+	struct net_reass_frag *last;
+
+	if (reass->size) {
+		return reass->size == size ? 0 : -EINVAL;
+	}
+
+	if (reass->count) {
+		last = &reass->frags[reass->count - 1];
+
+		if (last->offset + last->len > size) {
+			return -EINVAL;
+		}
+	}
+
+	reass->size = size;
+
+	return 0;
+}
+
+struct net_buf *net_reass_splice(struct net_reass *reass)
+{
+	struct net_buf *head = NULL;
+	struct net_buf *last = NULL;
+	int i;
+
+	for (i = 0; i < reass->count; i++) {
+		struct net_buf *buf = reass->frags[i].buf;
+
+		if (last) {
+			last->frags = buf;
+		} else {
+			head = buf;
+		}
+
+		last = net_buf_frag_last(buf);
+	}
+
+	net_reass_init(reass);
+
+	return head;
+}
+
+void net_reass_clear(struct net_reass *reass)
+{
+	int i;
+
+	for (i = 0; i < reass->count; i++) {
+		net_buf_unref(reass->frags[i].buf);
+	}
+
+	net_reass_init(reass);
+}
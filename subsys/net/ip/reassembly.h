@@ -0,0 +1,134 @@
+/** @file
+ * @brief Fragment reassembly
+ *
+ * This is not to be included by the application.
+ */
+
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __REASSEMBLY_H
+#define __REASSEMBLY_H
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+
+#include <net/buf.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** One received fragment */
+struct net_reass_frag {
+	/** Data of the fragment, the headers that are not part of the
+	 * reassembled packet have already been pulled away.
+	 */
+	struct net_buf *buf;
+
+	/** Offset of the fragment in the reassembled packet */
+	u16_t offset;
+
+	/** Length of the fragment payload */
+	u16_t len;
+};
+
+/**
+ * @brief Fragments of one packet being reassembled.
+ *
+ * The fragments are kept sorted by their offset and must not overlap, so
+ * the packet is complete when the received byte count reaches its size.
+ * The net_buf chains of the fragments are linked together when the packet
+ * is complete, no payload is copied.
+ */
+struct net_reass {
+	/** Received fragments, sorted by offset */
+	struct net_reass_frag frags[CONFIG_NET_REASSEMBLY_MAX_FRAGS];
+
+	/** Size of the reassembled packet, 0 until it is known */
+	u16_t size;
+
+	/** Number of payload bytes received so far */
+	u16_t received;
+
+	/** Number of used entries in frags */
+	u8_t count;
+};
+
+/**
+ * @brief Initialize reassembly state.
+ *
+ * @param reass Reassembly state
+ */
+static inline void net_reass_init(struct net_reass *reass)
+{
+	reass->size = 0;
+	reass->received = 0;
+	reass->count = 0;
+}
+
+/**
+ * @brief Add a fragment to a packet being reassembled.
+ *
+ * On success the reassembly takes over the reference to buf.
+ *
+ * @param reass Reassembly state
+ * @param buf Fragment data
+ * @param offset Offset of the fragment in the packet
+ * @param len Length of the fragment payload
+ *
+ * @return 0 if the fragment was added, -EALREADY if it is a duplicate of
+ * an already received fragment, -EINVAL if it overlaps another fragment
+ * or exceeds the packet size, -ENOMEM if there is no room for it.
+ */
+int net_reass_add(struct net_reass *reass, struct net_buf *buf,
+		  u16_t offset, u16_t len);
+
+/**
+ * @brief Set the size of the reassembled packet.
+ *
+ * @param reass Reassembly state
+ * @param size Packet size
+ *
+ * @return 0 if ok, -EINVAL if already received fragments do not fit.
+ */
+int net_reass_set_size(struct net_reass *reass, u16_t size);
+
+/**
+ * @brief Check if all the fragments of the packet have been received.
+ *
+ * @param reass Reassembly state
+ *
+ * @return True if the packet can be reassembled.
+ */
+static inline bool net_reass_complete(struct net_reass *reass)
+{
+	return reass->size && reass->received == reass->size;
+}
+
+/**
+ * @brief Link the fragments together.
+ *
+ * The reassembly state is empty after this.
+ *
+ * @param reass Reassembly state
+ *
+ * @return Fragment chain of the whole packet.
+ */
+struct net_buf *net_reass_splice(struct net_reass *reass);
+
+/**
+ * @brief Release all the received fragments.
+ *
+ * @param reass Reassembly state
+ */
+void net_reass_clear(struct net_reass *reass);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __REASSEMBLY_H */
@@ -51,7 +51,7 @@ static struct tcp_backlog_entry {
 	struct sockaddr remote;
 	u32_t send_seq;
 	u32_t send_ack;
-	u16_t send_mss;
+	struct net_tcp_options opts;
 	struct k_delayed_work ack_timer;
 } tcp_backlog[CONFIG_NET_TCP_BACKLOG_SIZE];
 
@@ -63,6 +63,18 @@ static struct tcp_backlog_entry {
 
 #define FIN_TIMEOUT K_SECONDS(1)
 
+/* Bounds of the retransmission timeout. RFC 6298 ch 2.4 asks for at
+ * least one second, which is needlessly slow on the local links most
+ * of the devices are attached to.
+ */
+#define MIN_RTO K_MSEC(100)
+#define MAX_RTO K_SECONDS(60)
+
+/* RFC 7323 options we are willing to negotiate */
+#define TCP_OPT_FLAGS							\
+	((IS_ENABLED(CONFIG_NET_TCP_WINDOW_SCALE) ? NET_TCP_WSCALE : 0) | \
+	 (IS_ENABLED(CONFIG_NET_TCP_TIMESTAMPS) ? NET_TCP_TS : 0))
+
 /* Declares a wrapper function for a net_conn callback that refs the
  * context around the invocation (to protect it from premature
  * deletion).  Long term would be nice to see this feature be part of
@@ -156,8 +168,37 @@ static void net_tcp_trace(struct net_pkt *pkt, struct net_tcp *tcp)
 
 static inline u32_t retry_timeout(const struct net_tcp *tcp)
 {
-	return ((u32_t)1 << tcp->retry_timeout_shift) *
-				CONFIG_NET_TCP_INIT_RETRANSMISSION_TIMEOUT;
+	return min((u64_t)tcp->rto << tcp->retry_timeout_shift, MAX_RTO);
+}
+
+/* Update the retransmission timeout from a round-trip time measurement,
+ * RFC 6298 ch 2.
+ */
+static void update_rto(struct net_tcp *tcp, u32_t rtt)
+{
+	rtt = max(rtt, 1);
+
+	if (!tcp->srtt) {
+		tcp->srtt = rtt << 3;
+		tcp->rttvar = rtt << 1;
+	} else {
+		s32_t delta = rtt - (tcp->srtt >> 3);
+
+		tcp->srtt += delta;
+
+		if (delta < 0) {
+			delta = -delta;
+		}
+
+		tcp->rttvar += delta - (tcp->rttvar >> 2);
+	}
+
+	tcp->rto = (tcp->srtt >> 3) + max(tcp->rttvar, 1);
+	tcp->rto = max(tcp->rto, MIN_RTO);
+	tcp->rto = min(tcp->rto, MAX_RTO);
+
+	NET_DBG("[%p] rtt %u srtt %u rttvar %u rto %u", tcp, rtt,
+		tcp->srtt >> 3, tcp->rttvar >> 2, tcp->rto);
 }
 
 #define is_6lo_technology(pkt)						    \
@@ -200,13 +241,66 @@ static void abort_connection(struct net_tcp *tcp)
 	net_context_unref(ctx);
 }
 
+/* Number of bytes that have been handed to the network but are not
+ * acknowledged yet.
+ */
+static u32_t flight_size(struct net_tcp *tcp)
+{
+	struct net_pkt *pkt;
+	u32_t size = 0;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&tcp->sent_list, pkt, sent_list) {
+		if (net_pkt_queued(pkt) || net_pkt_sent(pkt)) {
+			size += net_pkt_appdatalen(pkt);
+		}
+	}
+
+	return size;
+}
+
+/* Resend the first (only the first!) unack'd packet. */
+static void resend_first_segment(struct net_tcp *tcp)
+{
+	struct net_pkt *pkt;
+
+	pkt = CONTAINER_OF(sys_slist_peek_head(&tcp->sent_list),
+			   struct net_pkt, sent_list);
+
+	if (net_pkt_sent(pkt)) {
+		do_ref_if_needed(tcp, pkt);
+		net_pkt_set_sent(pkt, false);
+	}
+
+	net_pkt_set_queued(pkt, true);
+
+	/* Karn's algorithm, do not time retransmitted segments */
+	tcp->rtt_start = 0;
+
+	if (net_tcp_send_pkt(pkt) < 0 && !is_6lo_technology(pkt)) {
+		NET_DBG("retry %u: [%p] pkt %p send failed",
+			tcp->retry_timeout_shift, tcp, pkt);
+		net_pkt_unref(pkt);
+	} else {
+		NET_DBG("retry %u: [%p] sent pkt %p",
+			tcp->retry_timeout_shift, tcp, pkt);
+		if (IS_ENABLED(CONFIG_NET_STATISTICS_TCP) &&
+		    !is_6lo_technology(pkt)) {
+			net_stats_update_tcp_seg_rexmit(net_pkt_iface(pkt));
+		}
+	}
+}
+
 static void tcp_retry_expired(struct k_work *work)
 {
 	struct net_tcp *tcp = CONTAINER_OF(work, struct net_tcp, retry_timer);
-	struct net_pkt *pkt;
+
+	if (tcp->flags & NET_TCP_FAILED) {
+		abort_connection(tcp);
+		return;
+	}
 
 	/* Double the retry period for exponential backoff and resent
-	 * the first (only the first!) unack'd packet.
+	 * the first unack'd packet.
 	 */
 	if (!sys_slist_is_empty(&tcp->sent_list)) {
 		tcp->retry_timeout_shift++;
@@ -218,29 +312,9 @@ static void tcp_retry_expired(struct k_work *work)
 
 		k_delayed_work_submit(&tcp->retry_timer, retry_timeout(tcp));
 
-		pkt = CONTAINER_OF(sys_slist_peek_head(&tcp->sent_list),
-				   struct net_pkt, sent_list);
-
-		if (net_pkt_sent(pkt)) {
-			do_ref_if_needed(tcp, pkt);
-			net_pkt_set_sent(pkt, false);
-		}
-
-		net_pkt_set_queued(pkt, true);
+		net_tcp_cc_timeout(tcp, flight_size(tcp));
 
-		if (net_tcp_send_pkt(pkt) < 0 && !is_6lo_technology(pkt)) {
-			NET_DBG("retry %u: [%p] pkt %p send failed",
-				tcp->retry_timeout_shift, tcp, pkt);
-			net_pkt_unref(pkt);
-		} else {
-			NET_DBG("retry %u: [%p] sent pkt %p",
-				tcp->retry_timeout_shift, tcp, pkt);
-			if (IS_ENABLED(CONFIG_NET_STATISTICS_TCP) &&
-			    !is_6lo_technology(pkt)) {
-				net_stats_update_tcp_seg_rexmit(
-							net_pkt_iface(pkt));
-			}
-		}
+		resend_first_segment(tcp);
 	} else if (CONFIG_NET_TCP_TIME_WAIT_DELAY != 0) {
 		if (tcp->fin_sent && tcp->fin_rcvd) {
 			NET_DBG("[%p] Closing connection (context %p)",
@@ -274,11 +348,26 @@ struct net_tcp *net_tcp_alloc(struct net_context *context)
 	tcp_context[i].context = context;
 
 	tcp_context[i].send_seq = tcp_init_isn();
-	tcp_context[i].recv_wnd = min(NET_TCP_MAX_WIN, NET_TCP_BUF_MAX_LEN);
+	tcp_context[i].send_wnd = UINT16_MAX;
+	tcp_context[i].recv_wnd = NET_TCP_INIT_RECV_WND;
 	tcp_context[i].send_mss = NET_TCP_DEFAULT_MSS;
+	tcp_context[i].rto = CONFIG_NET_TCP_INIT_RETRANSMISSION_TIMEOUT;
+
+	if (!IS_ENABLED(CONFIG_NET_TCP_NAGLE)) {
+		tcp_context[i].flags |= NET_TCP_NODELAY;
+	}
+
+	/* Smallest shift that lets us advertise the whole window */
+	while ((NET_TCP_INIT_RECV_WND >> tcp_context[i].recv_wscale) >
+	       UINT16_MAX &&
+	       tcp_context[i].recv_wscale < NET_TCP_MAX_WSCALE) {
+		tcp_context[i].recv_wscale++;
+	}
 
 	tcp_context[i].accept_cb = NULL;
 
+	net_tcp_cc_init(&tcp_context[i]);
+
 	k_delayed_work_init(&tcp_context[i].retry_timer, tcp_retry_expired);
 	k_sem_init(&tcp_context[i].connect_wait, 0, UINT_MAX);
 
@@ -321,10 +410,17 @@ int net_tcp_release(struct net_tcp *tcp)
 		net_pkt_unref(pkt);
 	}
 
+	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&tcp->send_queue, pkt, tmp,
+					  sent_list) {
+		sys_slist_remove(&tcp->send_queue, NULL, &pkt->sent_list);
+		net_pkt_unref(pkt);
+	}
+
 	retry_timer_cancel(tcp);
 	k_sem_reset(&tcp->connect_wait);
 
 	ack_timer_cancel(tcp);
+	k_delayed_work_cancel(&tcp->ack_delay_timer);
 	fin_timer_cancel(tcp);
 	timewait_timer_cancel(tcp);
 
@@ -332,7 +428,7 @@ int net_tcp_release(struct net_tcp *tcp)
 	tcp->context = NULL;
 
 	key = irq_lock();
-	tcp->flags &= ~(NET_TCP_IN_USE | NET_TCP_RECV_MSS_SET);
+	tcp->flags &= ~(NET_TCP_IN_USE | NET_TCP_WSCALE | NET_TCP_TS);
 	irq_unlock(key);
 
 	NET_DBG("[%p] Disposed of TCP connection state", tcp);
@@ -500,12 +596,40 @@ u32_t net_tcp_get_recv_wnd(const struct net_tcp *tcp)
 	return tcp->recv_wnd;
 }
 
+/* Window value to put in the header of a segment. The window in a SYN
+ * segment is never scaled (RFC 7323 ch 2.2).
+ */
+static u16_t get_adv_wnd(const struct net_tcp *tcp, u8_t flags)
+{
+	u32_t wnd = net_tcp_get_recv_wnd(tcp);
+
+	if ((tcp->flags & NET_TCP_WSCALE) && !(flags & NET_TCP_SYN)) {
+		wnd >>= tcp->recv_wscale;
+	}
+
+	return min(wnd, UINT16_MAX);
+}
+
+/* Add NOP, NOP, timestamps, RFC 7323 appendix A layout */
+static u8_t add_ts_opt(u32_t ts_recent, u8_t *options)
+{
+	options[0] = NET_TCP_NOP_OPT;
+	options[1] = NET_TCP_NOP_OPT;
+	options[2] = NET_TCP_TIMESTAMPS_OPT;
+	options[3] = NET_TCP_TIMESTAMPS_SIZE;
+	sys_put_be32(k_uptime_get_32(), options + 4);
+	sys_put_be32(ts_recent, options + 8);
+
+	return NET_TCP_TS_OPT_LEN;
+}
+
 int net_tcp_prepare_segment(struct net_tcp *tcp, u8_t flags,
 			    void *options, size_t optlen,
 			    const struct sockaddr_ptr *local,
 			    const struct sockaddr *remote,
 			    struct net_pkt **send_pkt)
 {
+	u8_t ts_opt[NET_TCP_TS_OPT_LEN];
 	u32_t seq;
 	u16_t wnd;
 	struct tcp_segment segment = { 0 };
@@ -515,6 +639,12 @@ int net_tcp_prepare_segment(struct net_tcp *tcp, u8_t flags,
 		local = &tcp->context->local;
 	}
 
+	/* Once negotiated, timestamps are sent in every segment */
+	if ((tcp->flags & NET_TCP_TS) && !options && !(flags & NET_TCP_RST)) {
+		optlen = add_ts_opt(tcp->ts_recent, ts_opt);
+		options = ts_opt;
+	}
+
 	seq = tcp->send_seq;
 
 	if (flags & NET_TCP_ACK) {
@@ -554,7 +684,7 @@ int net_tcp_prepare_segment(struct net_tcp *tcp, u8_t flags,
 		}
 	}
 
-	wnd = net_tcp_get_recv_wnd(tcp);
+	wnd = get_adv_wnd(tcp, flags);
 
 	segment.src_addr = (struct sockaddr_ptr *)local;
 	segment.dst_addr = remote;
@@ -647,25 +777,56 @@ u16_t net_tcp_get_recv_mss(const struct net_tcp *tcp)
 	return 0;
 }
 
-static void net_tcp_set_syn_opt(struct net_tcp *tcp, u8_t *options,
-				u8_t *optionlen)
+/* The window scale and timestamps options are only added if they are
+ * being offered (SYN) or were offered by the peer (SYN-ACK), see
+ * NET_TCP_WSCALE and NET_TCP_TS. A listener answers with the options of
+ * peer_opts, they are only taken into use by the accepted connection.
+ */
+static void net_tcp_set_syn_opt(struct net_tcp *tcp,
+				const struct net_tcp_options *peer_opts,
+				u8_t *options, u8_t *optionlen)
 {
+	u32_t ts_recent = tcp->ts_recent;
+	u8_t flags = tcp->flags;
 	u32_t recv_mss;
 
-	*optionlen = 0;
-
-	if (!(tcp->flags & NET_TCP_RECV_MSS_SET)) {
-		recv_mss = net_tcp_get_recv_mss(tcp);
-		tcp->flags |= NET_TCP_RECV_MSS_SET;
-	} else {
-		recv_mss = 0;
+	if (peer_opts) {
+		flags = peer_opts->flags;
+		ts_recent = peer_opts->tsval;
 	}
 
+	*optionlen = 0;
+
+	recv_mss = net_tcp_get_recv_mss(tcp);
 	recv_mss |= (NET_TCP_MSS_OPT << 24) | (NET_TCP_MSS_SIZE << 16);
 	UNALIGNED_PUT(htonl(recv_mss),
 		      (u32_t *)(options + *optionlen));
 
 	*optionlen += NET_TCP_MSS_SIZE;
+
+	if (flags & NET_TCP_WSCALE) {
+		options[(*optionlen)++] = NET_TCP_NOP_OPT;
+		options[(*optionlen)++] = NET_TCP_WINDOW_SCALE_OPT;
+		options[(*optionlen)++] = NET_TCP_WINDOW_SCALE_SIZE;
+		options[(*optionlen)++] = tcp->recv_wscale;
+	}
+
+	if (flags & NET_TCP_TS) {
+		*optionlen += add_ts_opt(ts_recent, options + *optionlen);
+	}
+}
+
+/* Take the options received in a SYN or SYN-ACK into use. Window
+ * scaling and timestamps are only enabled if both ends sent them.
+ */
+static void set_peer_opts(struct net_tcp *tcp,
+			  const struct net_tcp_options *opts)
+{
+	tcp->flags &= ~(NET_TCP_WSCALE | NET_TCP_TS);
+	tcp->flags |= opts->flags & TCP_OPT_FLAGS;
+	tcp->send_wscale = opts->wscale;
+	tcp->ts_recent = opts->tsval;
+	tcp->send_mss = opts->mss;
 }
 
 int net_tcp_prepare_ack(struct net_tcp *tcp, const struct sockaddr *remote,
@@ -679,7 +840,7 @@ int net_tcp_prepare_ack(struct net_tcp *tcp, const struct sockaddr *remote,
 		/* In the SYN_RCVD state acknowledgment must be with the
 		 * SYN flag.
 		 */
-		net_tcp_set_syn_opt(tcp, options, &optionlen);
+		net_tcp_set_syn_opt(tcp, NULL, options, &optionlen);
 
 		return net_tcp_prepare_segment(tcp, NET_TCP_SYN | NET_TCP_ACK,
 					       options, optionlen, NULL, remote,
@@ -792,11 +953,114 @@ const char *net_tcp_state_str(enum net_tcp_state state)
 	return "";
 }
 
+/* Split the fragments longer than max_len. The tail of a fragment goes
+ * to a clone of it, which refers to the same data if the pool allows
+ * that and is a copy otherwise.
+ */
+static int split_long_frags(struct net_pkt *pkt, u16_t max_len)
+{
+	struct net_buf *frag, *tail;
+
+	for (frag = pkt->frags; frag; frag = frag->frags) {
+		if (frag->len <= max_len) {
+			continue;
+		}
+
+		tail = net_buf_clone(frag, ALLOC_TIMEOUT);
+		if (!tail) {
+			return -ENOMEM;
+		}
+
+		net_buf_pull(tail, max_len);
+		frag->len = max_len;
+
+		tail->frags = frag->frags;
+		frag->frags = tail;
+	}
+
+	return 0;
+}
+
+/* Queue data that does not fit into one segment as several packets.
+ * The fragments are moved to the new packets without copying, so a
+ * packet can end up shorter than the MSS.
+ */
+static int queue_split_data(struct net_tcp *tcp, struct net_pkt *pkt)
+{
+	u16_t max_len = net_tcp_get_send_data_len(tcp);
+	struct net_buf *frag, *prev = NULL;
+	struct net_pkt *part;
+	sys_slist_t parts;
+	sys_snode_t *node;
+	int count = 0;
+	u32_t len = 0;
+	int ret;
+
+	/* A segment cannot be longer than the MSS, even if a fragment is */
+	ret = split_long_frags(pkt, max_len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	/* Allocate all the packets first so that nothing is queued if
+	 * we run out of them.
+	 */
+	for (frag = pkt->frags; frag; frag = frag->frags) {
+		if (len && len + frag->len > max_len) {
+			count++;
+			len = 0;
+		}
+
+		len += frag->len;
+	}
+
+	sys_slist_init(&parts);
+
+	while (count--) {
+		part = net_pkt_get_tx(tcp->context, ALLOC_TIMEOUT);
+		if (!part) {
+			while ((node = sys_slist_get(&parts))) {
+				net_pkt_unref(CONTAINER_OF(node, struct net_pkt,
+							   sent_list));
+			}
+
+			return -ENOMEM;
+		}
+
+		sys_slist_append(&parts, &part->sent_list);
+	}
+
+	part = pkt;
+	len = 0;
+
+	for (frag = pkt->frags; frag; prev = frag, frag = frag->frags) {
+		if (len && len + frag->len > max_len) {
+			struct net_pkt *next;
+
+			next = CONTAINER_OF(sys_slist_get(&parts),
+					    struct net_pkt, sent_list);
+			prev->frags = NULL;
+			next->frags = frag;
+
+			net_pkt_set_appdatalen(part, len);
+			sys_slist_append(&tcp->send_queue, &part->sent_list);
+
+			part = next;
+			len = 0;
+		}
+
+		len += frag->len;
+	}
+
+	net_pkt_set_appdatalen(part, len);
+	sys_slist_append(&tcp->send_queue, &part->sent_list);
+
+	return 0;
+}
+
 int net_tcp_queue_data(struct net_context *context, struct net_pkt *pkt)
 {
-	struct net_conn *conn = (struct net_conn *)context->conn_handler;
 	size_t data_len = net_pkt_get_len(pkt);
-	int ret;
 
 	NET_DBG("[%p] Queue %p len %zd", context->tcp, pkt, data_len);
 
@@ -809,33 +1073,194 @@ int net_tcp_queue_data(struct net_context *context, struct net_pkt *pkt)
 		return -ESHUTDOWN;
 	}
 
-	net_pkt_set_appdatalen(pkt, net_pkt_get_len(pkt));
+	if (context->tcp->flags & NET_TCP_FAILED) {
+		return -ECONNRESET;
+	}
+
+	if (data_len > net_tcp_get_send_data_len(context->tcp)) {
+		return queue_split_data(context->tcp, pkt);
+	}
+
+	net_pkt_set_appdatalen(pkt, data_len);
 
-	/* Set PSH on all packets, our window is so small that there's
-	 * no point in the remote side trying to finesse things and
-	 * coalesce packets.
+	/* The segment is built later by queue_segments(), possibly
+	 * together with data written after this.
 	 */
-	ret = net_tcp_prepare_segment(context->tcp, NET_TCP_PSH | NET_TCP_ACK,
-				      NULL, 0, NULL, &conn->remote_addr, &pkt);
-	if (ret) {
-		return ret;
+	sys_slist_append(&context->tcp->send_queue, &pkt->sent_list);
+
+	return 0;
+}
+
+/* Nagle's algorithm (RFC 896, RFC 1122 ch 4.2.3.4): hold back a less
+ * than full-sized segment while there is unacknowledged data, so that
+ * more data can be merged into it. TCP_CORK holds it back regardless.
+ */
+static bool hold_partial_segment(struct net_tcp *tcp)
+{
+	if (tcp->flags & NET_TCP_CORK) {
+		return true;
 	}
 
-	context->tcp->send_seq += data_len;
+	return !(tcp->flags & NET_TCP_NODELAY) &&
+		!sys_slist_is_empty(&tcp->sent_list);
+}
+
+/* With GSO the L2 splits a packet into segments just before sending,
+ * so several segments worth of data can be sent as one packet. Do not
+ * put more into it than the windows allow to be sent at once.
+ */
+static u32_t gso_max_len(struct net_tcp *tcp, u16_t mss)
+{
+#if defined(CONFIG_NET_L2_ETHERNET_GSO)
+	struct net_if *iface = net_context_get_iface(tcp->context);
+	u32_t wnd;
 
-	net_stats_update_tcp_sent(net_pkt_iface(pkt), data_len);
+	if (net_if_l2(iface) != &NET_L2_GET_NAME(ETHERNET)) {
+		return mss;
+	}
 
-	sys_slist_append(&context->tcp->sent_list, &pkt->sent_list);
+	wnd = min(net_tcp_cc_get_cwnd(tcp), tcp->send_wnd);
+	wnd = min(wnd - wnd % mss,
+		  (u32_t)mss * CONFIG_NET_L2_ETHERNET_GSO_SEGS);
 
-	/* We need to restart retry_timer if it is stopped. */
-	if (k_delayed_work_remaining_get(&context->tcp->retry_timer) == 0) {
-		k_delayed_work_submit(&context->tcp->retry_timer,
-				      retry_timeout(context->tcp));
+	return max(wnd, (u32_t)mss);
+#else
+	return mss;
+#endif
+}
+
+/* Build segments from the data in the send queue and move them to the
+ * sent_list. Consecutive writes are merged into segments of up to one
+ * MSS, or several with GSO, by chaining their fragments, the data itself
+ * is not copied. If force is set, a partial segment is built even if
+ * Nagle's algorithm or TCP_CORK would hold it back.
+ */
+static void queue_segments(struct net_tcp *tcp, bool force)
+{
+	struct net_conn *conn = (struct net_conn *)tcp->context->conn_handler;
+	u16_t mss = net_tcp_get_send_data_len(tcp);
+	u32_t max_len = gso_max_len(tcp, mss);
+	sys_snode_t *node;
+
+	if (tcp->flags & NET_TCP_FAILED) {
+		return;
 	}
 
-	do_ref_if_needed(context->tcp, pkt);
+	while ((node = sys_slist_get(&tcp->send_queue))) {
+		struct net_pkt *pkt = CONTAINER_OF(node, struct net_pkt,
+						   sent_list);
+		u32_t len = net_pkt_appdatalen(pkt);
+		int ret;
 
-	return 0;
+		while ((node = sys_slist_peek_head(&tcp->send_queue))) {
+			struct net_pkt *next = CONTAINER_OF(node,
+							    struct net_pkt,
+							    sent_list);
+
+			if (len + net_pkt_appdatalen(next) > max_len) {
+				break;
+			}
+
+			sys_slist_get(&tcp->send_queue);
+
+			len += net_pkt_appdatalen(next);
+			net_pkt_frag_add(pkt, next->frags);
+			next->frags = NULL;
+			net_pkt_unref(next);
+		}
+
+		net_pkt_set_appdatalen(pkt, len);
+
+		if (len < mss && !force && hold_partial_segment(tcp)) {
+			sys_slist_prepend(&tcp->send_queue, &pkt->sent_list);
+			break;
+		}
+
+		/* Set PSH on all packets, our window is so small that
+		 * there's no point in the remote side trying to finesse
+		 * things and coalesce packets.
+		 */
+		ret = net_tcp_prepare_segment(tcp, NET_TCP_PSH | NET_TCP_ACK,
+					      NULL, 0, NULL,
+					      &conn->remote_addr, &pkt);
+		if (ret == -ENOMEM) {
+			/* The data is still intact, try again later */
+			sys_slist_prepend(&tcp->send_queue, &pkt->sent_list);
+			break;
+		} else if (ret) {
+			/* The data was accepted already and cannot be skipped
+			 * without corrupting the stream. Keep it queued and
+			 * reset the connection from the retry timer, as the
+			 * caller may still use the context.
+			 */
+			NET_ERR("[%p] Cannot prepare segment (%d), resetting "
+				"connection", tcp, ret);
+			sys_slist_prepend(&tcp->send_queue, &pkt->sent_list);
+			tcp->flags |= NET_TCP_FAILED;
+			k_delayed_work_submit(&tcp->retry_timer, K_NO_WAIT);
+			break;
+		}
+
+		if (len > mss) {
+			net_pkt_set_gso_size(pkt, mss);
+		}
+
+		tcp->send_seq += len;
+
+		net_stats_update_tcp_sent(net_pkt_iface(pkt), len);
+
+		sys_slist_append(&tcp->sent_list, &pkt->sent_list);
+
+		/* We need to restart retry_timer if it is stopped. */
+		if (k_delayed_work_remaining_get(&tcp->retry_timer) == 0) {
+			k_delayed_work_submit(&tcp->retry_timer,
+					      retry_timeout(tcp));
+		}
+
+		do_ref_if_needed(tcp, pkt);
+	}
+}
+
+/* Refresh the timestamps option of a segment that is (re)sent, so that
+ * the echo gives the round-trip time of this transmission. Only the
+ * layout used by net_tcp_prepare_segment() is recognized.
+ */
+static bool update_ts_opt(struct net_tcp *tcp, struct net_pkt *pkt,
+			  struct net_tcp_hdr *tcp_hdr)
+{
+	u8_t opt[NET_TCP_TS_OPT_LEN];
+	u8_t ts[2 * sizeof(u32_t)];
+	struct net_buf *frag;
+	u16_t pos;
+
+	if (!(tcp->flags & NET_TCP_TS) ||
+	    NET_TCP_HDR_LEN(tcp_hdr) != NET_TCPH_LEN + NET_TCP_TS_OPT_LEN) {
+		return false;
+	}
+
+	frag = net_frag_read(pkt->frags, net_pkt_ip_hdr_len(pkt) +
+			     net_pkt_ipv6_ext_len(pkt) + NET_TCPH_LEN,
+			     &pos, sizeof(opt), opt);
+	if (!frag && pos == 0xffff) {
+		return false;
+	}
+
+	if (opt[2] != NET_TCP_TIMESTAMPS_OPT) {
+		return false;
+	}
+
+	sys_put_be32(k_uptime_get_32(), ts);
+	sys_put_be32(tcp->ts_recent, ts + sizeof(u32_t));
+
+	if (!memcmp(opt + 4, ts, sizeof(ts))) {
+		return false;
+	}
+
+	frag = net_pkt_write(pkt, pkt->frags, net_pkt_ip_hdr_len(pkt) +
+			     net_pkt_ipv6_ext_len(pkt) + NET_TCPH_LEN + 4,
+			     &pos, sizeof(ts), ts, ALLOC_TIMEOUT);
+
+	return frag != NULL;
 }
 
 int net_tcp_send_pkt(struct net_pkt *pkt)
@@ -855,6 +1280,10 @@ int net_tcp_send_pkt(struct net_pkt *pkt)
 		calc_chksum = true;
 	}
 
+	if (update_ts_opt(ctx->tcp, pkt, tcp_hdr)) {
+		calc_chksum = true;
+	}
+
 	/* The data stream code always sets this flag, because
 	 * existing stacks (Linux, anyway) seem to ignore data packets
 	 * without a valid-but-already-transmitted ACK.  But set it
@@ -876,6 +1305,9 @@ int net_tcp_send_pkt(struct net_pkt *pkt)
 
 	ctx->tcp->sent_ack = ctx->tcp->send_ack;
 
+	/* The ACK went out with this segment */
+	k_delayed_work_cancel(&ctx->tcp->ack_delay_timer);
+
 	/* As we modified the header, we need to write it back.
 	 */
 	net_tcp_set_hdr(pkt, tcp_hdr);
@@ -934,6 +1366,11 @@ int net_tcp_send_pkt(struct net_pkt *pkt)
 
 static void restart_timer(struct net_tcp *tcp)
 {
+	if (tcp->flags & NET_TCP_FAILED) {
+		/* The connection is about to be reset */
+		return;
+	}
+
 	if (!sys_slist_is_empty(&tcp->sent_list)) {
 		tcp->flags |= NET_TCP_RETRYING;
 		tcp->retry_timeout_shift = 0;
@@ -953,38 +1390,85 @@ static void restart_timer(struct net_tcp *tcp)
 	}
 }
 
-int net_tcp_send_data(struct net_context *context, net_context_send_cb_t cb,
-		      void *token, void *user_data)
+/* Without timestamps one segment per round trip is timed to get the
+ * round-trip time samples.
+ */
+static void start_rtt_timing(struct net_tcp *tcp, struct net_pkt *pkt)
 {
+	struct net_tcp_hdr hdr, *tcp_hdr;
+
+	if ((tcp->flags & NET_TCP_TS) || tcp->rtt_start ||
+	    !net_pkt_appdatalen(pkt)) {
+		return;
+	}
+
+	tcp_hdr = net_tcp_get_hdr(pkt, &hdr);
+	if (!tcp_hdr) {
+		return;
+	}
+
+	tcp->rtt_seq = sys_get_be32(tcp_hdr->seq) +
+		net_pkt_appdatalen(pkt) - 1;
+	tcp->rtt_start = max(k_uptime_get_32(), 1);
+}
+
+/* Send queued data synchronously, as much as the congestion window and
+ * the window of the peer allow. The rest is sent when ACKs arrive.
+ */
+static void send_queued_data(struct net_tcp *tcp)
+{
+	u32_t cwnd = min(net_tcp_cc_get_cwnd(tcp), tcp->send_wnd);
+	u32_t flight = 0;
 	struct net_pkt *pkt;
 
-	/* For now, just send all queued data synchronously.  Need to
-	 * add window handling and retry/ACK logic.
-	 */
-	SYS_SLIST_FOR_EACH_CONTAINER(&context->tcp->sent_list, pkt, sent_list) {
+	queue_segments(tcp, false);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&tcp->sent_list, pkt, sent_list) {
+		u32_t len = net_pkt_appdatalen(pkt);
+		int ret;
+
 		/* Do not resend packets that were sent by expire timer */
 		if (net_pkt_queued(pkt)) {
 			NET_DBG("[%p] Skipping pkt %p because it was already "
-				"sent.", context->tcp, pkt);
+				"sent.", tcp, pkt);
+			flight += len;
+			continue;
+		}
+
+		if (net_pkt_sent(pkt)) {
+			flight += len;
 			continue;
 		}
 
-		if (!net_pkt_sent(pkt)) {
-			int ret;
+		/* Always allow one segment to be in flight, this also
+		 * probes a zero window.
+		 */
+		if (flight && flight + len > cwnd) {
+			NET_DBG("[%p] window %u full (%u bytes in flight)",
+				tcp, cwnd, flight);
+			break;
+		}
 
-			NET_DBG("[%p] Sending pkt %p (%zd bytes)", context->tcp,
-				pkt, net_pkt_get_len(pkt));
+		NET_DBG("[%p] Sending pkt %p (%zd bytes)", tcp,
+			pkt, net_pkt_get_len(pkt));
 
-			ret = net_tcp_send_pkt(pkt);
-			if (ret < 0 && !is_6lo_technology(pkt)) {
-				NET_DBG("[%p] pkt %p not sent (%d)",
-					context->tcp, pkt, ret);
-				net_pkt_unref(pkt);
-			}
+		start_rtt_timing(tcp, pkt);
 
-			net_pkt_set_queued(pkt, true);
+		ret = net_tcp_send_pkt(pkt);
+		if (ret < 0 && !is_6lo_technology(pkt)) {
+			NET_DBG("[%p] pkt %p not sent (%d)", tcp, pkt, ret);
+			net_pkt_unref(pkt);
 		}
+
+		net_pkt_set_queued(pkt, true);
+		flight += len;
 	}
+}
+
+int net_tcp_send_data(struct net_context *context, net_context_send_cb_t cb,
+		      void *token, void *user_data)
+{
+	send_queued_data(context->tcp);
 
 	/* Just make the callback synchronously even if it didn't
 	 * go over the wire.  In theory it would be nice to track
@@ -999,6 +1483,93 @@ int net_tcp_send_data(struct net_context *context, net_context_send_cb_t cb,
 	return 0;
 }
 
+/* A packet sent with GSO covers several segments and the peer can
+ * acknowledge only some of them. Remove the acknowledged data from the
+ * start of the packet, so that a retransmission only carries what is
+ * missing. Returns the number of bytes removed.
+ */
+static u32_t trim_acked_data(struct net_pkt *pkt, u32_t ack)
+{
+	struct net_tcp_hdr hdr, *tcp_hdr;
+	struct net_buf *frag, *prev = NULL;
+	u16_t offset;
+	u32_t len, left;
+
+	/* Packets still in the TX queue must not be modified */
+	if (!net_pkt_gso_size(pkt) || net_pkt_queued(pkt)) {
+		return 0;
+	}
+
+	tcp_hdr = net_tcp_get_hdr(pkt, &hdr);
+	if (!tcp_hdr ||
+	    !net_tcp_seq_greater(ack, sys_get_be32(tcp_hdr->seq))) {
+		return 0;
+	}
+
+	len = ack - sys_get_be32(tcp_hdr->seq);
+	if (len >= net_pkt_appdatalen(pkt)) {
+		return 0;
+	}
+
+	offset = net_pkt_ip_hdr_len(pkt) + net_pkt_ipv6_ext_len(pkt) +
+		NET_TCP_HDR_LEN(tcp_hdr);
+
+	frag = pkt->frags;
+	while (frag && offset >= frag->len) {
+		offset -= frag->len;
+		prev = frag;
+		frag = frag->frags;
+	}
+
+	for (left = len; frag && left; offset = 0) {
+		u16_t count = min(left, (u32_t)(frag->len - offset));
+
+		left -= count;
+
+		if (!offset && count == frag->len) {
+			frag = net_pkt_frag_del(pkt, prev, frag);
+			continue;
+		}
+
+		memmove(frag->data + offset, frag->data + offset + count,
+			frag->len - offset - count);
+		frag->len -= count;
+
+		prev = frag;
+		frag = frag->frags;
+	}
+
+	sys_put_be32(ack, tcp_hdr->seq);
+	net_tcp_set_hdr(pkt, tcp_hdr);
+
+	net_pkt_set_appdatalen(pkt, net_pkt_appdatalen(pkt) - len);
+
+#if defined(CONFIG_NET_IPV4)
+	if (net_pkt_family(pkt) == AF_INET) {
+		sys_put_be16(net_pkt_get_len(pkt), NET_IPV4_HDR(pkt)->len);
+
+		NET_IPV4_HDR(pkt)->chksum = 0;
+		if (net_if_need_calc_tx_checksum(net_pkt_iface(pkt))) {
+			NET_IPV4_HDR(pkt)->chksum =
+				~net_calc_chksum_ipv4(pkt);
+		}
+	}
+#endif
+#if defined(CONFIG_NET_IPV6)
+	if (net_pkt_family(pkt) == AF_INET6) {
+		sys_put_be16(net_pkt_get_len(pkt) -
+			     sizeof(struct net_ipv6_hdr),
+			     NET_IPV6_HDR(pkt)->len);
+	}
+#endif
+
+	if (net_if_need_calc_tx_checksum(net_pkt_iface(pkt))) {
+		net_tcp_set_chksum(pkt, pkt->frags);
+	}
+
+	return len;
+}
+
 bool net_tcp_ack_received(struct net_context *ctx, u32_t ack)
 {
 	struct net_tcp *tcp = ctx->tcp;
@@ -1006,7 +1577,9 @@ bool net_tcp_ack_received(struct net_context *ctx, u32_t ack)
 	sys_snode_t *head;
 	struct net_pkt *pkt;
 	u32_t seq;
+	u32_t acked = 0;
 	bool valid_ack = false;
+	bool partial_ack = false;
 
 	if (net_tcp_seq_greater(ack, ctx->tcp->send_seq)) {
 		NET_ERR("ctx %p: ACK for unsent data", ctx);
@@ -1038,6 +1611,13 @@ bool net_tcp_ack_received(struct net_context *ctx, u32_t ack)
 		seq = sys_get_be32(tcp_hdr->seq) + net_pkt_appdatalen(pkt) - 1;
 
 		if (!net_tcp_seq_greater(ack, seq)) {
+			u32_t trimmed = trim_acked_data(pkt, ack);
+
+			if (trimmed) {
+				acked += trimmed;
+				valid_ack = true;
+			}
+
 			break;
 		}
 
@@ -1051,11 +1631,24 @@ bool net_tcp_ack_received(struct net_context *ctx, u32_t ack)
 			}
 		}
 
+		acked += net_pkt_appdatalen(pkt);
+
 		sys_slist_remove(list, NULL, head);
 		net_pkt_unref(pkt);
 		valid_ack = true;
 	}
 
+	if (valid_ack && tcp->rtt_start &&
+	    net_tcp_seq_greater(ack, tcp->rtt_seq)) {
+		update_rto(tcp, k_uptime_get_32() - tcp->rtt_start);
+		tcp->rtt_start = 0;
+	}
+
+	if (IS_ENABLED(CONFIG_NET_TCP_CONGESTION_CONTROL) && valid_ack) {
+		partial_ack = net_tcp_cc_ack(tcp, ack, acked,
+					     flight_size(tcp));
+	}
+
 	/* Restart the timer on a valid inbound ACK.  This isn't quite the
 	 * same behavior as per-packet retry timers, but is close in practice
 	 * (it starts retries one timer period after the connection
@@ -1066,9 +1659,69 @@ bool net_tcp_ack_received(struct net_context *ctx, u32_t ack)
 		restart_timer(ctx->tcp);
 	}
 
+	if (valid_ack) {
+		if (partial_ack && !sys_slist_is_empty(list)) {
+			resend_first_segment(tcp);
+		}
+
+		/* The window opened or data held back by Nagle's
+		 * algorithm can go now, send what is waiting.
+		 */
+		send_queued_data(tcp);
+	}
+
+	return true;
+}
+
+/* Get the first unacknowledged sequence number, if that segment has
+ * been sent already.
+ */
+static bool get_unacked_seq(struct net_tcp *tcp, u32_t *seq)
+{
+	struct net_tcp_hdr hdr, *tcp_hdr;
+	struct net_pkt *pkt;
+
+	if (sys_slist_is_empty(&tcp->sent_list)) {
+		return false;
+	}
+
+	pkt = CONTAINER_OF(sys_slist_peek_head(&tcp->sent_list),
+			   struct net_pkt, sent_list);
+
+	if (!net_pkt_queued(pkt) && !net_pkt_sent(pkt)) {
+		return false;
+	}
+
+	tcp_hdr = net_tcp_get_hdr(pkt, &hdr);
+	if (!tcp_hdr) {
+		return false;
+	}
+
+	*seq = sys_get_be32(tcp_hdr->seq);
+
 	return true;
 }
 
+static void handle_dup_ack(struct net_tcp *tcp)
+{
+	struct net_pkt *pkt;
+
+	if (net_tcp_cc_dup_ack(tcp, flight_size(tcp))) {
+		pkt = CONTAINER_OF(sys_slist_peek_head(&tcp->sent_list),
+				   struct net_pkt, sent_list);
+
+		/* No point in resending if it is still in the TX queue */
+		if (!net_pkt_queued(pkt)) {
+			resend_first_segment(tcp);
+		}
+
+		return;
+	}
+
+	/* During fast recovery each duplicate ACK inflates the window */
+	send_queued_data(tcp);
+}
+
 void net_tcp_init(void)
 {
 }
@@ -1397,6 +2050,25 @@ int net_tcp_parse_opts(struct net_pkt *pkt, int opt_totlen,
 			frag = net_frag_read_be16(frag, pos, &pos,
 						  &opts->mss);
 			break;
+		case NET_TCP_WINDOW_SCALE_OPT:
+			if (optlen != 1) {
+				goto error;
+			}
+			frag = net_frag_read_u8(frag, pos, &pos,
+						&opts->wscale);
+			opts->wscale = min(opts->wscale, NET_TCP_MAX_WSCALE);
+			opts->flags |= NET_TCP_WSCALE;
+			break;
+		case NET_TCP_TIMESTAMPS_OPT:
+			if (optlen != 8) {
+				goto error;
+			}
+			frag = net_frag_read_be32(frag, pos, &pos,
+						  &opts->tsval);
+			frag = net_frag_read_be32(frag, pos, &pos,
+						  &opts->tsecr);
+			opts->flags |= NET_TCP_TS;
+			break;
 		default:
 			frag = net_frag_skip(frag, pos, &pos, optlen);
 			break;
@@ -1446,6 +2118,12 @@ static void queue_fin(struct net_context *ctx)
 	struct net_pkt *pkt = NULL;
 	int ret;
 
+	/* Data held back by Nagle's algorithm or TCP_CORK goes out
+	 * before the FIN.
+	 */
+	queue_segments(ctx->tcp, true);
+	send_queued_data(ctx->tcp);
+
 	ret = net_tcp_prepare_segment(ctx->tcp, NET_TCP_FIN, NULL, 0,
 				      NULL, &ctx->remote, &pkt);
 	if (ret || !pkt) {
@@ -1500,7 +2178,7 @@ int net_tcp_update_recv_wnd(struct net_context *context, s32_t delta)
 	}
 
 	new_win = context->tcp->recv_wnd + delta;
-	if (new_win < 0 || new_win > UINT16_MAX) {
+	if (new_win < 0 || new_win > (UINT16_MAX << NET_TCP_MAX_WSCALE)) {
 		return -EINVAL;
 	}
 
@@ -1509,6 +2187,79 @@ int net_tcp_update_recv_wnd(struct net_context *context, s32_t delta)
 	return 0;
 }
 
+static u16_t option_flag(enum net_context_option option)
+{
+	switch (option) {
+	case NET_OPT_TCP_NODELAY:
+		return NET_TCP_NODELAY;
+	case NET_OPT_TCP_CORK:
+		return NET_TCP_CORK;
+	default:
+		return 0;
+	}
+}
+
+int net_tcp_set_option(struct net_context *context,
+		       enum net_context_option option,
+		       const void *value, size_t len)
+{
+	struct net_tcp *tcp = context->tcp;
+	u16_t flag = option_flag(option);
+
+	if (!tcp) {
+		return -EPROTOTYPE;
+	}
+
+	if (!flag || len != sizeof(int)) {
+		return -EINVAL;
+	}
+
+	if (*(const int *)value) {
+		tcp->flags |= flag;
+	} else {
+		tcp->flags &= ~flag;
+	}
+
+	if (net_context_get_state(context) != NET_CONTEXT_CONNECTED) {
+		return 0;
+	}
+
+	/* Setting TCP_NODELAY or clearing TCP_CORK pushes out the
+	 * data that was held back.
+	 */
+	if (option == NET_OPT_TCP_CORK && !*(const int *)value) {
+		queue_segments(tcp, true);
+	}
+
+	send_queued_data(tcp);
+
+	return 0;
+}
+
+int net_tcp_get_option(struct net_context *context,
+		       enum net_context_option option,
+		       void *value, size_t *len)
+{
+	struct net_tcp *tcp = context->tcp;
+	u16_t flag = option_flag(option);
+
+	if (!tcp) {
+		return -EPROTOTYPE;
+	}
+
+	if (!flag || (len && *len < sizeof(int))) {
+		return -EINVAL;
+	}
+
+	*(int *)value = !!(tcp->flags & flag);
+
+	if (len) {
+		*len = sizeof(int);
+	}
+
+	return 0;
+}
+
 static int send_reset(struct net_context *context, struct sockaddr *local,
 		      struct sockaddr *remote);
 
@@ -1593,7 +2344,7 @@ static int tcp_backlog_find(struct net_pkt *pkt, int *empty_slot)
 }
 
 static int tcp_backlog_syn(struct net_pkt *pkt, struct net_context *context,
-			   u16_t send_mss)
+			   const struct net_tcp_options *opts)
 {
 	int empty_slot = -1;
 	int ret;
@@ -1619,7 +2370,7 @@ static int tcp_backlog_syn(struct net_pkt *pkt, struct net_context *context,
 
 	tcp_backlog[empty_slot].send_seq = context->tcp->send_seq;
 	tcp_backlog[empty_slot].send_ack = context->tcp->send_ack;
-	tcp_backlog[empty_slot].send_mss = send_mss;
+	tcp_backlog[empty_slot].opts = *opts;
 
 	k_delayed_work_init(&tcp_backlog[empty_slot].ack_timer,
 			    backlog_ack_timeout);
@@ -1653,7 +2404,15 @@ static int tcp_backlog_ack(struct net_pkt *pkt, struct net_context *context)
 		sizeof(struct sockaddr));
 	context->tcp->send_seq = tcp_backlog[r].send_seq + 1;
 	context->tcp->send_ack = tcp_backlog[r].send_ack;
-	context->tcp->send_mss = tcp_backlog[r].send_mss;
+	set_peer_opts(context->tcp, &tcp_backlog[r].opts);
+
+	context->tcp->send_wnd = sys_get_be16(tcp_hdr->wnd);
+	if (context->tcp->flags & NET_TCP_WSCALE) {
+		context->tcp->send_wnd <<= context->tcp->send_wscale;
+	}
+
+	/* The initial window depends on the MSS of the peer */
+	net_tcp_cc_init(context->tcp);
 
 	k_delayed_work_cancel(&tcp_backlog[r].ack_timer);
 	memset(&tcp_backlog[r], 0, sizeof(struct tcp_backlog_entry));
@@ -1736,6 +2495,26 @@ static void handle_timewait_timeout(struct k_work *work)
 	}
 }
 
+static void handle_ack_delay_timeout(struct k_work *work)
+{
+	struct net_tcp *tcp = CONTAINER_OF(work, struct net_tcp,
+					   ack_delay_timer);
+	struct net_pkt *pkt = NULL;
+
+	/* No data was sent in the meantime, acknowledge on our own */
+	if (tcp->send_ack == tcp->sent_ack) {
+		return;
+	}
+
+	if (net_tcp_prepare_ack(tcp, &tcp->context->remote, &pkt)) {
+		return;
+	}
+
+	if (net_tcp_send_pkt(pkt) < 0) {
+		net_pkt_unref(pkt);
+	}
+}
+
 int net_tcp_get(struct net_context *context)
 {
 	context->tcp = net_tcp_alloc(context);
@@ -1748,6 +2527,8 @@ int net_tcp_get(struct net_context *context)
 	k_delayed_work_init(&context->tcp->fin_timer, handle_fin_timeout);
 	k_delayed_work_init(&context->tcp->timewait_timer,
 			    handle_timewait_timeout);
+	k_delayed_work_init(&context->tcp->ack_delay_timer,
+			    handle_ack_delay_timeout);
 
 	return 0;
 }
@@ -1826,6 +2607,7 @@ static void print_send_info(struct net_pkt *pkt, const char *msg)
 static inline int send_syn_segment(struct net_context *context,
 				       const struct sockaddr_ptr *local,
 				       const struct sockaddr *remote,
+				       const struct net_tcp_options *peer_opts,
 				       int flags, const char *msg)
 {
 	struct net_pkt *pkt = NULL;
@@ -1833,9 +2615,7 @@ static inline int send_syn_segment(struct net_context *context,
 	u8_t options[NET_TCP_MAX_OPT_SIZE];
 	u8_t optionlen = 0;
 
-	if (flags == NET_TCP_SYN) {
-		net_tcp_set_syn_opt(context->tcp, options, &optionlen);
-	}
+	net_tcp_set_syn_opt(context->tcp, peer_opts, options, &optionlen);
 
 	ret = net_tcp_prepare_segment(context->tcp, flags, options, optionlen,
 				      local, remote, &pkt);
@@ -1861,14 +2641,19 @@ static inline int send_syn(struct net_context *context,
 {
 	net_tcp_change_state(context->tcp, NET_TCP_SYN_SENT);
 
-	return send_syn_segment(context, NULL, remote, NET_TCP_SYN, "SYN");
+	/* Offer all the options we support */
+	context->tcp->flags |= TCP_OPT_FLAGS;
+
+	return send_syn_segment(context, NULL, remote, NULL, NET_TCP_SYN,
+				"SYN");
 }
 
 static inline int send_syn_ack(struct net_context *context,
 			       struct sockaddr_ptr *local,
-			       struct sockaddr *remote)
+			       struct sockaddr *remote,
+			       const struct net_tcp_options *peer_opts)
 {
-	return send_syn_segment(context, local, remote,
+	return send_syn_segment(context, local, remote, peer_opts,
 				    NET_TCP_SYN | NET_TCP_ACK,
 				    "SYN_ACK");
 }
@@ -1901,6 +2686,30 @@ static int send_ack(struct net_context *context,
 	return ret;
 }
 
+/* Delay the ACK of received data so that it can be sent along with the
+ * reply of the application, but acknowledge at least every second
+ * full-sized segment (RFC 1122 ch 4.2.3.2, RFC 5681 ch 4.2).
+ */
+static void delay_ack(struct net_context *context)
+{
+	struct net_tcp *tcp = context->tcp;
+
+	if (tcp->send_ack == tcp->sent_ack) {
+		return;
+	}
+
+	if (CONFIG_NET_TCP_ACK_DELAY == 0 ||
+	    tcp->send_ack - tcp->sent_ack >= 2 * net_tcp_get_recv_mss(tcp)) {
+		send_ack(context, &context->remote, false);
+		return;
+	}
+
+	if (k_delayed_work_remaining_get(&tcp->ack_delay_timer) == 0) {
+		k_delayed_work_submit(&tcp->ack_delay_timer,
+				      K_MSEC(CONFIG_NET_TCP_ACK_DELAY));
+	}
+}
+
 static int send_reset(struct net_context *context,
 		      struct sockaddr *local,
 		      struct sockaddr *remote)
@@ -1929,6 +2738,7 @@ static int send_reset(struct net_context *context,
 NET_CONN_CB(tcp_established)
 {
 	struct net_context *context = (struct net_context *)user_data;
+	struct net_tcp_options tcp_opts = { 0 };
 	struct net_tcp_hdr hdr, *tcp_hdr;
 	enum net_verdict ret = NET_OK;
 	u8_t tcp_flags;
@@ -1951,6 +2761,9 @@ NET_CONN_CB(tcp_established)
 
 	tcp_flags = NET_TCP_FLAGS(tcp_hdr);
 
+	net_context_set_appdata_values(pkt, IPPROTO_TCP);
+	data_len = net_pkt_appdatalen(pkt);
+
 	if (net_tcp_seq_cmp(sys_get_be32(tcp_hdr->seq),
 			    context->tcp->send_ack) < 0) {
 		/* Peer sent us packet we've already seen. Apparently,
@@ -1999,13 +2812,63 @@ resend_ack:
 		return NET_DROP;
 	}
 
+	if (context->tcp->flags & NET_TCP_TS) {
+		if (net_tcp_parse_opts(pkt, NET_TCP_HDR_LEN(tcp_hdr) -
+				       sizeof(struct net_tcp_hdr),
+				       &tcp_opts) < 0) {
+			return NET_DROP;
+		}
+
+		/* RFC 7323 ch 4.3, remember the timestamp to echo */
+		if ((tcp_opts.flags & NET_TCP_TS) &&
+		    !net_tcp_seq_greater(sys_get_be32(tcp_hdr->seq),
+					 context->tcp->sent_ack) &&
+		    !net_tcp_seq_greater(context->tcp->ts_recent,
+					 tcp_opts.tsval)) {
+			context->tcp->ts_recent = tcp_opts.tsval;
+		}
+	}
+
 	/* Handle TCP state transition */
 	if (tcp_flags & NET_TCP_ACK) {
-		if (!net_tcp_ack_received(context,
-				     sys_get_be32(tcp_hdr->ack))) {
+		u32_t ack = sys_get_be32(tcp_hdr->ack);
+		u32_t wnd = sys_get_be16(tcp_hdr->wnd);
+		bool dup_ack = false;
+		bool rtt_sample = false;
+		u32_t una;
+
+		if (context->tcp->flags & NET_TCP_WSCALE) {
+			wnd <<= context->tcp->send_wscale;
+		}
+
+		if (get_unacked_seq(context->tcp, &una)) {
+			dup_ack = ack == una && wnd == context->tcp->send_wnd &&
+				!data_len &&
+				!(tcp_flags & (NET_TCP_SYN | NET_TCP_FIN));
+
+			/* RFC 7323 ch 4.1, RTTM from any ACK that moves
+			 * the left edge of the window.
+			 */
+			rtt_sample = (tcp_opts.flags & NET_TCP_TS) &&
+				tcp_opts.tsecr &&
+				net_tcp_seq_greater(ack, una);
+		}
+
+		context->tcp->send_wnd = wnd;
+
+		if (!net_tcp_ack_received(context, ack)) {
 			return NET_DROP;
 		}
 
+		if (rtt_sample) {
+			update_rto(context->tcp,
+				   k_uptime_get_32() - tcp_opts.tsecr);
+		}
+
+		if (IS_ENABLED(CONFIG_NET_TCP_CONGESTION_CONTROL) && dup_ack) {
+			handle_dup_ack(context->tcp);
+		}
+
 		/* TCP state might be changed after maintaining the sent pkt
 		 * list, e.g., an ack of FIN is received.
 		 */
@@ -2047,9 +2910,6 @@ resend_ack:
 		context->tcp->fin_rcvd = 1;
 	}
 
-	net_context_set_appdata_values(pkt, IPPROTO_TCP);
-
-	data_len = net_pkt_appdatalen(pkt);
 	if (data_len > net_tcp_get_recv_wnd(context->tcp)) {
 		/* In case we have zero window, we should still accept
 		 * Zero Window Probes from peer, which per convention
@@ -2069,6 +2929,21 @@ resend_ack:
 		return NET_DROP;
 	}
 
+	/* Drop the data without acknowledging it if the context holds too
+	 * many buffers already, the peer will retransmit it later.
+	 */
+	if (data_len > 0 && !net_quota_charge_rx_context(context, pkt)) {
+		return NET_DROP;
+	}
+
+	/* Increment the ack before the data is handed over, so that a
+	 * reply sent from the recv callback acknowledges it.
+	 */
+	context->tcp->send_ack += data_len;
+	if (tcp_flags & NET_TCP_FIN) {
+		context->tcp->send_ack += 1;
+	}
+
 	/* If the pkt has appdata, notify the recv callback which should
 	 * release the pkt. Otherwise, release the pkt immediately.
 	 */
@@ -2079,14 +2954,12 @@ resend_ack:
 		net_pkt_unref(pkt);
 	}
 
-	/* Increment the ack */
-	context->tcp->send_ack += data_len;
-	if (tcp_flags & NET_TCP_FIN) {
-		context->tcp->send_ack += 1;
+	if (data_len > 0 && !(tcp_flags & NET_TCP_FIN)) {
+		delay_ack(context);
+	} else {
+		send_ack(context, &conn->remote_addr, false);
 	}
 
-	send_ack(context, &conn->remote_addr, false);
-
 clean_up:
 	if (net_tcp_get_state(context->tcp) == NET_TCP_TIME_WAIT) {
 		k_delayed_work_submit(&context->tcp->timewait_timer,
@@ -2161,9 +3034,18 @@ NET_CONN_CB(tcp_synack_received)
 		/* Remove the temporary connection handler and register
 		 * a proper now as we have an established connection.
 		 */
+		struct net_tcp_options tcp_opts = {
+			.mss = NET_TCP_DEFAULT_MSS,
+		};
 		struct sockaddr local_addr;
 		struct sockaddr remote_addr;
 
+		if (net_tcp_parse_opts(pkt, NET_TCP_HDR_LEN(tcp_hdr) -
+				       sizeof(struct net_tcp_hdr),
+				       &tcp_opts) < 0) {
+			return NET_DROP;
+		}
+
 		if (net_pkt_get_src_addr(
 			pkt, &remote_addr, sizeof(remote_addr)) < 0) {
 			NET_DBG("Cannot parse remote address"
@@ -2192,6 +3074,12 @@ NET_CONN_CB(tcp_synack_received)
 			return NET_DROP;
 		}
 
+		set_peer_opts(context->tcp, &tcp_opts);
+
+		/* Window in a SYN segment is never scaled */
+		context->tcp->send_wnd = sys_get_be16(tcp_hdr->wnd);
+		net_tcp_cc_init(context->tcp);
+
 		net_tcp_change_state(context->tcp, NET_TCP_ESTABLISHED);
 		net_context_set_state(context, NET_CONTEXT_CONNECTED);
 
@@ -2331,9 +3219,12 @@ NET_CONN_CB(tcp_syn_rcvd)
 		context->tcp->send_ack =
 			sys_get_be32(tcp_hdr->seq) + 1;
 
-		/* Get MSS from TCP options here*/
+		/* The options of the peer are applied to the accepted
+		 * connection, the listener only echoes them in the SYN-ACK.
+		 */
+		tcp_opts.flags &= TCP_OPT_FLAGS;
 
-		r = tcp_backlog_syn(pkt, context, tcp_opts.mss);
+		r = tcp_backlog_syn(pkt, context, &tcp_opts);
 		if (r < 0) {
 			if (r == -EADDRINUSE) {
 				NET_DBG("TCP connection already exists");
@@ -2346,7 +3237,7 @@ NET_CONN_CB(tcp_syn_rcvd)
 
 		pkt_get_sockaddr(net_context_get_family(context),
 				 pkt, &pkt_src_addr);
-		send_syn_ack(context, &pkt_src_addr, &remote_addr);
+		send_syn_ack(context, &pkt_src_addr, &remote_addr, &tcp_opts);
 
 		return NET_DROP;
 	}
@@ -2438,6 +3329,13 @@ NET_CONN_CB(tcp_syn_rcvd)
 		 */
 		copy_pool_vars(new_context, context);
 
+		/* Accepted connections inherit the TCP_NODELAY and
+		 * TCP_CORK settings of the listening socket.
+		 */
+		new_context->tcp->flags &= ~(NET_TCP_NODELAY | NET_TCP_CORK);
+		new_context->tcp->flags |= context->tcp->flags &
+			(NET_TCP_NODELAY | NET_TCP_CORK);
+
 		net_tcp_change_state(tcp, NET_TCP_LISTEN);
 
 		/* We cannot use net_tcp_change_state() here as that will
@@ -0,0 +1,195 @@
+/** @file
+ * @brief TCP congestion control
+ *
+ * Generic slow start, fast retransmit and fast recovery handling, and the
+ * NewReno congestion avoidance algorithm.
+ */
+
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(CONFIG_NET_DEBUG_TCP)
+#define SYS_LOG_DOMAIN "net/tcp"
+#define NET_LOG_ENABLED 1
+#endif
+
+#include <kernel.h>
+#include <string.h>
+
+#include <net/net_ip.h>
+
+#include "net_private.h"
+#include "tcp_internal.h"
+
+/* RFC 5681 ch 3.2, number of duplicate ACKs that trigger a fast
+ * retransmit.
+ */
+#define DUP_ACK_THRESHOLD 3
+
+static u32_t newreno_ssthresh(struct net_tcp *tcp, u32_t flight_size)
+{
+	/* RFC 5681 eq. (4) */
+	return max(flight_size / 2, 2 * (u32_t)tcp->send_mss);
+}
+
+static void newreno_cong_avoid(struct net_tcp *tcp, u32_t acked)
+{
+	struct net_tcp_cc_state *cc = &tcp->cc;
+
+	/* Grow by one MSS per round trip, counting acknowledged bytes
+	 * instead of ACKs (RFC 3465).
+	 */
+	cc->bytes_acked += acked;
+
+	if (cc->bytes_acked >= cc->cwnd) {
+		cc->bytes_acked -= cc->cwnd;
+		cc->cwnd += tcp->send_mss;
+	}
+}
+
+static void newreno_init(struct net_tcp *tcp)
+{
+	ARG_UNUSED(tcp);
+}
+
+const struct net_tcp_cc net_tcp_cc_newreno = {
+	.name = "newreno",
+	.init = newreno_init,
+	.cong_avoid = newreno_cong_avoid,
+	.ssthresh = newreno_ssthresh,
+};
+
+static const struct net_tcp_cc *default_cc(void)
+{
+#if defined(CONFIG_NET_TCP_CC_DEFAULT_CUBIC)
+	return &net_tcp_cc_cubic;
+#else
+	return &net_tcp_cc_newreno;
+#endif
+}
+
+static inline u32_t initial_window(u16_t mss)
+{
+	/* RFC 5681 ch 3.1 */
+	if (mss > 2190) {
+		return 2 * mss;
+	} else if (mss > 1095) {
+		return 3 * mss;
+	}
+
+	return 4 * mss;
+}
+
+void net_tcp_cc_init(struct net_tcp *tcp)
+{
+	struct net_tcp_cc_state *cc = &tcp->cc;
+
+	memset(cc, 0, sizeof(*cc));
+
+	cc->ops = default_cc();
+	cc->cwnd = initial_window(tcp->send_mss);
+	cc->ssthresh = UINT32_MAX;
+
+	cc->ops->init(tcp);
+
+	NET_DBG("[%p] %s cwnd %u", tcp, cc->ops->name, cc->cwnd);
+}
+
+bool net_tcp_cc_ack(struct net_tcp *tcp, u32_t ack, u32_t acked,
+		    u32_t flight_size)
+{
+	struct net_tcp_cc_state *cc = &tcp->cc;
+
+	cc->dup_acks = 0;
+
+	if (cc->in_recovery) {
+		if (!net_tcp_seq_greater(cc->recover, ack)) {
+			/* Full acknowledgment, RFC 6582 ch 3.2 step 3 */
+			cc->cwnd = min(cc->ssthresh,
+				       max(flight_size, (u32_t)tcp->send_mss) +
+				       tcp->send_mss);
+			cc->in_recovery = 0;
+
+			NET_DBG("[%p] recovery done cwnd %u", tcp, cc->cwnd);
+
+			return false;
+		}
+
+		/* Partial acknowledgment, deflate the window by the amount
+		 * of new data acknowledged and retransmit the next segment.
+		 */
+		cc->cwnd -= min(acked, cc->cwnd);
+		if (acked >= tcp->send_mss) {
+			cc->cwnd += tcp->send_mss;
+		}
+
+		cc->cwnd = max(cc->cwnd, (u32_t)tcp->send_mss);
+
+		return true;
+	}
+
+	if (cc->cwnd < cc->ssthresh) {
+		/* Slow start, RFC 5681 eq. (2) */
+		cc->cwnd += min(acked, (u32_t)tcp->send_mss);
+	} else {
+		cc->ops->cong_avoid(tcp, acked);
+	}
+
+	return false;
+}
+
+bool net_tcp_cc_dup_ack(struct net_tcp *tcp, u32_t flight_size)
+{
+	struct net_tcp_cc_state *cc = &tcp->cc;
+
+	if (cc->in_recovery) {
+		/* Inflate the window for every segment that has left
+		 * the network.
+		 */
+		cc->cwnd += tcp->send_mss;
+		return false;
+	}
+
+	if (++cc->dup_acks != DUP_ACK_THRESHOLD) {
+		return false;
+	}
+
+	cc->ssthresh = cc->ops->ssthresh(tcp, flight_size);
+	cc->cwnd = cc->ssthresh + DUP_ACK_THRESHOLD * tcp->send_mss;
+	cc->recover = tcp->send_seq;
+	cc->bytes_acked = 0;
+	cc->in_recovery = 1;
+
+	NET_DBG("[%p] fast retransmit ssthresh %u cwnd %u", tcp,
+		cc->ssthresh, cc->cwnd);
+
+	return true;
+}
+
+void net_tcp_cc_timeout(struct net_tcp *tcp, u32_t flight_size)
+{
+	struct net_tcp_cc_state *cc = &tcp->cc;
+
+	/* Only the first timeout of a segment lowers the threshold, the
+	 * following backoffs would otherwise keep halving it.
+	 */
+	if (cc->cwnd > tcp->send_mss) {
+		cc->ssthresh = cc->ops->ssthresh(tcp, flight_size);
+	}
+
+	/* RFC 5681 eq. (5), loss window is one segment */
+	cc->cwnd = tcp->send_mss;
+	cc->bytes_acked = 0;
+	cc->dup_acks = 0;
+	cc->in_recovery = 0;
+
+	NET_DBG("[%p] timeout ssthresh %u", tcp, cc->ssthresh);
+}
+
+u32_t net_tcp_cc_get_cwnd(const struct net_tcp *tcp)
+{
+	return tcp->cc.cwnd;
+}
@@ -0,0 +1,187 @@
+/** @file
+ * @brief TCP congestion control
+ *
+ * This is not to be included by the application.
+ */
+
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __TCP_CC_H
+#define __TCP_CC_H
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct net_tcp;
+
+/**
+ * @brief Congestion control algorithm.
+ *
+ * Slow start, fast retransmit and fast recovery (RFC 5681, RFC 6582) are
+ * handled by the generic code in tcp_cc.c. An algorithm only decides how
+ * the congestion window grows during congestion avoidance and how much it
+ * is reduced when a loss is detected.
+ */
+struct net_tcp_cc {
+	/** Name of the algorithm, shown in the net shell */
+	const char *name;
+
+	/** Initialize algorithm specific state of a new connection */
+	void (*init)(struct net_tcp *tcp);
+
+	/** New data was acknowledged while in congestion avoidance */
+	void (*cong_avoid)(struct net_tcp *tcp, u32_t acked);
+
+	/** Loss was detected, return the new slow start threshold */
+	u32_t (*ssthresh)(struct net_tcp *tcp, u32_t flight_size);
+};
+
+/** Congestion control state of a TCP connection */
+struct net_tcp_cc_state {
+	/** Algorithm used by this connection */
+	const struct net_tcp_cc *ops;
+
+	/** Congestion window, in bytes */
+	u32_t cwnd;
+
+	/** Slow start threshold, in bytes */
+	u32_t ssthresh;
+
+	/** Highest sequence number sent when fast recovery was entered */
+	u32_t recover;
+
+	/** Bytes acknowledged since the last cwnd increase in
+	 * congestion avoidance (appropriate byte counting, RFC 3465).
+	 */
+	u32_t bytes_acked;
+
+	/** Number of consecutive duplicate ACKs received */
+	u8_t dup_acks;
+
+	/** Fast recovery is in progress */
+	u8_t in_recovery : 1;
+
+#if defined(CONFIG_NET_TCP_CC_CUBIC)
+	/** CUBIC state (RFC 8312) */
+	struct {
+		/** Window size just before the last reduction, in bytes */
+		u32_t w_max;
+
+		/** Window size before the previous reduction, used for
+		 * fast convergence.
+		 */
+		u32_t w_last_max;
+
+		/** Start of the current congestion avoidance epoch, in
+		 * milliseconds. Zero if no epoch is running.
+		 */
+		u32_t epoch_start;
+
+		/** Time to reach w_max again, in milliseconds */
+		u32_t k;
+
+		/** Window that the cubic function grows towards, in bytes */
+		u32_t origin;
+
+		/** Reno-friendly window estimate, in bytes */
+		u32_t w_est;
+	} cubic;
+#endif
+};
+
+#if defined(CONFIG_NET_TCP_CONGESTION_CONTROL)
+
+#if defined(CONFIG_NET_TCP_CC_CUBIC)
+extern const struct net_tcp_cc net_tcp_cc_cubic;
+#endif
+
+extern const struct net_tcp_cc net_tcp_cc_newreno;
+
+/**
+ * @brief Initialize congestion control state of a connection.
+ *
+ * Must be called once the send MSS of the connection is known.
+ *
+ * @param tcp TCP context
+ */
+void net_tcp_cc_init(struct net_tcp *tcp);
+
+/**
+ * @brief Inform congestion control that new data was acknowledged.
+ *
+ * @param tcp TCP context
+ * @param ack Received acknowledgment number
+ * @param acked Number of newly acknowledged bytes
+ * @param flight_size Bytes still outstanding after this ACK
+ *
+ * @return True if this was a partial ACK during fast recovery, in which
+ * case the caller must retransmit the first unacknowledged segment.
+ */
+bool net_tcp_cc_ack(struct net_tcp *tcp, u32_t ack, u32_t acked,
+		    u32_t flight_size);
+
+/**
+ * @brief Inform congestion control that a duplicate ACK was received.
+ *
+ * @param tcp TCP context
+ * @param flight_size Bytes outstanding
+ *
+ * @return True if the caller must do a fast retransmit of the first
+ * unacknowledged segment.
+ */
+bool net_tcp_cc_dup_ack(struct net_tcp *tcp, u32_t flight_size);
+
+/**
+ * @brief Inform congestion control that the retransmission timer expired.
+ *
+ * @param tcp TCP context
+ * @param flight_size Bytes outstanding
+ */
+void net_tcp_cc_timeout(struct net_tcp *tcp, u32_t flight_size);
+
+/**
+ * @brief Return the congestion window of a connection.
+ *
+ * @param tcp TCP context
+ *
+ * @return Congestion window in bytes
+ */
+u32_t net_tcp_cc_get_cwnd(const struct net_tcp *tcp);
+
+#else /* CONFIG_NET_TCP_CONGESTION_CONTROL */
+
+#define net_tcp_cc_init(...)
+#define net_tcp_cc_timeout(...)
+
+static inline bool net_tcp_cc_ack(struct net_tcp *tcp, u32_t ack,
+				  u32_t acked, u32_t flight_size)
+{
+	return false;
+}
+
+static inline bool net_tcp_cc_dup_ack(struct net_tcp *tcp,
+				      u32_t flight_size)
+{
+	return false;
+}
+
+static inline u32_t net_tcp_cc_get_cwnd(const struct net_tcp *tcp)
+{
+	return UINT32_MAX;
+}
+
+#endif /* CONFIG_NET_TCP_CONGESTION_CONTROL */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TCP_CC_H */
@@ -0,0 +1,180 @@
+/** @file
+ * @brief CUBIC TCP congestion control
+ *
+ * Implements the window growth function of RFC 8312 on top of the generic
+ * congestion control code in tcp_cc.c.
+ */
+
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(CONFIG_NET_DEBUG_TCP)
+#define SYS_LOG_DOMAIN "net/tcp"
+#define NET_LOG_ENABLED 1
+#endif
+
+#include <kernel.h>
+#include <string.h>
+
+#include <net/net_ip.h>
+
+#include "net_private.h"
+#include "tcp_internal.h"
+
+/* Multiplicative decrease factor beta_cubic = 0.7, scaled by 1024 */
+#define BETA_SCALE 1024
+#define BETA 717
+
+/* Reno-friendly additive increase factor 3 * (1 - beta) / (1 + beta),
+ * approximately 9/17.
+ */
+#define ALPHA_NUM 9
+#define ALPHA_DEN 17
+
+/* Limit the time since the start of an epoch so that the cube of it
+ * fits into 64 bits. 2^20 ms is about 17 minutes.
+ */
+#define MAX_EPOCH_MS (1 << 20)
+
+static u32_t cubic_root(u64_t a)
+{
+	u64_t x = 0;
+	int s;
+
+	for (s = 63; s >= 0; s -= 3) {
+		u64_t b;
+
+		x <<= 1;
+		b = 3 * x * (x + 1) + 1;
+
+		if ((a >> s) >= b) {
+			a -= b << s;
+			x++;
+		}
+	}
+
+	return (u32_t)x;
+}
+
+static void cubic_init(struct net_tcp *tcp)
+{
+	memset(&tcp->cc.cubic, 0, sizeof(tcp->cc.cubic));
+}
+
+static void cubic_epoch_start(struct net_tcp *tcp, u32_t now)
+{
+	struct net_tcp_cc_state *cc = &tcp->cc;
+
+	cc->cubic.epoch_start = now ? now : 1;
+	cc->cubic.w_est = cc->cwnd;
+	cc->bytes_acked = 0;
+
+	if (cc->cwnd < cc->cubic.w_max) {
+		/* K = cbrt(W_max * (1 - beta) / C), RFC 8312 eq. (2).
+		 * Computed in milliseconds with C = 0.4 from the distance
+		 * to W_max in thousandths of a segment.
+		 */
+		u64_t diff = (u64_t)(cc->cubic.w_max - cc->cwnd) * 1000 /
+			tcp->send_mss;
+
+		cc->cubic.k = cubic_root(diff * 2500000);
+		cc->cubic.origin = cc->cubic.w_max;
+	} else {
+		cc->cubic.k = 0;
+		cc->cubic.origin = cc->cwnd;
+	}
+}
+
+static u32_t cubic_target(struct net_tcp *tcp, u32_t now)
+{
+	struct net_tcp_cc_state *cc = &tcp->cc;
+	s64_t offs = min(now - cc->cubic.epoch_start, MAX_EPOCH_MS);
+	s64_t delta;
+	s64_t target;
+
+	offs -= cc->cubic.k;
+
+	/* W_cubic(t) = C * (t - K)^3 + W_max, RFC 8312 eq. (1) */
+	delta = (offs * offs * offs) / 1000000;
+	delta = delta * 4 * tcp->send_mss / 10000;
+
+	target = (s64_t)cc->cubic.origin + delta;
+	if (target < tcp->send_mss) {
+		target = tcp->send_mss;
+	} else if (target > UINT32_MAX) {
+		target = UINT32_MAX;
+	}
+
+	return (u32_t)target;
+}
+
+static void cubic_cong_avoid(struct net_tcp *tcp, u32_t acked)
+{
+	struct net_tcp_cc_state *cc = &tcp->cc;
+	u32_t now = k_uptime_get_32();
+	u32_t target;
+
+	if (!cc->cubic.epoch_start) {
+		cubic_epoch_start(tcp, now);
+	}
+
+	target = cubic_target(tcp, now);
+
+	/* Stay at least as aggressive as standard TCP would be,
+	 * RFC 8312 ch 4.2.
+	 */
+	cc->cubic.w_est += (u64_t)acked * tcp->send_mss * ALPHA_NUM /
+		((u64_t)ALPHA_DEN * cc->cwnd);
+	if (target < cc->cubic.w_est) {
+		target = cc->cubic.w_est;
+	}
+
+	cc->bytes_acked += acked;
+
+	if (target > cc->cwnd) {
+		u32_t inc = (u64_t)(target - cc->cwnd) * cc->bytes_acked /
+			cc->cwnd;
+
+		if (inc) {
+			/* Never grow more than 1.5 times per round trip */
+			cc->cwnd += min(inc, cc->bytes_acked / 2);
+			cc->bytes_acked = 0;
+		}
+	} else if (cc->bytes_acked >= 100 * cc->cwnd) {
+		/* Plateau around W_max, probe very slowly */
+		cc->cwnd += tcp->send_mss;
+		cc->bytes_acked = 0;
+	}
+}
+
+static u32_t cubic_ssthresh(struct net_tcp *tcp, u32_t flight_size)
+{
+	struct net_tcp_cc_state *cc = &tcp->cc;
+
+	ARG_UNUSED(flight_size);
+
+	cc->cubic.epoch_start = 0;
+
+	/* Fast convergence, RFC 8312 ch 4.6 */
+	if (cc->cwnd < cc->cubic.w_last_max) {
+		cc->cubic.w_last_max = cc->cwnd;
+		cc->cubic.w_max = (u64_t)cc->cwnd * (BETA_SCALE + BETA) /
+			(2 * BETA_SCALE);
+	} else {
+		cc->cubic.w_last_max = cc->cwnd;
+		cc->cubic.w_max = cc->cwnd;
+	}
+
+	return max((u32_t)((u64_t)cc->cwnd * BETA / BETA_SCALE),
+		   2 * (u32_t)tcp->send_mss);
+}
+
+const struct net_tcp_cc net_tcp_cc_cubic = {
+	.name = "cubic",
+	.init = cubic_init,
+	.cong_avoid = cubic_cong_avoid,
+	.ssthresh = cubic_ssthresh,
+};
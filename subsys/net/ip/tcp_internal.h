@@ -21,6 +21,7 @@
 #include <net/net_context.h>
 
 #include "connection.h"
+#include "tcp_cc.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -41,8 +42,20 @@ extern "C" {
 /** A retransmitted packet has been sent and not yet ack'd */
 #define NET_TCP_RETRYING BIT(4)
 
-/** MSS option has been set already */
-#define NET_TCP_RECV_MSS_SET BIT(5)
+/** Window scale option was negotiated (RFC 7323) */
+#define NET_TCP_WSCALE BIT(5)
+
+/** Timestamps option was negotiated (RFC 7323) */
+#define NET_TCP_TS BIT(6)
+
+/** Nagle's algorithm is disabled (TCP_NODELAY) */
+#define NET_TCP_NODELAY BIT(7)
+
+/** Partial segments are held back until uncorked (TCP_CORK) */
+#define NET_TCP_CORK BIT(8)
+
+/** Queued data cannot be sent, the connection is being reset */
+#define NET_TCP_FAILED BIT(9)
 
 /*
  * TCP connection states
@@ -81,34 +94,59 @@ enum net_tcp_state {
  */
 #define NET_TCP_DEFAULT_MSS   536
 
-/* TCP max window size */
-#define NET_TCP_MAX_WIN   (4 * 1024)
-
 /* Maximal value of the sequence number */
 #define NET_TCP_MAX_SEQ   0xffffffff
 
-#define NET_TCP_MAX_OPT_SIZE  8
+/* MSS, NOP + window scale and NOP + NOP + timestamps */
+#define NET_TCP_MAX_OPT_SIZE  20
 
 /* TCP Option codes */
 #define NET_TCP_END_OPT          0
 #define NET_TCP_NOP_OPT          1
 #define NET_TCP_MSS_OPT          2
 #define NET_TCP_WINDOW_SCALE_OPT 3
+#define NET_TCP_TIMESTAMPS_OPT   8
 
 /* TCP Option sizes */
 #define NET_TCP_END_SIZE          1
 #define NET_TCP_NOP_SIZE          1
 #define NET_TCP_MSS_SIZE          4
 #define NET_TCP_WINDOW_SCALE_SIZE 3
+#define NET_TCP_TIMESTAMPS_SIZE   10
+
+/* Length of the timestamps option including the two NOPs that align it,
+ * this is what is added to every segment once timestamps are in use.
+ */
+#define NET_TCP_TS_OPT_LEN  (2 * NET_TCP_NOP_SIZE + NET_TCP_TIMESTAMPS_SIZE)
+
+/* RFC 7323 ch 2.3, maximum window scale shift */
+#define NET_TCP_MAX_WSCALE 14
 
 /** Parsed TCP option values for net_tcp_parse_opts()  */
 struct net_tcp_options {
 	u16_t mss;
+	/** NET_TCP_WSCALE and NET_TCP_TS if the option was present */
+	u8_t flags;
+	u8_t wscale;
+	u32_t tsval;
+	u32_t tsecr;
 };
 
 /* Max received bytes to buffer internally */
 #define NET_TCP_BUF_MAX_LEN 1280
 
+/* Initial receive window. Unless configured, three quarters of the RX
+ * data buffers are offered to the peer, but at least NET_TCP_BUF_MAX_LEN.
+ */
+#if defined(CONFIG_NET_TCP_RECV_WINDOW_SIZE) && \
+	(CONFIG_NET_TCP_RECV_WINDOW_SIZE > 0)
+#define NET_TCP_INIT_RECV_WND CONFIG_NET_TCP_RECV_WINDOW_SIZE
+#else
+#define NET_TCP_INIT_RECV_WND						\
+	max(NET_TCP_BUF_MAX_LEN,					\
+	    CONFIG_NET_BUF_RX_COUNT * CONFIG_NET_BUF_DATA_SIZE * 3 / 4)
+#endif
+
 /* Max segment lifetime, in seconds */
 #define NET_TCP_MAX_SEG_LIFETIME 60
 
@@ -133,22 +171,51 @@ struct net_tcp {
 	/** TIME_WAIT timer */
 	struct k_delayed_work timewait_timer;
 
+	/** Delayed ACK timer */
+	struct k_delayed_work ack_delay_timer;
+
 	/** List pointer used for TCP retransmit buffering */
 	sys_slist_t sent_list;
 
+	/** Data queued by the application that is not yet put into
+	 * segments, so that small writes can be coalesced.
+	 */
+	sys_slist_t send_queue;
+
 	/** Current sequence number. */
 	u32_t send_seq;
 
+	/** Window advertised by the peer, scaled. */
+	u32_t send_wnd;
+
 	/** Acknowledgment number to send in next packet. */
 	u32_t send_ack;
 
 	/** Last ACK value sent */
 	u32_t sent_ack;
 
+	/** Timestamp to echo to the peer (TS.Recent in RFC 7323) */
+	u32_t ts_recent;
+
+	/** Smoothed round-trip time, in milliseconds scaled by 8 */
+	u32_t srtt;
+
+	/** Round-trip time variation, in milliseconds scaled by 4 */
+	u32_t rttvar;
+
+	/** Retransmission timeout, in milliseconds (RFC 6298) */
+	u32_t rto;
+
+	/** Sequence number being timed when timestamps are not in use */
+	u32_t rtt_seq;
+
+	/** Time when rtt_seq was sent, 0 if no segment is timed */
+	u32_t rtt_start;
+
 	/** Current retransmit period */
 	u32_t retry_timeout_shift : 5;
 	/** Flags for the TCP */
-	u32_t flags : 8;
+	u32_t flags : 10;
 	/** Current TCP state */
 	u32_t state : 4;
 	/* An outbound FIN packet has been sent */
@@ -156,7 +223,7 @@ struct net_tcp {
 	/* An inbound FIN packet has been received */
 	u32_t fin_rcvd : 1;
 	/** Remaining bits in this u32_t */
-	u32_t _padding : 13;
+	u32_t _padding : 11;
 
 	/** Accept callback to be called when the connection has been
 	 * established.
@@ -171,12 +238,29 @@ struct net_tcp {
 	/**
 	 * Current TCP receive window for our side
 	 */
-	u16_t recv_wnd;
+	u32_t recv_wnd;
 
 	/**
 	 * Send MSS for the peer
 	 */
 	u16_t send_mss;
+
+	/**
+	 * Window scale shift of our receive window
+	 */
+	u8_t recv_wscale;
+
+	/**
+	 * Window scale shift of the window advertised by the peer
+	 */
+	u8_t send_wscale;
+
+#if defined(CONFIG_NET_TCP_CONGESTION_CONTROL)
+	/**
+	 * Congestion control state
+	 */
+	struct net_tcp_cc_state cc;
+#endif
 };
 
 typedef void (*net_tcp_cb_t)(struct net_tcp *tcp, void *user_data);
@@ -383,6 +467,24 @@ u16_t net_tcp_get_recv_mss(const struct net_tcp *tcp);
  */
 u32_t net_tcp_get_recv_wnd(const struct net_tcp *tcp);
 
+/**
+ * @brief Returns how much data fits in one segment sent to the peer
+ *
+ * This is the send MSS minus the options that are added to every segment.
+ *
+ * @param tcp TCP context
+ *
+ * @return Maximum amount of data in one segment
+ */
+static inline u16_t net_tcp_get_send_data_len(const struct net_tcp *tcp)
+{
+	if (tcp->flags & NET_TCP_TS) {
+		return tcp->send_mss - NET_TCP_TS_OPT_LEN;
+	}
+
+	return tcp->send_mss;
+}
+
 /**
  * @brief Obtains the state for a TCP context
  *
@@ -428,8 +530,7 @@ u16_t net_tcp_get_chksum(struct net_pkt *pkt, struct net_buf *frag);
 /**
  * @brief Parse TCP options from network packet.
  *
- * Parse TCP options, returning MSS value (as that the only one we
- * handle so far).
+ * Parse TCP options, returning MSS, window scale and timestamps values.
  *
  * @param pkt Network packet
  * @param opt_totlen Total length of options to parse
@@ -498,6 +599,38 @@ int net_tcp_listen(struct net_context *context);
  */
 int net_tcp_update_recv_wnd(struct net_context *context, s32_t delta);
 
+/**
+ * @brief Set a TCP option of a context
+ *
+ * @param context Network context
+ * @param option NET_OPT_TCP_NODELAY or NET_OPT_TCP_CORK
+ * @param value Pointer to an int, non-zero enables the option
+ * @param len Length of the value
+ *
+ * @return 0 on success, -EPROTOTYPE if there is no TCP context, -EINVAL
+ *         if the option or its value is invalid, -EPROTONOSUPPORT if TCP
+ *         is not supported
+ */
+int net_tcp_set_option(struct net_context *context,
+		       enum net_context_option option,
+		       const void *value, size_t len);
+
+/**
+ * @brief Get a TCP option of a context
+ *
+ * @param context Network context
+ * @param option NET_OPT_TCP_NODELAY or NET_OPT_TCP_CORK
+ * @param value Pointer to an int where the option value is stored
+ * @param len Length of the value buffer, set to the returned length
+ *
+ * @return 0 on success, -EPROTOTYPE if there is no TCP context, -EINVAL
+ *         if the option is invalid, -EPROTONOSUPPORT if TCP is not
+ *         supported
+ */
+int net_tcp_get_option(struct net_context *context,
+		       enum net_context_option option,
+		       void *value, size_t *len);
+
 /**
  * @brief Initialize TCP parts of a context
  *
@@ -651,6 +784,12 @@ static inline u32_t net_tcp_get_recv_wnd(const struct net_tcp *tcp)
 	return 0;
 }
 
+static inline u16_t net_tcp_get_send_data_len(const struct net_tcp *tcp)
+{
+	ARG_UNUSED(tcp);
+	return 0;
+}
+
 static inline enum net_tcp_state net_tcp_get_state(const struct net_tcp *tcp)
 {
 	ARG_UNUSED(tcp);
@@ -737,6 +876,30 @@ static inline int net_tcp_update_recv_wnd(struct net_context *context,
 	return -EPROTONOSUPPORT;
 }
 
+static inline int net_tcp_set_option(struct net_context *context,
+				     enum net_context_option option,
+				     const void *value, size_t len)
+{
+	ARG_UNUSED(context);
+	ARG_UNUSED(option);
+	ARG_UNUSED(value);
+	ARG_UNUSED(len);
+
+	return -EPROTONOSUPPORT;
+}
+
+static inline int net_tcp_get_option(struct net_context *context,
+				     enum net_context_option option,
+				     void *value, size_t *len)
+{
+	ARG_UNUSED(context);
+	ARG_UNUSED(option);
+	ARG_UNUSED(value);
+	ARG_UNUSED(len);
+
+	return -EPROTONOSUPPORT;
+}
+
 static inline int net_tcp_get(struct net_context *context)
 {
 	ARG_UNUSED(context);
@@ -27,6 +27,7 @@ struct option_context {
 	u16_t delta;
 	u16_t offset;
 	struct net_buf *frag;
+	bool parsed; /* Set when an option (not the marker) was parsed */
 };
 
 #define COAP_VERSION 1
@@ -145,7 +146,8 @@ static int decode_delta(struct option_context *context, u16_t opt,
 static int parse_option(const struct coap_packet *cpkt,
 			struct option_context *context,
 			struct coap_option *option,
-			u16_t *opt_len)
+			u16_t *opt_len,
+			struct coap_option_index *index)
 {
 	u16_t hdr_len;
 	u16_t delta;
@@ -201,6 +203,14 @@ static int parse_option(const struct coap_packet *cpkt,
 		*opt_len += hdr_len;
 	}
 
+	context->parsed = true;
+
+	if (index) {
+		index->delta = context->delta + delta;
+		index->offset = cpkt->hdr_len + *opt_len;
+		index->len = len;
+	}
+
 	*opt_len += len;
 
 	if (r == 0) {
@@ -250,7 +260,7 @@ static int parse_option(const struct coap_packet *cpkt,
 	return r;
 }
 
-static int parse_options(const struct coap_packet *cpkt,
+static int parse_options(struct coap_packet *cpkt,
 			 struct coap_option *options, u8_t opt_num)
 {
 	struct option_context context = {
@@ -258,6 +268,7 @@ static int parse_options(const struct coap_packet *cpkt,
 					.frag = NULL,
 					.offset = 0
 					};
+	bool indexed = true;
 	u16_t opt_len;
 	u8_t num;
 	int r;
@@ -274,11 +285,33 @@ static int parse_options(const struct coap_packet *cpkt,
 	opt_len = 0;
 
 	while (true) {
+		struct coap_option_index *index = NULL;
 		struct coap_option *option;
 
+#if CONFIG_COAP_OPTION_INDEX_SIZE > 0
+		if (cpkt->opt_count < CONFIG_COAP_OPTION_INDEX_SIZE) {
+			index = &cpkt->opt_index[cpkt->opt_count];
+		}
+#endif
+
 		option = num < opt_num ? &options[num++] : NULL;
-		r = parse_option(cpkt, &context, option, &opt_len);
-		if (r <= 0) {
+		context.parsed = false;
+		r = parse_option(cpkt, &context, option, &opt_len, index);
+		if (r < 0) {
+			break;
+		}
+
+		if (context.parsed) {
+			if (index) {
+#if CONFIG_COAP_OPTION_INDEX_SIZE > 0
+				cpkt->opt_count++;
+#endif
+			} else {
+				indexed = false;
+			}
+		}
+
+		if (r == 0) {
 			break;
 		}
 	}
@@ -287,6 +320,12 @@ static int parse_options(const struct coap_packet *cpkt,
 		return r;
 	}
 
+#if CONFIG_COAP_OPTION_INDEX_SIZE > 0
+	cpkt->opt_indexed = indexed;
+#else
+	ARG_UNUSED(indexed);
+#endif
+
 	return opt_len;
 }
 
@@ -358,6 +397,12 @@ int coap_packet_parse(struct coap_packet *cpkt, struct net_pkt *pkt,
 	cpkt->hdr_len = 0;
 	cpkt->opt_len = 0;
 
+#if CONFIG_COAP_OPTION_INDEX_SIZE > 0
+	/* Do not leave the index of a previous packet behind on errors */
+	cpkt->opt_count = 0;
+	cpkt->opt_indexed = false;
+#endif
+
 	cpkt->frag = net_frag_skip(pkt->frags, 0, &cpkt->offset,
 				   net_pkt_ip_hdr_len(pkt) +
 				   NET_UDPH_LEN +
@@ -676,6 +721,166 @@ int coap_handle_request(struct coap_packet *cpkt,
 	return -ENOENT;
 }
 
+static u16_t resource_node_hash(const struct coap_resource_tree *tree,
+				u16_t parent, const u8_t *segment, u8_t len)
+{
+	/* FNV-1a over the parent index and the segment */
+	u32_t hash = 2166136261u;
+	u8_t i;
+
+	hash = (hash ^ (parent & 0xff)) * 16777619u;
+	hash = (hash ^ (parent >> 8)) * 16777619u;
+
+	for (i = 0; i < len; i++) {
+		hash = (hash ^ segment[i]) * 16777619u;
+	}
+
+	return hash % tree->node_count;
+}
+
+/* Return the node of a path segment, or the free slot where it would go */
+static u16_t resource_node_find(const struct coap_resource_tree *tree,
+				u16_t parent, const u8_t *segment, u8_t len)
+{
+	struct coap_resource_node *node;
+	u16_t i, n;
+
+	i = resource_node_hash(tree, parent, segment, len);
+
+	for (n = 0; n < tree->node_count; n++) {
+		node = &tree->nodes[i];
+
+		if (!node->segment ||
+		    (node->parent == parent && node->len == len &&
+		     !memcmp(node->segment, segment, len))) {
+			return i;
+		}
+
+		if (++i == tree->node_count) {
+			i = 0;
+		}
+	}
+
+	return COAP_RESOURCE_NODE_NONE;
+}
+
+int coap_resource_tree_init(struct coap_resource_tree *tree,
+			    struct coap_resource *resources,
+			    struct coap_resource_node *nodes,
+			    u16_t node_count)
+{
+	struct coap_resource_node *node;
+	u16_t parent, index, i;
+	size_t len;
+	u8_t j;
+
+	if (!tree || !resources || !nodes || !node_count ||
+	    node_count == COAP_RESOURCE_NODE_NONE) {
+		return -EINVAL;
+	}
+
+	memset(nodes, 0, node_count * sizeof(*nodes));
+
+	tree->resources = resources;
+	tree->nodes = nodes;
+	tree->node_count = node_count;
+	tree->root = COAP_RESOURCE_NODE_NONE;
+
+	for (i = 0; resources[i].path; i++) {
+		const char * const *path = resources[i].path;
+
+		if (i == COAP_RESOURCE_NODE_NONE) {
+			return -ENOMEM;
+		}
+
+		parent = COAP_RESOURCE_NODE_NONE;
+
+		for (j = 0; path[j]; j++) {
+			len = strlen(path[j]);
+			if (len > UINT8_MAX) {
+				return -EINVAL;
+			}
+
+			index = resource_node_find(tree, parent,
+						   (const u8_t *)path[j], len);
+			if (index == COAP_RESOURCE_NODE_NONE) {
+				NET_ERR("No room for resource %u in the tree",
+					i);
+				return -ENOMEM;
+			}
+
+			node = &nodes[index];
+			if (!node->segment) {
+				node->segment = path[j];
+				node->len = len;
+				node->parent = parent;
+				node->resource = COAP_RESOURCE_NODE_NONE;
+			}
+
+			parent = index;
+		}
+
+		if (parent == COAP_RESOURCE_NODE_NONE) {
+			if (tree->root == COAP_RESOURCE_NODE_NONE) {
+				tree->root = i;
+			}
+		} else if (nodes[parent].resource == COAP_RESOURCE_NODE_NONE) {
+			nodes[parent].resource = i;
+		}
+	}
+
+	return 0;
+}
+
+int coap_handle_request_tree(struct coap_packet *cpkt,
+			     struct coap_resource_tree *tree,
+			     struct coap_option *options,
+			     u8_t opt_num)
+{
+	struct coap_resource *resource;
+	coap_method_t method;
+	u16_t index = COAP_RESOURCE_NODE_NONE;
+	u16_t found;
+	u8_t i;
+
+	if (!is_request(cpkt)) {
+		return 0;
+	}
+
+	for (i = 0; i < opt_num; i++) {
+		if (options[i].delta != COAP_OPTION_URI_PATH) {
+			continue;
+		}
+
+		found = resource_node_find(tree, index, options[i].value,
+					   options[i].len);
+		if (found == COAP_RESOURCE_NODE_NONE ||
+		    !tree->nodes[found].segment) {
+			return -ENOENT;
+		}
+
+		index = found;
+	}
+
+	if (index == COAP_RESOURCE_NODE_NONE) {
+		index = tree->root;
+	} else {
+		index = tree->nodes[index].resource;
+	}
+
+	if (index == COAP_RESOURCE_NODE_NONE) {
+		return -ENOENT;
+	}
+
+	resource = &tree->resources[index];
+	method = method_from_code(resource, coap_header_get_code(cpkt));
+	if (!method) {
+		return 0;
+	}
+
+	return method(resource, cpkt);
+}
+
 unsigned int coap_option_value_to_int(const struct coap_option *option)
 {
 	switch (option->len) {
@@ -1025,6 +1230,11 @@ int coap_packet_append_option(struct coap_packet *cpkt, u16_t code,
 	cpkt->opt_len += r;
 	cpkt->last_delta += code;
 
+#if CONFIG_COAP_OPTION_INDEX_SIZE > 0
+	/* The index does not cover options added after parsing */
+	cpkt->opt_indexed = false;
+#endif
+
 	return 0;
 }
 
@@ -1054,6 +1264,52 @@ int coap_append_option_int(struct coap_packet *cpkt, u16_t code,
 	return coap_packet_append_option(cpkt, code, data, len);
 }
 
+#if CONFIG_COAP_OPTION_INDEX_SIZE > 0
+static int find_indexed_options(const struct coap_packet *cpkt, u16_t code,
+				struct coap_option *options, u16_t veclen)
+{
+	const struct coap_option_index *index;
+	struct net_buf *frag;
+	u16_t offset;
+	int count = 0;
+	u8_t i;
+
+	/* The index is sorted by option number */
+	for (i = 0; i < cpkt->opt_count && count < veclen; i++) {
+		index = &cpkt->opt_index[i];
+		if (index->delta < code) {
+			continue;
+		}
+
+		if (index->delta > code) {
+			break;
+		}
+
+		if (index->len > sizeof(options[count].value)) {
+			NET_ERR("%u is > sizeof(coap_option->value)(%zu)!",
+				index->len, sizeof(options[count].value));
+			return -EINVAL;
+		}
+
+		if (index->len) {
+			frag = net_frag_skip(cpkt->frag, cpkt->offset, &offset,
+					     index->offset);
+			frag = net_frag_read(frag, offset, &offset, index->len,
+					     options[count].value);
+			if (check_frag_read_status(frag, offset) < 0) {
+				return -EINVAL;
+			}
+		}
+
+		options[count].delta = code;
+		options[count].len = index->len;
+		count++;
+	}
+
+	return count;
+}
+#endif
+
 int coap_find_options(const struct coap_packet *cpkt, u16_t code,
 		      struct coap_option *options, u16_t veclen)
 {
@@ -1070,6 +1326,12 @@ int coap_find_options(const struct coap_packet *cpkt, u16_t code,
 		return -EINVAL;
 	}
 
+#if CONFIG_COAP_OPTION_INDEX_SIZE > 0
+	if (cpkt->opt_indexed) {
+		return find_indexed_options(cpkt, code, options, veclen);
+	}
+#endif
+
 	/* Skip CoAP header */
 	context.frag = net_frag_skip(cpkt->frag, cpkt->offset,
 				     &context.offset, cpkt->hdr_len);
@@ -1082,7 +1344,8 @@ int coap_find_options(const struct coap_packet *cpkt, u16_t code,
 	count = 0;
 
 	while (context.delta <= code && count < veclen) {
-		r = parse_option(cpkt, &context, &options[count], &opt_len);
+		r = parse_option(cpkt, &context, &options[count], &opt_len,
+				 NULL);
 		if (r < 0) {
 			return -EINVAL;
 		}
@@ -0,0 +1,606 @@
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(CONFIG_NET_DEBUG_COAP)
+#define SYS_LOG_DOMAIN "coap"
+#define NET_LOG_ENABLED 1
+#endif
+
+#include <stddef.h>
+#include <zephyr/types.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include <kernel.h>
+#include <random/rand32.h>
+#include <net/net_ip.h>
+#include <net/net_pkt.h>
+
+#include <net/coap.h>
+#include <net/coap_transmission.h>
+
+/* ACK_TIMEOUT and ACK_RANDOM_FACTOR of 1.5, RFC 7252 section 4.8 */
+#define ACK_TIMEOUT		CONFIG_COAP_INIT_ACK_TIMEOUT_MS
+#define ACK_RANDOM_RANGE	(ACK_TIMEOUT / 2)
+
+#define HEAP_INDEX_NONE		0xffff
+
+#define ID_HASH(id)		((id) % COAP_TRANSMISSION_HASH_SIZE)
+
+/* A message handed to the send callback */
+struct coap_transmit {
+	struct net_pkt *pkt;
+	struct sockaddr addr;
+	u16_t id;
+};
+
+static u32_t token_hash(const u8_t *token, u8_t tkl)
+{
+	u32_t hash = 2166136261u;
+	u8_t i;
+
+	for (i = 0; i < tkl; i++) {
+		hash = (hash ^ token[i]) * 16777619u;
+	}
+
+	return hash % COAP_TRANSMISSION_HASH_SIZE;
+}
+
+/* retransmission heap, must be called with interrupts locked */
+
+static void heap_set(struct coap_transmission *tx, u16_t i,
+		     struct coap_pending *pending)
+{
+	tx->heap[i] = pending;
+	pending->heap_index = i;
+}
+
+static void heap_sift_up(struct coap_transmission *tx, u16_t i)
+{
+	struct coap_pending *pending = tx->heap[i];
+
+	while (i > 0) {
+		u16_t parent = (i - 1) / 2;
+
+		if (tx->heap[parent]->deadline <= pending->deadline) {
+			break;
+		}
+
+		heap_set(tx, i, tx->heap[parent]);
+		i = parent;
+	}
+
+	heap_set(tx, i, pending);
+}
+
+static void heap_sift_down(struct coap_transmission *tx, u16_t i)
+{
+	struct coap_pending *pending = tx->heap[i];
+
+	while (true) {
+		u16_t child = 2 * i + 1;
+
+		if (child >= tx->heap_count) {
+			break;
+		}
+
+		if (child + 1 < tx->heap_count &&
+		    tx->heap[child + 1]->deadline < tx->heap[child]->deadline) {
+			child++;
+		}
+
+		if (pending->deadline <= tx->heap[child]->deadline) {
+			break;
+		}
+
+		heap_set(tx, i, tx->heap[child]);
+		i = child;
+	}
+
+	heap_set(tx, i, pending);
+}
+
+static void heap_push(struct coap_transmission *tx,
+		      struct coap_pending *pending)
+{
+	heap_set(tx, tx->heap_count++, pending);
+	heap_sift_up(tx, pending->heap_index);
+}
+
+static void heap_remove(struct coap_transmission *tx,
+			struct coap_pending *pending)
+{
+	u16_t i = pending->heap_index;
+	struct coap_pending *last;
+
+	pending->heap_index = HEAP_INDEX_NONE;
+	last = tx->heap[--tx->heap_count];
+	if (last == pending) {
+		return;
+	}
+
+	heap_set(tx, i, last);
+	heap_sift_up(tx, i);
+	heap_sift_down(tx, last->heap_index);
+}
+
+/* Arm the timer for the first deadline of the heap. Deadlines less than
+ * CONFIG_COAP_TRANSMISSION_COALESCE_MS before the armed one are served by
+ * the same wakeup.
+ */
+static void timer_update(struct coap_transmission *tx)
+{
+	s64_t deadline, now;
+
+	if (!tx->heap_count) {
+		return;
+	}
+
+	deadline = tx->heap[0]->deadline;
+	if (tx->timer_deadline &&
+	    deadline + CONFIG_COAP_TRANSMISSION_COALESCE_MS >=
+	    tx->timer_deadline) {
+		return;
+	}
+
+	now = k_uptime_get();
+	tx->timer_deadline = deadline;
+	k_delayed_work_submit(&tx->timer,
+			      deadline > now ? (s32_t)(deadline - now) : 0);
+}
+
+static bool peer_eq(const struct sockaddr *a, const struct sockaddr *b)
+{
+	if (a->sa_family != b->sa_family) {
+		return false;
+	}
+
+#if defined(CONFIG_NET_IPV6)
+	if (a->sa_family == AF_INET6) {
+		return net_sin6(a)->sin6_port == net_sin6(b)->sin6_port &&
+		       net_ipv6_addr_cmp(&net_sin6(a)->sin6_addr,
+					 &net_sin6(b)->sin6_addr);
+	}
+#endif
+
+#if defined(CONFIG_NET_IPV4)
+	if (a->sa_family == AF_INET) {
+		return net_sin(a)->sin_port == net_sin(b)->sin_port &&
+		       net_ipv4_addr_cmp(&net_sin(a)->sin_addr,
+					 &net_sin(b)->sin_addr);
+	}
+#endif
+
+	return true;
+}
+
+/* Only the messages in flight are in the heap, so this does not depend
+ * on the number of queued messages.
+ */
+static bool peer_has_slot(struct coap_transmission *tx,
+			  const struct sockaddr *addr)
+{
+	u16_t i, count = 0;
+
+	for (i = 0; i < tx->heap_count; i++) {
+		if (peer_eq(&tx->heap[i]->addr, addr) &&
+		    ++count >= CONFIG_COAP_NSTART) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* coap_pending_init() leaves heap_index at 0, so check the entry too */
+static bool in_heap(struct coap_transmission *tx, struct coap_pending *pending)
+{
+	return pending->heap_index < tx->heap_count &&
+	       tx->heap[pending->heap_index] == pending;
+}
+
+/* Returns true if the message was in flight */
+static bool pending_unlink(struct coap_transmission *tx,
+			   struct coap_pending *pending)
+{
+	struct coap_pending **entry;
+
+	entry = &tx->id_hash[ID_HASH(pending->id)];
+	while (*entry) {
+		if (*entry == pending) {
+			*entry = pending->id_next;
+			pending->id_next = NULL;
+			break;
+		}
+
+		entry = &(*entry)->id_next;
+	}
+
+	if (in_heap(tx, pending)) {
+		heap_remove(tx, pending);
+		return true;
+	}
+
+	sys_slist_find_and_remove(&tx->queue, &pending->node);
+
+	return false;
+}
+
+/* Called with the lock held, the pending may complete as soon as the
+ * lock is released so the message is sent from its own reference.
+ */
+static void pending_prepare(struct coap_pending *pending,
+			    struct coap_transmit *transmit)
+{
+	transmit->pkt = net_pkt_ref(pending->pkt);
+	memcpy(&transmit->addr, &pending->addr, sizeof(transmit->addr));
+	transmit->id = pending->id;
+}
+
+static int pending_transmit(struct coap_transmission *tx,
+			    struct coap_transmit *transmit)
+{
+	int r;
+
+	/* the send callback takes over the reference on success */
+	r = tx->send(tx, transmit->pkt, &transmit->addr);
+	if (r < 0) {
+		NET_DBG("Could not send message %u (err:%d)", transmit->id, r);
+		net_pkt_unref(transmit->pkt);
+	}
+
+	return r;
+}
+
+/* A message to a peer completed, start the next one queued for it */
+static void queue_run(struct coap_transmission *tx,
+		      const struct sockaddr *addr)
+{
+	struct coap_pending *pending = NULL;
+	sys_snode_t *node, *prev = NULL;
+	struct coap_transmit transmit;
+	unsigned int key;
+
+	key = irq_lock();
+
+	SYS_SLIST_FOR_EACH_NODE(&tx->queue, node) {
+		pending = CONTAINER_OF(node, struct coap_pending, node);
+		if (peer_eq(&pending->addr, addr)) {
+			break;
+		}
+
+		prev = node;
+	}
+
+	if (!node || !peer_has_slot(tx, addr)) {
+		irq_unlock(key);
+		return;
+	}
+
+	sys_slist_remove(&tx->queue, prev, node);
+	pending->deadline = k_uptime_get() + pending->timeout;
+	heap_push(tx, pending);
+	timer_update(tx);
+	pending_prepare(pending, &transmit);
+	irq_unlock(key);
+
+	pending_transmit(tx, &transmit);
+}
+
+static void transmission_timer(struct k_work *work)
+{
+	struct coap_transmission *tx =
+		CONTAINER_OF(work, struct coap_transmission, timer);
+	struct coap_transmit transmit;
+	struct coap_pending *pending;
+	struct sockaddr addr;
+	unsigned int key;
+	bool expired;
+	s64_t now;
+
+	now = k_uptime_get();
+
+	while (true) {
+		key = irq_lock();
+		tx->timer_deadline = 0;
+
+		if (!tx->heap_count || tx->heap[0]->deadline >
+		    now + CONFIG_COAP_TRANSMISSION_COALESCE_MS) {
+			timer_update(tx);
+			irq_unlock(key);
+			break;
+		}
+
+		pending = tx->heap[0];
+		expired = pending->retries >= CONFIG_COAP_MAX_RETRANSMIT;
+		if (expired) {
+			pending_unlink(tx, pending);
+		} else {
+			pending->retries++;
+			pending->timeout <<= 1;
+			pending->deadline = now + pending->timeout;
+			heap_sift_down(tx, 0);
+			pending_prepare(pending, &transmit);
+		}
+
+		irq_unlock(key);
+
+		if (!expired) {
+			NET_DBG("Retransmitting message %u", transmit.id);
+			pending_transmit(tx, &transmit);
+			continue;
+		}
+
+		NET_DBG("Message %u was not acknowledged", pending->id);
+
+		memcpy(&addr, &pending->addr, sizeof(addr));
+
+		if (tx->timeout) {
+			tx->timeout(tx, pending);
+		} else {
+			coap_pending_clear(pending);
+		}
+
+		queue_run(tx, &addr);
+	}
+}
+
+void coap_transmission_init(struct coap_transmission *tx,
+			    struct coap_pending *pendings,
+			    struct coap_pending **heap, u16_t len,
+			    coap_transmission_send_t send,
+			    coap_transmission_timeout_t timeout)
+{
+	memset(tx, 0, sizeof(*tx));
+
+	tx->pendings = pendings;
+	tx->heap = heap;
+	tx->pending_count = len;
+	tx->send = send;
+	tx->timeout = timeout;
+	sys_slist_init(&tx->queue);
+	k_delayed_work_init(&tx->timer, transmission_timer);
+}
+
+int coap_transmission_send(struct coap_transmission *tx,
+			   struct coap_pending *pending)
+{
+	struct coap_transmit transmit;
+	struct coap_pending **entry;
+	unsigned int key;
+	int r;
+
+	if (!pending->pkt) {
+		return -EINVAL;
+	}
+
+	pending->retries = 0;
+	pending->timeout = ACK_TIMEOUT + sys_rand32_get() % ACK_RANDOM_RANGE;
+	pending->heap_index = HEAP_INDEX_NONE;
+	pending->id_next = NULL;
+
+	key = irq_lock();
+
+	entry = &tx->id_hash[ID_HASH(pending->id)];
+	while (*entry) {
+		entry = &(*entry)->id_next;
+	}
+
+	*entry = pending;
+
+	if (!peer_has_slot(tx, &pending->addr)) {
+		sys_slist_append(&tx->queue, &pending->node);
+		irq_unlock(key);
+
+		NET_DBG("Message %u queued", pending->id);
+		return 0;
+	}
+
+	pending->deadline = k_uptime_get() + pending->timeout;
+	heap_push(tx, pending);
+	timer_update(tx);
+	pending_prepare(pending, &transmit);
+	irq_unlock(key);
+
+	r = pending_transmit(tx, &transmit);
+	if (r < 0) {
+		key = irq_lock();
+		pending_unlink(tx, pending);
+		irq_unlock(key);
+
+		queue_run(tx, &pending->addr);
+	}
+
+	return r;
+}
+
+void coap_transmission_cancel(struct coap_transmission *tx,
+			      struct coap_pending *pending)
+{
+	unsigned int key;
+	bool in_flight;
+
+	key = irq_lock();
+	in_flight = pending_unlink(tx, pending);
+	irq_unlock(key);
+
+	if (pending->pkt) {
+		coap_pending_clear(pending);
+	}
+
+	if (in_flight) {
+		queue_run(tx, &pending->addr);
+	}
+}
+
+struct coap_pending *coap_transmission_pending_received(
+	struct coap_transmission *tx,
+	const struct coap_packet *response)
+{
+	struct coap_pending *pending;
+	u16_t id = coap_header_get_id(response);
+	unsigned int key;
+
+	key = irq_lock();
+
+	for (pending = tx->id_hash[ID_HASH(id)]; pending;
+	     pending = pending->id_next) {
+		/* queued messages have not been sent yet */
+		if (pending->id == id && in_heap(tx, pending)) {
+			pending_unlink(tx, pending);
+			break;
+		}
+	}
+
+	irq_unlock(key);
+
+	if (!pending) {
+		return NULL;
+	}
+
+	coap_pending_clear(pending);
+	queue_run(tx, &pending->addr);
+
+	return pending;
+}
+
+static void reply_link(struct coap_reply **entry, struct coap_reply *reply,
+		       bool by_token)
+{
+	while (*entry) {
+		entry = by_token ? &(*entry)->token_next : &(*entry)->id_next;
+	}
+
+	*entry = reply;
+}
+
+static void reply_unlink(struct coap_reply **entry, struct coap_reply *reply,
+			 bool by_token)
+{
+	while (*entry) {
+		if (*entry == reply) {
+			*entry = by_token ? reply->token_next : reply->id_next;
+			return;
+		}
+
+		entry = by_token ? &(*entry)->token_next : &(*entry)->id_next;
+	}
+}
+
+void coap_transmission_reply_add(struct coap_transmission *tx,
+				 struct coap_reply *reply)
+{
+	unsigned int key;
+
+	reply->id_next = NULL;
+	reply->token_next = NULL;
+
+	key = irq_lock();
+
+	reply_link(&tx->reply_id_hash[ID_HASH(reply->id)], reply, false);
+
+	if (reply->tkl > 0) {
+		reply_link(&tx->reply_token_hash[token_hash(reply->token,
+							    reply->tkl)],
+			   reply, true);
+	}
+
+	irq_unlock(key);
+}
+
+void coap_transmission_reply_remove(struct coap_transmission *tx,
+				    struct coap_reply *reply)
+{
+	unsigned int key;
+
+	key = irq_lock();
+
+	reply_unlink(&tx->reply_id_hash[ID_HASH(reply->id)], reply, false);
+
+	if (reply->tkl > 0) {
+		reply_unlink(&tx->reply_token_hash[token_hash(reply->token,
+							      reply->tkl)],
+			     reply, true);
+	}
+
+	irq_unlock(key);
+
+	coap_reply_clear(reply);
+}
+
+static int get_observe_option(const struct coap_packet *cpkt)
+{
+	struct coap_option option = {};
+	int r;
+
+	r = coap_find_options(cpkt, COAP_OPTION_OBSERVE, &option, 1);
+	if (r <= 0) {
+		return -ENOENT;
+	}
+
+	return coap_option_value_to_int(&option);
+}
+
+struct coap_reply *coap_transmission_response_received(
+	struct coap_transmission *tx,
+	const struct coap_packet *response,
+	const struct sockaddr *from)
+{
+	struct coap_reply *r;
+	unsigned int key;
+	u8_t token[8];
+	u16_t id;
+	u8_t tkl;
+	int age;
+
+	id = coap_header_get_id(response);
+	tkl = coap_header_get_token(response, token);
+	age = get_observe_option(response);
+
+	/* The lookup is locked like the other accessors of the hashes, the
+	 * reply callback is called after the lock is released.
+	 */
+	key = irq_lock();
+
+	/* Piggybacked must match id when token is empty */
+	if (tkl == 0) {
+		r = tx->reply_id_hash[ID_HASH(id)];
+	} else {
+		r = tx->reply_token_hash[token_hash(token, tkl)];
+	}
+
+	for (; r; r = tkl == 0 ? r->id_next : r->token_next) {
+		if (tkl == 0 && r->id != id) {
+			continue;
+		}
+
+		if (tkl > 0 && (r->tkl != tkl || memcmp(r->token, token, tkl))) {
+			continue;
+		}
+
+		if (age > 0) {
+			/* age == 2 means that the notifications wrapped,
+			 * or this is the first one
+			 */
+			if (r->age > age && age != 2) {
+				continue;
+			}
+
+			r->age = age;
+		}
+
+		break;
+	}
+
+	irq_unlock(key);
+
+	if (r) {
+		r->reply(response, r, from);
+	}
+
+	return r;
+}
@@ -0,0 +1,165 @@
+/** @file
+ * @brief DNS answer cache
+ *
+ * Keeps the answers received by a DNS context until their TTL expires.
+ */
+
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(CONFIG_NET_DEBUG_DNS_RESOLVE)
+#define SYS_LOG_DOMAIN "dns/cache"
+#define NET_LOG_ENABLED 1
+#endif
+
+#include <zephyr/types.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+
+#include <kernel.h>
+#include <net/net_core.h>
+#include "dns_cache.h"
+
+#define DNS_CACHE_SIZE		CONFIG_DNS_RESOLVER_CACHE_ENTRIES
+#define DNS_CACHE_NAME_LEN	CONFIG_DNS_RESOLVER_CACHE_NAME_LEN
+
+static bool entry_matches(struct dns_cache_entry *entry, const char *name,
+			  size_t len, enum dns_query_type type)
+{
+	/* DNS names are case insensitive, RFC 4343 */
+	return entry->expires && entry->query_type == type &&
+		!strncasecmp(entry->name, name, len) && !entry->name[len];
+}
+
+/* Returns the live entry of a name, the entries found expired on the
+ * way are released. Must be called with the irqs locked.
+ */
+static struct dns_cache_entry *cache_lookup(struct dns_cache *cache,
+					    const char *name, size_t len,
+					    enum dns_query_type type,
+					    s64_t now)
+{
+	struct dns_cache_entry *found = NULL;
+	int i;
+
+	for (i = 0; i < DNS_CACHE_SIZE; i++) {
+		struct dns_cache_entry *entry = &cache->entries[i];
+
+		if (entry->expires && entry->expires <= now) {
+			entry->expires = 0;
+			continue;
+		}
+
+		if (!found && entry_matches(entry, name, len, type)) {
+			found = entry;
+		}
+	}
+
+	return found;
+}
+
+void dns_cache_flush(struct dns_cache *cache)
+{
+	unsigned int key;
+	int i;
+
+	key = irq_lock();
+
+	for (i = 0; i < DNS_CACHE_SIZE; i++) {
+		cache->entries[i].expires = 0;
+	}
+
+	irq_unlock(key);
+}
+
+int dns_cache_find(struct dns_cache *cache, const char *name,
+		   enum dns_query_type type, struct dns_cache_entry *entry)
+{
+	struct dns_cache_entry *found;
+	size_t len = strlen(name);
+	unsigned int key;
+
+	if (len > DNS_CACHE_NAME_LEN) {
+		return -ENOENT;
+	}
+
+	key = irq_lock();
+
+	found = cache_lookup(cache, name, len, type, k_uptime_get());
+	if (found) {
+		found->used = ++cache->clock;
+		memcpy(entry, found, sizeof(*entry));
+	}
+
+	irq_unlock(key);
+
+	return found ? 0 : -ENOENT;
+}
+
+void dns_cache_add(struct dns_cache *cache, const char *name,
+		   enum dns_query_type type, int status,
+		   const struct sockaddr *addr, int addr_count, u32_t ttl)
+{
+	struct dns_cache_entry *entry;
+	size_t len = strlen(name);
+	unsigned int key;
+	s64_t now;
+	int i;
+
+	if (status != DNS_EAI_ALLDONE) {
+		ttl = CONFIG_DNS_RESOLVER_CACHE_NEGATIVE_TTL;
+		addr_count = 0;
+	} else if (ttl > CONFIG_DNS_RESOLVER_CACHE_MAX_TTL) {
+		ttl = CONFIG_DNS_RESOLVER_CACHE_MAX_TTL;
+	}
+
+	if (ttl == 0 || len > DNS_CACHE_NAME_LEN) {
+		return;
+	}
+
+	if (addr_count > CONFIG_DNS_RESOLVER_CACHE_ADDRS) {
+		addr_count = CONFIG_DNS_RESOLVER_CACHE_ADDRS;
+	}
+
+	now = k_uptime_get();
+
+	key = irq_lock();
+
+	entry = cache_lookup(cache, name, len, type, now);
+	if (!entry) {
+		for (i = 0; i < DNS_CACHE_SIZE; i++) {
+			if (!cache->entries[i].expires) {
+				entry = &cache->entries[i];
+				break;
+			}
+
+			if (!entry ||
+			    (s32_t)(cache->entries[i].used - entry->used) < 0) {
+				entry = &cache->entries[i];
+			}
+		}
+
+		if (entry->expires) {
+			NET_DBG("Evicting %s", entry->name);
+			cache->evictions++;
+		}
+
+		memcpy(entry->name, name, len + 1);
+		entry->query_type = type;
+	}
+
+	memcpy(entry->addr, addr, addr_count * sizeof(struct sockaddr));
+	entry->addr_count = addr_count;
+	entry->status = status;
+	entry->expires = now + (s64_t)ttl * MSEC_PER_SEC;
+	entry->used = ++cache->clock;
+
+	irq_unlock(key);
+
+	NET_DBG("Cached %s type %d status %d for %u s", name, type, status,
+		ttl);
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _DNS_CACHE_H_
+#define _DNS_CACHE_H_
+
+#include <net/dns_resolve.h>
+
+/**
+ * @brief Remove all the answers from a cache
+ *
+ * @param cache DNS cache
+ */
+void dns_cache_flush(struct dns_cache *cache);
+
+/**
+ * @brief Look up the answer to a query in a cache
+ *
+ * @param cache DNS cache
+ * @param name Name to resolve
+ * @param type Query type
+ * @param entry Copy of the cached answer, valid when 0 is returned
+ *
+ * @return 0 if the answer is cached, -ENOENT otherwise
+ */
+int dns_cache_find(struct dns_cache *cache, const char *name,
+		   enum dns_query_type type, struct dns_cache_entry *entry);
+
+/**
+ * @brief Store the answer to a query in a cache
+ *
+ * @details Answers with a TTL of 0 are not stored, as required by
+ * RFC 1035, and the least recently used answer is evicted when the cache
+ * is full.
+ *
+ * @param cache DNS cache
+ * @param name Name that was resolved
+ * @param type Query type
+ * @param status DNS_EAI_ALLDONE if addresses were received, DNS_EAI_NODATA
+ * or DNS_EAI_NONAME for a negative answer
+ * @param addr Received addresses
+ * @param addr_count Number of addresses, only the first
+ * CONFIG_DNS_RESOLVER_CACHE_ADDRS ones are stored
+ * @param ttl TTL of the answer in seconds, ignored for negative answers
+ */
+void dns_cache_add(struct dns_cache *cache, const char *name,
+		   enum dns_query_type type, int status,
+		   const struct sockaddr *addr, int addr_count, u32_t ttl);
+
+#endif /* _DNS_CACHE_H_ */
@@ -25,6 +25,10 @@
 #include <net/dns_resolve.h>
 #include "dns_pack.h"
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+#include "dns_cache.h"
+#endif
+
 #define DNS_SERVER_COUNT CONFIG_DNS_RESOLVER_MAX_SERVERS
 #define SERVER_COUNT (DNS_SERVER_COUNT + MDNS_SERVER_COUNT)
 
@@ -261,6 +265,66 @@ static inline int get_slot_by_id(struct dns_resolve_context *ctx,
 	return -ENOENT;
 }
 
+/* Returns the first query waiting for the response to dns_id */
+static inline int get_slot_by_wait_id(struct dns_resolve_context *ctx,
+				      u16_t dns_id)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_DNS_NUM_CONCUR_QUERIES; i++) {
+		if (ctx->queries[i].cb && ctx->queries[i].wait_id == dns_id) {
+			return i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+/* Passes an address to all the queries waiting for the response to dns_id */
+static void dns_resolve_result(struct dns_resolve_context *ctx, u16_t dns_id,
+			       struct dns_addrinfo *info)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_DNS_NUM_CONCUR_QUERIES; i++) {
+		if (ctx->queries[i].cb && ctx->queries[i].wait_id == dns_id) {
+			ctx->queries[i].cb(DNS_EAI_INPROGRESS, info,
+					   ctx->queries[i].user_data);
+		}
+	}
+}
+
+/* Ends all the queries waiting for the response to dns_id */
+static void dns_resolve_done(struct dns_resolve_context *ctx, u16_t dns_id,
+			     enum dns_resolve_status status)
+{
+	bool waiting[CONFIG_DNS_NUM_CONCUR_QUERIES];
+	dns_resolve_cb_t cb;
+	int i;
+
+	/* The callbacks may start new queries in the released slots */
+	for (i = 0; i < CONFIG_DNS_NUM_CONCUR_QUERIES; i++) {
+		waiting[i] = ctx->queries[i].cb &&
+			     ctx->queries[i].wait_id == dns_id;
+	}
+
+	for (i = 0; i < CONFIG_DNS_NUM_CONCUR_QUERIES; i++) {
+		if (!waiting[i]) {
+			continue;
+		}
+
+		if (k_delayed_work_remaining_get(&ctx->queries[i].timer) > 0) {
+			k_delayed_work_cancel(&ctx->queries[i].timer);
+		}
+
+		cb = ctx->queries[i].cb;
+		ctx->queries[i].cb = NULL;
+
+		/* Marks the end of the results */
+		cb(status, NULL, ctx->queries[i].user_data);
+	}
+}
+
 static int dns_read(struct dns_resolve_context *ctx,
 		    struct net_pkt *pkt,
 		    struct net_buf *dns_data,
@@ -270,7 +334,11 @@ static int dns_read(struct dns_resolve_context *ctx,
 	struct dns_addrinfo info = { 0 };
 	/* Helper struct to track the dns msg received from the server */
 	struct dns_msg_t dns_msg;
-	u32_t ttl; /* RR ttl, so far it is not passed to caller */
+	u32_t ttl; /* RR ttl, only used by the cache */
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	struct sockaddr cached[CONFIG_DNS_RESOLVER_CACHE_ADDRS];
+	u32_t min_ttl = UINT32_MAX;
+#endif
 	u8_t *src, *addr;
 	int address_size;
 	/* index that points to the current answer being analyzed */
@@ -303,7 +371,7 @@ static int dns_read(struct dns_resolve_context *ctx,
 	 */
 	*dns_id = dns_unpack_header_id(dns_msg.msg);
 
-	query_idx = get_slot_by_id(ctx, *dns_id);
+	query_idx = get_slot_by_wait_id(ctx, *dns_id);
 	if (query_idx < 0) {
 		ret = DNS_EAI_SYSTEM;
 		goto quit;
@@ -314,6 +382,11 @@ static int dns_read(struct dns_resolve_context *ctx,
 		goto quit;
 	}
 
+	if (dns_header_rcode(dns_msg.msg) == DNS_HEADER_NAMEERROR) {
+		ret = DNS_EAI_NONAME;
+		goto done;
+	}
+
 	ret = dns_unpack_response_header(&dns_msg, *dns_id);
 	if (ret < 0) {
 		ret = DNS_EAI_FAIL;
@@ -368,6 +441,10 @@ static int dns_read(struct dns_resolve_context *ctx,
 			goto quit;
 		}
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+		min_ttl = min(min_ttl, ttl);
+#endif
+
 		switch (dns_msg.response_type) {
 		case DNS_RESPONSE_IP:
 			if (dns_msg.response_length < address_size) {
@@ -380,8 +457,14 @@ static int dns_read(struct dns_resolve_context *ctx,
 
 			memcpy(addr, src, address_size);
 
-			ctx->queries[query_idx].cb(DNS_EAI_INPROGRESS, &info,
-					ctx->queries[query_idx].user_data);
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+			if (items < ARRAY_SIZE(cached)) {
+				memcpy(&cached[items], &info.ai_addr,
+				       sizeof(cached[items]));
+			}
+#endif
+
+			dns_resolve_result(ctx, *dns_id, &info);
 			items++;
 			break;
 
@@ -429,21 +512,22 @@ static int dns_read(struct dns_resolve_context *ctx,
 		ret = DNS_EAI_ALLDONE;
 	}
 
-	if (k_delayed_work_remaining_get(&ctx->queries[query_idx].timer) > 0) {
-		k_delayed_work_cancel(&ctx->queries[query_idx].timer);
-	}
+done:
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	/* The query string of the callers stays valid until they are done */
+	dns_cache_add(&ctx->cache, ctx->queries[query_idx].query,
+		      ctx->queries[query_idx].query_type, ret, cached, items,
+		      min_ttl);
+#endif
 
-	/* Marks the end of the results */
-	ctx->queries[query_idx].cb(ret, NULL,
-				   ctx->queries[query_idx].user_data);
-	ctx->queries[query_idx].cb = NULL;
+	dns_resolve_done(ctx, *dns_id, ret);
 
 	net_pkt_unref(pkt);
 
 	return 0;
 
 finished:
-	dns_resolve_cancel(ctx, *dns_id);
+	dns_resolve_done(ctx, *dns_id, DNS_EAI_CANCELED);
 
 quit:
 	net_pkt_unref(pkt);
@@ -494,7 +578,7 @@ static void cb_recv(struct net_context *net_ctx,
 		int failure = 0;
 		int j;
 
-		i = get_slot_by_id(ctx, dns_id);
+		i = get_slot_by_wait_id(ctx, dns_id);
 		if (i < 0) {
 			goto free_buf;
 		}
@@ -523,18 +607,7 @@ static void cb_recv(struct net_context *net_ctx,
 	}
 
 quit:
-	i = get_slot_by_id(ctx, dns_id);
-	if (i < 0) {
-		goto free_buf;
-	}
-
-	if (k_delayed_work_remaining_get(&ctx->queries[i].timer) > 0) {
-		k_delayed_work_cancel(&ctx->queries[i].timer);
-	}
-
-	/* Marks the end of the results */
-	ctx->queries[i].cb(ret, NULL, ctx->queries[i].user_data);
-	ctx->queries[i].cb = NULL;
+	dns_resolve_done(ctx, dns_id, ret);
 
 free_buf:
 	if (dns_data) {
@@ -562,7 +635,7 @@ static int dns_write(struct dns_resolve_context *ctx,
 
 	net_ctx = ctx->servers[server_idx].net_ctx;
 	server = &ctx->servers[server_idx].dns_server;
-	dns_id = ctx->queries[query_idx].id;
+	dns_id = ctx->queries[query_idx].wait_id;
 	query_type = ctx->queries[query_idx].query_type;
 
 	ret = dns_msg_pack_query(dns_data->data, &dns_data->len, dns_data->size,
@@ -649,6 +722,51 @@ int dns_resolve_cancel(struct dns_resolve_context *ctx, u16_t dns_id)
 	return 0;
 }
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+/* Passes the cached answer of a query to the callback */
+static int dns_resolve_cached(struct dns_resolve_context *ctx,
+			      const char *query,
+			      enum dns_query_type type,
+			      dns_resolve_cb_t cb,
+			      void *user_data)
+{
+	struct dns_addrinfo info = { 0 };
+	struct dns_cache_entry entry;
+	int i;
+
+	if (dns_cache_find(&ctx->cache, query, type, &entry) < 0) {
+		ctx->cache.misses++;
+		return -ENOENT;
+	}
+
+	ctx->cache.hits++;
+
+	NET_DBG("Answering %s from the cache", query);
+
+	for (i = 0; i < entry.addr_count; i++) {
+		memcpy(&info.ai_addr, &entry.addr[i], sizeof(info.ai_addr));
+		info.ai_family = entry.addr[i].sa_family;
+
+		if (info.ai_family == AF_INET) {
+			info.ai_addrlen = sizeof(struct sockaddr_in);
+		} else {
+			info.ai_addrlen = sizeof(struct sockaddr_in6);
+		}
+
+		cb(DNS_EAI_INPROGRESS, &info, user_data);
+	}
+
+	cb(entry.status, NULL, user_data);
+
+	return 0;
+}
+
+void dns_resolve_cache_flush(struct dns_resolve_context *ctx)
+{
+	dns_cache_flush(&ctx->cache);
+}
+#endif
+
 static void query_timeout(struct k_work *work)
 {
 	struct dns_pending_query *pending_query =
@@ -719,11 +837,26 @@ int dns_resolve_name(struct dns_resolve_context *ctx,
 	}
 
 try_resolve:
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	if (dns_resolve_cached(ctx, query, type, cb, user_data) == 0) {
+		return 0;
+	}
+#endif
+
 	i = get_cb_slot(ctx);
 	if (i < 0) {
 		return -EAGAIN;
 	}
 
+	/* Look for a query of the same name before taking the slot */
+	for (j = 0; j < CONFIG_DNS_NUM_CONCUR_QUERIES; j++) {
+		if (ctx->queries[j].cb &&
+		    ctx->queries[j].query_type == type &&
+		    !strcmp(ctx->queries[j].query, query)) {
+			break;
+		}
+	}
+
 	ctx->queries[i].cb = cb;
 	ctx->queries[i].timeout = timeout;
 	ctx->queries[i].query = query;
@@ -733,6 +866,27 @@ try_resolve:
 
 	k_delayed_work_init(&ctx->queries[i].timer, query_timeout);
 
+	if (j < CONFIG_DNS_NUM_CONCUR_QUERIES) {
+		/* Wait for the response to the query in progress */
+		ctx->queries[i].id = sys_rand32_get();
+		ctx->queries[i].wait_id = ctx->queries[j].wait_id;
+
+		if (dns_id) {
+			*dns_id = ctx->queries[i].id;
+		}
+
+		NET_DBG("DNS id %u waits for %u", ctx->queries[i].id,
+			ctx->queries[i].wait_id);
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+		ctx->cache.shared++;
+#endif
+
+		k_delayed_work_submit(&ctx->queries[i].timer, timeout);
+
+		return 0;
+	}
+
 	dns_data = net_buf_alloc(&dns_msg_pool, ctx->buf_timeout);
 	if (!dns_data) {
 		ret = -ENOMEM;
@@ -752,6 +906,7 @@ try_resolve:
 	}
 
 	ctx->queries[i].id = sys_rand32_get();
+	ctx->queries[i].wait_id = ctx->queries[i].id;
 
 	/* Do this immediately after calculating the Id so that the unit
 	 * test will work properly.
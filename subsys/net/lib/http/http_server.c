@@ -114,11 +114,13 @@ static void validate_state_transition(struct http_ctx *ctx,
 		[HTTP_STATE_RECEIVING_HEADER] =
 					1 << HTTP_STATE_HEADER_RECEIVED |
 					1 << HTTP_STATE_CLOSED |
-					1 << HTTP_STATE_OPEN,
+					1 << HTTP_STATE_OPEN |
+					1 << HTTP_STATE_WAITING_HEADER,
 		[HTTP_STATE_HEADER_RECEIVED] =
 					1 << HTTP_STATE_OPEN |
 					1 << HTTP_STATE_CLOSED,
-		[HTTP_STATE_OPEN] = 1 << HTTP_STATE_CLOSED,
+		[HTTP_STATE_OPEN] = 1 << HTTP_STATE_CLOSED |
+					1 << HTTP_STATE_WAITING_HEADER,
 	};
 
 	if (!(valid_transitions[current] & 1 << new)) {
@@ -345,6 +347,98 @@ static void url_connected(struct http_ctx *ctx,
 	}
 }
 
+/* Insert an URL to the radix tree. The edge labels point to the root
+ * URL strings, a node is split when a new URL diverges in the middle of
+ * its label.
+ */
+static void http_url_tree_add(struct http_server_urls *my, u8_t idx)
+{
+	const char *url = my->urls[idx].root;
+	u16_t len = my->urls[idx].root_len;
+	struct http_url_node *node;
+	u16_t pos = 0;
+	u8_t n = 0;
+	u8_t *link;
+
+	if (!my->node_count) {
+		memset(&my->nodes[0], 0, sizeof(my->nodes[0]));
+		my->node_count = 1;
+	}
+
+	while (pos < len) {
+		u16_t common = 1;
+
+		link = &my->nodes[n].child;
+		while (*link && my->nodes[*link].label[0] != url[pos]) {
+			link = &my->nodes[*link].sibling;
+		}
+
+		if (!*link) {
+			n = my->node_count++;
+			node = &my->nodes[n];
+
+			node->label = url + pos;
+			node->label_len = len - pos;
+			node->child = 0;
+			node->sibling = 0;
+			node->url = 0;
+
+			*link = n;
+			break;
+		}
+
+		node = &my->nodes[*link];
+
+		while (common < node->label_len && pos + common < len &&
+		       node->label[common] == url[pos + common]) {
+			common++;
+		}
+
+		if (common < node->label_len) {
+			struct http_url_node *split;
+			u8_t m = my->node_count++;
+
+			split = &my->nodes[m];
+			split->label = node->label;
+			split->label_len = common;
+			split->child = *link;
+			split->sibling = node->sibling;
+			split->url = 0;
+
+			node->label += common;
+			node->label_len -= common;
+			node->sibling = 0;
+
+			*link = m;
+		}
+
+		n = *link;
+		pos += common;
+	}
+
+	/* Keep the URLs of the same node in registration order */
+	link = &my->nodes[n].url;
+	while (*link) {
+		link = &my->url_next[*link - 1];
+	}
+
+	*link = idx + 1;
+	my->url_next[idx] = 0;
+}
+
+static void http_url_tree_build(struct http_server_urls *my)
+{
+	u8_t i;
+
+	my->node_count = 0;
+
+	for (i = 0; i < CONFIG_HTTP_SERVER_NUM_URLS; i++) {
+		if (my->urls[i].is_used) {
+			http_url_tree_add(my, i);
+		}
+	}
+}
+
 struct http_root_url *http_server_add_url(struct http_server_urls *my,
 					  const char *url, u8_t flags)
 {
@@ -367,6 +461,8 @@ struct http_root_url *http_server_add_url(struct http_server_urls *my,
 			(flags == HTTP_URL_WEBSOCKET ? "WS" : "<unknown>"),
 			url);
 
+		http_url_tree_add(my, i);
+
 		return &my->urls[i];
 	}
 
@@ -389,6 +485,8 @@ int http_server_del_url(struct http_server_urls *my, const char *url)
 		my->urls[i].is_used = false;
 		my->urls[i].root = NULL;
 
+		http_url_tree_build(my);
+
 		return 0;
 	}
 
@@ -458,30 +556,57 @@ static int http_url_cmp(const char *url, u16_t url_len,
 struct http_root_url *http_url_find(struct http_ctx *ctx,
 				    enum http_url_flags flags)
 {
+	struct http_server_urls *my = ctx->http.urls;
 	u16_t url_len = ctx->http.url_len;
 	const char *url = ctx->http.url;
-	struct http_root_url *root_url;
+	struct http_root_url *found = NULL;
+	struct http_url_node *node;
+	u16_t pos = 0;
+	u8_t n = 0;
 	u8_t i;
-	int ret;
 
-	for (i = 0; i < CONFIG_HTTP_SERVER_NUM_URLS; i++) {
-		if (!ctx->http.urls) {
-			continue;
+	if (!my || !my->node_count || !url) {
+		return NULL;
+	}
+
+	/* Walk down the tree along the URL, every node passed is a prefix
+	 * of it. The URLs of the deepest node matching at a path boundary
+	 * win.
+	 */
+	while (true) {
+		node = &my->nodes[n];
+
+		for (i = node->url; i; i = my->url_next[i - 1]) {
+			struct http_root_url *root_url = &my->urls[i - 1];
+
+			if (root_url->flags == flags &&
+			    !http_url_cmp(url, url_len, root_url->root,
+					  root_url->root_len)) {
+				found = root_url;
+				break;
+			}
 		}
 
-		root_url = &ctx->http.urls->urls[i];
-		if (!root_url || !root_url->is_used) {
-			continue;
+		if (pos == url_len) {
+			break;
+		}
+
+		for (n = node->child; n; n = my->nodes[n].sibling) {
+			if (my->nodes[n].label[0] == url[pos]) {
+				break;
+			}
 		}
 
-		ret = http_url_cmp(url, url_len,
-				   root_url->root, root_url->root_len);
-		if (!ret && flags == root_url->flags) {
-			return root_url;
+		if (!n || my->nodes[n].label_len > url_len - pos ||
+		    memcmp(my->nodes[n].label, url + pos,
+			   my->nodes[n].label_len)) {
+			break;
 		}
+
+		pos += my->nodes[n].label_len;
 	}
 
-	return NULL;
+	return found;
 }
 
 static int http_process_recv(struct http_ctx *ctx,
@@ -525,6 +650,45 @@ out:
 	return ret;
 }
 
+/* Forget the header fields of the previous request */
+static void http_request_clear(struct http_ctx *ctx)
+{
+	memset(ctx->http.field_values, 0, sizeof(ctx->http.field_values));
+
+	ctx->http.field_values_ctr = 0;
+	ctx->http.url = NULL;
+	ctx->http.url_len = 0;
+	ctx->http.in_body = 0;
+	ctx->http.dispatched = 0;
+}
+
+static void http_request_init(struct http_ctx *ctx)
+{
+	http_parser_init(&ctx->http.parser, HTTP_REQUEST);
+	http_request_clear(ctx);
+	ctx->http.data_len = 0;
+}
+
+static void http_request_done(struct http_ctx *ctx)
+{
+	if (ctx->http.dispatched && ctx->cb.body) {
+		ctx->cb.body(ctx, NULL, 0, HTTP_DATA_FINAL,
+			     ctx->http.parser.addr, ctx->user_data);
+	}
+
+	ctx->http.in_body = 0;
+	ctx->http.dispatched = 0;
+	ctx->http.data_len = 0;
+
+#if defined(CONFIG_HTTP_SERVER_KEEPALIVE)
+	if (ctx->state != HTTP_STATE_CLOSED &&
+	    http_should_keep_alive(&ctx->http.parser)) {
+		/* Serve the next request of this connection */
+		http_change_state(ctx, HTTP_STATE_WAITING_HEADER);
+	}
+#endif
+}
+
 static void http_closed(struct net_app_ctx *app_ctx,
 			int status,
 			void *user_data)
@@ -553,7 +717,109 @@ static void http_closed(struct net_app_ctx *app_ctx,
 	ctx->websocket.data_waiting = 0;
 #endif
 
-	ctx->http.field_values_ctr = 0;
+	http_request_init(ctx);
+}
+
+/* Parse a piece of the request. The request line and the header fields
+ * are collected to the request buffer, as the URL handlers refer to them.
+ * The body is parsed in place and passed to the body callback.
+ *
+ * Returns the number of bytes parsed. When the connection is left open
+ * with no request in progress, the rest of the data is not HTTP.
+ * Returns -ECONNABORTED if a callback closed the connection.
+ */
+static int http_parse(struct http_ctx *ctx, const char *data, size_t len,
+		      const struct sockaddr *dst)
+{
+	struct http_parser *parser = &ctx->http.parser;
+	size_t total = len;
+	bool in_body;
+	size_t parsed;
+	size_t start;
+	size_t copy;
+
+	while (len) {
+		in_body = ctx->http.in_body;
+		if (in_body) {
+			parsed = http_parser_execute(parser,
+						     &ctx->http.parser_settings,
+						     data, len);
+		} else {
+			start = ctx->http.data_len;
+			if (start >= ctx->http.request_buf_len) {
+				NET_DBG("[%p] Request header does not fit "
+					"in %zd bytes", ctx,
+					ctx->http.request_buf_len);
+				return -EMSGSIZE;
+			}
+
+			copy = min(len, ctx->http.request_buf_len - start);
+			memcpy(ctx->http.request_buf + start, data, copy);
+
+			parsed = http_parser_execute(parser,
+						     &ctx->http.parser_settings,
+						     (const char *)
+						     ctx->http.request_buf +
+						     start,
+						     copy);
+
+			/* Anything after the header is parsed in place */
+			ctx->http.data_len = start + parsed;
+		}
+
+		data += parsed;
+		len -= parsed;
+
+		if (in_body && ctx->state == HTTP_STATE_CLOSED) {
+			/* The body callback closed the connection */
+			http_request_init(ctx);
+			return -ECONNABORTED;
+		}
+
+		if (HTTP_PARSER_ERRNO(parser) == HPE_OK) {
+			continue;
+		}
+
+		if (HTTP_PARSER_ERRNO(parser) != HPE_PAUSED) {
+			NET_DBG("[%p] Parsing failed (%s %s)", ctx,
+				http_errno_name(parser->http_errno),
+				http_errno_description(parser->http_errno));
+			return -EINVAL;
+		}
+
+		/* The parser stops after the header fields and at the end
+		 * of the request.
+		 */
+		http_parser_pause(parser, 0);
+
+		if (ctx->http.in_body) {
+			http_request_done(ctx);
+		} else if (ctx->state == HTTP_STATE_HEADER_RECEIVED) {
+			/* The rest of the data is websocket frames */
+			http_change_state(ctx, HTTP_STATE_OPEN);
+			url_connected(ctx, WS_CONNECTION, dst);
+			http_request_init(ctx);
+			return total - len;
+		} else {
+			ctx->http.dispatched = !http_process_recv(ctx, dst);
+			ctx->http.in_body = 1;
+		}
+
+		if (ctx->state == HTTP_STATE_CLOSED) {
+			/* The URL handler closed the connection */
+			http_request_init(ctx);
+			return -ECONNABORTED;
+		}
+
+		if (ctx->state == HTTP_STATE_OPEN && !ctx->http.in_body) {
+			/* The connection is not kept for HTTP requests, the
+			 * rest of the data goes to the receive callback.
+			 */
+			return total - len;
+		}
+	}
+
+	return total;
 }
 
 static void http_received(struct net_app_ctx *app_ctx,
@@ -562,13 +828,11 @@ static void http_received(struct net_app_ctx *app_ctx,
 			  void *user_data)
 {
 	struct http_ctx *ctx = user_data;
-	size_t start = ctx->http.data_len;
-	u16_t len = 0;
 	const struct sockaddr *dst = NULL;
 	struct net_buf *frag;
-	int parsed_len;
 	size_t recv_len;
 	size_t pkt_len;
+	int ret;
 
 	recv_len = net_pkt_appdatalen(pkt);
 	if (recv_len == 0) {
@@ -578,7 +842,7 @@ static void http_received(struct net_app_ctx *app_ctx,
 
 	if (status) {
 		NET_DBG("[%p] Status %d <%s>", ctx, status, RC_STR(status));
-		goto out;
+		goto quit;
 	}
 
 	/* Get rid of possible IP headers in the first fragment. */
@@ -598,7 +862,7 @@ static void http_received(struct net_app_ctx *app_ctx,
 		dst = &net_pkt_context(pkt)->remote;
 	}
 
-	if (ctx->state == HTTP_STATE_OPEN) {
+	if (ctx->state == HTTP_STATE_OPEN && !ctx->http.in_body) {
 		/* We have active websocket session and there is no longer
 		 * any HTTP traffic in the connection. Give the data to
 		 * application.
@@ -607,79 +871,45 @@ static void http_received(struct net_app_ctx *app_ctx,
 	}
 
 	while (frag) {
-		/* If this fragment cannot be copied to result buf,
-		 * then parse what we have which will cause the callback to be
-		 * called in function on_body(), and continue copying.
-		 */
-		if ((ctx->http.data_len + frag->len) >
-		    ctx->http.request_buf_len) {
+		ret = http_parse(ctx, (const char *)frag->data, frag->len, dst);
+		if (ret == -ECONNABORTED) {
+			break;
+		}
 
-			if (ctx->state == HTTP_STATE_HEADER_RECEIVED) {
-				goto ws_ready;
-			}
+		if (ret < 0) {
+			http_send_error(ctx, 400, NULL, 0, dst);
+			http_request_init(ctx);
+			http_close(ctx);
+			break;
+		}
 
-			/* If the caller has not supplied a callback, then
-			 * we cannot really continue if the request buffer
-			 * overflows. Set the data_len to mark how many bytes
-			 * should be needed in the response_buf.
+		if (ctx->state == HTTP_STATE_OPEN && !ctx->http.in_body) {
+			/* Pass the data after the request to the receive
+			 * callback, it is not HTTP anymore.
 			 */
-			if (http_process_recv(ctx, dst) < 0) {
-				ctx->http.data_len = recv_len;
-				goto out;
+			while (pkt->frags != frag) {
+				net_pkt_frag_del(pkt, NULL, pkt->frags);
 			}
 
-			parsed_len =
-				http_parser_execute(&ctx->http.parser,
-						    &ctx->http.parser_settings,
-						    ctx->http.request_buf +
-						    start,
-						    len);
-			if (parsed_len <= 0) {
-				goto fail;
+			net_buf_pull(frag, ret);
+			if (!frag->len) {
+				net_pkt_frag_del(pkt, NULL, frag);
 			}
 
-			ctx->http.data_len = 0;
-			len = 0;
-			start = 0;
-		}
-
-		memcpy(ctx->http.request_buf + ctx->http.data_len,
-		       frag->data, frag->len);
-
-		ctx->http.data_len += frag->len;
-		len += frag->len;
-		frag = frag->frags;
-	}
+			if (!pkt->frags) {
+				break;
+			}
 
-out:
-	parsed_len = http_parser_execute(&ctx->http.parser,
-					 &ctx->http.parser_settings,
-					 ctx->http.request_buf + start,
-					 len);
-	if (parsed_len < 0) {
-fail:
-		NET_DBG("[%p] Received %zd bytes, only parsed %d "
-			"bytes (%s %s)",
-			ctx, recv_len, parsed_len,
-			http_errno_name(ctx->http.parser.http_errno),
-			http_errno_description(
-				ctx->http.parser.http_errno));
-	}
+			net_pkt_set_appdata(pkt, pkt->frags->data);
+			net_pkt_set_appdatalen(pkt, net_pkt_get_len(pkt));
 
-	if (ctx->http.parser.http_errno != HPE_OK) {
-		http_send_error(ctx, 400, NULL, 0, dst);
-	} else {
-		if (ctx->state == HTTP_STATE_HEADER_RECEIVED) {
-			goto ws_ready;
+			goto ws_only;
 		}
 
-		http_process_recv(ctx, dst);
+		frag = frag->frags;
 	}
 
 quit:
-	http_parser_init(&ctx->http.parser, HTTP_REQUEST);
-	ctx->http.data_len = 0;
-	ctx->http.field_values_ctr = 0;
 	net_pkt_unref(pkt);
 
 	return;
@@ -850,15 +1080,9 @@ ws_only:
 #else
 		ctx->cb.recv(ctx, pkt, 0, 0, dst, ctx->user_data);
 #endif
+	} else {
+		net_pkt_unref(pkt);
 	}
-
-	return;
-
-ws_ready:
-	http_change_state(ctx, HTTP_STATE_OPEN);
-	url_connected(ctx, WS_CONNECTION, dst);
-	net_pkt_unref(pkt);
-	ctx->http.field_values_ctr = 0;
 }
 
 #if defined(CONFIG_HTTPS)
@@ -918,19 +1142,30 @@ quit:
 }
 #endif
 
+/* The header is collected to the request buffer, so the pieces of a
+ * field split over several packets are contiguous there and the callbacks
+ * only need to extend the previous piece.
+ */
 static int on_header_field(struct http_parser *parser,
 			   const char *at, size_t length)
 {
 	struct http_ctx *ctx = parser->data;
+	struct http_field_value *kv;
 
 	if (ctx->http.field_values_ctr >= CONFIG_HTTP_HEADERS) {
 		return 0;
 	}
 
+	kv = &ctx->http.field_values[ctx->http.field_values_ctr];
+	if (kv->key && at == kv->key + kv->key_len) {
+		kv->key_len += length;
+		return 0;
+	}
+
 	http_change_state(ctx, HTTP_STATE_RECEIVING_HEADER);
 
-	ctx->http.field_values[ctx->http.field_values_ctr].key = at;
-	ctx->http.field_values[ctx->http.field_values_ctr].key_len = length;
+	kv->key = at;
+	kv->key_len = length;
 
 	return 0;
 }
@@ -939,13 +1174,24 @@ static int on_header_value(struct http_parser *parser,
 			   const char *at, size_t length)
 {
 	struct http_ctx *ctx = parser->data;
+	u16_t ctr = ctx->http.field_values_ctr;
+	struct http_field_value *kv;
+
+	if (ctr > 0 &&
+	    (ctr >= CONFIG_HTTP_HEADERS || !ctx->http.field_values[ctr].key)) {
+		kv = &ctx->http.field_values[ctr - 1];
+		if (kv->value && at == kv->value + kv->value_len) {
+			kv->value_len += length;
+			return 0;
+		}
+	}
 
-	if (ctx->http.field_values_ctr >= CONFIG_HTTP_HEADERS) {
+	if (ctr >= CONFIG_HTTP_HEADERS) {
 		return 0;
 	}
 
-	ctx->http.field_values[ctx->http.field_values_ctr].value = at;
-	ctx->http.field_values[ctx->http.field_values_ctr].value_len = length;
+	ctx->http.field_values[ctr].value = at;
+	ctx->http.field_values[ctr].value_len = length;
 
 	ctx->http.field_values_ctr++;
 
@@ -956,25 +1202,66 @@ static int on_url(struct http_parser *parser, const char *at, size_t length)
 {
 	struct http_ctx *ctx = parser->data;
 
+	if (ctx->http.url && at == ctx->http.url + ctx->http.url_len) {
+		ctx->http.url_len += length;
+		return 0;
+	}
+
 	ctx->http.url = at;
 	ctx->http.url_len = length;
 
+	if (ctx->state == HTTP_STATE_CLOSED) {
+		http_server_conn_add(ctx);
+	}
+
 	http_change_state(ctx, HTTP_STATE_WAITING_HEADER);
 
-	http_server_conn_add(ctx);
+	return 0;
+}
+
+static int on_message_begin(struct http_parser *parser)
+{
+	struct http_ctx *ctx = parser->data;
+
+	http_request_clear(ctx);
 
 	return 0;
 }
 
 static int on_headers_complete(struct http_parser *parser)
 {
-	ARG_UNUSED(parser);
+	int ret = 0;
 
 #if defined(CONFIG_WEBSOCKET)
-	return ws_headers_complete(parser);
-#else
-	return 0;
+	ret = ws_headers_complete(parser);
 #endif
+
+	/* Stop so that the request is dispatched before its body */
+	http_parser_pause(parser, 1);
+
+	return ret;
+}
+
+static int on_body(struct http_parser *parser, const char *at, size_t length)
+{
+	struct http_ctx *ctx = parser->data;
+
+	if (ctx->http.dispatched && ctx->cb.body) {
+		ctx->cb.body(ctx, (const u8_t *)at, length, HTTP_DATA_MORE,
+			     parser->addr, ctx->user_data);
+	}
+
+	return 0;
+}
+
+static int on_message_complete(struct http_parser *parser)
+{
+	/* Stop so that a pipelined request is not parsed before the
+	 * current one is finished.
+	 */
+	http_parser_pause(parser, 1);
+
+	return 0;
 }
 
 static int init_http_parser(struct http_ctx *ctx)
@@ -984,7 +1271,10 @@ static int init_http_parser(struct http_ctx *ctx)
 	ctx->http.parser_settings.on_header_field = on_header_field;
 	ctx->http.parser_settings.on_header_value = on_header_value;
 	ctx->http.parser_settings.on_url = on_url;
+	ctx->http.parser_settings.on_message_begin = on_message_begin;
 	ctx->http.parser_settings.on_headers_complete = on_headers_complete;
+	ctx->http.parser_settings.on_body = on_body;
+	ctx->http.parser_settings.on_message_complete = on_message_complete;
 
 	http_parser_init(&ctx->http.parser, HTTP_REQUEST);
 
@@ -1113,6 +1403,21 @@ int http_server_enable(struct http_ctx *ctx)
 	return 0;
 }
 
+int http_server_set_body_cb(struct http_ctx *ctx, http_body_cb_t body_cb)
+{
+	if (!ctx) {
+		return -EINVAL;
+	}
+
+	if (!ctx->is_init) {
+		return -ENOENT;
+	}
+
+	ctx->cb.body = body_cb;
+
+	return 0;
+}
+
 int http_server_disable(struct http_ctx *ctx)
 {
 	NET_ASSERT(ctx);
@@ -40,6 +40,7 @@
 #include <net/net_pkt.h>
 #include <net/udp.h>
 #include <net/coap.h>
+#include <net/coap_transmission.h>
 #include <net/lwm2m.h>
 
 #include "lwm2m_object.h"
@@ -49,11 +50,17 @@
 #ifdef CONFIG_LWM2M_RW_JSON_SUPPORT
 #include "lwm2m_rw_json.h"
 #endif
+#ifdef CONFIG_LWM2M_RW_SENML_CBOR_SUPPORT
+#include "lwm2m_rw_senml_cbor.h"
+#endif
 #ifdef CONFIG_LWM2M_RD_CLIENT_SUPPORT
 #include "lwm2m_rd_client.h"
 #endif
 
-#define ENGINE_UPDATE_INTERVAL K_MSEC(500)
+/* The engine thread is woken up when a notification becomes due earlier,
+ * so this only bounds the sleep when nothing else is scheduled.
+ */
+#define ENGINE_MAX_SLEEP_INTERVAL K_SECONDS(60)
 
 #define WELL_KNOWN_CORE_PATH	"</.well-known/core>"
 
@@ -95,15 +102,21 @@
 
 struct observe_node {
 	sys_snode_t node;
+	/* next observer of the same object instance bucket */
+	struct observe_node *hash_next;
 	struct lwm2m_ctx *ctx;
 	struct lwm2m_obj_path path;
 	u8_t  token[MAX_TOKEN_LEN];
 	s64_t event_timestamp;
 	s64_t last_timestamp;
+	/* when the next notification is due */
+	s64_t deadline;
 	u32_t min_period_sec;
 	u32_t max_period_sec;
 	u32_t counter;
 	u16_t format;
+	/* position in the deadline heap */
+	u16_t heap_index;
 	u8_t  tkl;
 };
 
@@ -135,6 +148,33 @@ static sys_slist_t engine_obj_inst_list;
 static sys_slist_t engine_observer_list;
 static sys_slist_t engine_service_list;
 
+/* Objects and object instances are also chained into small hash tables
+ * keyed by their ids so that the lookups done for every read and write
+ * do not need to walk the whole registry.
+ */
+#define ENGINE_HASH_SIZE	16
+
+#define ENGINE_OBJ_HASH(obj_id) \
+	((obj_id) & (ENGINE_HASH_SIZE - 1))
+#define ENGINE_OBJ_INST_HASH(obj_id, obj_inst_id) \
+	(((obj_id) * 31 + (obj_inst_id)) & (ENGINE_HASH_SIZE - 1))
+
+static struct lwm2m_engine_obj *engine_obj_hash[ENGINE_HASH_SIZE];
+static struct lwm2m_engine_obj_inst *engine_obj_inst_hash[ENGINE_HASH_SIZE];
+
+/* numbers the created object instances for the resource handles */
+static u32_t engine_obj_inst_seq;
+
+/* Observers are indexed by the object instance they observe, and the
+ * pending notifications are kept in a min-heap ordered by their deadline,
+ * so the engine only looks at the observers that are due or affected.
+ */
+static struct observe_node *engine_observer_hash[ENGINE_HASH_SIZE];
+static struct observe_node *observer_heap[CONFIG_LWM2M_ENGINE_MAX_OBSERVER];
+static u16_t observer_heap_count;
+
+#define OBSERVER_NO_DEADLINE	INT64_MAX
+
 #define NUM_BLOCK1_CONTEXT	CONFIG_LWM2M_NUM_BLOCK1_CONTEXT
 
 /* TODO: figure out what's correct value */
@@ -164,6 +204,7 @@ static struct lwm2m_attr write_attr_pool[CONFIG_LWM2M_NUM_ATTR];
 static K_THREAD_STACK_DEFINE(engine_thread_stack,
 			     CONFIG_LWM2M_ENGINE_STACK_SIZE);
 static struct k_thread engine_thread_data;
+static bool engine_thread_started;
 
 static struct lwm2m_engine_obj *get_engine_obj(int obj_id);
 static struct lwm2m_engine_obj_inst *get_engine_obj_inst(int obj_id,
@@ -377,19 +418,181 @@ static void clear_attrs(void *ref)
 	}
 }
 
+/* Services and observers can be added from other threads and during
+ * system init, before the engine thread is running.
+ */
+static void engine_wakeup(void)
+{
+	if (engine_thread_started && k_current_get() != &engine_thread_data) {
+		k_wakeup(&engine_thread_data);
+	}
+}
+
+/* observer index and deadline heap */
+
+static s64_t observer_deadline(struct observe_node *obs)
+{
+	/* a pending event is reported once pmin has passed */
+	if (obs->event_timestamp > obs->last_timestamp) {
+		return obs->last_timestamp + K_SECONDS(obs->min_period_sec);
+	}
+
+	if (!obs->max_period_sec) {
+		return OBSERVER_NO_DEADLINE;
+	}
+
+	return obs->last_timestamp + K_SECONDS(obs->max_period_sec);
+}
+
+static void observer_heap_set(u16_t i, struct observe_node *obs)
+{
+	observer_heap[i] = obs;
+	obs->heap_index = i;
+}
+
+static void observer_heap_sift_up(u16_t i)
+{
+	struct observe_node *obs = observer_heap[i];
+
+	while (i > 0) {
+		u16_t parent = (i - 1) / 2;
+
+		if (observer_heap[parent]->deadline <= obs->deadline) {
+			break;
+		}
+
+		observer_heap_set(i, observer_heap[parent]);
+		i = parent;
+	}
+
+	observer_heap_set(i, obs);
+}
+
+static void observer_heap_sift_down(u16_t i)
+{
+	struct observe_node *obs = observer_heap[i];
+
+	while (true) {
+		u16_t child = 2 * i + 1;
+
+		if (child >= observer_heap_count) {
+			break;
+		}
+
+		if (child + 1 < observer_heap_count &&
+		    observer_heap[child + 1]->deadline <
+		    observer_heap[child]->deadline) {
+			child++;
+		}
+
+		if (obs->deadline <= observer_heap[child]->deadline) {
+			break;
+		}
+
+		observer_heap_set(i, observer_heap[child]);
+		i = child;
+	}
+
+	observer_heap_set(i, obs);
+}
+
+/* Must be called with interrupts locked */
+static void observer_heap_update(struct observe_node *obs)
+{
+	observer_heap_sift_up(obs->heap_index);
+	observer_heap_sift_down(obs->heap_index);
+}
+
+/* Recalculate the deadline of an observer, and wake up the engine if the
+ * observer is now the first one due.
+ */
+static void observer_schedule(struct observe_node *obs)
+{
+	unsigned int key;
+	bool first;
+
+	key = irq_lock();
+	obs->deadline = observer_deadline(obs);
+	observer_heap_update(obs);
+	first = obs->heap_index == 0;
+	irq_unlock(key);
+
+	if (first) {
+		engine_wakeup();
+	}
+}
+
+static void observer_link(struct observe_node *obs)
+{
+	struct observe_node **entry;
+	unsigned int key;
+
+	sys_slist_append(&engine_observer_list, &obs->node);
+
+	entry = &engine_observer_hash[ENGINE_OBJ_INST_HASH(
+			obs->path.obj_id, obs->path.obj_inst_id)];
+	while (*entry) {
+		entry = &(*entry)->hash_next;
+	}
+
+	obs->hash_next = NULL;
+	*entry = obs;
+
+	key = irq_lock();
+	obs->heap_index = observer_heap_count++;
+	observer_heap[obs->heap_index] = obs;
+	obs->deadline = OBSERVER_NO_DEADLINE;
+	irq_unlock(key);
+
+	observer_schedule(obs);
+}
+
+static void observer_unlink(sys_snode_t *prev_node, struct observe_node *obs)
+{
+	struct observe_node **entry;
+	struct observe_node *last;
+	unsigned int key;
+
+	sys_slist_remove(&engine_observer_list, prev_node, &obs->node);
+
+	entry = &engine_observer_hash[ENGINE_OBJ_INST_HASH(
+			obs->path.obj_id, obs->path.obj_inst_id)];
+	while (*entry) {
+		if (*entry == obs) {
+			*entry = obs->hash_next;
+			break;
+		}
+
+		entry = &(*entry)->hash_next;
+	}
+
+	key = irq_lock();
+	last = observer_heap[--observer_heap_count];
+	if (last != obs) {
+		observer_heap_set(obs->heap_index, last);
+		observer_heap_update(last);
+	}
+	irq_unlock(key);
+
+	memset(obs, 0, sizeof(*obs));
+}
+
 int lwm2m_notify_observer(u16_t obj_id, u16_t obj_inst_id, u16_t res_id)
 {
 	struct observe_node *obs;
 	int ret = 0;
 
 	/* look for observers which match our resource */
-	SYS_SLIST_FOR_EACH_CONTAINER(&engine_observer_list, obs, node) {
+	for (obs = engine_observer_hash[ENGINE_OBJ_INST_HASH(obj_id,
+							     obj_inst_id)];
+	     obs; obs = obs->hash_next) {
 		if (obs->path.obj_id == obj_id &&
 		    obs->path.obj_inst_id == obj_inst_id &&
 		    (obs->path.level < 3 ||
 		     obs->path.res_id == res_id)) {
 			/* update the event time for this observer */
 			obs->event_timestamp = k_uptime_get();
+			observer_schedule(obs);
 
 			SYS_LOG_DBG("NOTIFY EVENT %u/%u/%u",
 				    obj_id, obj_inst_id, res_id);
@@ -442,7 +645,9 @@ static int engine_add_observer(struct lwm2m_message *msg,
 	 */
 
 	/* make sure this observer doesn't exist already */
-	SYS_SLIST_FOR_EACH_CONTAINER(&engine_observer_list, obs, node) {
+	for (obs = engine_observer_hash[ENGINE_OBJ_INST_HASH(path->obj_id,
+							     path->obj_inst_id)];
+	     obs; obs = obs->hash_next) {
 		/* TODO: distinguish server object */
 		if (obs->ctx == msg->ctx &&
 		    memcmp(&obs->path, path, sizeof(*path)) == 0) {
@@ -532,8 +737,7 @@ static int engine_add_observer(struct lwm2m_message *msg,
 	observe_node_data[i].max_period_sec = max(attrs.pmax, attrs.pmin);
 	observe_node_data[i].format = format;
 	observe_node_data[i].counter = 1;
-	sys_slist_append(&engine_observer_list,
-			 &observe_node_data[i].node);
+	observer_link(&observe_node_data[i]);
 
 	SYS_LOG_DBG("OBSERVER ADDED %u/%u/%u(%u) token:'%s' addr:%s",
 		    path->obj_id, path->obj_inst_id, path->res_id, path->level,
@@ -567,8 +771,7 @@ static int engine_remove_observer(const u8_t *token, u8_t tkl)
 		return -ENOENT;
 	}
 
-	sys_slist_remove(&engine_observer_list, prev_node, &found_obj->node);
-	memset(found_obj, 0, sizeof(*found_obj));
+	observer_unlink(prev_node, found_obj);
 
 	SYS_LOG_DBG("observer '%s' removed", sprint_token(token, tkl));
 
@@ -589,8 +792,7 @@ static void engine_remove_observer_by_id(u16_t obj_id, s32_t obj_inst_id)
 			continue;
 		}
 
-		sys_slist_remove(&engine_observer_list, prev_node, &obs->node);
-		memset(obs, 0, sizeof(*obs));
+		observer_unlink(prev_node, obs);
 	}
 }
 
@@ -598,20 +800,45 @@ static void engine_remove_observer_by_id(u16_t obj_id, s32_t obj_inst_id)
 
 void lwm2m_register_obj(struct lwm2m_engine_obj *obj)
 {
+	struct lwm2m_engine_obj **entry;
+
 	sys_slist_append(&engine_obj_list, &obj->node);
+
+	/* append so that lookups find the first registered object */
+	entry = &engine_obj_hash[ENGINE_OBJ_HASH(obj->obj_id)];
+	while (*entry) {
+		entry = &(*entry)->hash_next;
+	}
+
+	obj->hash_next = NULL;
+	*entry = obj;
 }
 
 void lwm2m_unregister_obj(struct lwm2m_engine_obj *obj)
 {
+	struct lwm2m_engine_obj **entry;
+
 	engine_remove_observer_by_id(obj->obj_id, -1);
 	sys_slist_find_and_remove(&engine_obj_list, &obj->node);
+
+	entry = &engine_obj_hash[ENGINE_OBJ_HASH(obj->obj_id)];
+	while (*entry) {
+		if (*entry == obj) {
+			*entry = obj->hash_next;
+			obj->hash_next = NULL;
+			break;
+		}
+
+		entry = &(*entry)->hash_next;
+	}
 }
 
 static struct lwm2m_engine_obj *get_engine_obj(int obj_id)
 {
 	struct lwm2m_engine_obj *obj;
 
-	SYS_SLIST_FOR_EACH_CONTAINER(&engine_obj_list, obj, node) {
+	for (obj = engine_obj_hash[ENGINE_OBJ_HASH(obj_id)]; obj;
+	     obj = obj->hash_next) {
 		if (obj->obj_id == obj_id) {
 			return obj;
 		}
@@ -640,14 +867,39 @@ lwm2m_get_engine_obj_field(struct lwm2m_engine_obj *obj, int res_id)
 
 static void engine_register_obj_inst(struct lwm2m_engine_obj_inst *obj_inst)
 {
+	struct lwm2m_engine_obj_inst **entry;
+
 	sys_slist_append(&engine_obj_inst_list, &obj_inst->node);
+
+	entry = &engine_obj_inst_hash[ENGINE_OBJ_INST_HASH(
+			obj_inst->obj->obj_id, obj_inst->obj_inst_id)];
+	while (*entry) {
+		entry = &(*entry)->hash_next;
+	}
+
+	obj_inst->hash_next = NULL;
+	*entry = obj_inst;
 }
 
 static void engine_unregister_obj_inst(struct lwm2m_engine_obj_inst *obj_inst)
 {
+	struct lwm2m_engine_obj_inst **entry;
+
 	engine_remove_observer_by_id(
 			obj_inst->obj->obj_id, obj_inst->obj_inst_id);
 	sys_slist_find_and_remove(&engine_obj_inst_list, &obj_inst->node);
+
+	entry = &engine_obj_inst_hash[ENGINE_OBJ_INST_HASH(
+			obj_inst->obj->obj_id, obj_inst->obj_inst_id)];
+	while (*entry) {
+		if (*entry == obj_inst) {
+			*entry = obj_inst->hash_next;
+			obj_inst->hash_next = NULL;
+			break;
+		}
+
+		entry = &(*entry)->hash_next;
+	}
 }
 
 static struct lwm2m_engine_obj_inst *get_engine_obj_inst(int obj_id,
@@ -655,8 +907,9 @@ static struct lwm2m_engine_obj_inst *get_engine_obj_inst(int obj_id,
 {
 	struct lwm2m_engine_obj_inst *obj_inst;
 
-	SYS_SLIST_FOR_EACH_CONTAINER(&engine_obj_inst_list, obj_inst,
-				     node) {
+	for (obj_inst = engine_obj_inst_hash[ENGINE_OBJ_INST_HASH(obj_id,
+								   obj_inst_id)];
+	     obj_inst; obj_inst = obj_inst->hash_next) {
 		if (obj_inst->obj->obj_id == obj_id &&
 		    obj_inst->obj_inst_id == obj_inst_id) {
 			return obj_inst;
@@ -717,6 +970,7 @@ int lwm2m_create_obj_inst(u16_t obj_id, u16_t obj_inst_id,
 	obj->instance_count++;
 	(*obj_inst)->obj = obj;
 	(*obj_inst)->obj_inst_id = obj_inst_id;
+	(*obj_inst)->create_seq = ++engine_obj_inst_seq;
 	engine_register_obj_inst(*obj_inst);
 #ifdef CONFIG_LWM2M_RD_CLIENT_SUPPORT
 	engine_trigger_update();
@@ -916,12 +1170,13 @@ void lwm2m_reset_message(struct lwm2m_message *msg, bool release)
 	}
 
 	if (msg->pending) {
-		coap_pending_clear(msg->pending);
+		coap_transmission_cancel(&msg->ctx->transmission, msg->pending);
 	}
 
 	if (msg->reply) {
 		/* make sure we want to clear the reply */
-		coap_reply_clear(msg->reply);
+		coap_transmission_reply_remove(&msg->ctx->transmission,
+					       msg->reply);
 	}
 
 	if (release) {
@@ -989,9 +1244,7 @@ int lwm2m_init_message(struct lwm2m_message *msg)
 		return 0;
 	}
 
-	msg->pending = coap_pending_next_unused(
-				msg->ctx->pendings,
-				CONFIG_LWM2M_ENGINE_MAX_PENDING);
+	msg->pending = coap_transmission_next_unused(&msg->ctx->transmission);
 	if (!msg->pending) {
 		SYS_LOG_ERR("Unable to find a free pending to track "
 			    "retransmissions.");
@@ -1021,6 +1274,8 @@ int lwm2m_init_message(struct lwm2m_message *msg)
 		coap_reply_clear(msg->reply);
 		coap_reply_init(msg->reply, &msg->cpkt);
 		msg->reply->reply = msg->reply_cb;
+		coap_transmission_reply_add(&msg->ctx->transmission,
+					    msg->reply);
 	}
 
 	return 0;
@@ -1043,37 +1298,28 @@ int lwm2m_send_message(struct lwm2m_message *msg)
 		return -EINVAL;
 	}
 
+	msg->send_attempts++;
+
+	/* the transmission layer retransmits until the message is ACKed */
 	if (msg->type == COAP_TYPE_CON) {
-		/*
-		 * Increase packet ref count to avoid being unref after
-		 * net_app_send_pkt()
-		 */
-		coap_pending_cycle(msg->pending);
+		ret = coap_transmission_send(&msg->ctx->transmission,
+					     msg->pending);
+		if (ret < 0) {
+			coap_transmission_cancel(&msg->ctx->transmission,
+						 msg->pending);
+		}
+
+		return ret;
 	}
 
-	msg->send_attempts++;
 	ret = net_app_send_pkt(&msg->ctx->net_app_ctx, msg->cpkt.pkt,
 			       &msg->ctx->net_app_ctx.default_ctx->remote,
 			       NET_SOCKADDR_MAX_SIZE, K_NO_WAIT, NULL);
 	if (ret < 0) {
-		if (msg->type == COAP_TYPE_CON) {
-			coap_pending_clear(msg->pending);
-		}
-
 		return ret;
 	}
 
-	if (msg->type == COAP_TYPE_CON) {
-		/* don't re-queue the retransmit work on retransmits */
-		if (msg->send_attempts > 1) {
-			return 0;
-		}
-
-		k_delayed_work_submit(&msg->ctx->retransmit_work,
-				      msg->pending->timeout);
-	} else {
-		lwm2m_reset_message(msg, true);
-	}
+	lwm2m_reset_message(msg, true);
 
 	return ret;
 }
@@ -1164,6 +1410,12 @@ static int select_writer(struct lwm2m_output_context *out, u16_t accept)
 		break;
 #endif
 
+#ifdef CONFIG_LWM2M_RW_SENML_CBOR_SUPPORT
+	case LWM2M_FORMAT_APP_SENML_CBOR:
+		out->writer = &senml_cbor_writer;
+		break;
+#endif
+
 	default:
 		SYS_LOG_WRN("Unknown content type %u", accept);
 		return -ENOMSG;
@@ -1188,6 +1440,12 @@ static int select_reader(struct lwm2m_input_context *in, u16_t format)
 		in->reader = &oma_tlv_reader;
 		break;
 
+#ifdef CONFIG_LWM2M_RW_SENML_CBOR_SUPPORT
+	case LWM2M_FORMAT_APP_SENML_CBOR:
+		in->reader = &senml_cbor_reader;
+		break;
+#endif
+
 	default:
 		SYS_LOG_WRN("Unknown content type %u", format);
 		return -ENOMSG;
@@ -1377,41 +1635,17 @@ int lwm2m_engine_set_res_data(char *pathstr, void *data_ptr, u16_t data_len,
 	return ret;
 }
 
-static int lwm2m_engine_set(char *pathstr, void *value, u16_t len)
+static int engine_set_res(struct lwm2m_obj_path *path,
+			  struct lwm2m_engine_obj_inst *obj_inst,
+			  struct lwm2m_engine_obj_field *obj_field,
+			  struct lwm2m_engine_res_inst *res,
+			  void *value, u16_t len)
 {
-	struct lwm2m_obj_path path;
-	struct lwm2m_engine_obj_inst *obj_inst;
-	struct lwm2m_engine_obj_field *obj_field;
-	struct lwm2m_engine_res_inst *res = NULL;
 	void *data_ptr = NULL;
 	size_t data_len = 0;
 	int ret = 0;
 	bool changed = false;
 
-	SYS_LOG_DBG("path:%s, value:%p, len:%d", pathstr, value, len);
-
-	/* translate path -> path_obj */
-	ret = string_to_path(pathstr, &path, '/');
-	if (ret < 0) {
-		return ret;
-	}
-
-	if (path.level < 3) {
-		SYS_LOG_ERR("path must have 3 parts");
-		return -EINVAL;
-	}
-
-	/* look up resource obj */
-	ret = path_to_objs(&path, &obj_inst, &obj_field, &res);
-	if (ret < 0) {
-		return ret;
-	}
-
-	if (!res) {
-		SYS_LOG_ERR("res instance %d not found", path.res_id);
-		return -ENOENT;
-	}
-
 	if (LWM2M_HAS_RES_FLAG(res, LWM2M_RES_DATA_FLAG_RO)) {
 		SYS_LOG_ERR("res data pointer is read-only");
 		return -EACCES;
@@ -1435,7 +1669,7 @@ static int lwm2m_engine_set(char *pathstr, void *value, u16_t len)
 	if (len > res->data_len -
 		(obj_field->data_type == LWM2M_RES_TYPE_STRING ? 1 : 0)) {
 		SYS_LOG_ERR("length %u is too long for resource %d data",
-			    len, path.res_id);
+			    len, path->res_id);
 		return -ENOMEM;
 	}
 
@@ -1518,12 +1752,42 @@ static int lwm2m_engine_set(char *pathstr, void *value, u16_t len)
 	}
 
 	if (changed) {
-		NOTIFY_OBSERVER_PATH(&path);
+		NOTIFY_OBSERVER_PATH(path);
 	}
 
 	return ret;
 }
 
+static int lwm2m_engine_set(char *pathstr, void *value, u16_t len)
+{
+	struct lwm2m_obj_path path;
+	struct lwm2m_engine_obj_inst *obj_inst;
+	struct lwm2m_engine_obj_field *obj_field;
+	struct lwm2m_engine_res_inst *res = NULL;
+	int ret = 0;
+
+	SYS_LOG_DBG("path:%s, value:%p, len:%d", pathstr, value, len);
+
+	/* translate path -> path_obj */
+	ret = string_to_path(pathstr, &path, '/');
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (path.level < 3) {
+		SYS_LOG_ERR("path must have 3 parts");
+		return -EINVAL;
+	}
+
+	/* look up resource obj */
+	ret = path_to_objs(&path, &obj_inst, &obj_field, &res);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return engine_set_res(&path, obj_inst, obj_field, res, value, len);
+}
+
 int lwm2m_engine_set_opaque(char *pathstr, char *data_ptr, u16_t data_len)
 {
 	return lwm2m_engine_set(pathstr, data_ptr, data_len);
@@ -1624,40 +1888,14 @@ int lwm2m_engine_get_res_data(char *pathstr, void **data_ptr, u16_t *data_len,
 	return 0;
 }
 
-static int lwm2m_engine_get(char *pathstr, void *buf, u16_t buflen)
+static int engine_get_res(struct lwm2m_engine_obj_inst *obj_inst,
+			  struct lwm2m_engine_obj_field *obj_field,
+			  struct lwm2m_engine_res_inst *res,
+			  void *buf, u16_t buflen)
 {
-	int ret = 0;
-	struct lwm2m_obj_path path;
-	struct lwm2m_engine_obj_inst *obj_inst;
-	struct lwm2m_engine_obj_field *obj_field;
-	struct lwm2m_engine_res_inst *res = NULL;
 	void *data_ptr = NULL;
 	size_t data_len = 0;
 
-	SYS_LOG_DBG("path:%s, buf:%p, buflen:%d", pathstr, buf, buflen);
-
-	/* translate path -> path_obj */
-	ret = string_to_path(pathstr, &path, '/');
-	if (ret < 0) {
-		return ret;
-	}
-
-	if (path.level < 3) {
-		SYS_LOG_ERR("path must have 3 parts");
-		return -EINVAL;
-	}
-
-	/* look up resource obj */
-	ret = path_to_objs(&path, &obj_inst, &obj_field, &res);
-	if (ret < 0) {
-		return ret;
-	}
-
-	if (!res) {
-		SYS_LOG_ERR("res instance %d not found", path.res_id);
-		return -ENOENT;
-	}
-
 	/* setup initial data elements */
 	data_ptr = res->data_ptr;
 	data_len = res->data_len;
@@ -1746,6 +1984,36 @@ static int lwm2m_engine_get(char *pathstr, void *buf, u16_t buflen)
 	return 0;
 }
 
+static int lwm2m_engine_get(char *pathstr, void *buf, u16_t buflen)
+{
+	int ret = 0;
+	struct lwm2m_obj_path path;
+	struct lwm2m_engine_obj_inst *obj_inst;
+	struct lwm2m_engine_obj_field *obj_field;
+	struct lwm2m_engine_res_inst *res = NULL;
+
+	SYS_LOG_DBG("path:%s, buf:%p, buflen:%d", pathstr, buf, buflen);
+
+	/* translate path -> path_obj */
+	ret = string_to_path(pathstr, &path, '/');
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (path.level < 3) {
+		SYS_LOG_ERR("path must have 3 parts");
+		return -EINVAL;
+	}
+
+	/* look up resource obj */
+	ret = path_to_objs(&path, &obj_inst, &obj_field, &res);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return engine_get_res(obj_inst, obj_field, res, buf, buflen);
+}
+
 int lwm2m_engine_get_opaque(char *pathstr, void *buf, u16_t buflen)
 {
 	return lwm2m_engine_get(pathstr, buf, buflen);
@@ -1819,6 +2087,260 @@ int lwm2m_engine_get_float64(char *pathstr, float64_value_t *buf)
 	return lwm2m_engine_get(pathstr, buf, sizeof(float64_value_t));
 }
 
+/* resource handle functions */
+
+/* The instance structure is cleared when the instance is deleted, and it
+ * may have been reused by another instance since the handle was resolved.
+ * The creation number tells even the same instance created again apart.
+ */
+static int res_handle_check(const struct lwm2m_engine_res_handle *handle)
+{
+	if (!handle->res || !handle->obj_inst->obj ||
+	    handle->obj_inst->create_seq != handle->obj_inst_seq ||
+	    handle->obj_inst->obj->obj_id != handle->obj_id ||
+	    handle->obj_inst->obj_inst_id != handle->obj_inst_id ||
+	    handle->res->res_id != handle->res_id ||
+	    get_engine_obj(handle->obj_id) != handle->obj_inst->obj) {
+		return -ENOENT;
+	}
+
+	return 0;
+}
+
+int lwm2m_engine_res_handle_get(char *pathstr,
+				struct lwm2m_engine_res_handle *handle)
+{
+	struct lwm2m_obj_path path;
+	int ret;
+
+	memset(handle, 0, sizeof(*handle));
+
+	ret = string_to_path(pathstr, &path, '/');
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (path.level < 3) {
+		SYS_LOG_ERR("path must have 3 parts");
+		return -EINVAL;
+	}
+
+	ret = path_to_objs(&path, &handle->obj_inst, &handle->obj_field,
+			   &handle->res);
+	if (ret < 0) {
+		return ret;
+	}
+
+	handle->obj_inst_seq = handle->obj_inst->create_seq;
+	handle->obj_id = path.obj_id;
+	handle->obj_inst_id = path.obj_inst_id;
+	handle->res_id = path.res_id;
+
+	/* the instances of an unregistered object can still be found */
+	return res_handle_check(handle);
+}
+
+static int res_handle_set(const struct lwm2m_engine_res_handle *handle,
+			  void *value, u16_t len)
+{
+	struct lwm2m_obj_path path;
+	int ret;
+
+	ret = res_handle_check(handle);
+	if (ret < 0) {
+		return ret;
+	}
+
+	path.obj_id = handle->obj_id;
+	path.obj_inst_id = handle->obj_inst_id;
+	path.res_id = handle->res_id;
+	path.res_inst_id = 0;
+	path.level = 3;
+
+	return engine_set_res(&path, handle->obj_inst, handle->obj_field,
+			      handle->res, value, len);
+}
+
+static int res_handle_get(const struct lwm2m_engine_res_handle *handle,
+			  void *buf, u16_t buflen)
+{
+	int ret;
+
+	ret = res_handle_check(handle);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return engine_get_res(handle->obj_inst, handle->obj_field,
+			      handle->res, buf, buflen);
+}
+
+int lwm2m_engine_res_handle_set_opaque(struct lwm2m_engine_res_handle *handle,
+				       char *data_ptr, u16_t data_len)
+{
+	return res_handle_set(handle, data_ptr, data_len);
+}
+
+int lwm2m_engine_res_handle_set_string(struct lwm2m_engine_res_handle *handle,
+				       char *data_ptr)
+{
+	return res_handle_set(handle, data_ptr, strlen(data_ptr));
+}
+
+int lwm2m_engine_res_handle_set_u8(struct lwm2m_engine_res_handle *handle,
+				   u8_t value)
+{
+	return res_handle_set(handle, &value, 1);
+}
+
+int lwm2m_engine_res_handle_set_u16(struct lwm2m_engine_res_handle *handle,
+				    u16_t value)
+{
+	return res_handle_set(handle, &value, 2);
+}
+
+int lwm2m_engine_res_handle_set_u32(struct lwm2m_engine_res_handle *handle,
+				    u32_t value)
+{
+	return res_handle_set(handle, &value, 4);
+}
+
+int lwm2m_engine_res_handle_set_u64(struct lwm2m_engine_res_handle *handle,
+				    u64_t value)
+{
+	return res_handle_set(handle, &value, 8);
+}
+
+int lwm2m_engine_res_handle_set_s8(struct lwm2m_engine_res_handle *handle,
+				   s8_t value)
+{
+	return res_handle_set(handle, &value, 1);
+}
+
+int lwm2m_engine_res_handle_set_s16(struct lwm2m_engine_res_handle *handle,
+				    s16_t value)
+{
+	return res_handle_set(handle, &value, 2);
+}
+
+int lwm2m_engine_res_handle_set_s32(struct lwm2m_engine_res_handle *handle,
+				    s32_t value)
+{
+	return res_handle_set(handle, &value, 4);
+}
+
+int lwm2m_engine_res_handle_set_s64(struct lwm2m_engine_res_handle *handle,
+				    s64_t value)
+{
+	return res_handle_set(handle, &value, 8);
+}
+
+int lwm2m_engine_res_handle_set_bool(struct lwm2m_engine_res_handle *handle,
+				     bool value)
+{
+	u8_t temp = (value != 0 ? 1 : 0);
+
+	return res_handle_set(handle, &temp, 1);
+}
+
+int lwm2m_engine_res_handle_set_float32(struct lwm2m_engine_res_handle *handle,
+					float32_value_t *value)
+{
+	return res_handle_set(handle, value, sizeof(float32_value_t));
+}
+
+int lwm2m_engine_res_handle_set_float64(struct lwm2m_engine_res_handle *handle,
+					float64_value_t *value)
+{
+	return res_handle_set(handle, value, sizeof(float64_value_t));
+}
+
+int lwm2m_engine_res_handle_get_opaque(struct lwm2m_engine_res_handle *handle,
+				       void *buf, u16_t buflen)
+{
+	return res_handle_get(handle, buf, buflen);
+}
+
+int lwm2m_engine_res_handle_get_string(struct lwm2m_engine_res_handle *handle,
+				       void *buf, u16_t buflen)
+{
+	return res_handle_get(handle, buf, buflen);
+}
+
+int lwm2m_engine_res_handle_get_u8(struct lwm2m_engine_res_handle *handle,
+				   u8_t *value)
+{
+	return res_handle_get(handle, value, 1);
+}
+
+int lwm2m_engine_res_handle_get_u16(struct lwm2m_engine_res_handle *handle,
+				    u16_t *value)
+{
+	return res_handle_get(handle, value, 2);
+}
+
+int lwm2m_engine_res_handle_get_u32(struct lwm2m_engine_res_handle *handle,
+				    u32_t *value)
+{
+	return res_handle_get(handle, value, 4);
+}
+
+int lwm2m_engine_res_handle_get_u64(struct lwm2m_engine_res_handle *handle,
+				    u64_t *value)
+{
+	return res_handle_get(handle, value, 8);
+}
+
+int lwm2m_engine_res_handle_get_s8(struct lwm2m_engine_res_handle *handle,
+				   s8_t *value)
+{
+	return res_handle_get(handle, value, 1);
+}
+
+int lwm2m_engine_res_handle_get_s16(struct lwm2m_engine_res_handle *handle,
+				    s16_t *value)
+{
+	return res_handle_get(handle, value, 2);
+}
+
+int lwm2m_engine_res_handle_get_s32(struct lwm2m_engine_res_handle *handle,
+				    s32_t *value)
+{
+	return res_handle_get(handle, value, 4);
+}
+
+int lwm2m_engine_res_handle_get_s64(struct lwm2m_engine_res_handle *handle,
+				    s64_t *value)
+{
+	return res_handle_get(handle, value, 8);
+}
+
+int lwm2m_engine_res_handle_get_bool(struct lwm2m_engine_res_handle *handle,
+				     bool *value)
+{
+	int ret = 0;
+	s8_t temp = 0;
+
+	ret = res_handle_get(handle, &temp, 1);
+	if (!ret) {
+		*value = temp != 0;
+	}
+
+	return ret;
+}
+
+int lwm2m_engine_res_handle_get_float32(struct lwm2m_engine_res_handle *handle,
+					float32_value_t *buf)
+{
+	return res_handle_get(handle, buf, sizeof(float32_value_t));
+}
+
+int lwm2m_engine_res_handle_get_float64(struct lwm2m_engine_res_handle *handle,
+					float64_value_t *buf)
+{
+	return res_handle_get(handle, buf, sizeof(float64_value_t));
+}
+
 int lwm2m_engine_get_resource(char *pathstr, struct lwm2m_engine_res_inst **res)
 {
 	int ret;
@@ -2588,6 +3110,7 @@ static int lwm2m_write_attr_handler(struct lwm2m_engine_obj *obj,
 			    nattrs.pmin, max(nattrs.pmin, nattrs.pmax));
 		obs->min_period_sec = (u32_t)nattrs.pmin;
 		obs->max_period_sec = (u32_t)max(nattrs.pmin, nattrs.pmax);
+		observer_schedule(obs);
 		memset(&nattrs, 0, sizeof(nattrs));
 	}
 
@@ -3021,6 +3544,11 @@ static int do_write_op(struct lwm2m_engine_obj *obj,
 		return do_write_op_json(obj, context);
 #endif
 
+#ifdef CONFIG_LWM2M_RW_SENML_CBOR_SUPPORT
+	case LWM2M_FORMAT_APP_SENML_CBOR:
+		return do_write_op_senml_cbor(obj, context);
+#endif
+
 	default:
 		SYS_LOG_ERR("Unsupported format: %u", format);
 		return -ENOMSG;
@@ -3404,13 +3932,12 @@ void lwm2m_udp_receive(struct lwm2m_ctx *client_ctx, struct net_pkt *pkt,
 	}
 
 	tkl = coap_header_get_token(&response, token);
-	pending = coap_pending_received(&response, client_ctx->pendings,
-					CONFIG_LWM2M_ENGINE_MAX_PENDING);
+	pending = coap_transmission_pending_received(&client_ctx->transmission,
+						     &response);
 	/*
-	 * Clear pending pointer because coap_pending_received() calls
-	 * coap_pending_clear, and later when we call lwm2m_reset_message()
-	 * it will try and call coap_pending_clear() again if msg->pending
-	 * is != NULL.
+	 * Clear pending pointer because the pending was already released,
+	 * and it may be reused before we call lwm2m_reset_message(), which
+	 * would cancel it again if msg->pending is != NULL.
 	 */
 	if (pending) {
 		msg = find_msg(pending, NULL);
@@ -3421,9 +3948,8 @@ void lwm2m_udp_receive(struct lwm2m_ctx *client_ctx, struct net_pkt *pkt,
 
 	SYS_LOG_DBG("checking for reply from [%s]",
 		    lwm2m_sprint_ip_addr(&from_addr));
-	reply = coap_response_received(&response, &from_addr,
-				       client_ctx->replies,
-				       CONFIG_LWM2M_ENGINE_MAX_REPLIES);
+	reply = coap_transmission_response_received(&client_ctx->transmission,
+						    &response, &from_addr);
 	if (reply) {
 		/*
 		 * Separate response is composed of 2 messages, empty ACK with
@@ -3516,64 +4042,37 @@ static void udp_receive(struct net_app_ctx *app_ctx, struct net_pkt *pkt,
 	lwm2m_udp_receive(client_ctx, pkt, false, handle_request);
 }
 
-static void retransmit_request(struct k_work *work)
+static int transmission_send(struct coap_transmission *tx,
+			     struct net_pkt *pkt,
+			     const struct sockaddr *addr)
 {
 	struct lwm2m_ctx *client_ctx;
-	struct lwm2m_message *msg;
-	struct coap_pending *pending;
-	int r;
 
-	client_ctx = CONTAINER_OF(work, struct lwm2m_ctx, retransmit_work);
-	pending = coap_pending_next_to_expire(client_ctx->pendings,
-					      CONFIG_LWM2M_ENGINE_MAX_PENDING);
-	if (!pending) {
-		return;
-	}
+	client_ctx = CONTAINER_OF(tx, struct lwm2m_ctx, transmission);
+
+	return net_app_send_pkt(&client_ctx->net_app_ctx, pkt,
+				(struct sockaddr *)addr, NET_SOCKADDR_MAX_SIZE,
+				K_NO_WAIT, NULL);
+}
+
+static void transmission_timeout(struct coap_transmission *tx,
+				 struct coap_pending *pending)
+{
+	struct lwm2m_message *msg;
 
 	msg = find_msg(pending, NULL);
 	if (!msg) {
 		SYS_LOG_ERR("pending has no valid LwM2M message!");
+		coap_pending_clear(pending);
 		return;
 	}
 
-	/* ref pkt to avoid being freed after net_app_send_pkt() */
-	net_pkt_ref(pending->pkt);
-
-	SYS_LOG_DBG("Resending message: %p", msg);
-	msg->send_attempts++;
-	/*
-	 * Don't use lwm2m_send_message() because it calls
-	 * coap_pending_cycle() / coap_pending_cycle() in a different order
-	 * and under different circumstances.  It also does it's own ref /
-	 * unref of the net_pkt.  Keep it simple and call net_app_send_pkt()
-	 * directly here.
-	 */
-	r = net_app_send_pkt(&msg->ctx->net_app_ctx, msg->cpkt.pkt,
-			     &msg->ctx->net_app_ctx.default_ctx->remote,
-			     NET_SOCKADDR_MAX_SIZE, K_NO_WAIT, NULL);
-	if (r < 0) {
-		SYS_LOG_ERR("Error sending lwm2m message: %d", r);
-		/* don't error here, retry until timeout */
-		net_pkt_unref(pending->pkt);
-	}
-
-	if (!coap_pending_cycle(pending)) {
-		/* pending request has expired */
-		if (msg->message_timeout_cb) {
-			msg->message_timeout_cb(msg);
-		}
-
-		/*
-		 * coap_pending_clear() is called in lwm2m_reset_message()
-		 * which balances the ref we made in coap_pending_cycle()
-		 */
-		lwm2m_reset_message(msg, true);
-		return;
+	/* pending request has expired */
+	if (msg->message_timeout_cb) {
+		msg->message_timeout_cb(msg);
 	}
 
-	/* unref to balance ref we made for sendto() */
-	net_pkt_unref(pending->pkt);
-	k_delayed_work_submit(&client_ctx->retransmit_work, pending->timeout);
+	lwm2m_reset_message(msg, true);
 }
 
 static int notify_message_reply_cb(const struct coap_packet *response,
@@ -3708,6 +4207,23 @@ s32_t engine_next_service_timeout_ms(u32_t max_timeout)
 	struct service_node *srv;
 	u64_t time_left_ms, timestamp = k_uptime_get();
 	u32_t timeout = max_timeout;
+	s64_t deadline = OBSERVER_NO_DEADLINE;
+	unsigned int key;
+
+	key = irq_lock();
+	if (observer_heap_count) {
+		deadline = observer_heap[0]->deadline;
+	}
+	irq_unlock(key);
+
+	/* notification is due */
+	if (deadline <= (s64_t)timestamp) {
+		return 0;
+	}
+
+	if (deadline - timestamp < timeout) {
+		timeout = deadline - timestamp;
+	}
 
 	SYS_SLIST_FOR_EACH_CONTAINER(&engine_service_list, srv, node) {
 		if (!srv->service_fn) {
@@ -3754,6 +4270,9 @@ int lwm2m_engine_add_service(void (*service)(void), u32_t period_ms)
 	sys_slist_append(&engine_service_list,
 			 &service_node_data[i].node);
 
+	/* the new service is due right away */
+	engine_wakeup();
+
 	return 0;
 }
 
@@ -3766,34 +4285,33 @@ static void lwm2m_engine_service(void)
 
 	while (true) {
 		/*
-		 * 1. scan the observer list
-		 * 2. For each notify event found, scan the observer list
-		 * 3. For each observer match, generate a NOTIFY message,
-		 *    attaching the notify response handler
+		 * Send the notifications which are due, earliest first:
+		 * - manual: an event was reported and pmin has passed
+		 * - automatic: pmax has passed since the last notification
 		 */
 		timestamp = k_uptime_get();
-		SYS_SLIST_FOR_EACH_CONTAINER(&engine_observer_list, obs, node) {
-			/*
-			 * manual notify requirements:
-			 * - event_timestamp > last_timestamp
-			 * - current timestamp > last_timestamp + min_period_sec
-			 */
-			if (obs->event_timestamp > obs->last_timestamp &&
-			    timestamp > obs->last_timestamp +
-					K_SECONDS(obs->min_period_sec)) {
-				obs->last_timestamp = k_uptime_get();
-				generate_notify_message(obs, true);
+		while (true) {
+			unsigned int key;
+			bool manual;
+
+			key = irq_lock();
+			obs = observer_heap_count ? observer_heap[0] : NULL;
+			if (obs && obs->deadline > timestamp) {
+				obs = NULL;
+			}
+			irq_unlock(key);
 
-			/*
-			 * automatic time-based notify requirements:
-			 * - current timestamp > last_timestamp + max_period_sec
-			 */
-			} else if (timestamp > obs->last_timestamp +
-					K_SECONDS(obs->min_period_sec)) {
-				obs->last_timestamp = k_uptime_get();
-				generate_notify_message(obs, false);
+			if (!obs) {
+				break;
 			}
 
+			/* Sending takes time, so the next period starts from
+			 * the current time and not from when the loop began.
+			 */
+			manual = obs->event_timestamp > obs->last_timestamp;
+			obs->last_timestamp = k_uptime_get();
+			observer_schedule(obs);
+			generate_notify_message(obs, manual);
 		}
 
 		timestamp = k_uptime_get();
@@ -3812,7 +4330,8 @@ static void lwm2m_engine_service(void)
 		}
 
 		/* calculate how long to sleep till the next service */
-		k_sleep(engine_next_service_timeout_ms(ENGINE_UPDATE_INTERVAL));
+		k_sleep(engine_next_service_timeout_ms(
+				ENGINE_MAX_SLEEP_INTERVAL));
 	}
 }
 
@@ -3830,7 +4349,10 @@ int lwm2m_engine_set_net_pkt_pool(struct lwm2m_ctx *ctx,
 
 void lwm2m_engine_context_init(struct lwm2m_ctx *client_ctx)
 {
-	k_delayed_work_init(&client_ctx->retransmit_work, retransmit_request);
+	coap_transmission_init(&client_ctx->transmission, client_ctx->pendings,
+			       client_ctx->pending_heap,
+			       CONFIG_LWM2M_ENGINE_MAX_PENDING,
+			       transmission_send, transmission_timeout);
 
 #if defined(CONFIG_NET_CONTEXT_NET_PKT_POOL)
 	net_app_set_net_pkt_pool(&client_ctx->net_app_ctx,
@@ -3943,6 +4465,7 @@ static int lwm2m_engine_init(struct device *dev)
 			/* Lowest priority cooperative thread */
 			K_PRIO_COOP(CONFIG_NUM_COOP_PRIORITIES - 1),
 			0, K_NO_WAIT);
+	engine_thread_started = true;
 	SYS_LOG_DBG("LWM2M engine thread started");
 	return 0;
 }
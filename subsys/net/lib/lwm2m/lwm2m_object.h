@@ -163,6 +163,9 @@ struct lwm2m_engine_obj {
 	/* object list */
 	sys_snode_t node;
 
+	/* next object in the same lookup bucket */
+	struct lwm2m_engine_obj *hash_next;
+
 	/* object field definitions */
 	struct lwm2m_engine_obj_field *fields;
 
@@ -243,12 +246,18 @@ struct lwm2m_engine_obj_inst {
 	/* instance list */
 	sys_snode_t node;
 
+	/* next instance in the same lookup bucket */
+	struct lwm2m_engine_obj_inst *hash_next;
+
 	struct lwm2m_engine_obj *obj;
 	struct lwm2m_engine_res_inst *resources;
 
 	/* object instance member data */
 	u16_t obj_inst_id;
 	u16_t resource_count;
+
+	/* creation number, tells a re-created instance from the old one */
+	u32_t create_seq;
 };
 
 struct lwm2m_output_context {
@@ -0,0 +1,1059 @@
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * SenML CBOR (RFC 8428) content format.
+ *
+ * The writer streams the records straight into the net_buf fragments of
+ * the response: the record array uses the CBOR indefinite length encoding
+ * so nothing has to be counted or buffered up front.  The first record of
+ * an object instance carries the base name "/<obj>/<inst>/" and the other
+ * records only the resource ID.
+ *
+ * The reader walks the records in place.  As the labels of a record may
+ * come in any order, the position of the value is remembered and the
+ * value is handed to the engine once the name of the record is known.
+ */
+
+#define SYS_LOG_DOMAIN "lib/lwm2m_senml_cbor"
+#define SYS_LOG_LEVEL CONFIG_SYS_LOG_LWM2M_LEVEL
+#include <logging/sys_log.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <misc/byteorder.h>
+
+#include "lwm2m_rw_senml_cbor.h"
+#include "lwm2m_engine.h"
+
+/* CBOR major types */
+#define CBOR_MAJOR_UINT		0
+#define CBOR_MAJOR_NINT		1
+#define CBOR_MAJOR_BSTR		2
+#define CBOR_MAJOR_TSTR		3
+#define CBOR_MAJOR_ARRAY	4
+#define CBOR_MAJOR_MAP		5
+#define CBOR_MAJOR_TAG		6
+#define CBOR_MAJOR_SIMPLE	7
+
+/* additional information values */
+#define CBOR_INFO_UINT8		24
+#define CBOR_INFO_UINT16	25
+#define CBOR_INFO_UINT32	26
+#define CBOR_INFO_UINT64	27
+#define CBOR_INFO_INDEFINITE	31
+
+#define CBOR_FALSE		20
+#define CBOR_TRUE		21
+#define CBOR_FLOAT16		25
+#define CBOR_FLOAT32		26
+#define CBOR_FLOAT64		27
+
+#define CBOR_INDEFINITE_ARRAY	0x9f
+#define CBOR_BREAK		0xff
+
+/* max nesting of skipped values */
+#define CBOR_MAX_DEPTH		4
+
+/* SenML labels */
+#define SENML_LABEL_BASE_NAME	-2
+#define SENML_LABEL_NAME	0
+#define SENML_LABEL_VALUE	2
+#define SENML_LABEL_STRING	3
+#define SENML_LABEL_BOOL	4
+#define SENML_LABEL_DATA	8
+
+/* "/65535/65535/65535/65535" */
+#define SENML_NAME_LEN		25
+
+struct cbor_item {
+	u64_t value;
+	u8_t major;
+	u8_t info;
+	/* length of the encoded head */
+	u8_t len;
+};
+
+/* writer helpers */
+
+static size_t cbor_put(struct lwm2m_output_context *out,
+		       const u8_t *data, u16_t len)
+{
+	out->frag = net_pkt_write(out->out_cpkt->pkt, out->frag,
+				  out->offset, &out->offset, len,
+				  (u8_t *)data, BUF_ALLOC_TIMEOUT);
+	if (!out->frag && out->offset == 0xffff) {
+		/* TODO: Generate error? */
+		return 0;
+	}
+
+	return len;
+}
+
+static size_t cbor_put_head(struct lwm2m_output_context *out,
+			    u8_t major, u64_t value)
+{
+	u8_t buf[9];
+	u16_t len;
+
+	if (value < CBOR_INFO_UINT8) {
+		buf[0] = (major << 5) | value;
+		len = 1;
+	} else if (value <= 0xff) {
+		buf[0] = (major << 5) | CBOR_INFO_UINT8;
+		buf[1] = value;
+		len = 2;
+	} else if (value <= 0xffff) {
+		buf[0] = (major << 5) | CBOR_INFO_UINT16;
+		sys_put_be16(value, &buf[1]);
+		len = 3;
+	} else if (value <= 0xffffffff) {
+		buf[0] = (major << 5) | CBOR_INFO_UINT32;
+		sys_put_be32(value, &buf[1]);
+		len = 5;
+	} else {
+		buf[0] = (major << 5) | CBOR_INFO_UINT64;
+		sys_put_be32(value >> 32, &buf[1]);
+		sys_put_be32(value, &buf[5]);
+		len = 9;
+	}
+
+	return cbor_put(out, buf, len);
+}
+
+static size_t cbor_put_int(struct lwm2m_output_context *out, s64_t value)
+{
+	if (value < 0) {
+		return cbor_put_head(out, CBOR_MAJOR_NINT,
+				     (u64_t)(-(value + 1)));
+	}
+
+	return cbor_put_head(out, CBOR_MAJOR_UINT, value);
+}
+
+static size_t cbor_put_str(struct lwm2m_output_context *out, u8_t major,
+			   const char *buf, size_t buflen)
+{
+	size_t len;
+
+	len = cbor_put_head(out, major, buflen);
+	if (buflen) {
+		len += cbor_put(out, (const u8_t *)buf, buflen);
+	}
+
+	return len;
+}
+
+static size_t cbor_put_float(struct lwm2m_output_context *out, double value)
+{
+	union {
+		float f;
+		u32_t u;
+	} f32;
+	union {
+		double d;
+		u64_t u;
+	} f64;
+	u8_t buf[9];
+
+	/* use the short encoding when it does not lose precision */
+	f32.f = (float)value;
+	if ((double)f32.f == value) {
+		buf[0] = (CBOR_MAJOR_SIMPLE << 5) | CBOR_FLOAT32;
+		sys_put_be32(f32.u, &buf[1]);
+		return cbor_put(out, buf, 5);
+	}
+
+	f64.d = value;
+	buf[0] = (CBOR_MAJOR_SIMPLE << 5) | CBOR_FLOAT64;
+	sys_put_be32(f64.u >> 32, &buf[1]);
+	sys_put_be32(f64.u, &buf[5]);
+	return cbor_put(out, buf, 9);
+}
+
+/* Start a record, up to the label of its value */
+static size_t put_record(struct lwm2m_output_context *out,
+			 struct lwm2m_obj_path *path, int label)
+{
+	char name[SENML_NAME_LEN];
+	bool first = !(out->writer_flags & WRITER_OUTPUT_VALUE);
+	size_t len;
+	int name_len;
+
+	len = cbor_put_head(out, CBOR_MAJOR_MAP, first ? 3 : 2);
+
+	if (first) {
+		name_len = snprintk(name, sizeof(name), "/%u/%u/",
+				    path->obj_id, path->obj_inst_id);
+		len += cbor_put_int(out, SENML_LABEL_BASE_NAME);
+		len += cbor_put_str(out, CBOR_MAJOR_TSTR, name, name_len);
+		out->writer_flags |= WRITER_OUTPUT_VALUE;
+	}
+
+	if (out->writer_flags & WRITER_RESOURCE_INSTANCE) {
+		name_len = snprintk(name, sizeof(name), "%u/%u",
+				    path->res_id, path->res_inst_id);
+	} else {
+		name_len = snprintk(name, sizeof(name), "%u", path->res_id);
+	}
+
+	len += cbor_put_int(out, SENML_LABEL_NAME);
+	len += cbor_put_str(out, CBOR_MAJOR_TSTR, name, name_len);
+	len += cbor_put_int(out, label);
+
+	return len;
+}
+
+static size_t put_begin(struct lwm2m_output_context *out,
+			struct lwm2m_obj_path *path)
+{
+	u8_t head = CBOR_INDEFINITE_ARRAY;
+
+	out->writer_flags = 0;
+	return cbor_put(out, &head, 1);
+}
+
+static size_t put_end(struct lwm2m_output_context *out,
+		      struct lwm2m_obj_path *path)
+{
+	u8_t brk = CBOR_BREAK;
+
+	return cbor_put(out, &brk, 1);
+}
+
+static size_t put_begin_ri(struct lwm2m_output_context *out,
+			   struct lwm2m_obj_path *path)
+{
+	out->writer_flags |= WRITER_RESOURCE_INSTANCE;
+	return 0;
+}
+
+static size_t put_end_ri(struct lwm2m_output_context *out,
+			 struct lwm2m_obj_path *path)
+{
+	out->writer_flags &= ~WRITER_RESOURCE_INSTANCE;
+	return 0;
+}
+
+static size_t put_s64(struct lwm2m_output_context *out,
+		      struct lwm2m_obj_path *path, s64_t value)
+{
+	size_t len;
+
+	len = put_record(out, path, SENML_LABEL_VALUE);
+	len += cbor_put_int(out, value);
+
+	return len;
+}
+
+static size_t put_s32(struct lwm2m_output_context *out,
+		      struct lwm2m_obj_path *path, s32_t value)
+{
+	return put_s64(out, path, (s64_t)value);
+}
+
+static size_t put_s16(struct lwm2m_output_context *out,
+		      struct lwm2m_obj_path *path, s16_t value)
+{
+	return put_s64(out, path, (s64_t)value);
+}
+
+static size_t put_s8(struct lwm2m_output_context *out,
+		     struct lwm2m_obj_path *path, s8_t value)
+{
+	return put_s64(out, path, (s64_t)value);
+}
+
+static size_t put_string(struct lwm2m_output_context *out,
+			 struct lwm2m_obj_path *path,
+			 char *buf, size_t buflen)
+{
+	size_t len;
+
+	len = put_record(out, path, SENML_LABEL_STRING);
+	len += cbor_put_str(out, CBOR_MAJOR_TSTR, buf, buflen);
+
+	return len;
+}
+
+static size_t put_opaque(struct lwm2m_output_context *out,
+			 struct lwm2m_obj_path *path,
+			 char *buf, size_t buflen)
+{
+	size_t len;
+
+	len = put_record(out, path, SENML_LABEL_DATA);
+	len += cbor_put_str(out, CBOR_MAJOR_BSTR, buf, buflen);
+
+	return len;
+}
+
+static size_t put_float32fix(struct lwm2m_output_context *out,
+			     struct lwm2m_obj_path *path,
+			     float32_value_t *value)
+{
+	size_t len;
+
+	len = put_record(out, path, SENML_LABEL_VALUE);
+	if (value->val2 == 0) {
+		len += cbor_put_int(out, value->val1);
+	} else {
+		len += cbor_put_float(out, value->val1 +
+				      value->val2 / 1000000.0);
+	}
+
+	return len;
+}
+
+static size_t put_float64fix(struct lwm2m_output_context *out,
+			     struct lwm2m_obj_path *path,
+			     float64_value_t *value)
+{
+	size_t len;
+
+	len = put_record(out, path, SENML_LABEL_VALUE);
+	if (value->val2 == 0) {
+		len += cbor_put_int(out, value->val1);
+	} else {
+		len += cbor_put_float(out, value->val1 +
+				      value->val2 / 1000000000.0);
+	}
+
+	return len;
+}
+
+static size_t put_bool(struct lwm2m_output_context *out,
+		       struct lwm2m_obj_path *path,
+		       bool value)
+{
+	size_t len;
+
+	len = put_record(out, path, SENML_LABEL_BOOL);
+	len += cbor_put_head(out, CBOR_MAJOR_SIMPLE,
+			     value ? CBOR_TRUE : CBOR_FALSE);
+
+	return len;
+}
+
+const struct lwm2m_writer senml_cbor_writer = {
+	put_begin,
+	put_end,
+	put_begin_ri,
+	put_end_ri,
+	put_s8,
+	put_s16,
+	put_s32,
+	put_s64,
+	put_string,
+	put_float32fix,
+	put_float64fix,
+	put_bool,
+	put_opaque
+};
+
+/* reader helpers */
+
+static int cbor_read(struct lwm2m_input_context *in, u8_t *buf, u16_t len)
+{
+	if (!in->frag) {
+		return -ENODATA;
+	}
+
+	in->frag = net_frag_read(in->frag, in->offset, &in->offset, len, buf);
+	if (!in->frag && in->offset == 0xffff) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int cbor_get_item(struct lwm2m_input_context *in,
+			 struct cbor_item *item)
+{
+	u8_t buf[8];
+	u8_t head;
+	int i, ret;
+
+	ret = cbor_read(in, &head, 1);
+	if (ret < 0) {
+		return ret;
+	}
+
+	item->major = head >> 5;
+	item->info = head & 0x1f;
+	item->value = item->info;
+	item->len = 1;
+
+	if (item->info < CBOR_INFO_UINT8) {
+		return 0;
+	}
+
+	if (item->info == CBOR_INFO_INDEFINITE) {
+		/* break, or the start of an indefinite length item */
+		if (item->major == CBOR_MAJOR_SIMPLE ||
+		    (item->major >= CBOR_MAJOR_BSTR &&
+		     item->major <= CBOR_MAJOR_MAP)) {
+			return 0;
+		}
+
+		return -EINVAL;
+	}
+
+	if (item->info > CBOR_INFO_UINT64) {
+		return -EINVAL;
+	}
+
+	item->len += 1 << (item->info - CBOR_INFO_UINT8);
+	ret = cbor_read(in, buf, item->len - 1);
+	if (ret < 0) {
+		return ret;
+	}
+
+	item->value = 0;
+	for (i = 0; i < item->len - 1; i++) {
+		item->value = (item->value << 8) | buf[i];
+	}
+
+	return 0;
+}
+
+static bool cbor_is_break(const struct cbor_item *item)
+{
+	return item->major == CBOR_MAJOR_SIMPLE &&
+	       item->info == CBOR_INFO_INDEFINITE;
+}
+
+static bool cbor_is_indefinite(const struct cbor_item *item)
+{
+	return item->major != CBOR_MAJOR_SIMPLE &&
+	       item->info == CBOR_INFO_INDEFINITE;
+}
+
+static int cbor_skip(struct lwm2m_input_context *in, int depth);
+
+/* Skip the content of an item whose head has already been read */
+static int cbor_skip_content(struct lwm2m_input_context *in,
+			     const struct cbor_item *item, int depth)
+{
+	struct cbor_item chunk;
+	u64_t count;
+	int ret;
+
+	if (depth > CBOR_MAX_DEPTH) {
+		return -EINVAL;
+	}
+
+	switch (item->major) {
+
+	case CBOR_MAJOR_UINT:
+	case CBOR_MAJOR_NINT:
+	case CBOR_MAJOR_SIMPLE:
+		return 0;
+
+	case CBOR_MAJOR_BSTR:
+	case CBOR_MAJOR_TSTR:
+		if (!cbor_is_indefinite(item)) {
+			if (item->value > 0xffff) {
+				return -EINVAL;
+			}
+
+			return cbor_read(in, NULL, item->value);
+		}
+
+		/* chunked string */
+		while (true) {
+			ret = cbor_get_item(in, &chunk);
+			if (ret < 0) {
+				return ret;
+			}
+
+			if (cbor_is_break(&chunk)) {
+				return 0;
+			}
+
+			if (chunk.major != item->major ||
+			    cbor_is_indefinite(&chunk)) {
+				return -EINVAL;
+			}
+
+			ret = cbor_skip_content(in, &chunk, depth + 1);
+			if (ret < 0) {
+				return ret;
+			}
+		}
+
+	case CBOR_MAJOR_ARRAY:
+	case CBOR_MAJOR_MAP:
+		if (cbor_is_indefinite(item)) {
+			while (true) {
+				ret = cbor_get_item(in, &chunk);
+				if (ret < 0) {
+					return ret;
+				}
+
+				if (cbor_is_break(&chunk)) {
+					return 0;
+				}
+
+				ret = cbor_skip_content(in, &chunk, depth + 1);
+				if (ret < 0) {
+					return ret;
+				}
+			}
+		}
+
+		count = item->value;
+		if (item->major == CBOR_MAJOR_MAP) {
+			count *= 2;
+		}
+
+		while (count--) {
+			ret = cbor_skip(in, depth + 1);
+			if (ret < 0) {
+				return ret;
+			}
+		}
+
+		return 0;
+
+	case CBOR_MAJOR_TAG:
+		return cbor_skip(in, depth + 1);
+
+	}
+
+	return -EINVAL;
+}
+
+static int cbor_skip(struct lwm2m_input_context *in, int depth)
+{
+	struct cbor_item item;
+	int ret;
+
+	ret = cbor_get_item(in, &item);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return cbor_skip_content(in, &item, depth);
+}
+
+static int cbor_item_to_double(const struct cbor_item *item, double *value)
+{
+	union {
+		float f;
+		u32_t u;
+	} f32;
+	union {
+		double d;
+		u64_t u;
+	} f64;
+	u32_t exp, mant;
+
+	switch (item->major) {
+
+	case CBOR_MAJOR_UINT:
+		*value = (double)item->value;
+		return 0;
+
+	case CBOR_MAJOR_NINT:
+		*value = -1.0 - (double)item->value;
+		return 0;
+
+	case CBOR_MAJOR_SIMPLE:
+		break;
+
+	default:
+		return -EINVAL;
+
+	}
+
+	switch (item->info) {
+
+	case CBOR_FLOAT16:
+		exp = (item->value >> 10) & 0x1f;
+		mant = item->value & 0x3ff;
+		if (exp == 0x1f) {
+			return -EINVAL;
+		}
+
+		if (exp == 0) {
+			/* subnormal */
+			*value = mant / 16777216.0;
+		} else {
+			f32.u = ((exp + 112) << 23) | (mant << 13);
+			*value = f32.f;
+		}
+
+		if (item->value & 0x8000) {
+			*value = -*value;
+		}
+
+		return 0;
+
+	case CBOR_FLOAT32:
+		f32.u = item->value;
+		*value = f32.f;
+		return 0;
+
+	case CBOR_FLOAT64:
+		f64.u = item->value;
+		*value = f64.d;
+		return 0;
+
+	}
+
+	return -EINVAL;
+}
+
+static size_t get_s64(struct lwm2m_input_context *in, s64_t *value)
+{
+	struct cbor_item item;
+	double temp;
+
+	*value = 0;
+	if (cbor_get_item(in, &item) < 0) {
+		return 0;
+	}
+
+	if (item.major == CBOR_MAJOR_UINT) {
+		*value = item.value;
+	} else if (item.major == CBOR_MAJOR_NINT) {
+		*value = -1 - (s64_t)item.value;
+	} else if (!cbor_item_to_double(&item, &temp)) {
+		*value = (s64_t)temp;
+	} else {
+		SYS_LOG_ERR("invalid number, major type %u", item.major);
+		return 0;
+	}
+
+	return item.len;
+}
+
+static size_t get_s32(struct lwm2m_input_context *in, s32_t *value)
+{
+	s64_t temp;
+	size_t size;
+
+	*value = 0;
+	size = get_s64(in, &temp);
+	if (size > 0) {
+		*value = (s32_t)temp;
+	}
+
+	return size;
+}
+
+static size_t get_string(struct lwm2m_input_context *in,
+			 u8_t *buf, size_t buflen)
+{
+	struct cbor_item item;
+
+	if (cbor_get_item(in, &item) < 0) {
+		return 0;
+	}
+
+	if ((item.major != CBOR_MAJOR_TSTR &&
+	     item.major != CBOR_MAJOR_BSTR) || cbor_is_indefinite(&item)) {
+		SYS_LOG_ERR("invalid string, major type %u", item.major);
+		return 0;
+	}
+
+	if (buflen <= item.value) {
+		/* TODO: Generate error? */
+		return 0;
+	}
+
+	if (item.value && cbor_read(in, buf, item.value) < 0) {
+		return 0;
+	}
+
+	buf[item.value] = '\0';
+
+	return item.len + item.value;
+}
+
+static size_t get_float32fix(struct lwm2m_input_context *in,
+			     float32_value_t *value)
+{
+	struct cbor_item item;
+	double temp;
+
+	if (cbor_get_item(in, &item) < 0 ||
+	    cbor_item_to_double(&item, &temp) < 0) {
+		return 0;
+	}
+
+	value->val1 = (s32_t)temp;
+	value->val2 = (s32_t)((temp - value->val1) * 1000000.0);
+
+	return item.len;
+}
+
+static size_t get_float64fix(struct lwm2m_input_context *in,
+			     float64_value_t *value)
+{
+	struct cbor_item item;
+	double temp;
+
+	if (cbor_get_item(in, &item) < 0 ||
+	    cbor_item_to_double(&item, &temp) < 0) {
+		return 0;
+	}
+
+	value->val1 = (s64_t)temp;
+	value->val2 = (s64_t)((temp - value->val1) * 1000000000.0);
+
+	return item.len;
+}
+
+static size_t get_bool(struct lwm2m_input_context *in, bool *value)
+{
+	struct cbor_item item;
+
+	*value = false;
+	if (cbor_get_item(in, &item) < 0) {
+		return 0;
+	}
+
+	if (item.major != CBOR_MAJOR_SIMPLE ||
+	    (item.info != CBOR_TRUE && item.info != CBOR_FALSE)) {
+		SYS_LOG_ERR("invalid boolean");
+		return 0;
+	}
+
+	*value = item.info == CBOR_TRUE;
+
+	return item.len;
+}
+
+static size_t get_opaque(struct lwm2m_input_context *in,
+			 u8_t *value, size_t buflen, bool *last_block)
+{
+	struct cbor_item item;
+
+	if (cbor_get_item(in, &item) < 0 || item.major != CBOR_MAJOR_BSTR ||
+	    cbor_is_indefinite(&item) || item.value > 0xffff) {
+		*last_block = true;
+		return 0;
+	}
+
+	in->opaque_len = item.value;
+	return lwm2m_engine_get_opaque_more(in, value, buflen, last_block);
+}
+
+const struct lwm2m_reader senml_cbor_reader = {
+	get_s32,
+	get_s64,
+	get_string,
+	get_float32fix,
+	get_float64fix,
+	get_bool,
+	get_opaque
+};
+
+static int get_name(struct lwm2m_input_context *in, char *buf, size_t buflen)
+{
+	struct cbor_item item;
+	int ret;
+
+	ret = cbor_get_item(in, &item);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (item.major != CBOR_MAJOR_TSTR || cbor_is_indefinite(&item) ||
+	    item.value >= buflen) {
+		return -EINVAL;
+	}
+
+	if (item.value) {
+		ret = cbor_read(in, (u8_t *)buf, item.value);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	buf[item.value] = '\0';
+
+	return 0;
+}
+
+/* Parse the concatenated base name and name of a record into a path */
+static int parse_name(const char *base_name, const char *name,
+		      struct lwm2m_obj_path *path)
+{
+	char full[2 * SENML_NAME_LEN];
+	u32_t value;
+	u16_t ids[4];
+	int level = 0;
+	char *p;
+
+	snprintk(full, sizeof(full), "%s%s", base_name, name);
+
+	p = full;
+	while (*p) {
+		if (*p == '/') {
+			p++;
+			continue;
+		}
+
+		if (!isdigit((unsigned char)*p) || level == ARRAY_SIZE(ids)) {
+			return -EINVAL;
+		}
+
+		value = 0;
+		while (isdigit((unsigned char)*p)) {
+			value = value * 10 + (*p++ - '0');
+			if (value > 0xffff) {
+				return -EINVAL;
+			}
+		}
+
+		if (*p && *p != '/') {
+			return -EINVAL;
+		}
+
+		ids[level++] = value;
+	}
+
+	memset(path, 0, sizeof(*path));
+	path->level = level;
+	if (level > 0) {
+		path->obj_id = ids[0];
+	}
+
+	if (level > 1) {
+		path->obj_inst_id = ids[1];
+	}
+
+	if (level > 2) {
+		path->res_id = ids[2];
+	}
+
+	if (level > 3) {
+		path->res_inst_id = ids[3];
+	}
+
+	return 0;
+}
+
+static int do_write_op_senml_cbor_item(struct lwm2m_engine_context *context)
+{
+	struct lwm2m_engine_obj_inst *obj_inst = NULL;
+	struct lwm2m_engine_res_inst *res = NULL;
+	struct lwm2m_engine_obj_field *obj_field = NULL;
+	u8_t created = 0;
+	int ret, i;
+
+	ret = lwm2m_get_or_create_engine_obj(context, &obj_inst, &created);
+	if (ret < 0) {
+		return ret;
+	}
+
+	obj_field = lwm2m_get_engine_obj_field(obj_inst->obj,
+					       context->path->res_id);
+	/* if obj_field is not found, treat as an optional resource */
+	if (!obj_field) {
+		if (context->operation == LWM2M_OP_CREATE) {
+			return -ENOTSUP;
+		}
+
+		return -ENOENT;
+	}
+
+	if (!LWM2M_HAS_PERM(obj_field, LWM2M_PERM_W)) {
+		return -EPERM;
+	}
+
+	if (!obj_inst->resources || obj_inst->resource_count == 0) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < obj_inst->resource_count; i++) {
+		if (obj_inst->resources[i].res_id == context->path->res_id) {
+			res = &obj_inst->resources[i];
+			break;
+		}
+	}
+
+	if (!res) {
+		return -ENOENT;
+	}
+
+	return lwm2m_write_handler(obj_inst, res, obj_field, context);
+}
+
+static int write_record(struct lwm2m_engine_context *context,
+			const char *base_name, const char *name,
+			struct net_buf *value_frag, u16_t value_offset)
+{
+	struct lwm2m_input_context *in = context->in;
+	struct lwm2m_obj_path *path = context->path;
+	struct lwm2m_obj_path record;
+	struct net_buf *end_frag;
+	u16_t end_offset;
+	int ret;
+
+	ret = parse_name(base_name, name, &record);
+	if (ret < 0) {
+		SYS_LOG_ERR("invalid record name %s%s", base_name, name);
+		return ret;
+	}
+
+	/* TODO: support writing multiple resource instances */
+	if (record.level > 3) {
+		return -ENOTSUP;
+	}
+
+	if (record.level < 3 || record.obj_id != path->obj_id ||
+	    (path->level > 1 && record.obj_inst_id != path->obj_inst_id) ||
+	    (path->level > 2 && record.res_id != path->res_id)) {
+		SYS_LOG_ERR("record %s%s outside of the request path",
+			    base_name, name);
+		return -EINVAL;
+	}
+
+	path->obj_inst_id = record.obj_inst_id;
+	path->res_id = record.res_id;
+	path->level = 3;
+
+	/* read the value in place, then continue after the record */
+	end_frag = in->frag;
+	end_offset = in->offset;
+	in->frag = value_frag;
+	in->offset = value_offset;
+
+	ret = do_write_op_senml_cbor_item(context);
+
+	in->frag = end_frag;
+	in->offset = end_offset;
+
+	return ret;
+}
+
+int do_write_op_senml_cbor(struct lwm2m_engine_obj *obj,
+			   struct lwm2m_engine_context *context)
+{
+	struct lwm2m_input_context *in = context->in;
+	char base_name[SENML_NAME_LEN] = "";
+	char name[SENML_NAME_LEN];
+	struct cbor_item records, pairs, item;
+	struct net_buf *value_frag;
+	u16_t value_offset;
+	u64_t count;
+	s64_t label;
+	u8_t olv = context->path->level;
+	int ret;
+
+	ret = cbor_get_item(in, &records);
+	if (ret < 0 || records.major != CBOR_MAJOR_ARRAY) {
+		SYS_LOG_ERR("payload is not a SenML pack");
+		return -EINVAL;
+	}
+
+	count = records.value;
+	while (cbor_is_indefinite(&records) || count--) {
+		ret = cbor_get_item(in, &pairs);
+		if (ret < 0) {
+			return ret;
+		}
+
+		if (cbor_is_break(&pairs) && cbor_is_indefinite(&records)) {
+			break;
+		}
+
+		if (pairs.major != CBOR_MAJOR_MAP) {
+			return -EINVAL;
+		}
+
+		name[0] = '\0';
+		value_frag = NULL;
+		value_offset = 0;
+
+		while (cbor_is_indefinite(&pairs) || pairs.value--) {
+			ret = cbor_get_item(in, &item);
+			if (ret < 0) {
+				return ret;
+			}
+
+			if (cbor_is_break(&item) &&
+			    cbor_is_indefinite(&pairs)) {
+				break;
+			}
+
+			if (item.major == CBOR_MAJOR_UINT) {
+				label = item.value;
+			} else if (item.major == CBOR_MAJOR_NINT) {
+				label = -1 - (s64_t)item.value;
+			} else {
+				/* unknown string label, skip its value */
+				ret = cbor_skip_content(in, &item, 0);
+				if (ret < 0) {
+					return ret;
+				}
+
+				ret = cbor_skip(in, 0);
+				if (ret < 0) {
+					return ret;
+				}
+
+				continue;
+			}
+
+			switch (label) {
+
+			case SENML_LABEL_BASE_NAME:
+				ret = get_name(in, base_name,
+					       sizeof(base_name));
+				break;
+
+			case SENML_LABEL_NAME:
+				ret = get_name(in, name, sizeof(name));
+				break;
+
+			case SENML_LABEL_VALUE:
+			case SENML_LABEL_STRING:
+			case SENML_LABEL_BOOL:
+			case SENML_LABEL_DATA:
+				value_frag = in->frag;
+				value_offset = in->offset;
+				ret = cbor_skip(in, 0);
+				break;
+
+			default:
+				ret = cbor_skip(in, 0);
+				break;
+
+			}
+
+			if (ret < 0) {
+				return ret;
+			}
+		}
+
+		/* records without a value only update the base name */
+		if (!value_frag) {
+			continue;
+		}
+
+		ret = write_record(context, base_name, name,
+				   value_frag, value_offset);
+		context->path->level = olv;
+
+		/*
+		 * ignore errors for CREATE op
+		 * TODO: support BOOTSTRAP WRITE where optional
+		 * resources are ignored
+		 */
+		if (ret < 0 && (context->operation != LWM2M_OP_CREATE ||
+				ret != -ENOTSUP)) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
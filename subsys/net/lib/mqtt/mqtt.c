@@ -11,7 +11,9 @@
 #include <net/net_pkt.h>
 #include <net/net_app.h>
 #include <net/buf.h>
+#include <misc/byteorder.h>
 #include <errno.h>
+#include <string.h>
 
 #define MSG_SIZE	CONFIG_MQTT_MSG_MAX_SIZE
 #define MQTT_BUF_CTR	(1 + CONFIG_MQTT_ADDITIONAL_BUFFER_CTR)
@@ -22,12 +24,439 @@
  */
 NET_BUF_POOL_DEFINE(mqtt_msg_pool, MQTT_BUF_CTR, MSG_SIZE, 0, NULL);
 
-#define MQTT_PUBLISHER_MIN_MSG_SIZE	2
-
 #if defined(CONFIG_MQTT_LIB_TLS)
 #define TLS_HS_DEFAULT_TIMEOUT 3000
 #endif
 
+#if defined(CONFIG_MQTT_INFLIGHT_WINDOW) && CONFIG_MQTT_INFLIGHT_WINDOW > 0
+#define INFLIGHT_WINDOW	CONFIG_MQTT_INFLIGHT_WINDOW
+#endif
+
+#if defined(CONFIG_MQTT_STATS)
+#define MQTT_STATS_ADD(ctx, field, val)	((ctx)->stats.field += (val))
+#else
+#define MQTT_STATS_ADD(ctx, field, val)	((void)(val))
+#endif
+
+#if defined(INFLIGHT_WINDOW)
+static
+struct mqtt_inflight *inflight_find(struct mqtt_ctx *ctx, u16_t pkt_id)
+{
+	int i;
+
+	for (i = 0; i < INFLIGHT_WINDOW; i++) {
+		if (ctx->inflight[i].qos != MQTT_QoS0 &&
+		    ctx->inflight[i].pkt_id == pkt_id) {
+			return &ctx->inflight[i];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Takes an entry of the in-flight window for a QoS1 or QoS2 MQTT PUBLISH msg
+ *
+ * @param [in] ctx MQTT context
+ * @param [in] msg MQTT PUBLISH msg about to be sent
+ * @param [out] entry New entry, NULL if the msg already had one
+ *
+ * @retval 0 on success
+ * @retval -EAGAIN if the window is full
+ */
+static
+int inflight_add(struct mqtt_ctx *ctx, struct mqtt_publish_msg *msg,
+		 struct mqtt_inflight **entry)
+{
+	struct mqtt_inflight *inflight;
+	unsigned int key;
+	int rc = 0;
+	int i;
+
+	*entry = NULL;
+
+	if (msg->qos == MQTT_QoS0) {
+		return 0;
+	}
+
+	key = irq_lock();
+
+	inflight = inflight_find(ctx, msg->pkt_id);
+	if (inflight) {
+		/* Sent again, the ack cannot be matched to one of the
+		 * transmissions so it does not give a RTT sample
+		 */
+		inflight->dup = 1;
+		goto exit_add;
+	}
+
+	if (ctx->inflight_count == INFLIGHT_WINDOW) {
+		rc = -EAGAIN;
+		goto exit_add;
+	}
+
+	for (i = 0; i < INFLIGHT_WINDOW; i++) {
+		if (ctx->inflight[i].qos == MQTT_QoS0) {
+			break;
+		}
+	}
+
+	inflight = &ctx->inflight[i];
+	inflight->pkt_id = msg->pkt_id;
+	inflight->qos = msg->qos;
+	inflight->received = 0;
+	inflight->dup = 0;
+	inflight->queued = 0;
+	inflight->sent = k_uptime_get_32();
+	ctx->inflight_count++;
+
+	*entry = inflight;
+
+exit_add:
+	irq_unlock(key);
+
+	return rc;
+}
+
+static
+void inflight_release(struct mqtt_ctx *ctx, struct mqtt_inflight *inflight)
+{
+	unsigned int key;
+
+	key = irq_lock();
+	inflight->qos = MQTT_QoS0;
+	ctx->inflight_count--;
+	irq_unlock(key);
+}
+
+/**
+ * Releases the entry of the in-flight window acknowledged by a MQTT
+ * PUBACK or PUBCOMP msg
+ *
+ * @param ctx MQTT context
+ * @param pkt_id Packet Identifier of the received msg
+ * @param type MQTT_PUBACK, MQTT_PUBREC or MQTT_PUBCOMP
+ */
+static
+void inflight_ack(struct mqtt_ctx *ctx, u16_t pkt_id, enum mqtt_packet type)
+{
+	struct mqtt_inflight *inflight;
+	unsigned int key;
+	bool sample = false;
+	u32_t rtt = 0;
+
+	key = irq_lock();
+
+	inflight = inflight_find(ctx, pkt_id);
+	if (!inflight) {
+		goto exit_ack;
+	}
+
+	if (type == MQTT_PUBREC) {
+		if (inflight->qos == MQTT_QoS2) {
+			inflight->received = 1;
+		}
+
+		goto exit_ack;
+	}
+
+	/* QoS1 msgs end with a MQTT PUBACK msg, QoS2 ones with a PUBCOMP */
+	if ((type == MQTT_PUBACK) != (inflight->qos == MQTT_QoS1)) {
+		goto exit_ack;
+	}
+
+	if (!inflight->dup && !inflight->queued) {
+		rtt = k_uptime_get_32() - inflight->sent;
+		sample = true;
+	}
+
+	inflight->qos = MQTT_QoS0;
+	ctx->inflight_count--;
+
+exit_ack:
+	irq_unlock(key);
+
+#if defined(CONFIG_MQTT_STATS)
+	if (sample) {
+		if (ctx->stats.rtt_count == 0 || rtt < ctx->stats.rtt_min) {
+			ctx->stats.rtt_min = rtt;
+		}
+
+		if (rtt > ctx->stats.rtt_max) {
+			ctx->stats.rtt_max = rtt;
+		}
+
+		ctx->stats.rtt_sum += rtt;
+		ctx->stats.rtt_count++;
+	}
+#else
+	ARG_UNUSED(sample);
+	ARG_UNUSED(rtt);
+#endif
+}
+
+#if defined(CONFIG_MQTT_TX_BATCH)
+/**
+ * Updates the entries of the in-flight window of the queued MQTT PUBLISH
+ * msgs once the batch is passed to the network
+ *
+ * @param ctx MQTT context
+ * @param rc Result of the send, the entries are released on error
+ */
+static
+void inflight_batch_sent(struct mqtt_ctx *ctx, int rc)
+{
+	u32_t now = k_uptime_get_32();
+	unsigned int key;
+	int i;
+
+	key = irq_lock();
+
+	for (i = 0; i < INFLIGHT_WINDOW; i++) {
+		if (ctx->inflight[i].qos == MQTT_QoS0 ||
+		    !ctx->inflight[i].queued) {
+			continue;
+		}
+
+		ctx->inflight[i].queued = 0;
+
+		if (rc < 0) {
+			ctx->inflight[i].qos = MQTT_QoS0;
+			ctx->inflight_count--;
+		} else {
+			ctx->inflight[i].sent = now;
+		}
+	}
+
+	irq_unlock(key);
+}
+#endif
+#endif
+
+#if defined(CONFIG_MQTT_TX_BATCH)
+/**
+ * Sends the queued MQTT PUBLISH msgs in one packet, must be called with
+ * the batch lock held
+ *
+ * The msgs are dropped if they cannot be sent, as they would be if they
+ * were sent on their own, and their entries of the in-flight window are
+ * released.
+ *
+ * @param ctx MQTT context
+ *
+ * @retval 0 on success
+ * @retval -ENOMEM
+ * @retval -EIO
+ */
+static
+int mqtt_tx_batch_send(struct mqtt_ctx *ctx)
+{
+	struct net_pkt *tx;
+	u16_t msgs = ctx->tx_batch_msgs;
+	u16_t len = ctx->tx_batch_len;
+	int rc;
+
+	if (len == 0) {
+		return 0;
+	}
+
+	ctx->tx_batch_len = 0;
+	ctx->tx_batch_msgs = 0;
+
+	tx = net_app_get_net_pkt(&ctx->net_app_ctx,
+				AF_UNSPEC, ctx->net_timeout);
+	if (tx == NULL) {
+		rc = -ENOMEM;
+		goto exit_send;
+	}
+
+	rc = net_pkt_append_all(tx, len, ctx->tx_batch, ctx->net_timeout);
+	if (rc != true) {
+		net_pkt_unref(tx);
+		rc = -ENOMEM;
+		goto exit_send;
+	}
+
+	rc = net_app_send_pkt(&ctx->net_app_ctx,
+			tx, NULL, 0, ctx->net_timeout, NULL);
+	if (rc < 0) {
+		net_pkt_unref(tx);
+		goto exit_send;
+	}
+
+	MQTT_STATS_ADD(ctx, tx_msgs, msgs);
+	MQTT_STATS_ADD(ctx, tx_bytes, len);
+	MQTT_STATS_ADD(ctx, tx_sends, 1);
+
+#if defined(INFLIGHT_WINDOW)
+	inflight_batch_sent(ctx, rc);
+#endif
+
+	return rc;
+
+exit_send:
+	MQTT_STATS_ADD(ctx, tx_errors, msgs);
+
+#if defined(INFLIGHT_WINDOW)
+	inflight_batch_sent(ctx, rc);
+#endif
+
+	return rc;
+}
+
+static
+void mqtt_tx_batch_timeout(struct k_work *work)
+{
+	struct mqtt_ctx *ctx = CONTAINER_OF(work, struct mqtt_ctx,
+					    tx_batch_work);
+
+	mqtt_tx_flush(ctx);
+}
+
+/**
+ * Queues a MQTT PUBLISH msg to be sent with the next ones
+ *
+ * @param ctx MQTT context
+ * @param msg MQTT PUBLISH msg
+ * @param inflight Entry of the in-flight window taken by msg, or NULL
+ *
+ * @retval 0 on success
+ * @retval -EMSGSIZE if the msg does not fit in the batch buffer
+ * @retval -EINVAL
+ */
+static
+int mqtt_tx_batch_publish(struct mqtt_ctx *ctx, struct mqtt_publish_msg *msg,
+			  struct mqtt_inflight *inflight)
+{
+	unsigned int key;
+	u16_t len;
+	int rc;
+
+	k_mutex_lock(&ctx->tx_batch_lock, K_FOREVER);
+
+	rc = mqtt_pack_publish(ctx->tx_batch + ctx->tx_batch_len, &len,
+			       sizeof(ctx->tx_batch) - ctx->tx_batch_len, msg);
+	if (rc == -ENOMEM && ctx->tx_batch_len > 0) {
+		/* No room left, send the queued msgs and start a new batch.
+		 * As in mqtt_send(), the queued msgs are dropped on error,
+		 * their in-flight entries are released and tx_errors counts
+		 * them, this one is still queued
+		 */
+		k_delayed_work_cancel(&ctx->tx_batch_work);
+		(void)mqtt_tx_batch_send(ctx);
+
+		rc = mqtt_pack_publish(ctx->tx_batch, &len,
+				       sizeof(ctx->tx_batch), msg);
+	}
+
+	if (rc == -ENOMEM) {
+		rc = -EMSGSIZE;
+		goto exit_publish;
+	} else if (rc != 0) {
+		rc = -EINVAL;
+		goto exit_publish;
+	}
+
+	if (ctx->tx_batch_len == 0) {
+		k_delayed_work_submit(&ctx->tx_batch_work,
+				      K_MSEC(CONFIG_MQTT_TX_BATCH_DELAY_MS));
+	}
+
+	ctx->tx_batch_len += len;
+	ctx->tx_batch_msgs++;
+
+	/* the RTT is measured from the time the batch is sent */
+	if (inflight) {
+		key = irq_lock();
+		inflight->queued = 1;
+		irq_unlock(key);
+	}
+
+exit_publish:
+	k_mutex_unlock(&ctx->tx_batch_lock);
+
+	return rc;
+}
+#endif
+
+int mqtt_tx_flush(struct mqtt_ctx *ctx)
+{
+#if defined(CONFIG_MQTT_TX_BATCH)
+	int rc;
+
+	k_mutex_lock(&ctx->tx_batch_lock, K_FOREVER);
+	k_delayed_work_cancel(&ctx->tx_batch_work);
+	rc = mqtt_tx_batch_send(ctx);
+	k_mutex_unlock(&ctx->tx_batch_lock);
+
+	return rc;
+#else
+	ARG_UNUSED(ctx);
+
+	return 0;
+#endif
+}
+
+/**
+ * Sends a MQTT msg, after the MQTT PUBLISH msgs queued before it
+ *
+ * @param ctx MQTT context
+ * @param tx TX packet, released by the network on success
+ *
+ * @retval 0 on success
+ * @retval -EIO on network error
+ */
+static
+int mqtt_send(struct mqtt_ctx *ctx, struct net_pkt *tx)
+{
+	u16_t len = net_pkt_get_len(tx);
+	int rc;
+
+	/* The queued msgs are dropped on error, their in-flight entries are
+	 * released and tx_errors counts them, this one is still sent
+	 */
+	(void)mqtt_tx_flush(ctx);
+
+	rc = net_app_send_pkt(&ctx->net_app_ctx,
+			tx, NULL, 0, ctx->net_timeout, NULL);
+	if (rc < 0) {
+		MQTT_STATS_ADD(ctx, tx_errors, 1);
+		return rc;
+	}
+
+	MQTT_STATS_ADD(ctx, tx_msgs, 1);
+	MQTT_STATS_ADD(ctx, tx_bytes, len);
+	MQTT_STATS_ADD(ctx, tx_sends, 1);
+
+	return rc;
+}
+
+/**
+ * Forgets the msgs sent on the previous connection
+ *
+ * @param ctx MQTT context
+ */
+static
+void mqtt_tx_reset(struct mqtt_ctx *ctx)
+{
+#if defined(INFLIGHT_WINDOW)
+	unsigned int key;
+
+	key = irq_lock();
+	memset(ctx->inflight, 0, sizeof(ctx->inflight));
+	ctx->inflight_count = 0;
+	irq_unlock(key);
+#endif
+
+#if defined(CONFIG_MQTT_TX_BATCH)
+	k_mutex_lock(&ctx->tx_batch_lock, K_FOREVER);
+	k_delayed_work_cancel(&ctx->tx_batch_work);
+	ctx->tx_batch_len = 0;
+	ctx->tx_batch_msgs = 0;
+	k_mutex_unlock(&ctx->tx_batch_lock);
+#endif
+}
+
 int mqtt_tx_connect(struct mqtt_ctx *ctx, struct mqtt_connect_msg *msg)
 {
 	struct net_buf *data = NULL;
@@ -57,8 +486,7 @@ int mqtt_tx_connect(struct mqtt_ctx *ctx, struct mqtt_connect_msg *msg)
 	net_pkt_frag_add(tx, data);
 	data = NULL;
 
-	rc = net_app_send_pkt(&ctx->net_app_ctx,
-			tx, NULL, 0, ctx->net_timeout, NULL);
+	rc = mqtt_send(ctx, tx);
 	if (rc < 0) {
 		net_pkt_unref(tx);
 	}
@@ -98,8 +526,7 @@ int mqtt_tx_disconnect(struct mqtt_ctx *ctx)
 		goto exit_disconnect;
 	}
 
-	rc = net_app_send_pkt(&ctx->net_app_ctx,
-			tx, NULL, 0, ctx->net_timeout, NULL);
+	rc = mqtt_send(ctx, tx);
 	if (rc < 0) {
 		goto exit_disconnect;
 	}
@@ -173,8 +600,7 @@ int mqtt_tx_pub_msgs(struct mqtt_ctx *ctx, u16_t id,
 		goto exit_send;
 	}
 
-	rc = net_app_send_pkt(&ctx->net_app_ctx,
-			tx, NULL, 0, ctx->net_timeout, NULL);
+	rc = mqtt_send(ctx, tx);
 	if (rc < 0) {
 		goto exit_send;
 	}
@@ -211,13 +637,29 @@ int mqtt_tx_pubrel(struct mqtt_ctx *ctx, u16_t id)
 
 int mqtt_tx_publish(struct mqtt_ctx *ctx, struct mqtt_publish_msg *msg)
 {
+	struct mqtt_inflight *inflight = NULL;
 	struct net_buf *data = NULL;
 	struct net_pkt *tx = NULL;
 	int rc;
 
+#if defined(INFLIGHT_WINDOW)
+	rc = inflight_add(ctx, msg, &inflight);
+	if (rc < 0) {
+		return rc;
+	}
+#endif
+
+#if defined(CONFIG_MQTT_TX_BATCH)
+	rc = mqtt_tx_batch_publish(ctx, msg, inflight);
+	if (rc != -EMSGSIZE) {
+		goto exit_inflight;
+	}
+#endif
+
 	data = net_buf_alloc(&mqtt_msg_pool, ctx->net_timeout);
 	if (data == NULL) {
-		return -ENOMEM;
+		rc = -ENOMEM;
+		goto exit_inflight;
 	}
 
 	rc = mqtt_pack_publish(data->data, &data->len, data->size, msg);
@@ -236,19 +678,27 @@ int mqtt_tx_publish(struct mqtt_ctx *ctx, struct mqtt_publish_msg *msg)
 	net_pkt_frag_add(tx, data);
 	data = NULL;
 
-	rc = net_app_send_pkt(&ctx->net_app_ctx,
-			tx, NULL, 0, ctx->net_timeout, NULL);
+	rc = mqtt_send(ctx, tx);
 	if (rc < 0) {
 		net_pkt_unref(tx);
 	}
 
 	tx = NULL;
 
-	return rc;
+	goto exit_inflight;
 
 exit_publish:
 	net_pkt_frag_unref(data);
 
+exit_inflight:
+#if defined(INFLIGHT_WINDOW)
+	if (rc < 0 && inflight) {
+		inflight_release(ctx, inflight);
+	}
+#else
+	ARG_UNUSED(inflight);
+#endif
+
 	return rc;
 }
 
@@ -276,8 +726,7 @@ int mqtt_tx_pingreq(struct mqtt_ctx *ctx)
 		goto exit_pingreq;
 	}
 
-	rc = net_app_send_pkt(&ctx->net_app_ctx,
-			tx, NULL, 0, ctx->net_timeout, NULL);
+	rc = mqtt_send(ctx, tx);
 	if (rc < 0) {
 		goto exit_pingreq;
 	}
@@ -321,8 +770,7 @@ int mqtt_tx_subscribe(struct mqtt_ctx *ctx, u16_t pkt_id, u8_t items,
 	net_pkt_frag_add(tx, data);
 	data = NULL;
 
-	rc = net_app_send_pkt(&ctx->net_app_ctx,
-			tx, NULL, 0, ctx->net_timeout, NULL);
+	rc = mqtt_send(ctx, tx);
 	if (rc < 0) {
 		net_pkt_unref(tx);
 	}
@@ -366,8 +814,7 @@ int mqtt_tx_unsubscribe(struct mqtt_ctx *ctx, u16_t pkt_id, u8_t items,
 	net_pkt_frag_add(tx, data);
 	data = NULL;
 
-	rc = net_app_send_pkt(&ctx->net_app_ctx,
-			tx, NULL, 0, ctx->net_timeout, NULL);
+	rc = mqtt_send(ctx, tx);
 	if (rc < 0) {
 		net_pkt_unref(tx);
 	}
@@ -496,6 +943,9 @@ int mqtt_rx_pub_msgs(struct mqtt_ctx *ctx, struct net_buf *rx,
 			rc = -EINVAL;
 		}
 	} else {
+#if defined(INFLIGHT_WINDOW)
+		inflight_ack(ctx, pkt_id, type);
+#endif
 		rc = ctx->publish_tx(ctx, pkt_id, type);
 	}
 
@@ -609,27 +1059,22 @@ int mqtt_rx_unsuback(struct mqtt_ctx *ctx, struct net_buf *rx)
 	return 0;
 }
 
-int mqtt_rx_publish(struct mqtt_ctx *ctx, struct net_buf *rx)
+static
+int mqtt_rx_publish_msg(struct mqtt_ctx *ctx, struct mqtt_publish_msg *msg)
 {
-	struct mqtt_publish_msg msg;
 	int rc;
 
-	rc = mqtt_unpack_publish(rx->data, rx->len, &msg);
-	if (rc != 0) {
-		return -EINVAL;
-	}
-
-	rc = ctx->publish_rx(ctx, &msg, msg.pkt_id, MQTT_PUBLISH);
+	rc = ctx->publish_rx(ctx, msg, msg->pkt_id, MQTT_PUBLISH);
 	if (rc != 0) {
 		return -EINVAL;
 	}
 
-	switch (msg.qos) {
+	switch (msg->qos) {
 	case MQTT_QoS2:
-		rc = mqtt_tx_pubrec(ctx, msg.pkt_id);
+		rc = mqtt_tx_pubrec(ctx, msg->pkt_id);
 		break;
 	case MQTT_QoS1:
-		rc = mqtt_tx_puback(ctx, msg.pkt_id);
+		rc = mqtt_tx_puback(ctx, msg->pkt_id);
 		break;
 	case MQTT_QoS0:
 		break;
@@ -640,85 +1085,100 @@ int mqtt_rx_publish(struct mqtt_ctx *ctx, struct net_buf *rx)
 	return rc;
 }
 
+int mqtt_rx_publish(struct mqtt_ctx *ctx, struct net_buf *rx)
+{
+	struct mqtt_publish_msg msg;
+	int rc;
+
+	rc = mqtt_unpack_publish(rx->data, rx->len, &msg);
+	if (rc != 0) {
+		return -EINVAL;
+	}
+
+	return mqtt_rx_publish_msg(ctx, &msg);
+}
+
+/* States of the incremental msg decoder */
+#define MQTT_RX_TYPE		0
+#define MQTT_RX_LENGTH		1
+#define MQTT_RX_BODY		2
+#define MQTT_RX_TOPIC_LEN	3
+#define MQTT_RX_PUBLISH_HDR	4
+#define MQTT_RX_PAYLOAD		5
+#define MQTT_RX_SKIP		6
+#define MQTT_RX_ABORT		7
+
+static
+void mqtt_rx_reset(struct mqtt_ctx *ctx)
+{
+	if (ctx->rx_buf) {
+		net_buf_unref(ctx->rx_buf);
+		ctx->rx_buf = NULL;
+	}
+
+	ctx->rx_state = MQTT_RX_TYPE;
+}
+
 /**
- * Linearizes an IP fragmented packet
- *
- * @param [in] ctx MQTT context structure
- * @param [in] rx RX IP stack packet
- * @param [in] min_size Min message size allowed. This allows us to exit if the
- * rx packet is shorter than the expected msg size
+ * Drops the rest of the MQTT message being decoded
  *
- * @retval Data buffer
- * @retval NULL on error
+ * @param ctx MQTT context
+ * @param malformed Execute the 'ctx->malformed' callback
  */
 static
-struct net_buf *mqtt_linearize_packet(struct mqtt_ctx *ctx, struct net_pkt *rx,
-				      u16_t min_size)
+void mqtt_rx_drop(struct mqtt_ctx *ctx, bool malformed)
 {
-	struct net_buf *data = NULL;
-	u16_t data_len;
-	u16_t offset;
-	int rc;
-
-	/* CONFIG_MQTT_MSG_MAX_SIZE is defined via Kconfig. So here it's
-	 * determined if the input packet could fit our data buffer or if
-	 * it has the expected size.
-	 */
-	data_len = net_pkt_appdatalen(rx);
-	if (data_len < min_size || data_len > CONFIG_MQTT_MSG_MAX_SIZE) {
-		return NULL;
+	if (malformed && ctx->malformed) {
+		ctx->malformed(ctx, ctx->rx_type);
 	}
 
-	data = net_buf_alloc(&mqtt_msg_pool, ctx->net_timeout);
-	if (data == NULL) {
-		return NULL;
-	}
+	mqtt_rx_reset(ctx);
 
-	offset = net_pkt_get_len(rx) - data_len;
-	rc = net_frag_linear_copy(data, rx->frags, offset, data_len);
-	if (rc != 0) {
-		goto exit_error;
+	if (ctx->rx_remaining > 0) {
+		ctx->rx_state = MQTT_RX_SKIP;
 	}
+}
 
-	return data;
+/**
+ * Stops decoding the stream after an unrecoverable error
+ *
+ * @details The rest of the stream is discarded, and the connection is
+ * disconnected. Decoding starts again with the next mqtt_connect() call.
+ *
+ * @param ctx MQTT context
+ */
+static
+void mqtt_rx_abort(struct mqtt_ctx *ctx)
+{
+	if (ctx->malformed) {
+		ctx->malformed(ctx, ctx->rx_type);
+	}
 
-exit_error:
-	net_pkt_frag_unref(data);
+	mqtt_rx_reset(ctx);
+	ctx->rx_state = MQTT_RX_ABORT;
 
-	return NULL;
+	if (ctx->connected) {
+		(void)mqtt_tx_disconnect(ctx);
+		ctx->connected = 0;
+	}
 }
 
 /**
- * Calls the appropriate rx routine for the MQTT message contained in rx
+ * Calls the appropriate rx routine for the complete MQTT message contained
+ * in ctx->rx_buf
  *
  * @details On error, this routine will execute the 'ctx->malformed' callback
  * (if defined)
  *
  * @param ctx MQTT context
- * @param rx RX packet
- *
- * @retval 0 on success
- * @retval -EINVAL if an unknown message is received
- * @retval -ENOMEM if no data buffer is available
- * @retval mqtt_rx_connack, mqtt_rx_pingresp, mqtt_rx_puback, mqtt_rx_pubcomp,
- *         mqtt_rx_publish, mqtt_rx_pubrec, mqtt_rx_pubrel and mqtt_rx_suback
- *         return codes
  */
 static
-int mqtt_parser(struct mqtt_ctx *ctx, struct net_pkt *rx)
+void mqtt_rx_dispatch(struct mqtt_ctx *ctx)
 {
-	u16_t pkt_type = MQTT_INVALID;
-	struct net_buf *data = NULL;
-	int rc = -EINVAL;
-
-	data = mqtt_linearize_packet(ctx, rx, MQTT_PUBLISHER_MIN_MSG_SIZE);
-	if (!data) {
-		return -ENOMEM;
-	}
-
-	pkt_type = MQTT_PACKET_TYPE(data->data[0]);
+	struct net_buf *data = ctx->rx_buf;
+	int rc;
 
-	switch (pkt_type) {
+	switch (ctx->rx_type) {
 	case MQTT_CONNACK:
 		if (!ctx->connected) {
 			rc = mqtt_rx_connack(ctx, data, ctx->clean_session);
@@ -753,10 +1213,326 @@ int mqtt_parser(struct mqtt_ctx *ctx, struct net_pkt *rx)
 	}
 
 	if (rc != 0 && ctx->malformed) {
-		ctx->malformed(ctx, pkt_type);
+		ctx->malformed(ctx, ctx->rx_type);
 	}
 
-	net_pkt_frag_unref(data);
+	mqtt_rx_reset(ctx);
+}
+
+/**
+ * Decides how to decode the MQTT message once its fixed header is known
+ *
+ * @details Messages are copied to ctx->rx_buf, except the payload of the
+ * MQTT PUBLISH msg when the 'ctx->publish_rx_payload' callback is set.
+ * If no data buffer is available, the whole message is dropped.
+ *
+ * @param ctx MQTT context
+ *
+ * @retval 0 on success
+ * @retval -ENOMEM if no data buffer is available
+ */
+static
+int mqtt_rx_start(struct mqtt_ctx *ctx)
+{
+	u8_t hdr_len = ctx->rx_rlen_shift / 7 + 1;
+	u8_t shift;
+	u8_t byte;
+
+	MQTT_STATS_ADD(ctx, rx_msgs, 1);
+
+	ctx->rx_buf = net_buf_alloc(&mqtt_msg_pool, ctx->net_timeout);
+	if (!ctx->rx_buf) {
+		mqtt_rx_drop(ctx, false);
+		return -ENOMEM;
+	}
+
+	/* The Remaining Length is written back with the same number of
+	 * bytes, so the fixed header is the one that was received.
+	 */
+	net_buf_add_u8(ctx->rx_buf, ctx->rx_hdr_byte);
+	for (shift = 0; shift < ctx->rx_rlen_shift; shift += 7) {
+		byte = (ctx->rx_remaining >> shift) & 0x7f;
+		if (shift + 7 < ctx->rx_rlen_shift) {
+			byte |= 0x80;
+		}
+
+		net_buf_add_u8(ctx->rx_buf, byte);
+	}
+
+	if (ctx->rx_type == MQTT_PUBLISH && ctx->publish_rx_payload) {
+		if (ctx->rx_remaining < sizeof(u16_t)) {
+			mqtt_rx_drop(ctx, true);
+			return 0;
+		}
+
+		ctx->rx_hdr_len = hdr_len + sizeof(u16_t);
+		ctx->rx_state = MQTT_RX_TOPIC_LEN;
+		return 0;
+	}
+
+	if (hdr_len + ctx->rx_remaining > MSG_SIZE) {
+		mqtt_rx_drop(ctx, true);
+		return 0;
+	}
+
+	ctx->rx_hdr_len = hdr_len + ctx->rx_remaining;
+	ctx->rx_state = MQTT_RX_BODY;
+
+	return 0;
+}
+
+/**
+ * Delivers the payload of the MQTT PUBLISH msg being decoded
+ *
+ * @param ctx MQTT context
+ * @param data Payload bytes
+ * @param len Number of bytes
+ */
+static
+void mqtt_rx_payload(struct mqtt_ctx *ctx, u8_t *data, u16_t len)
+{
+	int rc;
+
+	if (len > 0) {
+		rc = ctx->publish_rx_payload(ctx, &ctx->rx_publish,
+					     ctx->rx_offset, data, len,
+					     ctx->rx_total);
+		ctx->rx_offset += len;
+		ctx->rx_remaining -= len;
+
+		if (rc != 0) {
+			mqtt_rx_drop(ctx, false);
+			return;
+		}
+	}
+
+	if (ctx->rx_remaining > 0) {
+		return;
+	}
+
+	rc = mqtt_rx_publish_msg(ctx, &ctx->rx_publish);
+	if (rc != 0 && ctx->malformed) {
+		ctx->malformed(ctx, MQTT_PUBLISH);
+	}
+
+	mqtt_rx_reset(ctx);
+}
+
+/**
+ * Called when the bytes of the MQTT message expected in ctx->rx_buf have
+ * been received
+ *
+ * @param ctx MQTT context
+ */
+static
+void mqtt_rx_header(struct mqtt_ctx *ctx)
+{
+	struct mqtt_publish_msg *msg = &ctx->rx_publish;
+	u8_t *data = ctx->rx_buf->data;
+	u16_t offset = ctx->rx_rlen_shift / 7 + 1;
+	u16_t len;
+
+	switch (ctx->rx_state) {
+	case MQTT_RX_BODY:
+		mqtt_rx_dispatch(ctx);
+		return;
+	case MQTT_RX_TOPIC_LEN:
+		msg->dup = (data[0] & 0x08) >> 3;
+		msg->qos = (data[0] & 0x06) >> 1;
+		msg->retain = data[0] & 0x01;
+		msg->topic_len = sys_get_be16(data + offset);
+
+		len = msg->topic_len;
+		if (msg->qos == MQTT_QoS1 || msg->qos == MQTT_QoS2) {
+			len += sizeof(u16_t);
+		} else if (msg->qos != MQTT_QoS0) {
+			mqtt_rx_drop(ctx, true);
+			return;
+		}
+
+		if (len > ctx->rx_remaining ||
+		    ctx->rx_hdr_len + len > MSG_SIZE) {
+			mqtt_rx_drop(ctx, true);
+			return;
+		}
+
+		ctx->rx_hdr_len += len;
+		ctx->rx_state = MQTT_RX_PUBLISH_HDR;
+
+		if (len > 0) {
+			return;
+		}
+
+		/* empty topic and QoS 0, the header is complete */
+		/* FALLTHROUGH */
+	case MQTT_RX_PUBLISH_HDR:
+		offset += sizeof(u16_t);
+		msg->topic = (char *)data + offset;
+		offset += msg->topic_len;
+
+		if (msg->qos != MQTT_QoS0) {
+			msg->pkt_id = sys_get_be16(data + offset);
+		} else {
+			msg->pkt_id = 0;
+		}
+
+		msg->msg = NULL;
+		msg->msg_len = 0;
+
+		ctx->rx_offset = 0;
+		ctx->rx_total = ctx->rx_remaining;
+		ctx->rx_state = MQTT_RX_PAYLOAD;
+
+		if (ctx->rx_remaining == 0) {
+			mqtt_rx_payload(ctx, NULL, 0);
+		}
+		break;
+	}
+}
+
+/**
+ * Decodes the MQTT messages contained in a contiguous part of the stream
+ *
+ * @details Messages may start and end anywhere in the stream, the state
+ * is kept in the context between calls.
+ *
+ * @param ctx MQTT context
+ * @param data Received bytes
+ * @param len Number of bytes
+ *
+ * @retval 0 on success
+ * @retval -ENOMEM if a msg was dropped, no data buffer was available
+ * @retval -EINVAL if the stream cannot be decoded anymore
+ */
+static
+int mqtt_rx_feed(struct mqtt_ctx *ctx, u8_t *data, u16_t len)
+{
+	u16_t count;
+	u8_t byte;
+	int rc = 0;
+
+	while (len > 0) {
+		switch (ctx->rx_state) {
+		case MQTT_RX_TYPE:
+			ctx->rx_hdr_byte = *data;
+			ctx->rx_type = MQTT_PACKET_TYPE(*data);
+			ctx->rx_remaining = 0;
+			ctx->rx_rlen_shift = 0;
+			data++;
+			len--;
+			ctx->rx_state = MQTT_RX_LENGTH;
+			break;
+		case MQTT_RX_LENGTH:
+			/* See MQTT 2.2.3 Remaining Length, 4 bytes at most */
+			if (ctx->rx_rlen_shift > 21) {
+				mqtt_rx_abort(ctx);
+				return -EINVAL;
+			}
+
+			byte = *data++;
+			len--;
+			ctx->rx_remaining |= (u32_t)(byte & 0x7f) <<
+					     ctx->rx_rlen_shift;
+			ctx->rx_rlen_shift += 7;
+
+			if (byte & 0x80) {
+				break;
+			}
+
+			/* the rest of the msg is skipped if no buffer is
+			 * available, keep decoding the following msgs
+			 */
+			if (mqtt_rx_start(ctx) != 0) {
+				rc = -ENOMEM;
+				break;
+			}
+
+			if (ctx->rx_state == MQTT_RX_BODY &&
+			    ctx->rx_remaining == 0) {
+				mqtt_rx_header(ctx);
+			}
+			break;
+		case MQTT_RX_BODY:
+		case MQTT_RX_TOPIC_LEN:
+		case MQTT_RX_PUBLISH_HDR:
+			count = min(len, ctx->rx_hdr_len - ctx->rx_buf->len);
+			net_buf_add_mem(ctx->rx_buf, data, count);
+			ctx->rx_remaining -= count;
+			data += count;
+			len -= count;
+
+			if (ctx->rx_buf->len == ctx->rx_hdr_len) {
+				mqtt_rx_header(ctx);
+			}
+			break;
+		case MQTT_RX_PAYLOAD:
+			count = min(len, ctx->rx_remaining);
+			mqtt_rx_payload(ctx, data, count);
+			data += count;
+			len -= count;
+			break;
+		case MQTT_RX_SKIP:
+			count = min(len, ctx->rx_remaining);
+			ctx->rx_remaining -= count;
+			data += count;
+			len -= count;
+
+			if (ctx->rx_remaining == 0) {
+				ctx->rx_state = MQTT_RX_TYPE;
+			}
+			break;
+		case MQTT_RX_ABORT:
+			return -EINVAL;
+		}
+	}
+
+	return rc;
+}
+
+/**
+ * Decodes the MQTT messages contained in rx
+ *
+ * @details The fragments of rx are decoded in place, and MQTT messages may
+ * span several packets. The payload of the MQTT PUBLISH msg is not copied
+ * if the 'ctx->publish_rx_payload' callback is set.
+ *
+ * @param ctx MQTT context
+ * @param rx RX packet
+ *
+ * @retval 0 on success
+ * @retval -ENOMEM if a msg was dropped, no data buffer was available
+ * @retval -EINVAL if the stream cannot be decoded anymore
+ */
+static
+int mqtt_parser(struct mqtt_ctx *ctx, struct net_pkt *rx)
+{
+	struct net_buf *frag;
+	u16_t offset;
+	int rc = 0;
+	int ret;
+
+	offset = net_pkt_get_len(rx) - net_pkt_appdatalen(rx);
+
+	MQTT_STATS_ADD(ctx, rx_bytes, net_pkt_appdatalen(rx));
+
+	for (frag = rx->frags; frag; frag = frag->frags) {
+		if (offset >= frag->len) {
+			offset -= frag->len;
+			continue;
+		}
+
+		ret = mqtt_rx_feed(ctx, frag->data + offset,
+				   frag->len - offset);
+		if (ret == -EINVAL) {
+			return ret;
+		}
+
+		if (ret != 0) {
+			rc = ret;
+		}
+
+		offset = 0;
+	}
 
 	return rc;
 }
@@ -809,6 +1585,15 @@ int mqtt_connect(struct mqtt_ctx *ctx)
 		return -EFAULT;
 	}
 
+	/* a new connection starts a new stream of messages */
+	mqtt_rx_reset(ctx);
+	mqtt_tx_reset(ctx);
+
+#if defined(CONFIG_MQTT_STATS)
+	memset(&ctx->stats, 0, sizeof(ctx->stats));
+	ctx->stats.connected_at = k_uptime_get();
+#endif
+
 	rc = net_app_init_tcp_client(&ctx->net_app_ctx,
 			NULL,
 			NULL,
@@ -877,6 +1662,20 @@ int mqtt_init(struct mqtt_ctx *ctx, enum mqtt_app app_type)
 
 	ctx->app_type = app_type;
 	ctx->rcv = mqtt_parser;
+	ctx->rx_buf = NULL;
+	ctx->rx_state = MQTT_RX_TYPE;
+
+#if defined(INFLIGHT_WINDOW)
+	memset(ctx->inflight, 0, sizeof(ctx->inflight));
+	ctx->inflight_count = 0;
+#endif
+
+#if defined(CONFIG_MQTT_TX_BATCH)
+	k_mutex_init(&ctx->tx_batch_lock);
+	k_delayed_work_init(&ctx->tx_batch_work, mqtt_tx_batch_timeout);
+	ctx->tx_batch_len = 0;
+	ctx->tx_batch_msgs = 0;
+#endif
 
 #if defined(CONFIG_MQTT_LIB_TLS)
 	if (ctx->tls_hs_timeout == 0) {
@@ -900,5 +1699,8 @@ int mqtt_close(struct mqtt_ctx *ctx)
 		net_app_release(&ctx->net_app_ctx);
 	}
 
+	mqtt_rx_reset(ctx);
+	mqtt_tx_reset(ctx);
+
 	return 0;
 }
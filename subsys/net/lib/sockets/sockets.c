@@ -16,11 +16,15 @@
 #include <kernel.h>
 #include <net/net_context.h>
 #include <net/net_pkt.h>
+#include <net/net_stats.h>
 #include <net/socket.h>
 
 #define SOCK_EOF 1
 #define SOCK_NONBLOCK 2
 
+/* Datagrams taken from the receive queue at a time by zsock_recvmmsg() */
+#define ZSOCK_MMSG_BATCH 8
+
 #define SET_ERRNO(x) \
 	{ int _err = x; if (_err < 0) { errno = -_err; return -1; } }
 
@@ -162,6 +166,8 @@ static void zsock_received_cb(struct net_context *ctx, struct net_pkt *pkt,
 		net_context_update_recv_wnd(ctx, -net_pkt_appdatalen(pkt));
 	}
 
+	net_stats_update_latency(pkt, NET_STATS_LATENCY_RX_SOCKET);
+
 	k_fifo_put(&ctx->recv_q, pkt);
 }
 
@@ -235,17 +241,62 @@ ssize_t zsock_send(int sock, const void *buf, size_t len, int flags)
 	return zsock_sendto(sock, buf, len, flags, NULL, 0);
 }
 
+static inline s32_t zsock_timeout(struct net_context *ctx, int flags)
+{
+	if ((flags & ZSOCK_MSG_DONTWAIT) || sock_is_nonblock(ctx)) {
+		return K_NO_WAIT;
+	}
+
+	return K_FOREVER;
+}
+
+/* Register the callback before sending in order to receive the response
+ * from the peer.
+ */
+static inline int zsock_prepare_send(struct net_context *ctx)
+{
+	return net_context_recv(ctx, zsock_received_cb, K_NO_WAIT,
+				ctx->user_data);
+}
+
+/* On success the packet is owned by the stack, on error by the caller */
+static int zsock_net_send(struct net_context *ctx, struct net_pkt *pkt,
+			  s32_t timeout, const struct sockaddr *dest_addr,
+			  socklen_t addrlen)
+{
+	int err;
+
+	if (dest_addr) {
+		err = net_context_sendto(pkt, dest_addr, addrlen, NULL,
+					 timeout, NULL, ctx->user_data);
+	} else {
+		err = net_context_send(pkt, NULL, timeout, NULL, ctx->user_data);
+	}
+
+	return err < 0 ? err : 0;
+}
+
+static int zsock_send_ctx_pkt(struct net_context *ctx, struct net_pkt *pkt,
+			      s32_t timeout, const struct sockaddr *dest_addr,
+			      socklen_t addrlen)
+{
+	int err;
+
+	err = zsock_prepare_send(ctx);
+	if (err < 0) {
+		return err;
+	}
+
+	return zsock_net_send(ctx, pkt, timeout, dest_addr, addrlen);
+}
+
 ssize_t zsock_sendto(int sock, const void *buf, size_t len, int flags,
 		     const struct sockaddr *dest_addr, socklen_t addrlen)
 {
 	int err;
 	struct net_pkt *send_pkt;
-	s32_t timeout = K_FOREVER;
 	struct net_context *ctx = INT_TO_POINTER(sock);
-
-	if ((flags & ZSOCK_MSG_DONTWAIT) || sock_is_nonblock(ctx)) {
-		timeout = K_NO_WAIT;
-	}
+	s32_t timeout = zsock_timeout(ctx, flags);
 
 	send_pkt = net_pkt_get_tx(ctx, timeout);
 	if (!send_pkt) {
@@ -260,32 +311,143 @@ ssize_t zsock_sendto(int sock, const void *buf, size_t len, int flags,
 		return -1;
 	}
 
-	/* Register the callback before sending in order to receive the response
-	 * from the peer.
-	 */
-	err = net_context_recv(ctx, zsock_received_cb, K_NO_WAIT, ctx->user_data);
+	err = zsock_send_ctx_pkt(ctx, send_pkt, timeout, dest_addr, addrlen);
 	if (err < 0) {
 		net_pkt_unref(send_pkt);
 		errno = -err;
 		return -1;
 	}
 
-	if (dest_addr) {
-		err = net_context_sendto(send_pkt, dest_addr, addrlen, NULL,
-					 timeout, NULL, ctx->user_data);
-	} else {
-		err = net_context_send(send_pkt, NULL, timeout, NULL, ctx->user_data);
+	return len;
+}
+
+struct net_pkt *zsock_pkt_alloc(int sock, int flags)
+{
+	struct net_context *ctx = INT_TO_POINTER(sock);
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_get_tx(ctx, zsock_timeout(ctx, flags));
+	if (!pkt) {
+		errno = EAGAIN;
+	}
+
+	return pkt;
+}
+
+ssize_t zsock_send_pkt(int sock, struct net_pkt *pkt, int flags)
+{
+	return zsock_sendto_pkt(sock, pkt, flags, NULL, 0);
+}
+
+ssize_t zsock_sendto_pkt(int sock, struct net_pkt *pkt, int flags,
+			 const struct sockaddr *dest_addr, socklen_t addrlen)
+{
+	struct net_context *ctx = INT_TO_POINTER(sock);
+	size_t len;
+
+	if (net_pkt_context(pkt) != ctx) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	len = net_pkt_get_len(pkt);
+
+	SET_ERRNO(zsock_send_ctx_pkt(ctx, pkt, zsock_timeout(ctx, flags),
+				     dest_addr, addrlen));
+
+	return len;
+}
+
+/* Gather the iovecs of msg into one packet and send it. The receive
+ * callback must have been registered with zsock_prepare_send().
+ */
+static ssize_t zsock_sendmsg_ctx(struct net_context *ctx,
+				 const struct zsock_msghdr *msg, int flags)
+{
+	s32_t timeout = zsock_timeout(ctx, flags);
+	struct net_pkt *send_pkt;
+	size_t len = 0;
+	size_t i;
+	int err;
+
+	send_pkt = net_pkt_get_tx(ctx, timeout);
+	if (!send_pkt) {
+		return -EAGAIN;
+	}
+
+	for (i = 0; i < msg->msg_iovlen; i++) {
+		size_t iov_len = msg->msg_iov[i].iov_len;
+		size_t appended;
+
+		if (!iov_len) {
+			continue;
+		}
+
+		appended = net_pkt_append(send_pkt, iov_len,
+					  msg->msg_iov[i].iov_base, timeout);
+		len += appended;
+
+		if (appended < iov_len) {
+			break;
+		}
+	}
+
+	if (!len) {
+		net_pkt_unref(send_pkt);
+		return -EAGAIN;
 	}
 
+	err = zsock_net_send(ctx, send_pkt, timeout, msg->msg_name,
+			     msg->msg_namelen);
 	if (err < 0) {
 		net_pkt_unref(send_pkt);
-		errno = -err;
-		return -1;
+		return err;
 	}
 
 	return len;
 }
 
+ssize_t zsock_sendmsg(int sock, const struct zsock_msghdr *msg, int flags)
+{
+	struct net_context *ctx = INT_TO_POINTER(sock);
+	ssize_t len;
+
+	SET_ERRNO(zsock_prepare_send(ctx));
+
+	len = zsock_sendmsg_ctx(ctx, msg, flags);
+	SET_ERRNO(len);
+
+	return len;
+}
+
+int zsock_sendmmsg(int sock, struct zsock_mmsghdr *msgvec, unsigned int vlen,
+		   int flags)
+{
+	struct net_context *ctx = INT_TO_POINTER(sock);
+	unsigned int i;
+
+	SET_ERRNO(zsock_prepare_send(ctx));
+
+	for (i = 0; i < vlen; i++) {
+		ssize_t len = zsock_sendmsg_ctx(ctx, &msgvec[i].msg_hdr,
+						flags);
+
+		if (len < 0) {
+			/* Report the error only if nothing was sent */
+			if (i > 0) {
+				break;
+			}
+
+			errno = -len;
+			return -1;
+		}
+
+		msgvec[i].msg_len = len;
+	}
+
+	return i;
+}
+
 static inline ssize_t zsock_recv_dgram(struct net_context *ctx,
 				       void *buf,
 				       size_t max_len,
@@ -322,6 +484,8 @@ static inline ssize_t zsock_recv_dgram(struct net_context *ctx,
 		return -1;
 	}
 
+	net_stats_update_latency(pkt, NET_STATS_LATENCY_RX_APP);
+
 	if (src_addr && addrlen) {
 		int rv;
 
@@ -406,6 +570,8 @@ static inline ssize_t zsock_recv_stream(struct net_context *ctx,
 			}
 		}
 
+		net_stats_update_latency(pkt, NET_STATS_LATENCY_RX_APP);
+
 		frag = pkt->frags;
 		if (!frag) {
 			NET_ERR("net_pkt has empty fragments on start!");
@@ -449,6 +615,363 @@ static inline ssize_t zsock_recv_stream(struct net_context *ctx,
 	return recv_len;
 }
 
+static ssize_t zsock_recv_pkt_stream(struct net_context *ctx,
+				     struct net_pkt **pkt, s32_t timeout)
+{
+	size_t len;
+	int res;
+
+	if (sock_is_eof(ctx)) {
+		return 0;
+	}
+
+	res = _k_fifo_wait_non_empty(&ctx->recv_q, timeout);
+	/* EAGAIN when timeout expired, EINTR when cancelled */
+	if (res && res != -EAGAIN && res != -EINTR) {
+		errno = -res;
+		return -1;
+	}
+
+	*pkt = k_fifo_get(&ctx->recv_q, K_NO_WAIT);
+	if (!*pkt) {
+		if (sock_is_eof(ctx)) {
+			return 0;
+		}
+
+		errno = EAGAIN;
+		return -1;
+	}
+
+	net_stats_update_latency(*pkt, NET_STATS_LATENCY_RX_APP);
+
+	if (net_pkt_eof(*pkt)) {
+		sock_set_eof(ctx);
+	}
+
+	/* The header was already removed in zsock_received_cb(), what
+	 * is left is the data not yet consumed by zsock_recv().
+	 */
+	len = net_pkt_get_len(*pkt);
+	net_context_update_recv_wnd(ctx, len);
+
+	return len;
+}
+
+ssize_t zsock_recv_pkt(int sock, struct net_pkt **pkt, int flags)
+{
+	struct net_context *ctx = INT_TO_POINTER(sock);
+	s32_t timeout = zsock_timeout(ctx, flags);
+
+	*pkt = NULL;
+
+	/* The packet is handed over, there is nothing to peek at */
+	if (flags & ZSOCK_MSG_PEEK) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (net_context_get_type(ctx) == SOCK_STREAM) {
+		return zsock_recv_pkt_stream(ctx, pkt, timeout);
+	}
+
+	*pkt = k_fifo_get(&ctx->recv_q, timeout);
+	if (!*pkt) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	net_stats_update_latency(*pkt, NET_STATS_LATENCY_RX_APP);
+
+	return net_pkt_appdatalen(*pkt);
+}
+
+/* Scatter len bytes of pkt, starting at offset, to the iovecs */
+static size_t zsock_copy_to_iov(struct net_pkt *pkt, u16_t offset,
+				size_t len, const struct zsock_msghdr *msg)
+{
+	struct net_buf *frag = pkt->frags;
+	u16_t pos = offset;
+	size_t copied = 0;
+	size_t i;
+
+	for (i = 0; i < msg->msg_iovlen && copied < len && frag; i++) {
+		u16_t chunk = min(msg->msg_iov[i].iov_len, len - copied);
+
+		if (!chunk) {
+			continue;
+		}
+
+		frag = net_frag_read(frag, pos, &pos, chunk,
+				     msg->msg_iov[i].iov_base);
+		if (!frag && pos == 0xffff) {
+			break;
+		}
+
+		copied += chunk;
+	}
+
+	return copied;
+}
+
+/* Fill msg from a received datagram. The packet is released unless
+ * ZSOCK_MSG_PEEK is set.
+ */
+static ssize_t zsock_recvmsg_pkt(struct net_pkt *pkt,
+				 struct zsock_msghdr *msg, int flags)
+{
+	unsigned int header_len;
+	size_t recv_len;
+
+	net_stats_update_latency(pkt, NET_STATS_LATENCY_RX_APP);
+
+	msg->msg_flags = 0;
+
+	if (msg->msg_name && msg->msg_namelen) {
+		int rv;
+
+		rv = net_pkt_get_src_addr(pkt, msg->msg_name,
+					  msg->msg_namelen);
+		if (rv < 0) {
+			if (!(flags & ZSOCK_MSG_PEEK)) {
+				net_pkt_unref(pkt);
+			}
+
+			return rv;
+		}
+
+		if (((struct sockaddr *)msg->msg_name)->sa_family == AF_INET) {
+			msg->msg_namelen = sizeof(struct sockaddr_in);
+		} else {
+			msg->msg_namelen = sizeof(struct sockaddr_in6);
+		}
+	}
+
+	header_len = net_pkt_appdata(pkt) - pkt->frags->data;
+	recv_len = zsock_copy_to_iov(pkt, header_len, net_pkt_appdatalen(pkt),
+				     msg);
+
+	if (recv_len < net_pkt_appdatalen(pkt)) {
+		msg->msg_flags |= ZSOCK_MSG_TRUNC;
+	}
+
+	if (!(flags & ZSOCK_MSG_PEEK)) {
+		net_pkt_unref(pkt);
+	}
+
+	return recv_len;
+}
+
+static ssize_t zsock_recvmsg_dgram(struct net_context *ctx,
+				   struct zsock_msghdr *msg, int flags)
+{
+	s32_t timeout = zsock_timeout(ctx, flags);
+	struct net_pkt *pkt;
+
+	if (flags & ZSOCK_MSG_PEEK) {
+		int res;
+
+		res = _k_fifo_wait_non_empty(&ctx->recv_q, timeout);
+		/* EAGAIN when timeout expired, EINTR when cancelled */
+		if (res && res != -EAGAIN && res != -EINTR) {
+			return res;
+		}
+
+		pkt = k_fifo_peek_head(&ctx->recv_q);
+	} else {
+		pkt = k_fifo_get(&ctx->recv_q, timeout);
+	}
+
+	if (!pkt) {
+		return -EAGAIN;
+	}
+
+	return zsock_recvmsg_pkt(pkt, msg, flags);
+}
+
+/* Receive up to vlen datagrams. Only the first one is waited for, the
+ * ones queued by then are taken from the receive queue at once, at most
+ * ZSOCK_MMSG_BATCH at a time, and copied out after that.
+ */
+static int zsock_recvmmsg_dgram(struct net_context *ctx,
+				struct zsock_mmsghdr *msgvec,
+				unsigned int vlen, int flags)
+{
+	struct net_pkt *pkts[ZSOCK_MMSG_BATCH];
+	unsigned int count = 0;
+	unsigned int n, i;
+	ssize_t len;
+	int key;
+
+	pkts[0] = k_fifo_get(&ctx->recv_q, zsock_timeout(ctx, flags));
+	if (!pkts[0]) {
+		return -EAGAIN;
+	}
+
+	n = 1;
+
+	while (n) {
+		key = irq_lock();
+
+		while (n < min(vlen - count, ARRAY_SIZE(pkts))) {
+			pkts[n] = k_fifo_get(&ctx->recv_q, K_NO_WAIT);
+			if (!pkts[n]) {
+				break;
+			}
+
+			n++;
+		}
+
+		irq_unlock(key);
+
+		for (i = 0; i < n; i++) {
+			len = zsock_recvmsg_pkt(pkts[i],
+						&msgvec[count].msg_hdr, 0);
+			if (len < 0) {
+				/* The rest of the batch was already taken
+				 * from the queue and is dropped.
+				 */
+				while (++i < n) {
+					net_pkt_unref(pkts[i]);
+				}
+
+				return count ? count : len;
+			}
+
+			msgvec[count++].msg_len = len;
+		}
+
+		n = 0;
+
+		if (count == vlen) {
+			break;
+		}
+
+		/* Take the next batch if more was queued */
+		pkts[0] = k_fifo_get(&ctx->recv_q, K_NO_WAIT);
+		if (pkts[0]) {
+			n = 1;
+		}
+	}
+
+	return count;
+}
+
+static ssize_t zsock_recvmsg_stream(struct net_context *ctx,
+				    struct zsock_msghdr *msg, int flags)
+{
+	size_t recv_len = 0;
+	size_t i;
+
+	msg->msg_flags = 0;
+
+	/* Fill the iovecs with what is available once the first byte
+	 * has arrived.
+	 */
+	for (i = 0; i < msg->msg_iovlen; i++) {
+		u8_t *base = msg->msg_iov[i].iov_base;
+		size_t filled = 0;
+
+		while (filled < msg->msg_iov[i].iov_len) {
+			ssize_t len;
+
+			len = zsock_recv_stream(ctx, base + filled,
+						msg->msg_iov[i].iov_len -
+						filled,
+						recv_len ?
+						flags | ZSOCK_MSG_DONTWAIT :
+						flags);
+			if (len <= 0 || (flags & ZSOCK_MSG_PEEK)) {
+				if (len < 0 && !recv_len) {
+					return -errno;
+				}
+
+				return recv_len + max(len, 0);
+			}
+
+			filled += len;
+			recv_len += len;
+		}
+	}
+
+	return recv_len;
+}
+
+static ssize_t zsock_recvmsg_ctx(struct net_context *ctx,
+				 struct zsock_msghdr *msg, int flags)
+{
+	enum net_sock_type sock_type = net_context_get_type(ctx);
+
+	if (sock_type == SOCK_DGRAM) {
+		return zsock_recvmsg_dgram(ctx, msg, flags);
+	} else if (sock_type == SOCK_STREAM) {
+		return zsock_recvmsg_stream(ctx, msg, flags);
+	}
+
+	__ASSERT(0, "Unknown socket type");
+
+	return -ENOTSUP;
+}
+
+ssize_t zsock_recvmsg(int sock, struct zsock_msghdr *msg, int flags)
+{
+	struct net_context *ctx = INT_TO_POINTER(sock);
+	ssize_t len;
+
+	len = zsock_recvmsg_ctx(ctx, msg, flags);
+	SET_ERRNO(len);
+
+	return len;
+}
+
+int zsock_recvmmsg(int sock, struct zsock_mmsghdr *msgvec, unsigned int vlen,
+		   int flags)
+{
+	struct net_context *ctx = INT_TO_POINTER(sock);
+	unsigned int i;
+
+	if (!vlen) {
+		return 0;
+	}
+
+	if (net_context_get_type(ctx) == SOCK_DGRAM &&
+	    !(flags & ZSOCK_MSG_PEEK)) {
+		int count = zsock_recvmmsg_dgram(ctx, msgvec, vlen, flags);
+
+		SET_ERRNO(count);
+
+		return count;
+	}
+
+	/* A stream has no message boundaries, the messages are filled in
+	 * turn. Only wait for the first one, then take what is already
+	 * queued.
+	 */
+	for (i = 0; i < vlen; i++) {
+		ssize_t len;
+
+		len = zsock_recvmsg_ctx(ctx, &msgvec[i].msg_hdr,
+					i ? flags | ZSOCK_MSG_DONTWAIT : flags);
+		if (len < 0) {
+			if (i > 0) {
+				break;
+			}
+
+			errno = -len;
+			return -1;
+		}
+
+		msgvec[i].msg_len = len;
+
+		/* End of stream */
+		if (!len && net_context_get_type(ctx) == SOCK_STREAM) {
+			i++;
+			break;
+		}
+	}
+
+	return i;
+}
+
 ssize_t zsock_recv(int sock, void *buf, size_t max_len, int flags)
 {
 	return zsock_recvfrom(sock, buf, max_len, flags, NULL, NULL);
@@ -497,6 +1020,52 @@ int zsock_fcntl(int sock, int cmd, int flags)
 	}
 }
 
+static int sockopt_to_option(int level, int optname,
+			     enum net_context_option *option)
+{
+	if (level != IPPROTO_TCP) {
+		return -ENOPROTOOPT;
+	}
+
+	switch (optname) {
+	case ZSOCK_TCP_NODELAY:
+		*option = NET_OPT_TCP_NODELAY;
+		return 0;
+	case ZSOCK_TCP_CORK:
+		*option = NET_OPT_TCP_CORK;
+		return 0;
+	default:
+		return -ENOPROTOOPT;
+	}
+}
+
+int zsock_setsockopt(int sock, int level, int optname,
+		     const void *optval, socklen_t optlen)
+{
+	struct net_context *ctx = INT_TO_POINTER(sock);
+	enum net_context_option option;
+
+	SET_ERRNO(sockopt_to_option(level, optname, &option));
+	SET_ERRNO(net_context_set_option(ctx, option, optval, optlen));
+
+	return 0;
+}
+
+int zsock_getsockopt(int sock, int level, int optname,
+		     void *optval, socklen_t *optlen)
+{
+	struct net_context *ctx = INT_TO_POINTER(sock);
+	enum net_context_option option;
+	size_t len = *optlen;
+
+	SET_ERRNO(sockopt_to_option(level, optname, &option));
+	SET_ERRNO(net_context_get_option(ctx, option, optval, &len));
+
+	*optlen = len;
+
+	return 0;
+}
+
 int zsock_poll(struct zsock_pollfd *fds, int nfds, int timeout)
 {
 	int i;
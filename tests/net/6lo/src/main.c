@@ -852,7 +852,7 @@ static struct net_6lo_data test_data_25 = {
 
 #endif
 
-static void test_6lo(struct net_6lo_data *data)
+static struct net_pkt *compress_data(struct net_6lo_data *data)
 {
 	struct net_pkt *pkt;
 
@@ -873,6 +873,46 @@ static void test_6lo(struct net_6lo_data *data)
 	net_hexdump_frags("after-compression", pkt, false);
 #endif
 
+	return pkt;
+}
+
+#if defined(CONFIG_NET_6LO_FLOW_CACHE)
+/* Room for an uncompressed packet behind the IPv6 dispatch byte */
+#define SIZE_OF_PASS (1 + NET_IPV6UDPH_LEN + SIZE_OF_LARGE_DATA)
+
+static u8_t first_pass[SIZE_OF_PASS];
+static u8_t second_pass[SIZE_OF_PASS];
+#endif
+
+static void test_6lo(struct net_6lo_data *data)
+{
+	struct net_pkt *pkt;
+#if defined(CONFIG_NET_6LO_FLOW_CACHE)
+	size_t len;
+#endif
+
+	pkt = compress_data(data);
+
+#if defined(CONFIG_NET_6LO_FLOW_CACHE)
+	/* The flow was just cached, compressing it again must give the
+	 * same bytes.
+	 */
+	len = net_pkt_get_len(pkt);
+	zassert_true(net_frag_linearize(first_pass, sizeof(first_pass),
+					pkt, 0, len) == len,
+		     "failed to copy the packet");
+	net_pkt_unref(pkt);
+
+	pkt = compress_data(data);
+
+	zassert_equal(net_pkt_get_len(pkt), len, "cached length differs");
+	zassert_true(net_frag_linearize(second_pass, sizeof(second_pass),
+					pkt, 0, len) == len,
+		     "failed to copy the packet");
+	zassert_false(memcmp(first_pass, second_pass, len),
+		      "cached compression differs");
+#endif
+
 	zassert_true(net_6lo_uncompress(pkt),
 		     "uncompression failed");
 #if DEBUG > 0
@@ -942,9 +982,31 @@ void test_loop(void)
 	net_pkt_print();
 }
 
+void test_flow_chksum(void)
+{
+#if defined(CONFIG_NET_6LO_FLOW_CACHE)
+	struct net_6lo_data data = test_data_2;
+
+	/* Cache the flow, then send a different payload on it. The
+	 * checksum of the new packet must replace the cached one.
+	 */
+	data.nh.udp.chksum = htons(0x1234);
+	data.small = true;
+	test_6lo(&data);
+
+	data.nh.udp.chksum = htons(0xabcd);
+	data.small = false;
+	test_6lo(&data);
+#else
+	ztest_test_skip();
+#endif
+}
+
 /*test case main entry*/
 void test_main(void)
 {
-	ztest_test_suite(test_6lo, ztest_unit_test(test_loop));
+	ztest_test_suite(test_6lo,
+			 ztest_unit_test(test_loop),
+			 ztest_unit_test(test_flow_chksum));
 	ztest_run_test_suite(test_6lo);
 }
@@ -62,10 +62,15 @@ static int destroy_called;
 static void buf_destroy(struct net_buf *buf);
 static void fixed_destroy(struct net_buf *buf);
 static void var_destroy(struct net_buf *buf);
+static void class_destroy(struct net_buf *buf);
 
 NET_BUF_POOL_HEAP_DEFINE(bufs_pool, 10, buf_destroy);
 NET_BUF_POOL_FIXED_DEFINE(fixed_pool, 10, 128, fixed_destroy);
 NET_BUF_POOL_VAR_DEFINE(var_pool, 10, 1024, var_destroy);
+NET_BUF_POOL_CLASS_DEFINE(class_pool, 10, class_destroy,
+			  NET_BUF_DATA_CLASS(64, 2),
+			  NET_BUF_DATA_CLASS(256, 2),
+			  NET_BUF_DATA_CLASS(1536, 1));
 
 static void buf_destroy(struct net_buf *buf)
 {
@@ -94,6 +99,15 @@ static void var_destroy(struct net_buf *buf)
 	net_buf_destroy(buf);
 }
 
+static void class_destroy(struct net_buf *buf)
+{
+	struct net_buf_pool *pool = net_buf_pool_get(buf->pool_id);
+
+	destroy_called++;
+	zassert_equal(pool, &class_pool, "Invalid free pointer in buffer");
+	net_buf_destroy(buf);
+}
+
 static const char example_data[] = "0123456789"
 				   "abcdefghijklmnopqrstuvxyz"
 				   "!#¤%&/()=?";
@@ -457,6 +471,109 @@ static void net_buf_test_var_pool(void)
 	zassert_equal(destroy_called, 3, "Incorrect destroy callback count");
 }
 
+static void net_buf_test_class_pool(void)
+{
+	const struct net_buf_data_class *classes;
+	struct net_buf *buf1, *buf2, *buf3, *buf4, *buf5;
+
+	destroy_called = 0;
+
+	zassert_equal(net_buf_pool_get_classes(&class_pool, &classes), 3,
+		      "Invalid number of classes");
+
+	buf1 = net_buf_alloc_len(&class_pool, 20, K_NO_WAIT);
+	zassert_not_null(buf1, "Failed to get buffer");
+	zassert_equal(buf1->size, 64, "Invalid size class");
+
+	buf2 = net_buf_alloc_len(&class_pool, 200, K_NO_WAIT);
+	zassert_not_null(buf2, "Failed to get buffer");
+	zassert_equal(buf2->size, 256, "Invalid size class");
+
+	buf3 = net_buf_alloc_len(&class_pool, 2000, K_NO_WAIT);
+	zassert_not_null(buf3, "Failed to get buffer");
+	zassert_equal(buf3->size, 1536, "Largest class not used");
+
+	/* The smallest class is used up after this, the next small
+	 * buffer comes from the next class.
+	 */
+	buf4 = net_buf_alloc_len(&class_pool, 64, K_NO_WAIT);
+	zassert_not_null(buf4, "Failed to get buffer");
+	zassert_equal(buf4->size, 64, "Invalid size class");
+
+	buf5 = net_buf_alloc_len(&class_pool, 10, K_NO_WAIT);
+	zassert_not_null(buf5, "Failed to get buffer");
+	zassert_equal(buf5->size, 256, "Overflow to next class failed");
+
+	zassert_equal(classes[0].used, 2, "Invalid usage");
+	zassert_equal(classes[0].overflows, 1, "Overflow not counted");
+	zassert_equal(classes[1].used, 2, "Invalid usage");
+	zassert_equal(classes[2].used, 1, "Invalid usage");
+
+	zassert_is_null(net_buf_alloc_len(&class_pool, 10, K_NO_WAIT),
+			"Got buffer with all classes used up");
+
+	net_buf_unref(buf1);
+	net_buf_unref(buf2);
+	net_buf_unref(buf3);
+	net_buf_unref(buf4);
+	net_buf_unref(buf5);
+
+	zassert_equal(destroy_called, 5, "Incorrect destroy callback count");
+	zassert_equal(classes[0].used + classes[1].used + classes[2].used, 0,
+		      "Data blocks not freed");
+	zassert_equal(classes[0].max_used, 2, "Invalid max usage");
+
+	/* Freed blocks are reused */
+	buf1 = net_buf_alloc_len(&class_pool, 100, K_NO_WAIT);
+	zassert_not_null(buf1, "Failed to get buffer");
+	zassert_equal(buf1->size, 256, "Invalid size class");
+	net_buf_unref(buf1);
+}
+
+NET_BUF_SPSC_DEFINE(test_spsc, 2);
+
+static void net_buf_test_spsc(void)
+{
+	struct net_buf *buf, *frag, *got;
+
+	zassert_is_null(net_buf_spsc_get(&test_spsc, K_NO_WAIT),
+			"Got buffer from empty channel");
+	zassert_is_null(net_buf_spsc_get(&test_spsc, K_MSEC(10)),
+			"Got buffer from empty channel");
+
+	buf = net_buf_alloc_len(&bufs_pool, 20, K_NO_WAIT);
+	zassert_not_null(buf, "Failed to get buffer");
+
+	frag = net_buf_alloc_len(&bufs_pool, 20, K_NO_WAIT);
+	zassert_not_null(frag, "Failed to get buffer");
+
+	net_buf_frag_add(buf, frag);
+
+	zassert_equal(net_buf_spsc_put(&test_spsc, buf), 0,
+		      "Failed to put buffer");
+	zassert_equal(net_buf_spsc_put(&test_spsc, buf), 0,
+		      "Failed to put buffer");
+	zassert_equal(net_buf_spsc_put(&test_spsc, buf), -ENOBUFS,
+		      "Full channel accepted buffer");
+
+	got = net_buf_spsc_get(&test_spsc, K_NO_WAIT);
+	zassert_equal(got, buf, "Invalid buffer");
+	zassert_equal(got->frags, frag, "Fragment lost");
+
+	/* Wraps around the end of the slots */
+	zassert_equal(net_buf_spsc_put(&test_spsc, buf), 0,
+		      "Failed to put buffer");
+
+	zassert_equal(net_buf_spsc_get(&test_spsc, K_FOREVER), buf,
+		      "Invalid buffer");
+	zassert_equal(net_buf_spsc_get(&test_spsc, K_MSEC(10)), buf,
+		      "Invalid buffer");
+	zassert_is_null(net_buf_spsc_get(&test_spsc, K_NO_WAIT),
+			"Got buffer from empty channel");
+
+	net_buf_unref(buf);
+}
+
 void test_main(void)
 {
 	ztest_test_suite(net_buf_test,
@@ -468,7 +585,9 @@ void test_main(void)
 			 ztest_unit_test(net_buf_test_multi_frags),
 			 ztest_unit_test(net_buf_test_clone),
 			 ztest_unit_test(net_buf_test_fixed_pool),
-			 ztest_unit_test(net_buf_test_var_pool)
+			 ztest_unit_test(net_buf_test_var_pool),
+			 ztest_unit_test(net_buf_test_class_pool),
+			 ztest_unit_test(net_buf_test_spsc)
 			 );
 
 	ztest_run_test_suite(net_buf_test);
@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _CAPTURE_FILE_H
+#define _CAPTURE_FILE_H
+
+#include <stddef.h>
+
+int capture_file_read(const char *name, void *buf, size_t buf_len);
+
+#endif /* _CAPTURE_FILE_H */
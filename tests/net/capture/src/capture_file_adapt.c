@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ *
+ * Reads back the capture file written on the host. This is in a separate
+ * file because there are naming conflicts between host and zephyr network
+ * stacks.
+ */
+
+#define _DEFAULT_SOURCE
+
+/* Host include files */
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "capture_file.h"
+
+int capture_file_read(const char *name, void *buf, size_t buf_len)
+{
+	size_t total = 0;
+	ssize_t ret;
+	int fd;
+
+	fd = open(name, O_RDONLY);
+	if (fd < 0) {
+		return -errno;
+	}
+
+	while (total < buf_len) {
+		ret = read(fd, (char *)buf + total, buf_len - total);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			ret = -errno;
+			close(fd);
+			return ret;
+		}
+
+		if (!ret) {
+			break;
+		}
+
+		total += ret;
+	}
+
+	close(fd);
+
+	return total;
+}
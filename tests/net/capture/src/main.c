@@ -0,0 +1,479 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <linker/sections.h>
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <device.h>
+#include <init.h>
+#include <net/buf.h>
+#include <net/net_core.h>
+#include <net/net_pkt.h>
+#include <net/net_ip.h>
+#include <net/ethernet.h>
+#include <net/net_capture.h>
+
+#include <ztest.h>
+
+#include "net_private.h"
+#include "capture_file.h"
+
+#define ALLOC_TIMEOUT K_MSEC(100)
+
+/* Time for the capture thread to write out what is queued */
+#define OUTPUT_TIME K_MSEC(100)
+
+/* pcapng framing */
+#define PCAPNG_SHB		0x0A0D0D0A
+#define PCAPNG_IDB		0x00000001
+#define PCAPNG_EPB		0x00000006
+#define PCAPNG_BYTE_ORDER	0x1A2B3C4D
+#define PCAPNG_EPB_INBOUND	1
+#define PCAPNG_EPB_OUTBOUND	2
+#define LINKTYPE_RAW		101
+
+#define SHB_LEN			28
+#define IDB_LEN			20
+#define EPB_HDR_LEN		28
+#define EPB_TRAILER_LEN		16
+
+#define MAX_EPBS 128
+
+/* Packets built by build_pkt() start with this much headers */
+#define PKT_HDR_LEN (NET_IPV4H_LEN + 4)
+
+struct epb_info {
+	u32_t if_id;
+	u32_t cap_len;
+	u32_t orig_len;
+	u32_t flags;
+	u16_t id;
+};
+
+static u8_t file_buf[32768];
+static struct epb_info epbs[MAX_EPBS];
+static int epb_count;
+
+static struct net_if *iface;
+static int iface_count;
+
+/* Id of the next test packet */
+static u16_t next_id;
+
+struct net_capture_context {
+	u8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static struct net_capture_context net_capture_context_data;
+
+static int net_capture_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_capture_iface_init(struct net_if *iface)
+{
+	struct net_capture_context *context =
+		net_if_get_device(iface)->driver_data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	context->mac_addr[0] = 0x00;
+	context->mac_addr[1] = 0x00;
+	context->mac_addr[2] = 0x5E;
+	context->mac_addr[3] = 0x00;
+	context->mac_addr[4] = 0x53;
+	context->mac_addr[5] = sys_rand32_get();
+
+	net_if_set_link_addr(iface, context->mac_addr,
+			     sizeof(context->mac_addr), NET_LINK_ETHERNET);
+}
+
+static int tester_send(struct net_if *iface, struct net_pkt *pkt)
+{
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+static struct net_if_api net_capture_if_api = {
+	.init = net_capture_iface_init,
+	.send = tester_send,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT(net_capture_test, "net_capture_test",
+		net_capture_dev_init, &net_capture_context_data, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_capture_if_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE, 1500);
+
+static u32_t get_u32(const u8_t *ptr)
+{
+	u32_t val;
+
+	memcpy(&val, ptr, sizeof(val));
+
+	return val;
+}
+
+/* Read the capture file and check its framing. The packet blocks are
+ * stored in epbs[].
+ */
+static void parse_capture(void)
+{
+	int len;
+	int pos;
+	int i;
+
+	len = capture_file_read(CONFIG_NET_CAPTURE_FILE_NAME, file_buf,
+				sizeof(file_buf));
+	zassert_true(len >= SHB_LEN + iface_count * IDB_LEN,
+		     "Capture file too short (%d)", len);
+	zassert_true(len < sizeof(file_buf), "Capture file too long");
+
+	zassert_equal(get_u32(file_buf), PCAPNG_SHB, "No section header");
+	zassert_equal(get_u32(file_buf + 4), SHB_LEN, "Section header len");
+	zassert_equal(get_u32(file_buf + 8), PCAPNG_BYTE_ORDER,
+		      "Byte order magic");
+	zassert_equal(get_u32(file_buf + SHB_LEN - 4), SHB_LEN,
+		      "Section header trailer");
+
+	pos = SHB_LEN;
+
+	for (i = 0; i < iface_count; i++) {
+		zassert_equal(get_u32(file_buf + pos), PCAPNG_IDB,
+			      "No interface block %d", i);
+		zassert_equal(get_u32(file_buf + pos + 4), IDB_LEN,
+			      "Interface block %d len", i);
+		zassert_equal(get_u32(file_buf + pos + 8) & 0xffff,
+			      LINKTYPE_RAW, "Interface block %d link type", i);
+		zassert_equal(get_u32(file_buf + pos + 12),
+			      CONFIG_NET_CAPTURE_SNAPLEN,
+			      "Interface block %d snap length", i);
+		pos += IDB_LEN;
+	}
+
+	for (epb_count = 0; pos < len; epb_count++) {
+		struct epb_info *epb = &epbs[epb_count];
+		const u8_t *block = file_buf + pos;
+		u32_t block_len;
+
+		zassert_true(epb_count < MAX_EPBS, "Too many packet blocks");
+		zassert_true(len - pos >= EPB_HDR_LEN + EPB_TRAILER_LEN,
+			     "Truncated packet block %d", epb_count);
+		zassert_equal(get_u32(block), PCAPNG_EPB,
+			      "No packet block %d", epb_count);
+
+		block_len = get_u32(block + 4);
+		epb->if_id = get_u32(block + 8);
+		epb->cap_len = get_u32(block + 20);
+		epb->orig_len = get_u32(block + 24);
+
+		zassert_equal(block_len, EPB_HDR_LEN +
+			      ROUND_UP(epb->cap_len, 4) + EPB_TRAILER_LEN,
+			      "Packet block %d len %u", epb_count, block_len);
+		zassert_true(pos + block_len <= len,
+			     "Truncated packet block %d", epb_count);
+		zassert_equal(get_u32(block + block_len - 4), block_len,
+			      "Packet block %d trailer", epb_count);
+		zassert_equal(epb->cap_len, min(epb->orig_len,
+						CONFIG_NET_CAPTURE_SNAPLEN),
+			      "Packet block %d captured length", epb_count);
+
+		epb->flags = get_u32(block + block_len - 12);
+		epb->id = (block[EPB_HDR_LEN + PKT_HDR_LEN] << 8) |
+			block[EPB_HDR_LEN + PKT_HDR_LEN + 1];
+
+		pos += block_len;
+	}
+}
+
+/* Build an IPv4 packet with a transport header that has the given
+ * ports, followed by the id of the packet and filler up to len bytes.
+ */
+static struct net_pkt *build_pkt(u8_t proto, u16_t port, u16_t len)
+{
+	u8_t hdr[PKT_HDR_LEN + 2];
+	struct net_pkt *pkt;
+	u8_t fill = 0xff;
+	u16_t i;
+
+	zassert_true(len >= sizeof(hdr), "Packet too short");
+
+	pkt = net_pkt_get_reserve_tx(0, ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "Cannot allocate pkt");
+
+	net_pkt_set_iface(pkt, iface);
+
+	memset(hdr, 0, sizeof(hdr));
+	hdr[0] = 0x45;
+	hdr[2] = len >> 8;
+	hdr[3] = len;
+	hdr[8] = 64;
+	hdr[9] = proto;
+	hdr[NET_IPV4H_LEN] = 0xc0;
+	hdr[NET_IPV4H_LEN + 1] = 0x01;
+	hdr[NET_IPV4H_LEN + 2] = port >> 8;
+	hdr[NET_IPV4H_LEN + 3] = port;
+	hdr[PKT_HDR_LEN] = next_id >> 8;
+	hdr[PKT_HDR_LEN + 1] = next_id;
+
+	next_id++;
+
+	zassert_true(net_pkt_append_all(pkt, sizeof(hdr), hdr,
+					ALLOC_TIMEOUT),
+		     "Cannot add headers");
+
+	/* Words with the high bit set must never be taken as records */
+	for (i = sizeof(hdr); i < len; i++) {
+		zassert_true(net_pkt_append_all(pkt, 1, &fill,
+						ALLOC_TIMEOUT),
+			     "Cannot add data");
+	}
+
+	return pkt;
+}
+
+static void capture_one(u8_t proto, u16_t port, u16_t len,
+			enum net_capture_point point)
+{
+	struct net_pkt *pkt = build_pkt(proto, port, len);
+
+	net_capture_pkt(iface, pkt, point);
+	net_pkt_unref(pkt);
+}
+
+static void count_iface(struct net_if *iface, void *user_data)
+{
+	iface_count++;
+}
+
+static void capture_setup(void)
+{
+	struct net_capture_stats stats;
+
+	iface = net_if_get_default();
+	zassert_not_null(iface, "Interface missing");
+
+	net_if_foreach(count_iface, NULL);
+
+	zassert_false(net_capture_is_enabled(iface), "Capture enabled");
+	zassert_equal(net_capture_enable(iface), 0, "Cannot enable capture");
+	zassert_true(net_capture_is_enabled(iface), "Capture not enabled");
+
+	k_sleep(OUTPUT_TIME);
+
+	/* Only the section and interface headers */
+	parse_capture();
+	zassert_equal(epb_count, 0, "Packet blocks written");
+
+	net_capture_get_stats(&stats);
+	zassert_equal(stats.written, SHB_LEN + iface_count * IDB_LEN,
+		      "Written %u bytes", stats.written);
+}
+
+static void capture_pkts(void)
+{
+	u16_t first_id = next_id;
+	int first = epb_count;
+
+	capture_one(IPPROTO_UDP, 5353, 60, NET_CAPTURE_RX_IP);
+	capture_one(IPPROTO_TCP, 80, 61, NET_CAPTURE_TX_IP);
+	capture_one(IPPROTO_UDP, 5353, 300, NET_CAPTURE_RX_IP);
+
+	/* An interface without link layer is captured at the IP level */
+	capture_one(IPPROTO_UDP, 5353, 60, NET_CAPTURE_RX_LL);
+
+	k_sleep(OUTPUT_TIME);
+	parse_capture();
+
+	zassert_equal(epb_count - first, 3, "Wrote %d packet blocks",
+		      epb_count - first);
+
+	zassert_equal(epbs[first].if_id, net_if_get_by_iface(iface),
+		      "Interface id");
+	zassert_equal(epbs[first].orig_len, 60, "Original length");
+	zassert_equal(epbs[first].flags, PCAPNG_EPB_INBOUND, "Direction");
+	zassert_equal(epbs[first].id, first_id, "Packet id");
+
+	zassert_equal(epbs[first + 1].orig_len, 61, "Original length");
+	zassert_equal(epbs[first + 1].flags, PCAPNG_EPB_OUTBOUND,
+		      "Direction");
+	zassert_equal(epbs[first + 1].id, first_id + 1, "Packet id");
+
+	zassert_equal(epbs[first + 2].orig_len, 300, "Original length");
+	zassert_equal(epbs[first + 2].cap_len, CONFIG_NET_CAPTURE_SNAPLEN,
+		      "Captured length");
+	zassert_equal(epbs[first + 2].id, first_id + 2, "Packet id");
+}
+
+static void capture_filter(void)
+{
+	struct net_capture_filter filter = { 0 };
+	struct net_capture_filter current;
+	struct net_capture_stats before, after;
+	u16_t id = next_id;
+	int first = epb_count;
+
+	net_capture_get_stats(&before);
+
+	filter.proto = IPPROTO_UDP;
+	net_capture_set_filter(&filter);
+
+	net_capture_get_filter(&current);
+	zassert_equal(current.proto, IPPROTO_UDP, "Filter not set");
+
+	capture_one(IPPROTO_TCP, 5353, 60, NET_CAPTURE_RX_IP);
+	capture_one(IPPROTO_UDP, 5353, 60, NET_CAPTURE_RX_IP);
+
+	filter.port = 80;
+	net_capture_set_filter(&filter);
+
+	capture_one(IPPROTO_UDP, 5353, 60, NET_CAPTURE_RX_IP);
+	capture_one(IPPROTO_UDP, 80, 60, NET_CAPTURE_RX_IP);
+
+	filter.proto = 0;
+	filter.port = 0;
+	filter.family = AF_INET6;
+	net_capture_set_filter(&filter);
+
+	capture_one(IPPROTO_UDP, 80, 60, NET_CAPTURE_RX_IP);
+
+	net_capture_set_filter(NULL);
+
+	capture_one(IPPROTO_TCP, 80, 60, NET_CAPTURE_RX_IP);
+
+	k_sleep(OUTPUT_TIME);
+	parse_capture();
+	net_capture_get_stats(&after);
+
+	zassert_equal(after.filtered - before.filtered, 3,
+		      "Filtered %u packets", after.filtered - before.filtered);
+	zassert_equal(epb_count - first, 3, "Wrote %d packet blocks",
+		      epb_count - first);
+	zassert_equal(epbs[first].id, id + 1, "Wrong packet captured");
+	zassert_equal(epbs[first + 1].id, id + 3, "Wrong packet captured");
+	zassert_equal(epbs[first + 2].id, id + 5, "Wrong packet captured");
+}
+
+/* Go around the ring several times with records of different lengths,
+ * so that the records of each lap start in the middle of the records
+ * of the previous ones.
+ */
+static void capture_ring_laps(void)
+{
+	struct net_capture_stats before, after;
+	u16_t id = next_id;
+	int first = epb_count;
+	int i;
+
+	net_capture_get_stats(&before);
+
+	for (i = 0; i < 60; i++) {
+		capture_one(IPPROTO_UDP, 5353, 30 + (i * 37) % 150,
+			    NET_CAPTURE_RX_IP);
+
+		if (i % 3 == 2) {
+			k_sleep(K_MSEC(10));
+		}
+	}
+
+	k_sleep(OUTPUT_TIME);
+	parse_capture();
+	net_capture_get_stats(&after);
+
+	zassert_equal(after.dropped, before.dropped, "Packets dropped");
+	zassert_equal(after.captured - before.captured, 60,
+		      "Captured %u packets", after.captured - before.captured);
+	zassert_equal(epb_count - first, 60, "Wrote %d packet blocks",
+		      epb_count - first);
+
+	for (i = 0; i < 60; i++) {
+		zassert_equal(epbs[first + i].orig_len, 30 + (i * 37) % 150,
+			      "Packet %d length", i);
+		zassert_equal(epbs[first + i].id, (u16_t)(id + i),
+			      "Packet %d out of order", i);
+	}
+}
+
+static void capture_overflow(void)
+{
+	struct net_capture_stats before, after;
+	u16_t id = next_id;
+	int first = epb_count;
+	u32_t count;
+	int i;
+
+	net_capture_get_stats(&before);
+
+	/* The output thread cannot run, so the ring fills up */
+	for (i = 0; i < 20; i++) {
+		capture_one(IPPROTO_UDP, 5353, 200, NET_CAPTURE_RX_IP);
+	}
+
+	net_capture_get_stats(&after);
+
+	count = after.captured - before.captured;
+
+	zassert_true(after.dropped > before.dropped, "Nothing dropped");
+	zassert_equal(count + after.dropped - before.dropped, 20,
+		      "Packets lost");
+
+	k_sleep(OUTPUT_TIME);
+	parse_capture();
+
+	zassert_equal(epb_count - first, count, "Wrote %d packet blocks",
+		      epb_count - first);
+
+	for (i = 0; i < count; i++) {
+		zassert_equal(epbs[first + i].id, (u16_t)(id + i),
+			      "Packet %d out of order", i);
+	}
+
+	/* There is room again */
+	capture_one(IPPROTO_UDP, 5353, 200, NET_CAPTURE_RX_IP);
+
+	k_sleep(OUTPUT_TIME);
+	parse_capture();
+
+	zassert_equal(epb_count - first, count + 1, "Capture did not recover");
+}
+
+static void capture_disable(void)
+{
+	int first = epb_count;
+
+	net_capture_disable(iface);
+	zassert_false(net_capture_is_enabled(iface), "Capture enabled");
+
+	capture_one(IPPROTO_UDP, 5353, 60, NET_CAPTURE_RX_IP);
+
+	k_sleep(OUTPUT_TIME);
+	parse_capture();
+
+	zassert_equal(epb_count, first, "Packet captured");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_capture_test,
+			 ztest_unit_test(capture_setup),
+			 ztest_unit_test(capture_pkts),
+			 ztest_unit_test(capture_filter),
+			 ztest_unit_test(capture_ring_laps),
+			 ztest_unit_test(capture_overflow),
+			 ztest_unit_test(capture_disable)
+			 );
+
+	ztest_run_test_suite(net_capture_test);
+}
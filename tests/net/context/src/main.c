@@ -502,6 +502,171 @@ static void net_ctx_sendto_v4(void)
 		      "Context send IPv4 UDP test failed");
 }
 
+#if defined(CONFIG_NET_QUOTA)
+static struct net_pkt *quota_tx_pkt(void)
+{
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	int len = strlen(test_data);
+
+	pkt = net_pkt_get_tx(udp_v6_ctx, K_NO_WAIT);
+	zassert_not_null(pkt, "Allocation limited by TX quota");
+
+	frag = net_pkt_get_data(udp_v6_ctx, K_NO_WAIT);
+	zassert_not_null(frag, "Cannot allocate data");
+
+	net_pkt_frag_add(pkt, frag);
+	memcpy(net_buf_add(frag, len), test_data, len);
+	net_pkt_set_appdatalen(pkt, len);
+
+	return pkt;
+}
+
+static struct net_pkt *quota_rx_pkt(int bufs)
+{
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_get_reserve_rx(0, K_NO_WAIT);
+	zassert_not_null(pkt, "Cannot allocate RX pkt");
+
+	while (bufs--) {
+		struct net_buf *frag = net_pkt_get_frag(pkt, K_NO_WAIT);
+
+		zassert_not_null(frag, "Cannot allocate RX buf");
+		net_pkt_frag_add(pkt, frag);
+	}
+
+	return pkt;
+}
+#endif /* CONFIG_NET_QUOTA */
+
+static void net_ctx_tx_quota(void)
+{
+#if defined(CONFIG_NET_QUOTA)
+	struct sockaddr_in6 addr = {
+		.sin6_family = AF_INET6,
+		.sin6_port = htons(PEER_PORT),
+		.sin6_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				   0, 0, 0, 0, 0, 0, 0, 0x2 } } },
+	};
+	atomic_val_t exceeded;
+	struct net_pkt *pkt;
+	int ret, i;
+
+	/* Let the packets of the earlier tests go out */
+	k_sleep(K_MSEC(50));
+
+	zassert_equal(atomic_get(&udp_v6_ctx->quota.tx), 0,
+		      "TX quota held");
+
+	exceeded = atomic_get(&udp_v6_ctx->quota.exceeded);
+
+	/* The TX thread cannot run, so the sent packets stay queued.
+	 * Only sending is limited, not allocation.
+	 */
+	for (i = 0; i < CONFIG_NET_QUOTA_CONTEXT_TX; i++) {
+		ret = net_context_sendto(quota_tx_pkt(),
+					 (struct sockaddr *)&addr,
+					 sizeof(struct sockaddr_in6),
+					 NULL, K_NO_WAIT, NULL, NULL);
+		zassert_equal(ret, 0, "Send %d failed (%d)", i, ret);
+	}
+
+	zassert_equal(atomic_get(&udp_v6_ctx->quota.tx),
+		      CONFIG_NET_QUOTA_CONTEXT_TX, "TX quota not used up");
+
+	pkt = quota_tx_pkt();
+
+	ret = net_context_sendto(pkt, (struct sockaddr *)&addr,
+				 sizeof(struct sockaddr_in6),
+				 NULL, K_NO_WAIT, NULL, NULL);
+	zassert_equal(ret, -EAGAIN, "TX quota not enforced (%d)", ret);
+	zassert_equal(atomic_get(&udp_v6_ctx->quota.exceeded), exceeded + 1,
+		      "Exceeded quota not counted");
+
+	/* Sent packets release the quota */
+	k_sleep(K_MSEC(50));
+
+	zassert_equal(atomic_get(&udp_v6_ctx->quota.tx), 0,
+		      "TX quota not released");
+
+	ret = net_context_sendto(pkt, (struct sockaddr *)&addr,
+				 sizeof(struct sockaddr_in6),
+				 NULL, K_NO_WAIT, NULL, NULL);
+	zassert_equal(ret, 0, "Released quota not available (%d)", ret);
+
+	k_sleep(K_MSEC(50));
+#endif /* CONFIG_NET_QUOTA */
+}
+
+static void net_ctx_rx_quota(void)
+{
+#if defined(CONFIG_NET_QUOTA)
+	struct net_if *iface = net_if_get_default();
+	struct net_pkt *pkt1, *pkt2, *pkt3;
+	atomic_val_t exceeded;
+
+	/* Context quota */
+	exceeded = atomic_get(&udp_v6_ctx->quota.exceeded);
+
+	pkt1 = quota_rx_pkt(2);
+	pkt2 = quota_rx_pkt(2);
+	pkt3 = quota_rx_pkt(1);
+
+	zassert_true(net_quota_charge_rx_context(udp_v6_ctx, pkt1),
+		     "RX pkt 1 refused");
+	zassert_true(net_quota_charge_rx_context(udp_v6_ctx, pkt2),
+		     "RX pkt 2 refused");
+	zassert_equal(atomic_get(&udp_v6_ctx->quota.rx), 4,
+		      "RX bufs not charged");
+
+	zassert_false(net_quota_charge_rx_context(udp_v6_ctx, pkt3),
+		      "RX quota not enforced");
+	zassert_equal(atomic_get(&udp_v6_ctx->quota.exceeded), exceeded + 1,
+		      "Exceeded quota not counted");
+
+	net_pkt_unref(pkt1);
+
+	zassert_equal(atomic_get(&udp_v6_ctx->quota.rx), 2,
+		      "RX bufs not released");
+	zassert_true(net_quota_charge_rx_context(udp_v6_ctx, pkt3),
+		     "Released RX quota not available");
+
+	net_pkt_unref(pkt2);
+	net_pkt_unref(pkt3);
+
+	zassert_equal(atomic_get(&udp_v6_ctx->quota.rx), 0,
+		      "RX bufs not released");
+
+	/* A packet larger than the quota is taken when nothing is held */
+	pkt1 = quota_rx_pkt(CONFIG_NET_QUOTA_CONTEXT_RX + 2);
+
+	zassert_true(net_quota_charge_rx_context(udp_v6_ctx, pkt1),
+		     "Large RX pkt refused");
+
+	net_pkt_unref(pkt1);
+
+	/* Interface quota, net_recv_data() refuses the packet */
+	pkt1 = quota_rx_pkt(CONFIG_NET_QUOTA_IFACE_RX - 1);
+	pkt2 = quota_rx_pkt(2);
+
+	zassert_true(net_quota_charge_rx_iface(iface, pkt1),
+		     "RX pkt refused by iface");
+	zassert_equal(net_recv_data(iface, pkt2), -ENOBUFS,
+		      "Interface RX quota not enforced");
+
+	net_pkt_unref(pkt1);
+
+	zassert_true(net_quota_charge_rx_iface(iface, pkt2),
+		     "Released iface RX quota not available");
+
+	net_pkt_unref(pkt2);
+
+	zassert_equal(atomic_get(&iface->quota.rx), 0,
+		      "Iface RX bufs not released");
+#endif /* CONFIG_NET_QUOTA */
+}
+
 static void recv_cb(struct net_context *context,
 		    struct net_pkt *pkt,
 		    int status,
@@ -1100,6 +1265,8 @@ void test_main(void)
 			ztest_unit_test(net_ctx_send_v4),
 			ztest_unit_test(net_ctx_sendto_v6),
 			ztest_unit_test(net_ctx_sendto_v4),
+			ztest_unit_test(net_ctx_tx_quota),
+			ztest_unit_test(net_ctx_rx_quota),
 			ztest_unit_test(net_ctx_recv_v6),
 			ztest_unit_test(net_ctx_recv_v4),
 			ztest_unit_test(net_ctx_recv_v6_fail),
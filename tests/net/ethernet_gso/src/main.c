@@ -0,0 +1,509 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <misc/printk.h>
+#include <linker/sections.h>
+
+#include <ztest.h>
+
+#include <net/ethernet.h>
+#include <net/buf.h>
+#include <net/net_ip.h>
+#include <net/net_l2.h>
+#include <net/tcp.h>
+
+#include "tcp_internal.h"
+
+#define NET_LOG_ENABLED 1
+#include "net_private.h"
+
+#if defined(CONFIG_NET_DEBUG_L2_ETHERNET)
+#define DBG(fmt, ...) printk(fmt, ##__VA_ARGS__)
+#else
+#define DBG(fmt, ...)
+#endif
+
+#define ALLOC_TIMEOUT K_MSEC(100)
+
+#define GSO_SIZE 1000
+#define SEQ 0xfffffc00
+#define IPV4_ID 0x1234
+
+#define MAX_SENT 8
+
+static struct in6_addr my_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 1, 0, 0, 0,
+				       0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+static struct in6_addr peer_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 9, 0, 0, 0,
+					 0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+
+static struct in_addr in4addr_my = { { { 192, 0, 2, 1 } } };
+static struct in_addr in4addr_peer = { { { 192, 0, 2, 2 } } };
+
+/* Packets that the drivers have been given, in order */
+static struct net_pkt *sent[MAX_SENT];
+static int sent_count;
+static int batch_calls;
+
+/* How many packets send_batch() accepts in one call */
+static int batch_limit;
+
+struct eth_context {
+	struct net_if *iface;
+	u8_t mac_addr[6];
+};
+
+static struct eth_context eth_context_batch;
+static struct eth_context eth_context_single;
+
+static struct net_if *iface_batch;
+static struct net_if *iface_single;
+
+static void eth_iface_init(struct net_if *iface)
+{
+	struct device *dev = net_if_get_device(iface);
+	struct eth_context *context = dev->driver_data;
+
+	context->iface = iface;
+
+	net_if_set_link_addr(iface, context->mac_addr,
+			     sizeof(context->mac_addr),
+			     NET_LINK_ETHERNET);
+
+	ethernet_init(iface);
+}
+
+static int eth_tx(struct net_if *iface, struct net_pkt *pkt)
+{
+	if (!pkt->frags) {
+		DBG("No data to send!\n");
+		return -ENODATA;
+	}
+
+	zassert_true(sent_count < MAX_SENT, "Too many packets sent");
+
+	sent[sent_count++] = pkt;
+
+	return 0;
+}
+
+static int eth_tx_batch(struct net_if *iface, struct net_pkt **pkts,
+			int count)
+{
+	int i;
+
+	batch_calls++;
+
+	for (i = 0; i < count && i < batch_limit; i++) {
+		eth_tx(iface, pkts[i]);
+	}
+
+	return i;
+}
+
+static enum ethernet_hw_caps eth_capabilities(struct device *dev)
+{
+	return 0;
+}
+
+static struct ethernet_api api_funcs_batch = {
+	.iface_api.init = eth_iface_init,
+	.iface_api.send = eth_tx,
+
+	.get_capabilities = eth_capabilities,
+	.send_batch = eth_tx_batch,
+};
+
+static struct ethernet_api api_funcs_single = {
+	.iface_api.init = eth_iface_init,
+	.iface_api.send = eth_tx,
+
+	.get_capabilities = eth_capabilities,
+};
+
+static int eth_init(struct device *dev)
+{
+	struct eth_context *context = dev->driver_data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	context->mac_addr[0] = 0x00;
+	context->mac_addr[1] = 0x00;
+	context->mac_addr[2] = 0x5E;
+	context->mac_addr[3] = 0x00;
+	context->mac_addr[4] = 0x53;
+	context->mac_addr[5] = sys_rand32_get();
+
+	return 0;
+}
+
+ETH_NET_DEVICE_INIT(eth_gso_batch_test, "eth_gso_batch_test",
+		    eth_init, &eth_context_batch,
+		    NULL, CONFIG_ETH_INIT_PRIORITY,
+		    &api_funcs_batch, 1500);
+
+ETH_NET_DEVICE_INIT(eth_gso_single_test, "eth_gso_single_test",
+		    eth_init, &eth_context_single,
+		    NULL, CONFIG_ETH_INIT_PRIORITY,
+		    &api_funcs_single, 1500);
+
+static void reset_sent(void)
+{
+	while (sent_count) {
+		net_pkt_unref(sent[--sent_count]);
+	}
+
+	batch_calls = 0;
+	batch_limit = MAX_SENT;
+}
+
+static void eth_setup(void)
+{
+	iface_batch = eth_context_batch.iface;
+	iface_single = eth_context_single.iface;
+
+	zassert_not_null(iface_batch, "Batch interface missing");
+	zassert_not_null(iface_single, "Single interface missing");
+}
+
+static u8_t pattern(size_t offset)
+{
+	return offset % 251;
+}
+
+/* Build a TCP packet with len bytes of data, as TCP would give it to
+ * the L2 when GSO is enabled.
+ */
+static struct net_pkt *build_pkt(struct net_if *iface, sa_family_t family,
+				  u16_t len)
+{
+	struct net_tcp_hdr tcp_hdr;
+	struct net_pkt *pkt;
+	u8_t data[64];
+	u16_t ip_hdr_len;
+	u16_t i;
+
+	pkt = net_pkt_get_reserve_tx(sizeof(struct net_eth_hdr),
+				     ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "Cannot allocate pkt");
+
+	net_pkt_set_iface(pkt, iface);
+	net_pkt_set_family(pkt, family);
+	net_pkt_set_gso_size(pkt, GSO_SIZE);
+
+	memset(net_pkt_ll(pkt), 0, net_pkt_ll_reserve(pkt));
+
+	if (family == AF_INET) {
+		struct net_ipv4_hdr hdr;
+
+		ip_hdr_len = sizeof(hdr);
+
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.vhl = 0x45;
+		hdr.ttl = 64;
+		hdr.proto = IPPROTO_TCP;
+		sys_put_be16(ip_hdr_len + NET_TCPH_LEN + len, hdr.len);
+		sys_put_be16(IPV4_ID, hdr.id);
+		net_ipaddr_copy(&hdr.src, &in4addr_my);
+		net_ipaddr_copy(&hdr.dst, &in4addr_peer);
+
+		zassert_true(net_pkt_append_all(pkt, sizeof(hdr),
+						(u8_t *)&hdr, ALLOC_TIMEOUT),
+			     "Cannot add IPv4 header");
+	} else {
+		struct net_ipv6_hdr hdr;
+
+		ip_hdr_len = sizeof(hdr);
+
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.vtc = 0x60;
+		hdr.nexthdr = IPPROTO_TCP;
+		hdr.hop_limit = 64;
+		sys_put_be16(NET_TCPH_LEN + len, hdr.len);
+		net_ipaddr_copy(&hdr.src, &my_addr);
+		net_ipaddr_copy(&hdr.dst, &peer_addr);
+
+		zassert_true(net_pkt_append_all(pkt, sizeof(hdr),
+						(u8_t *)&hdr, ALLOC_TIMEOUT),
+			     "Cannot add IPv6 header");
+	}
+
+	net_pkt_set_ip_hdr_len(pkt, ip_hdr_len);
+
+	memset(&tcp_hdr, 0, sizeof(tcp_hdr));
+	tcp_hdr.src_port = htons(4242);
+	tcp_hdr.dst_port = htons(80);
+	sys_put_be32(SEQ, tcp_hdr.seq);
+	sys_put_be32(1, tcp_hdr.ack);
+	tcp_hdr.offset = (NET_TCPH_LEN / 4) << 4;
+	tcp_hdr.flags = NET_TCP_ACK | NET_TCP_PSH | NET_TCP_FIN;
+	sys_put_be16(8192, tcp_hdr.wnd);
+
+	zassert_true(net_pkt_append_all(pkt, sizeof(tcp_hdr),
+					(u8_t *)&tcp_hdr, ALLOC_TIMEOUT),
+		     "Cannot add TCP header");
+
+	for (i = 0; i < len; ) {
+		u16_t count = min(sizeof(data), len - i);
+		u16_t j;
+
+		for (j = 0; j < count; j++) {
+			data[j] = pattern(i + j);
+		}
+
+		zassert_true(net_pkt_append_all(pkt, count, data,
+						ALLOC_TIMEOUT),
+			     "Cannot add data");
+		i += count;
+	}
+
+	return pkt;
+}
+
+/* Check that sent[] holds the frames of a len byte packet built by
+ * build_pkt().
+ */
+static void check_segments(sa_family_t family, u16_t len)
+{
+	u16_t ip_hdr_len = family == AF_INET ? sizeof(struct net_ipv4_hdr) :
+		sizeof(struct net_ipv6_hdr);
+	u16_t hdr_len = ip_hdr_len + NET_TCPH_LEN;
+	int count = (len + GSO_SIZE - 1) / GSO_SIZE;
+	static u8_t data[GSO_SIZE];
+	int i;
+
+	zassert_equal(sent_count, count, "Sent %d frames, expected %d",
+		      sent_count, count);
+
+	for (i = 0; i < count; i++) {
+		struct net_pkt *seg = sent[i];
+		u16_t seg_len = min(len - i * GSO_SIZE, GSO_SIZE);
+		struct net_tcp_hdr hdr, *tcp_hdr;
+		u16_t j;
+
+		zassert_equal(net_pkt_get_len(seg), hdr_len + seg_len,
+			      "Frame %d length %zu, expected %u", i,
+			      net_pkt_get_len(seg), hdr_len + seg_len);
+		zassert_equal(net_pkt_ip_hdr_len(seg), ip_hdr_len,
+			      "Frame %d IP header length", i);
+
+		tcp_hdr = net_tcp_get_hdr(seg, &hdr);
+		zassert_not_null(tcp_hdr, "Frame %d TCP header missing", i);
+
+		zassert_equal(sys_get_be32(tcp_hdr->seq),
+			      (u32_t)(SEQ + i * GSO_SIZE),
+			      "Frame %d sequence number", i);
+		zassert_equal(sys_get_be32(tcp_hdr->ack), 1,
+			      "Frame %d ack number", i);
+
+		if (i == count - 1) {
+			zassert_equal(tcp_hdr->flags,
+				      NET_TCP_ACK | NET_TCP_PSH | NET_TCP_FIN,
+				      "Last frame flags 0x%x",
+				      tcp_hdr->flags);
+		} else {
+			zassert_equal(tcp_hdr->flags, NET_TCP_ACK,
+				      "Frame %d flags 0x%x", i,
+				      tcp_hdr->flags);
+		}
+
+		if (family == AF_INET) {
+			zassert_equal(sys_get_be16(NET_IPV4_HDR(seg)->len),
+				      hdr_len + seg_len,
+				      "Frame %d IPv4 length", i);
+			zassert_equal(sys_get_be16(NET_IPV4_HDR(seg)->id),
+				      IPV4_ID + i, "Frame %d IPv4 id", i);
+			zassert_equal(net_calc_chksum_ipv4(seg), 0xffff,
+				      "Frame %d IPv4 checksum", i);
+		} else {
+			zassert_equal(sys_get_be16(NET_IPV6_HDR(seg)->len),
+				      NET_TCPH_LEN + seg_len,
+				      "Frame %d IPv6 length", i);
+		}
+
+		zassert_equal(net_calc_chksum_tcp(seg), 0xffff,
+			      "Frame %d TCP checksum", i);
+
+		zassert_true(net_frag_linearize(data, sizeof(data), seg,
+						hdr_len, seg_len) == seg_len,
+			     "Cannot read frame %d data", i);
+
+		for (j = 0; j < seg_len; j++) {
+			if (data[j] != pattern(i * GSO_SIZE + j)) {
+				zassert_true(false,
+					     "Frame %d data differs at %u",
+					     i, j);
+			}
+		}
+	}
+}
+
+static void gso_batch_ipv4(void)
+{
+	struct net_pkt *pkt;
+	int ret;
+
+	reset_sent();
+
+	pkt = build_pkt(iface_batch, AF_INET, 2 * GSO_SIZE + 500);
+
+	ret = net_eth_send_gso(iface_batch, pkt);
+	zassert_equal(ret, 0, "GSO send failed (%d)", ret);
+	zassert_equal(batch_calls, 1, "Frames not sent in one batch");
+
+	check_segments(AF_INET, 2 * GSO_SIZE + 500);
+
+	reset_sent();
+}
+
+static void gso_batch_ipv6(void)
+{
+	struct net_pkt *pkt;
+	int ret;
+
+	reset_sent();
+
+	pkt = build_pkt(iface_batch, AF_INET6, 3 * GSO_SIZE);
+
+	ret = net_eth_send_gso(iface_batch, pkt);
+	zassert_equal(ret, 0, "GSO send failed (%d)", ret);
+	zassert_equal(batch_calls, 1, "Frames not sent in one batch");
+
+	check_segments(AF_INET6, 3 * GSO_SIZE);
+
+	reset_sent();
+}
+
+static void gso_no_batch(void)
+{
+	struct net_pkt *pkt;
+	int ret;
+
+	reset_sent();
+
+	pkt = build_pkt(iface_single, AF_INET, 2 * GSO_SIZE + 1);
+
+	ret = net_eth_send_gso(iface_single, pkt);
+	zassert_equal(ret, 0, "GSO send failed (%d)", ret);
+
+	check_segments(AF_INET, 2 * GSO_SIZE + 1);
+
+	reset_sent();
+}
+
+static void gso_one_segment(void)
+{
+	struct net_pkt *pkt;
+	int ret;
+
+	reset_sent();
+
+	pkt = build_pkt(iface_batch, AF_INET, GSO_SIZE);
+
+	ret = net_eth_send_gso(iface_batch, pkt);
+	zassert_equal(ret, 0, "GSO send failed (%d)", ret);
+	zassert_equal(batch_calls, 0, "Single frame sent as a batch");
+	zassert_equal(sent_count, 1, "Sent %d frames", sent_count);
+	zassert_equal_ptr(sent[0], pkt, "Packet was copied");
+
+	reset_sent();
+}
+
+static void gso_too_many_segments(void)
+{
+	struct net_pkt *pkt;
+	int ret;
+
+	reset_sent();
+
+	pkt = build_pkt(iface_batch, AF_INET,
+			CONFIG_NET_L2_ETHERNET_GSO_SEGS * GSO_SIZE + 1);
+
+	ret = net_eth_send_gso(iface_batch, pkt);
+	zassert_equal(ret, -EMSGSIZE, "GSO send did not fail (%d)", ret);
+	zassert_equal(sent_count, 0, "Sent %d frames", sent_count);
+
+	/* Like send(), the packet is not consumed on error */
+	net_pkt_unref(pkt);
+}
+
+static void batch_partial(void)
+{
+	struct net_pkt *pkts[3];
+	int ret;
+	int i;
+
+	reset_sent();
+
+	for (i = 0; i < ARRAY_SIZE(pkts); i++) {
+		pkts[i] = build_pkt(iface_batch, AF_INET, 10);
+	}
+
+	batch_limit = 1;
+
+	ret = net_eth_send_batch(iface_batch, pkts, ARRAY_SIZE(pkts));
+	zassert_equal(ret, 1, "Sent %d pkts, expected 1", ret);
+	zassert_equal(sent_count, 1, "Driver got %d pkts", sent_count);
+	zassert_equal_ptr(sent[0], pkts[0], "Wrong pkt sent");
+
+	reset_sent();
+
+	for (i = 0; i < ARRAY_SIZE(pkts); i++) {
+		pkts[i] = build_pkt(iface_batch, AF_INET, 10);
+	}
+
+	batch_limit = 0;
+
+	ret = net_eth_send_batch(iface_batch, pkts, ARRAY_SIZE(pkts));
+	zassert_true(ret < 0, "Batch send did not fail (%d)", ret);
+	zassert_equal(sent_count, 0, "Driver got %d pkts", sent_count);
+
+	reset_sent();
+}
+
+static void batch_single(void)
+{
+	struct net_pkt *pkts[3];
+	int ret;
+	int i;
+
+	reset_sent();
+
+	for (i = 0; i < ARRAY_SIZE(pkts); i++) {
+		pkts[i] = build_pkt(iface_single, AF_INET6, 10);
+	}
+
+	ret = net_eth_send_batch(iface_single, pkts, ARRAY_SIZE(pkts));
+	zassert_equal(ret, ARRAY_SIZE(pkts), "Sent %d pkts", ret);
+
+	for (i = 0; i < ARRAY_SIZE(pkts); i++) {
+		zassert_equal_ptr(sent[i], pkts[i], "Pkt %d out of order",
+				  i);
+	}
+
+	reset_sent();
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_eth_gso_test,
+			 ztest_unit_test(eth_setup),
+			 ztest_unit_test(gso_batch_ipv4),
+			 ztest_unit_test(gso_batch_ipv6),
+			 ztest_unit_test(gso_no_batch),
+			 ztest_unit_test(gso_one_segment),
+			 ztest_unit_test(gso_too_many_segments),
+			 ztest_unit_test(batch_partial),
+			 ztest_unit_test(batch_single)
+			 );
+
+	ztest_run_test_suite(net_eth_gso_test);
+}
@@ -0,0 +1,529 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <linker/sections.h>
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <device.h>
+#include <init.h>
+#include <misc/printk.h>
+#include <net/buf.h>
+#include <net/net_core.h>
+#include <net/net_pkt.h>
+#include <net/net_ip.h>
+#include <net/ethernet.h>
+#include <net/tcp.h>
+
+#include <ztest.h>
+
+#include "connection.h"
+#include "tcp_internal.h"
+#include "net_private.h"
+
+#define ALLOC_TIMEOUT K_MSEC(100)
+#define WAIT_TIME K_MSEC(200)
+
+#define LOCAL_PORT 80
+#define REMOTE_PORT 4242
+
+#define SEG_LEN 100
+#define SEQ 0xffffff00
+
+#define MAX_RECV 8
+
+static struct in6_addr my_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 1, 0, 0, 0,
+				       0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+static struct in6_addr peer_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 9, 0, 0, 0,
+					 0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+
+static struct in_addr in4addr_my = { { { 192, 0, 2, 1 } } };
+static struct in_addr in4addr_peer = { { { 192, 0, 2, 2 } } };
+
+/* What the TCP connection handler got */
+struct recv_info {
+	u32_t seq;
+	u16_t data_len;
+	u8_t flags;
+	bool data_ok;
+};
+
+static struct recv_info recv[MAX_RECV];
+static int recv_count;
+static K_SEM_DEFINE(recv_sem, 0, UINT_MAX);
+
+static struct net_conn_handle *conn_handle;
+static struct net_if *iface;
+
+struct net_gro_context {
+	u8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static struct net_gro_context net_gro_context_data;
+
+static int net_gro_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_gro_iface_init(struct net_if *iface)
+{
+	struct net_gro_context *context =
+		net_if_get_device(iface)->driver_data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	context->mac_addr[0] = 0x00;
+	context->mac_addr[1] = 0x00;
+	context->mac_addr[2] = 0x5E;
+	context->mac_addr[3] = 0x00;
+	context->mac_addr[4] = 0x53;
+	context->mac_addr[5] = sys_rand32_get();
+
+	net_if_set_link_addr(iface, context->mac_addr,
+			     sizeof(context->mac_addr), NET_LINK_ETHERNET);
+}
+
+static int tester_send(struct net_if *iface, struct net_pkt *pkt)
+{
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+static struct net_if_api net_gro_if_api = {
+	.init = net_gro_iface_init,
+	.send = tester_send,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT(net_gro_test, "net_gro_test",
+		net_gro_dev_init, &net_gro_context_data, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_gro_if_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE, 1500);
+
+static u8_t pattern(u32_t seq)
+{
+	return (seq - SEQ) % 251;
+}
+
+static enum net_verdict tcp_received(struct net_conn *conn,
+				     struct net_pkt *pkt,
+				     void *user_data)
+{
+	struct net_tcp_hdr hdr, *tcp_hdr;
+	struct recv_info *info;
+	struct net_buf *frag;
+	u16_t hdr_len;
+	u16_t pos;
+	u16_t i;
+
+	zassert_true(recv_count < MAX_RECV, "Too many packets received");
+
+	info = &recv[recv_count];
+
+	tcp_hdr = net_tcp_get_hdr(pkt, &hdr);
+	zassert_not_null(tcp_hdr, "TCP header missing");
+
+	hdr_len = net_pkt_ip_hdr_len(pkt) + net_pkt_ipv6_ext_len(pkt) +
+		NET_TCP_HDR_LEN(tcp_hdr);
+
+	info->seq = sys_get_be32(tcp_hdr->seq);
+	info->flags = tcp_hdr->flags;
+	info->data_len = net_pkt_get_len(pkt) - hdr_len;
+	info->data_ok = true;
+
+	/* The IP header must describe the merged packet */
+	if (net_pkt_family(pkt) == AF_INET) {
+		zassert_equal(sys_get_be16(NET_IPV4_HDR(pkt)->len),
+			      net_pkt_get_len(pkt), "IPv4 length");
+		zassert_equal(net_calc_chksum_ipv4(pkt), 0xffff,
+			      "IPv4 checksum");
+	} else {
+		zassert_equal(sys_get_be16(NET_IPV6_HDR(pkt)->len),
+			      net_pkt_get_len(pkt) -
+			      sizeof(struct net_ipv6_hdr), "IPv6 length");
+	}
+
+	frag = net_frag_get_pos(pkt, hdr_len, &pos);
+
+	for (i = 0; i < info->data_len; i++) {
+		u8_t byte;
+
+		frag = net_frag_read_u8(frag, pos, &pos, &byte);
+		if (byte != pattern(info->seq + i)) {
+			info->data_ok = false;
+			break;
+		}
+	}
+
+	recv_count++;
+	k_sem_give(&recv_sem);
+
+	net_pkt_unref(pkt);
+
+	return NET_OK;
+}
+
+static void gro_setup(void)
+{
+	struct net_if_addr *ifaddr;
+	int ret;
+
+	iface = net_if_get_default();
+	zassert_not_null(iface, "Interface missing");
+
+	ifaddr = net_if_ipv6_addr_add(iface, &my_addr, NET_ADDR_MANUAL, 0);
+	zassert_not_null(ifaddr, "Cannot add IPv6 address");
+
+	ifaddr = net_if_ipv4_addr_add(iface, &in4addr_my, NET_ADDR_MANUAL, 0);
+	zassert_not_null(ifaddr, "Cannot add IPv4 address");
+
+	ret = net_conn_register(IPPROTO_TCP, NULL, NULL, REMOTE_PORT,
+				LOCAL_PORT, tcp_received, NULL, &conn_handle);
+	zassert_equal(ret, 0, "Cannot register connection (%d)", ret);
+}
+
+/* Build a received TCP segment carrying len bytes of data */
+static struct net_pkt *build_segment(sa_family_t family, u32_t seq,
+				     u16_t len, u8_t flags)
+{
+	struct net_tcp_hdr *tcp_hdr;
+	struct net_tcp_hdr hdr;
+	struct net_pkt *pkt;
+	u16_t ip_hdr_len;
+	u16_t i;
+
+	pkt = net_pkt_get_reserve_rx(0, ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "Cannot allocate pkt");
+
+	net_pkt_set_iface(pkt, iface);
+	net_pkt_set_family(pkt, family);
+
+	if (family == AF_INET) {
+		struct net_ipv4_hdr ip;
+
+		ip_hdr_len = sizeof(ip);
+
+		memset(&ip, 0, sizeof(ip));
+		ip.vhl = 0x45;
+		ip.ttl = 64;
+		ip.proto = IPPROTO_TCP;
+		sys_put_be16(ip_hdr_len + NET_TCPH_LEN + len, ip.len);
+		sys_put_be16(seq, ip.id);
+		net_ipaddr_copy(&ip.src, &in4addr_peer);
+		net_ipaddr_copy(&ip.dst, &in4addr_my);
+
+		zassert_true(net_pkt_append_all(pkt, sizeof(ip), (u8_t *)&ip,
+						ALLOC_TIMEOUT),
+			     "Cannot add IPv4 header");
+	} else {
+		struct net_ipv6_hdr ip;
+
+		ip_hdr_len = sizeof(ip);
+
+		memset(&ip, 0, sizeof(ip));
+		ip.vtc = 0x60;
+		ip.nexthdr = IPPROTO_TCP;
+		ip.hop_limit = 64;
+		sys_put_be16(NET_TCPH_LEN + len, ip.len);
+		net_ipaddr_copy(&ip.src, &peer_addr);
+		net_ipaddr_copy(&ip.dst, &my_addr);
+
+		zassert_true(net_pkt_append_all(pkt, sizeof(ip), (u8_t *)&ip,
+						ALLOC_TIMEOUT),
+			     "Cannot add IPv6 header");
+	}
+
+	net_pkt_set_ip_hdr_len(pkt, ip_hdr_len);
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.src_port = htons(REMOTE_PORT);
+	hdr.dst_port = htons(LOCAL_PORT);
+	sys_put_be32(seq, hdr.seq);
+	sys_put_be32(1, hdr.ack);
+	hdr.offset = (NET_TCPH_LEN / 4) << 4;
+	hdr.flags = flags;
+	sys_put_be16(8192, hdr.wnd);
+
+	zassert_true(net_pkt_append_all(pkt, sizeof(hdr), (u8_t *)&hdr,
+					ALLOC_TIMEOUT),
+		     "Cannot add TCP header");
+
+	for (i = 0; i < len; i++) {
+		u8_t byte = pattern(seq + i);
+
+		zassert_true(net_pkt_append_all(pkt, 1, &byte,
+						ALLOC_TIMEOUT),
+			     "Cannot add data");
+	}
+
+	if (family == AF_INET) {
+		NET_IPV4_HDR(pkt)->chksum = ~net_calc_chksum_ipv4(pkt);
+	}
+
+	tcp_hdr = net_pkt_tcp_data(pkt);
+	tcp_hdr->chksum = ~net_calc_chksum_tcp(pkt);
+
+	return pkt;
+}
+
+struct segment {
+	u32_t seq;
+	u16_t len;
+	u8_t flags;
+	bool bad_chksum;
+};
+
+/* Give the segments to the stack as one RX burst, like a driver that
+ * has several frames pending.
+ */
+static void receive_burst(sa_family_t family, const struct segment *segs,
+			  int count)
+{
+	struct net_pkt *pkts[MAX_RECV];
+	int i;
+
+	zassert_true(count <= MAX_RECV, "Too many segments");
+
+	recv_count = 0;
+	k_sem_reset(&recv_sem);
+
+	for (i = 0; i < count; i++) {
+		pkts[i] = build_segment(family, segs[i].seq, segs[i].len,
+					segs[i].flags);
+
+		if (segs[i].bad_chksum) {
+			net_pkt_tcp_data(pkts[i])->chksum ^= 0x5555;
+		}
+	}
+
+	k_sched_lock();
+
+	for (i = 0; i < count; i++) {
+		zassert_equal(net_recv_data(iface, pkts[i]), 0,
+			      "Cannot receive pkt %d", i);
+	}
+
+	k_sched_unlock();
+}
+
+/* Check what was delivered: for each packet, the sequence number of
+ * its first byte and its amount of data.
+ */
+static void check_received(const struct recv_info *expected, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		zassert_equal(k_sem_take(&recv_sem, WAIT_TIME), 0,
+			      "Packet %d not received", i);
+	}
+
+	/* Nothing more should come */
+	zassert_not_equal(k_sem_take(&recv_sem, WAIT_TIME), 0,
+			  "Extra packet received");
+
+	zassert_equal(recv_count, count, "Received %d packets, expected %d",
+		      recv_count, count);
+
+	for (i = 0; i < count; i++) {
+		zassert_equal(recv[i].seq, expected[i].seq,
+			      "Packet %d seq 0x%x, expected 0x%x", i,
+			      recv[i].seq, expected[i].seq);
+		zassert_equal(recv[i].data_len, expected[i].data_len,
+			      "Packet %d has %u bytes, expected %u", i,
+			      recv[i].data_len, expected[i].data_len);
+		zassert_equal(recv[i].flags, expected[i].flags,
+			      "Packet %d flags 0x%x, expected 0x%x", i,
+			      recv[i].flags, expected[i].flags);
+		zassert_true(recv[i].data_ok, "Packet %d data corrupted", i);
+	}
+}
+
+#define SEG(n, f) { .seq = SEQ + (n) * SEG_LEN, .len = SEG_LEN, .flags = (f) }
+#define RECV(n, segs, f) { .seq = SEQ + (n) * SEG_LEN, \
+			   .data_len = (segs) * SEG_LEN, .flags = (f) }
+
+static void gro_merge_ipv4(void)
+{
+	const struct segment segs[] = {
+		SEG(0, NET_TCP_ACK),
+		SEG(1, NET_TCP_ACK),
+		SEG(2, NET_TCP_ACK),
+	};
+	const struct recv_info expected[] = {
+		RECV(0, 3, NET_TCP_ACK),
+	};
+
+	receive_burst(AF_INET, segs, ARRAY_SIZE(segs));
+	check_received(expected, ARRAY_SIZE(expected));
+}
+
+static void gro_merge_ipv6(void)
+{
+	const struct segment segs[] = {
+		SEG(0, NET_TCP_ACK),
+		SEG(1, NET_TCP_ACK),
+		SEG(2, NET_TCP_ACK | NET_TCP_PSH),
+	};
+	const struct recv_info expected[] = {
+		RECV(0, 3, NET_TCP_ACK | NET_TCP_PSH),
+	};
+
+	receive_burst(AF_INET6, segs, ARRAY_SIZE(segs));
+	check_received(expected, ARRAY_SIZE(expected));
+}
+
+static void gro_flush_on_psh(void)
+{
+	const struct segment segs[] = {
+		SEG(0, NET_TCP_ACK),
+		SEG(1, NET_TCP_ACK | NET_TCP_PSH),
+		SEG(2, NET_TCP_ACK),
+		SEG(3, NET_TCP_ACK),
+	};
+	const struct recv_info expected[] = {
+		RECV(0, 2, NET_TCP_ACK | NET_TCP_PSH),
+		RECV(2, 2, NET_TCP_ACK),
+	};
+
+	receive_burst(AF_INET, segs, ARRAY_SIZE(segs));
+	check_received(expected, ARRAY_SIZE(expected));
+}
+
+static void gro_psh_not_held(void)
+{
+	const struct segment segs[] = {
+		SEG(0, NET_TCP_ACK | NET_TCP_PSH),
+		SEG(1, NET_TCP_ACK),
+	};
+	const struct recv_info expected[] = {
+		RECV(0, 1, NET_TCP_ACK | NET_TCP_PSH),
+		RECV(1, 1, NET_TCP_ACK),
+	};
+
+	receive_burst(AF_INET, segs, ARRAY_SIZE(segs));
+	check_received(expected, ARRAY_SIZE(expected));
+}
+
+static void gro_out_of_order(void)
+{
+	const struct segment segs[] = {
+		SEG(0, NET_TCP_ACK),
+		SEG(2, NET_TCP_ACK),
+		SEG(1, NET_TCP_ACK),
+		SEG(3, NET_TCP_ACK),
+	};
+	const struct recv_info expected[] = {
+		RECV(0, 1, NET_TCP_ACK),
+		RECV(2, 1, NET_TCP_ACK),
+		RECV(1, 2, NET_TCP_ACK),
+	};
+
+	/* Segment 3 follows segment 1 that was held before it */
+	receive_burst(AF_INET, segs, ARRAY_SIZE(segs));
+	check_received(expected, ARRAY_SIZE(expected));
+}
+
+static void gro_flag_change(void)
+{
+	const struct segment segs[] = {
+		SEG(0, NET_TCP_ACK),
+		SEG(1, NET_TCP_ACK),
+		SEG(2, NET_TCP_ACK | NET_TCP_FIN),
+		SEG(3, NET_TCP_ACK | NET_TCP_URG),
+	};
+	const struct recv_info expected[] = {
+		RECV(0, 2, NET_TCP_ACK),
+		RECV(2, 1, NET_TCP_ACK | NET_TCP_FIN),
+		RECV(3, 1, NET_TCP_ACK | NET_TCP_URG),
+	};
+
+	receive_burst(AF_INET6, segs, ARRAY_SIZE(segs));
+	check_received(expected, ARRAY_SIZE(expected));
+}
+
+static void gro_bad_chksum(void)
+{
+	const struct segment segs[] = {
+		SEG(0, NET_TCP_ACK),
+		{ .seq = SEQ + SEG_LEN, .len = SEG_LEN, .flags = NET_TCP_ACK,
+		  .bad_chksum = true },
+		SEG(2, NET_TCP_ACK),
+	};
+	const struct recv_info expected[] = {
+		RECV(0, 1, NET_TCP_ACK),
+		RECV(2, 1, NET_TCP_ACK),
+	};
+
+	/* The corrupted segment is dropped by the TCP layer */
+	receive_burst(AF_INET, segs, ARRAY_SIZE(segs));
+	check_received(expected, ARRAY_SIZE(expected));
+}
+
+static void gro_max_segs(void)
+{
+	const struct segment segs[] = {
+		SEG(0, NET_TCP_ACK),
+		SEG(1, NET_TCP_ACK),
+		SEG(2, NET_TCP_ACK),
+		SEG(3, NET_TCP_ACK),
+		SEG(4, NET_TCP_ACK),
+		SEG(5, NET_TCP_ACK),
+	};
+	const struct recv_info expected[] = {
+		RECV(0, CONFIG_NET_GRO_MAX_SEGS, NET_TCP_ACK),
+		RECV(CONFIG_NET_GRO_MAX_SEGS, 6 - CONFIG_NET_GRO_MAX_SEGS,
+		     NET_TCP_ACK),
+	};
+
+	receive_burst(AF_INET, segs, ARRAY_SIZE(segs));
+	check_received(expected, ARRAY_SIZE(expected));
+}
+
+static void gro_flush_end_of_burst(void)
+{
+	const struct segment segs[] = {
+		SEG(0, NET_TCP_ACK),
+	};
+	const struct recv_info expected[] = {
+		RECV(0, 1, NET_TCP_ACK),
+	};
+
+	/* A segment without PSH is held only until the RX queue is
+	 * empty, so it must not wait for the next one.
+	 */
+	receive_burst(AF_INET, segs, ARRAY_SIZE(segs));
+	check_received(expected, ARRAY_SIZE(expected));
+
+	receive_burst(AF_INET6, segs, ARRAY_SIZE(segs));
+	check_received(expected, ARRAY_SIZE(expected));
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_gro_test,
+			 ztest_unit_test(gro_setup),
+			 ztest_unit_test(gro_merge_ipv4),
+			 ztest_unit_test(gro_merge_ipv6),
+			 ztest_unit_test(gro_flush_on_psh),
+			 ztest_unit_test(gro_psh_not_held),
+			 ztest_unit_test(gro_out_of_order),
+			 ztest_unit_test(gro_flag_change),
+			 ztest_unit_test(gro_bad_chksum),
+			 ztest_unit_test(gro_max_segs),
+			 ztest_unit_test(gro_flush_end_of_burst)
+			 );
+
+	ztest_run_test_suite(net_gro_test);
+}
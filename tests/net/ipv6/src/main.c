@@ -629,6 +629,48 @@ static void test_change_ll_addr(void)
 		     "Wrong link address 2");
 }
 
+/**
+ * @brief IPv6 neighbor cache eviction
+ */
+static void test_nbr_evict(void)
+{
+	struct net_linkaddr_storage llstorage;
+	struct net_linkaddr lladdr;
+	struct in6_addr addr;
+	struct net_nbr *nbr;
+	int i;
+
+	memset(llstorage.addr, 0, sizeof(llstorage.addr));
+	lladdr.len = 6;
+	lladdr.addr = llstorage.addr;
+	lladdr.type = NET_LINK_ETHERNET;
+
+	/* Adding more neighbors than fit in the cache must succeed as the
+	 * older stale entries are evicted.
+	 */
+	for (i = 0; i <= CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		net_ipv6_addr_create(&addr, 0x2001, 0xdb8, 0, 0, 0, 0, 0x10,
+				     i + 1);
+		llstorage.addr[0] = 0x02;
+		llstorage.addr[5] = i + 1;
+
+		nbr = net_ipv6_nbr_add(net_if_get_default(), &addr, &lladdr,
+				       false, NET_IPV6_NBR_STATE_STALE);
+		zassert_not_null(nbr, "Cannot add neighbor %s\n",
+				 net_sprint_ipv6_addr(&addr));
+	}
+
+	nbr = net_ipv6_nbr_lookup(net_if_get_default(), &addr);
+	zassert_not_null(nbr, "Neighbor %s not found in cache\n",
+			 net_sprint_ipv6_addr(&addr));
+
+	for (i = 0; i <= CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		net_ipv6_addr_create(&addr, 0x2001, 0xdb8, 0, 0, 0, 0, 0x10,
+				     i + 1);
+		net_ipv6_nbr_rm(net_if_get_default(), &addr);
+	}
+}
+
 void test_main(void)
 {
 	ztest_test_suite(test_ipv6_fn,
@@ -642,7 +684,8 @@ void test_main(void)
 			 ztest_unit_test(test_ra_message),
 			 ztest_unit_test(test_hbho_message),
 			 ztest_unit_test(test_change_ll_addr),
-			 ztest_unit_test(test_prefix_timeout)
+			 ztest_unit_test(test_prefix_timeout),
+			 ztest_unit_test(test_nbr_evict)
 			 );
 	ztest_run_test_suite(test_ipv6_fn);
 }
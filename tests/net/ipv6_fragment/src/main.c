@@ -688,6 +688,60 @@ static void test_recv_ipv6_fragment(void)
 	 */
 }
 
+static void test_reassembly(void)
+{
+	static const u16_t offsets[] = { 16, 0, 8 };
+	static struct net_reass reass;
+	struct net_buf *buf[ARRAY_SIZE(offsets)];
+	struct net_buf *chain;
+	int i, ret;
+
+	for (i = 0; i < ARRAY_SIZE(offsets); i++) {
+		buf[i] = net_pkt_get_reserve_rx_data(0, ALLOC_TIMEOUT);
+		zassert_not_null(buf[i], "Cannot allocate data buffer");
+
+		memset(net_buf_add(buf[i], 8), offsets[i], 8);
+	}
+
+	net_reass_init(&reass);
+
+	ret = net_reass_add(&reass, buf[0], offsets[0], 8);
+	zassert_equal(ret, 0, "Cannot add last fragment");
+
+	ret = net_reass_set_size(&reass, 24);
+	zassert_equal(ret, 0, "Cannot set size");
+
+	ret = net_reass_add(&reass, buf[1], offsets[1], 8);
+	zassert_equal(ret, 0, "Cannot add first fragment");
+
+	zassert_false(net_reass_complete(&reass), "Reassembly done too early");
+
+	ret = net_reass_add(&reass, buf[1], offsets[1], 8);
+	zassert_equal(ret, -EALREADY, "Duplicate fragment accepted");
+
+	ret = net_reass_add(&reass, buf[2], 4, 8);
+	zassert_equal(ret, -EINVAL, "Overlapping fragment accepted");
+
+	ret = net_reass_add(&reass, buf[2], 24, 8);
+	zassert_equal(ret, -EINVAL, "Fragment beyond the end accepted");
+
+	ret = net_reass_add(&reass, buf[2], offsets[2], 8);
+	zassert_equal(ret, 0, "Cannot add middle fragment");
+
+	zassert_true(net_reass_complete(&reass), "Reassembly not done");
+
+	chain = net_reass_splice(&reass);
+	zassert_equal(chain, buf[1], "Wrong first fragment");
+
+	for (i = 0; chain; i++, chain = chain->frags) {
+		zassert_equal(chain->data[0], i * 8, "Fragments out of order");
+	}
+
+	zassert_equal(i, 3, "Wrong fragment count");
+
+	net_buf_unref(buf[1]);
+}
+
 void test_main(void)
 {
 	ztest_test_suite(net_ipv6_fragment_test,
@@ -696,7 +750,8 @@ void test_main(void)
 			 ztest_unit_test(test_find_last_ipv6_fragment_hbho_udp),
 			 ztest_unit_test(test_find_last_ipv6_fragment_hbho_frag),
 			 ztest_unit_test(test_send_ipv6_fragment),
-			 ztest_unit_test(test_recv_ipv6_fragment)
+			 ztest_unit_test(test_recv_ipv6_fragment),
+			 ztest_unit_test(test_reassembly)
 			 );
 
 	ztest_run_test_suite(net_ipv6_fragment_test);
@@ -22,6 +22,7 @@
 #include <tc_util.h>
 
 #include <net/coap.h>
+#include <net/coap_transmission.h>
 
 #define COAP_BUF_SIZE 128
 #define COAP_LIMITED_BUF_SIZE 13
@@ -486,6 +487,262 @@ done:
 	return result;
 }
 
+static int parse_uri_path_pdu(struct coap_packet *cpkt, struct net_pkt *pkt,
+			      int num)
+{
+	u8_t hdr[] = { 0x40, 0x01, 0x12, 0x34 };
+	u8_t opt[2];
+	struct net_buf *frag;
+	int i;
+
+	frag = net_buf_alloc(&coap_data_pool, K_NO_WAIT);
+	if (!frag) {
+		TC_PRINT("Could not get buffer from pool\n");
+		return -ENOMEM;
+	}
+
+	net_pkt_frag_add(pkt, frag);
+
+	net_pkt_append_all(pkt, sizeof(ipv6_simple_pdu),
+			   (u8_t *)ipv6_simple_pdu, K_FOREVER);
+	net_pkt_append_all(pkt, sizeof(hdr), hdr, K_FOREVER);
+
+	/* URI-Path options "a", "b", ... followed by Content-Format 42 */
+	for (i = 0; i < num; i++) {
+		opt[0] = i ? 0x01 : (COAP_OPTION_URI_PATH << 4) | 0x01;
+		opt[1] = 'a' + i;
+		net_pkt_append_all(pkt, sizeof(opt), opt, K_FOREVER);
+	}
+
+	opt[0] = ((COAP_OPTION_CONTENT_FORMAT - COAP_OPTION_URI_PATH) << 4) |
+		 0x01;
+	opt[1] = 42;
+	net_pkt_append_all(pkt, sizeof(opt), opt, K_FOREVER);
+
+	net_pkt_set_ip_hdr_len(pkt, NET_IPV6H_LEN);
+	net_pkt_set_ipv6_ext_len(pkt, 0);
+
+	return coap_packet_parse(cpkt, pkt, NULL, 0);
+}
+
+static int test_find_options_index(void)
+{
+	/* Fits the option index, and needs the fallback */
+	int nums[] = { 2, CONFIG_COAP_OPTION_INDEX_SIZE + 2 };
+	struct coap_option options[CONFIG_COAP_OPTION_INDEX_SIZE + 2];
+	struct coap_packet cpkt;
+#if CONFIG_COAP_OPTION_INDEX_SIZE > 0
+	struct net_buf *frag;
+#endif
+	struct net_pkt *pkt;
+	int result = TC_FAIL;
+	int i, j, r;
+
+	for (i = 0; i < ARRAY_SIZE(nums); i++) {
+		pkt = net_pkt_get_reserve(&coap_pkt_slab, 0, K_NO_WAIT);
+		if (!pkt) {
+			TC_PRINT("Could not get packet from pool\n");
+			goto done;
+		}
+
+		r = parse_uri_path_pdu(&cpkt, pkt, nums[i]);
+		if (r) {
+			TC_PRINT("Could not parse packet\n");
+			net_pkt_unref(pkt);
+			goto done;
+		}
+
+		r = coap_find_options(&cpkt, COAP_OPTION_URI_PATH, options,
+				      ARRAY_SIZE(options));
+		if (r != nums[i]) {
+			TC_PRINT("Found %d URI-Path options, expected %d\n",
+				 r, nums[i]);
+			net_pkt_unref(pkt);
+			goto done;
+		}
+
+		for (j = 0; j < r; j++) {
+			if (options[j].len != 1 ||
+			    options[j].value[0] != 'a' + j) {
+				TC_PRINT("URI-Path option %d mismatch\n", j);
+				net_pkt_unref(pkt);
+				goto done;
+			}
+		}
+
+		/* limited by the vector length */
+		r = coap_find_options(&cpkt, COAP_OPTION_URI_PATH, options, 1);
+		if (r != 1 || options[0].value[0] != 'a') {
+			TC_PRINT("Vector length not respected\n");
+			net_pkt_unref(pkt);
+			goto done;
+		}
+
+		r = coap_find_options(&cpkt, COAP_OPTION_CONTENT_FORMAT,
+				      options, 1);
+		if (r != 1 || coap_option_value_to_int(&options[0]) != 42) {
+			TC_PRINT("Content-Format option mismatch\n");
+			net_pkt_unref(pkt);
+			goto done;
+		}
+
+		r = coap_find_options(&cpkt, COAP_OPTION_OBSERVE, options, 1);
+		if (r != 0) {
+			TC_PRINT("There shouldn't be an Observe option\n");
+			net_pkt_unref(pkt);
+			goto done;
+		}
+
+		net_pkt_unref(pkt);
+	}
+
+#if CONFIG_COAP_OPTION_INDEX_SIZE > 0
+	/* A packet without CoAP data must not keep the index of the
+	 * previous packet
+	 */
+	pkt = net_pkt_get_reserve(&coap_pkt_slab, 0, K_NO_WAIT);
+	if (!pkt) {
+		TC_PRINT("Could not get packet from pool\n");
+		goto done;
+	}
+
+	r = parse_uri_path_pdu(&cpkt, pkt, 2);
+	net_pkt_unref(pkt);
+	if (r || !cpkt.opt_indexed) {
+		TC_PRINT("Options not indexed\n");
+		goto done;
+	}
+
+	pkt = net_pkt_get_reserve(&coap_pkt_slab, 0, K_NO_WAIT);
+	if (!pkt) {
+		TC_PRINT("Could not get packet from pool\n");
+		goto done;
+	}
+
+	frag = net_buf_alloc(&coap_data_pool, K_NO_WAIT);
+	if (!frag) {
+		TC_PRINT("Could not get buffer from pool\n");
+		net_pkt_unref(pkt);
+		goto done;
+	}
+
+	net_pkt_frag_add(pkt, frag);
+	net_pkt_append_all(pkt, sizeof(ipv6_simple_pdu),
+			   (u8_t *)ipv6_simple_pdu, K_FOREVER);
+	net_pkt_set_ip_hdr_len(pkt, NET_IPV6H_LEN);
+	net_pkt_set_ipv6_ext_len(pkt, 0);
+
+	coap_packet_parse(&cpkt, pkt, NULL, 0);
+	net_pkt_unref(pkt);
+
+	if (cpkt.opt_indexed || cpkt.opt_count) {
+		TC_PRINT("Index of the previous packet kept\n");
+		goto done;
+	}
+#endif
+
+	result = TC_PASS;
+
+done:
+	TC_END_RESULT(result);
+
+	return result;
+}
+
+static int tree_resource_hit = -1;
+
+static int tree_resource_get(struct coap_resource *resource,
+			     struct coap_packet *request)
+{
+	tree_resource_hit = POINTER_TO_INT(resource->user_data);
+
+	return 0;
+}
+
+static const char * const tree_path_a[] = { "a", NULL };
+static const char * const tree_path_ab[] = { "a", "b", NULL };
+static const char * const tree_path_ac[] = { "a", "c", NULL };
+static const char * const tree_path_b[] = { "b", NULL };
+
+static struct coap_resource tree_resources[] = {
+	{ .path = tree_path_a, .get = tree_resource_get,
+	  .user_data = INT_TO_POINTER(0) },
+	{ .path = tree_path_ab, .get = tree_resource_get,
+	  .user_data = INT_TO_POINTER(1) },
+	{ .path = tree_path_ac, .get = tree_resource_get,
+	  .user_data = INT_TO_POINTER(2) },
+	/* Shadowed by the first resource with the same path */
+	{ .path = tree_path_ab, .get = tree_resource_get,
+	  .user_data = INT_TO_POINTER(3) },
+	{ .path = tree_path_b, .get = tree_resource_get,
+	  .user_data = INT_TO_POINTER(4) },
+	{ },
+};
+
+static int test_resource_tree(void)
+{
+	/* Number of URI-Path options and the resource expected to match */
+	int nums[] = { 1, 2, 3 };
+	int hits[] = { 0, 1, -1 };
+	struct coap_resource_node nodes[10];
+	struct coap_resource_tree tree;
+	struct coap_option options[4];
+	struct coap_packet cpkt;
+	struct net_pkt *pkt;
+	int result = TC_FAIL;
+	int i, r;
+
+	/* "a", "a/b", "a/c" and "b" need four nodes */
+	r = coap_resource_tree_init(&tree, tree_resources, nodes, 3);
+	if (r != -ENOMEM) {
+		TC_PRINT("Tree should not fit in three nodes\n");
+		goto done;
+	}
+
+	r = coap_resource_tree_init(&tree, tree_resources, nodes,
+				    ARRAY_SIZE(nodes));
+	if (r) {
+		TC_PRINT("Could not build the resource tree\n");
+		goto done;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(nums); i++) {
+		pkt = net_pkt_get_reserve(&coap_pkt_slab, 0, K_NO_WAIT);
+		if (!pkt) {
+			TC_PRINT("Could not get packet from pool\n");
+			goto done;
+		}
+
+		r = parse_uri_path_pdu(&cpkt, pkt, nums[i]);
+		if (r) {
+			TC_PRINT("Could not parse packet\n");
+			net_pkt_unref(pkt);
+			goto done;
+		}
+
+		r = coap_find_options(&cpkt, COAP_OPTION_URI_PATH, options,
+				      ARRAY_SIZE(options));
+
+		tree_resource_hit = -1;
+		r = coap_handle_request_tree(&cpkt, &tree, options, r);
+		net_pkt_unref(pkt);
+
+		if (r != (hits[i] < 0 ? -ENOENT : 0) ||
+		    tree_resource_hit != hits[i]) {
+			TC_PRINT("Path of %d segments dispatched to %d (%d)\n",
+				 nums[i], tree_resource_hit, r);
+			goto done;
+		}
+	}
+
+	result = TC_PASS;
+
+done:
+	TC_END_RESULT(result);
+
+	return result;
+}
+
 static int test_retransmit_second_round(void)
 {
 	struct coap_packet cpkt, resp;
@@ -590,6 +847,261 @@ done:
 	return result;
 }
 
+static struct coap_transmission transmission;
+static struct coap_pending tx_pendings[NUM_PENDINGS];
+static struct coap_pending *tx_heap[NUM_PENDINGS];
+static int tx_sent;
+static int tx_replied;
+static u16_t tx_ack_id;
+static bool tx_ack_in_send;
+static bool tx_pkt_freed;
+
+static struct coap_pending *transmission_ack(u16_t id);
+
+static int transmission_send(struct coap_transmission *tx,
+			     struct net_pkt *pkt,
+			     const struct sockaddr *addr)
+{
+	tx_sent++;
+
+	/* The ACK arrives while the message is still being sent */
+	if (tx_ack_in_send) {
+		tx_ack_in_send = false;
+		transmission_ack(tx_ack_id);
+
+		if (!pkt->ref || !pkt->frags) {
+			tx_pkt_freed = true;
+		}
+	}
+
+	/* "sending" consumes the reference like net_app_send_pkt() */
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+static int transmission_reply(const struct coap_packet *response,
+			      struct coap_reply *reply,
+			      const struct sockaddr *from)
+{
+	tx_replied++;
+
+	return 0;
+}
+
+static int init_message(struct coap_packet *cpkt, u8_t type,
+			const u8_t *token, u8_t tkl, u16_t id)
+{
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+
+	pkt = net_pkt_get_reserve(&coap_pkt_slab, 0, K_NO_WAIT);
+	if (!pkt) {
+		TC_PRINT("Could not get packet from pool\n");
+		return -ENOMEM;
+	}
+
+	frag = net_buf_alloc(&coap_data_pool, K_NO_WAIT);
+	if (!frag) {
+		TC_PRINT("Could not get buffer from pool\n");
+		net_pkt_unref(pkt);
+		return -ENOMEM;
+	}
+
+	net_pkt_frag_add(pkt, frag);
+
+	return coap_packet_init(cpkt, pkt, 1, type, tkl, (u8_t *)token,
+				COAP_METHOD_GET, id);
+}
+
+/* Returns the pending matching an ACK with the given id */
+static struct coap_pending *transmission_ack(u16_t id)
+{
+	struct coap_pending *pending;
+	struct coap_packet resp;
+
+	if (init_message(&resp, COAP_TYPE_ACK, NULL, 0, id)) {
+		return NULL;
+	}
+
+	pending = coap_transmission_pending_received(&transmission, &resp);
+	net_pkt_unref(resp.pkt);
+
+	return pending;
+}
+
+static int test_transmission(void)
+{
+	static const u8_t token[] = { 0xca, 0xfe, 0x00, 0x01 };
+	struct coap_pending *pending[2] = { };
+	struct coap_reply reply = { };
+	struct coap_packet cpkt;
+	int result = TC_FAIL;
+	u16_t id[2];
+	int i, r;
+
+	coap_transmission_init(&transmission, tx_pendings, tx_heap,
+			       NUM_PENDINGS, transmission_send, NULL);
+
+	for (i = 0; i < ARRAY_SIZE(pending); i++) {
+		id[i] = coap_next_id();
+
+		r = init_message(&cpkt, COAP_TYPE_CON, token, sizeof(token),
+				 id[i]);
+		if (r) {
+			TC_PRINT("Could not initialize packet\n");
+			goto done;
+		}
+
+		pending[i] = coap_transmission_next_unused(&transmission);
+		if (!pending[i]) {
+			TC_PRINT("No free pending\n");
+			net_pkt_unref(cpkt.pkt);
+			goto done;
+		}
+
+		coap_pending_init(pending[i], &cpkt,
+				  (struct sockaddr *)&dummy_addr);
+
+		if (i == 0) {
+			coap_reply_init(&reply, &cpkt);
+			reply.reply = transmission_reply;
+			coap_transmission_reply_add(&transmission, &reply);
+		}
+
+		r = coap_transmission_send(&transmission, pending[i]);
+		if (r) {
+			TC_PRINT("Could not send message %d\n", i);
+			goto done;
+		}
+	}
+
+	/* NSTART is 1, the second message waits for the first one */
+	if (tx_sent != 1) {
+		TC_PRINT("Sent %d messages, expected 1\n", tx_sent);
+		goto done;
+	}
+
+	if (transmission_ack(id[1])) {
+		TC_PRINT("Queued message should not be acknowledged\n");
+		goto done;
+	}
+
+	if (transmission_ack(id[0]) != pending[0] || tx_sent != 2) {
+		TC_PRINT("First message not acknowledged\n");
+		goto done;
+	}
+
+	/* Separate response, matched by token */
+	r = init_message(&cpkt, COAP_TYPE_CON, token, sizeof(token),
+			 coap_next_id());
+	if (r) {
+		TC_PRINT("Could not initialize packet\n");
+		goto done;
+	}
+
+	if (coap_transmission_response_received(
+		    &transmission, &cpkt,
+		    (struct sockaddr *)&dummy_addr) != &reply ||
+	    tx_replied != 1) {
+		TC_PRINT("Reply not matched by token\n");
+		net_pkt_unref(cpkt.pkt);
+		goto done;
+	}
+
+	net_pkt_unref(cpkt.pkt);
+
+	if (transmission_ack(id[1]) != pending[1]) {
+		TC_PRINT("Second message not acknowledged\n");
+		goto done;
+	}
+
+	if (transmission.heap_count) {
+		TC_PRINT("There should be no messages in flight\n");
+		goto done;
+	}
+
+	result = TC_PASS;
+
+done:
+	for (i = 0; i < ARRAY_SIZE(pending); i++) {
+		if (pending[i]) {
+			coap_transmission_cancel(&transmission, pending[i]);
+		}
+	}
+
+	coap_transmission_reply_remove(&transmission, &reply);
+
+	TC_END_RESULT(result);
+
+	return result;
+}
+
+static int test_transmission_ack_in_send(void)
+{
+	struct coap_pending *pending = NULL;
+	struct coap_packet cpkt;
+	int result = TC_FAIL;
+	u32_t free_pkts;
+	int r;
+
+	coap_transmission_init(&transmission, tx_pendings, tx_heap,
+			       NUM_PENDINGS, transmission_send, NULL);
+
+	free_pkts = k_mem_slab_num_free_get(&coap_pkt_slab);
+	tx_sent = 0;
+	tx_ack_id = coap_next_id();
+
+	r = init_message(&cpkt, COAP_TYPE_CON, NULL, 0, tx_ack_id);
+	if (r) {
+		TC_PRINT("Could not initialize packet\n");
+		goto done;
+	}
+
+	pending = coap_transmission_next_unused(&transmission);
+	if (!pending) {
+		TC_PRINT("No free pending\n");
+		net_pkt_unref(cpkt.pkt);
+		goto done;
+	}
+
+	coap_pending_init(pending, &cpkt, (struct sockaddr *)&dummy_addr);
+
+	tx_ack_in_send = true;
+
+	r = coap_transmission_send(&transmission, pending);
+	if (r || tx_sent != 1) {
+		TC_PRINT("Could not send message\n");
+		goto done;
+	}
+
+	if (tx_pkt_freed) {
+		TC_PRINT("Packet released while it was sent\n");
+		goto done;
+	}
+
+	if (pending->pkt || transmission.heap_count) {
+		TC_PRINT("Message not acknowledged\n");
+		goto done;
+	}
+
+	if (k_mem_slab_num_free_get(&coap_pkt_slab) != free_pkts) {
+		TC_PRINT("Packet leaked\n");
+		goto done;
+	}
+
+	result = TC_PASS;
+
+done:
+	if (pending) {
+		coap_transmission_cancel(&transmission, pending);
+	}
+
+	TC_END_RESULT(result);
+
+	return result;
+}
+
 static void get_from_ip_addr(struct coap_packet *cpkt,
 			     struct sockaddr_in6 *from)
 {
@@ -1561,7 +2073,11 @@ static const struct {
 	{ "Parse emtpy PDU test", test_parse_empty_pdu, },
 	{ "Parse empty PDU test no marker", test_parse_empty_pdu_1, },
 	{ "Parse simple PDU test", test_parse_simple_pdu, },
+	{ "Find options from the option index", test_find_options_index, },
+	{ "Dispatch requests from a resource tree", test_resource_tree, },
 	{ "Test retransmission", test_retransmit_second_round, },
+	{ "Test transmission layer", test_transmission, },
+	{ "Test ACK while sending", test_transmission_ack_in_send, },
 	{ "Test observer server", test_observer_server, },
 	{ "Test observer client", test_observer_client, },
 	{ "Test block sized transfer", test_block_size, },
@@ -21,6 +21,9 @@
 
 #define NET_LOG_ENABLED 1
 #include "net_private.h"
+#include "udp_internal.h"
+
+#include "dns_cache.h"
 
 #if defined(CONFIG_NET_DEBUG_DNS_RESOLVE)
 #define DBG(fmt, ...) printk(fmt, ##__VA_ARGS__)
@@ -33,6 +36,10 @@
 #define NAME_IPV4 "192.0.2.1"
 #define NAME_IPV6 "2001:db8::1"
 
+/* Names answered by the responder, the first label selects the answer */
+#define NAME_FOUND "found.zephyr.test"
+#define NAME_NX "nx.zephyr.test"
+
 #define DNS_TIMEOUT 500 /* ms */
 
 #if defined(CONFIG_NET_IPV6)
@@ -58,6 +65,8 @@ static struct net_if *iface1;
 static bool test_failed;
 static bool test_started;
 static bool timeout_query;
+static bool respond_query;
+static int responder_queries;
 static struct k_sem wait_data;
 static struct k_sem wait_data2;
 static u16_t current_dns_id;
@@ -119,6 +128,84 @@ static inline int get_slot_by_id(struct dns_resolve_context *ctx,
 	return -1;
 }
 
+/* Answers the DNS query in pkt like a server at CONFIG_DNS_SERVER1
+ * would, either with the address 192.0.2.1 or with a name error.
+ */
+static void dns_respond(struct net_if *iface, struct net_pkt *pkt)
+{
+	static const u8_t answer[] = {
+		0xc0, 0x0c,		/* pointer to the QNAME */
+		0x00, 0x01,		/* type A */
+		0x00, 0x01,		/* class IN */
+		0x00, 0x00, 0x00, 0x3c,	/* TTL 60 s */
+		0x00, 0x04,		/* RDLENGTH */
+		192, 0, 2, 1,
+	};
+	u16_t offset = NET_IPV4H_LEN + NET_UDPH_LEN;
+	u8_t msg[128];
+	struct net_udp_hdr *udp;
+	struct net_ipv4_hdr *ip;
+	struct net_pkt *rsp;
+	struct net_buf *frag;
+	u16_t port;
+	int len;
+
+	/* The queries are sent to the IPv4 server */
+	if ((NET_IPV4_HDR(pkt)->vhl & 0xf0) != 0x40) {
+		return;
+	}
+
+	len = net_frag_linearize(msg, sizeof(msg) - sizeof(answer), pkt,
+				 offset, net_pkt_get_len(pkt) - offset);
+	if (len < 0) {
+		test_failed = true;
+		return;
+	}
+
+	responder_queries++;
+
+	/* QR and RD flags, RA flag */
+	msg[2] = 0x81;
+	msg[3] = 0x80;
+
+	if (msg[12] == 2 && !memcmp(&msg[13], "nx", 2)) {
+		msg[3] |= 3; /* RCODE name error */
+	} else {
+		msg[7] = 1; /* ANCOUNT */
+		memcpy(msg + len, answer, sizeof(answer));
+		len += sizeof(answer);
+	}
+
+	rsp = net_pkt_get_reserve_rx(0, K_FOREVER);
+	frag = net_pkt_get_frag(rsp, K_FOREVER);
+	net_pkt_frag_add(rsp, frag);
+	net_pkt_set_iface(rsp, iface);
+	net_pkt_set_family(rsp, AF_INET);
+	net_pkt_set_ip_hdr_len(rsp, NET_IPV4H_LEN);
+
+	/* The response swaps the addresses and the ports of the query */
+	net_buf_add_mem(frag, NET_IPV4_HDR(pkt), offset);
+	net_buf_add_mem(frag, msg, len);
+
+	ip = NET_IPV4_HDR(rsp);
+	net_ipaddr_copy(&ip->src, &NET_IPV4_HDR(pkt)->dst);
+	net_ipaddr_copy(&ip->dst, &NET_IPV4_HDR(pkt)->src);
+	ip->len[0] = (offset + len) >> 8;
+	ip->len[1] = offset + len;
+
+	udp = (struct net_udp_hdr *)(frag->data + NET_IPV4H_LEN);
+	port = udp->src_port;
+	udp->src_port = udp->dst_port;
+	udp->dst_port = port;
+	udp->len = htons(NET_UDPH_LEN + len);
+	net_udp_set_chksum(rsp, rsp->frags);
+
+	if (net_recv_data(iface, rsp) < 0) {
+		net_pkt_unref(rsp);
+		test_failed = true;
+	}
+}
+
 static int sender_iface(struct net_if *iface, struct net_pkt *pkt)
 {
 	if (!pkt->frags) {
@@ -126,6 +213,11 @@ static int sender_iface(struct net_if *iface, struct net_pkt *pkt)
 		return -ENODATA;
 	}
 
+	if (respond_query) {
+		dns_respond(iface, pkt);
+		goto out;
+	}
+
 	if (!timeout_query) {
 		struct net_if_test *data =
 			net_if_get_device(iface)->driver_data;
@@ -431,17 +523,19 @@ static void dns_query_ipv6_server_count(void)
 static void dns_query_too_many(void)
 {
 	int expected_status = DNS_EAI_CANCELED;
-	int ret;
+	int ret, i;
 
 	timeout_query = true;
 
-	ret = dns_get_addr_info(NAME4,
-				DNS_QUERY_TYPE_A,
-				NULL,
-				dns_result_cb_timeout,
-				INT_TO_POINTER(expected_status),
-				DNS_TIMEOUT);
-	zassert_equal(ret, 0, "Cannot create IPv4 query");
+	for (i = 0; i < CONFIG_DNS_NUM_CONCUR_QUERIES; i++) {
+		ret = dns_get_addr_info(NAME4,
+					DNS_QUERY_TYPE_A,
+					NULL,
+					dns_result_cb_timeout,
+					INT_TO_POINTER(expected_status),
+					DNS_TIMEOUT);
+		zassert_equal(ret, 0, "Cannot create IPv4 query");
+	}
 
 	ret = dns_get_addr_info(NAME4,
 				DNS_QUERY_TYPE_A,
@@ -451,8 +545,10 @@ static void dns_query_too_many(void)
 				DNS_TIMEOUT);
 	zassert_equal(ret, -EAGAIN, "Should have run out of space");
 
-	if (k_sem_take(&wait_data, WAIT_TIME)) {
-		zassert_true(false, "Timeout while waiting data");
+	for (i = 0; i < CONFIG_DNS_NUM_CONCUR_QUERIES; i++) {
+		if (k_sem_take(&wait_data, WAIT_TIME)) {
+			zassert_true(false, "Timeout while waiting data");
+		}
 	}
 
 	timeout_query = false;
@@ -750,6 +846,199 @@ static void dns_query_ipv6_numeric(void)
 	}
 }
 
+static void dns_cache_answers(void)
+{
+	static struct dns_cache cache;
+	struct sockaddr addr = { .sa_family = AF_INET };
+	struct dns_cache_entry entry;
+	char name[] = "x.zephyr.test";
+	int ret, i;
+
+	dns_cache_add(&cache, NAME4, DNS_QUERY_TYPE_A, DNS_EAI_ALLDONE,
+		      &addr, 1, 1);
+	dns_cache_add(&cache, NAME6, DNS_QUERY_TYPE_AAAA, DNS_EAI_NODATA,
+		      NULL, 0, 0);
+
+	/**TESTPOINT: Check the answers are cached, names ignore the case */
+	ret = dns_cache_find(&cache, "4.ZEPHYR.test", DNS_QUERY_TYPE_A,
+			     &entry);
+	zassert_equal(ret, 0, "Answer not cached");
+	zassert_equal(entry.status, DNS_EAI_ALLDONE, "Invalid status");
+	zassert_equal(entry.addr_count, 1, "Invalid address count");
+
+	ret = dns_cache_find(&cache, NAME4, DNS_QUERY_TYPE_AAAA, &entry);
+	zassert_equal(ret, -ENOENT, "Query type not checked");
+
+	/**TESTPOINT: Check the negative answers are cached */
+	ret = dns_cache_find(&cache, NAME6, DNS_QUERY_TYPE_AAAA, &entry);
+	zassert_equal(ret, 0, "Negative answer not cached");
+	zassert_equal(entry.status, DNS_EAI_NODATA, "Invalid status");
+	zassert_equal(entry.addr_count, 0, "Invalid address count");
+
+	/**TESTPOINT: Check the answers with a TTL of 0 are not cached */
+	dns_cache_add(&cache, name, DNS_QUERY_TYPE_A, DNS_EAI_ALLDONE,
+		      &addr, 1, 0);
+	ret = dns_cache_find(&cache, name, DNS_QUERY_TYPE_A, &entry);
+	zassert_equal(ret, -ENOENT, "Answer with TTL 0 cached");
+
+	/**TESTPOINT: Check the least recently used answer is evicted */
+	for (i = 0; i < CONFIG_DNS_RESOLVER_CACHE_ENTRIES; i++) {
+		ret = dns_cache_find(&cache, NAME4, DNS_QUERY_TYPE_A, &entry);
+		zassert_equal(ret, 0, "Recently used answer evicted");
+
+		name[0] = 'a' + i;
+		dns_cache_add(&cache, name, DNS_QUERY_TYPE_A, DNS_EAI_ALLDONE,
+			      &addr, 1, 1);
+	}
+
+	ret = dns_cache_find(&cache, NAME6, DNS_QUERY_TYPE_AAAA, &entry);
+	zassert_equal(ret, -ENOENT, "Least recently used answer not evicted");
+	zassert_true(cache.evictions > 0, "Evictions not counted");
+
+	/**TESTPOINT: Check the answers expire */
+	k_sleep(K_SECONDS(1) + 100);
+
+	ret = dns_cache_find(&cache, NAME4, DNS_QUERY_TYPE_A, &entry);
+	zassert_equal(ret, -ENOENT, "Answer did not expire");
+}
+
+struct resolve_result {
+	int status;
+	int addr_count;
+};
+
+void dns_result_count_cb(enum dns_resolve_status status,
+			 struct dns_addrinfo *info,
+			 void *user_data)
+{
+	struct resolve_result *result = user_data;
+
+	if (status == DNS_EAI_INPROGRESS) {
+		if (info->ai_family == AF_INET &&
+		    net_ipv4_addr_cmp(&net_sin(&info->ai_addr)->sin_addr,
+				      &my_addr2)) {
+			result->addr_count++;
+		}
+
+		return;
+	}
+
+	result->status = status;
+	k_sem_give(&wait_data2);
+}
+
+static void dns_query_shared(void)
+{
+#if CONFIG_DNS_NUM_CONCUR_QUERIES > 1
+	struct dns_resolve_context *ctx = dns_resolve_get_default();
+	struct resolve_result result1 = { 0 };
+	struct resolve_result result2 = { 0 };
+	u32_t shared = ctx->cache.shared;
+	u16_t dns_id1, dns_id2;
+	int ret, i;
+
+	respond_query = true;
+	responder_queries = 0;
+
+	ret = dns_resolve_name(ctx, NAME_FOUND, DNS_QUERY_TYPE_A, &dns_id1,
+			       dns_result_count_cb, &result1, DNS_TIMEOUT);
+	zassert_equal(ret, 0, "Cannot create IPv4 query");
+
+	ret = dns_resolve_name(ctx, NAME_FOUND, DNS_QUERY_TYPE_A, &dns_id2,
+			       dns_result_count_cb, &result2, DNS_TIMEOUT);
+	zassert_equal(ret, 0, "Cannot create the second IPv4 query");
+
+	/**TESTPOINT: Check the second query waits for the first one */
+	zassert_not_equal(dns_id1, dns_id2, "Same DNS id");
+	i = get_slot_by_id(ctx, dns_id2);
+	zassert_true(i >= 0, "No slot for the second query");
+	zassert_equal(ctx->queries[i].wait_id, dns_id1, "Query not shared");
+	zassert_equal(ctx->cache.shared, shared + 1, "Sharing not counted");
+
+	for (i = 0; i < 2; i++) {
+		if (k_sem_take(&wait_data2, WAIT_TIME)) {
+			zassert_true(false, "Timeout while waiting data");
+		}
+	}
+
+	/**TESTPOINT: Check both queries get the answer of one response */
+	zassert_equal(responder_queries, 1, "Query sent twice");
+	zassert_equal(result1.status, DNS_EAI_ALLDONE, "Invalid status");
+	zassert_equal(result1.addr_count, 1, "Invalid address count");
+	zassert_equal(result2.status, DNS_EAI_ALLDONE, "Invalid status");
+	zassert_equal(result2.addr_count, 1, "Invalid address count");
+	zassert_false(test_failed, "Cannot respond");
+
+	respond_query = false;
+	dns_resolve_cache_flush(ctx);
+#else
+	ztest_test_skip();
+#endif
+}
+
+static void dns_query_cached(void)
+{
+	struct dns_resolve_context *ctx = dns_resolve_get_default();
+	struct resolve_result result = { 0 };
+	u32_t hits;
+	int ret;
+
+	respond_query = true;
+	responder_queries = 0;
+
+	ret = dns_resolve_name(ctx, NAME_FOUND, DNS_QUERY_TYPE_A, NULL,
+			       dns_result_count_cb, &result, DNS_TIMEOUT);
+	zassert_equal(ret, 0, "Cannot create IPv4 query");
+
+	if (k_sem_take(&wait_data2, WAIT_TIME)) {
+		zassert_true(false, "Timeout while waiting data");
+	}
+
+	zassert_equal(result.status, DNS_EAI_ALLDONE, "Invalid status");
+	zassert_equal(result.addr_count, 1, "Invalid address count");
+
+	/**TESTPOINT: Check the answer is given from the cache */
+	memset(&result, 0, sizeof(result));
+	hits = ctx->cache.hits;
+
+	ret = dns_resolve_name(ctx, NAME_FOUND, DNS_QUERY_TYPE_A, NULL,
+			       dns_result_count_cb, &result, DNS_TIMEOUT);
+	zassert_equal(ret, 0, "Cannot create IPv4 query");
+	zassert_equal(result.status, DNS_EAI_ALLDONE, "Answer not cached");
+	zassert_equal(result.addr_count, 1, "Invalid address count");
+	zassert_equal(ctx->cache.hits, hits + 1, "Hit not counted");
+	k_sem_take(&wait_data2, K_NO_WAIT);
+
+	/**TESTPOINT: Check a name error gives DNS_EAI_NONAME */
+	memset(&result, 0, sizeof(result));
+
+	ret = dns_resolve_name(ctx, NAME_NX, DNS_QUERY_TYPE_A, NULL,
+			       dns_result_count_cb, &result, DNS_TIMEOUT);
+	zassert_equal(ret, 0, "Cannot create IPv4 query");
+
+	if (k_sem_take(&wait_data2, WAIT_TIME)) {
+		zassert_true(false, "Timeout while waiting data");
+	}
+
+	zassert_equal(result.status, DNS_EAI_NONAME, "Invalid status");
+	zassert_equal(result.addr_count, 0, "Invalid address count");
+
+	/**TESTPOINT: Check the name error is cached too */
+	memset(&result, 0, sizeof(result));
+
+	ret = dns_resolve_name(ctx, NAME_NX, DNS_QUERY_TYPE_A, NULL,
+			       dns_result_count_cb, &result, DNS_TIMEOUT);
+	zassert_equal(ret, 0, "Cannot create IPv4 query");
+	zassert_equal(result.status, DNS_EAI_NONAME, "Name error not cached");
+	k_sem_take(&wait_data2, K_NO_WAIT);
+
+	zassert_equal(responder_queries, 2, "Cached names queried again");
+	zassert_false(test_failed, "Cannot respond");
+
+	respond_query = false;
+	dns_resolve_cache_flush(ctx);
+}
+
 void test_main(void)
 {
 	ztest_test_suite(dns_tests,
@@ -769,7 +1058,10 @@ void test_main(void)
 			 ztest_unit_test(dns_query_ipv4),
 			 ztest_unit_test(dns_query_ipv6),
 			 ztest_unit_test(dns_query_ipv4_numeric),
-			 ztest_unit_test(dns_query_ipv6_numeric));
+			 ztest_unit_test(dns_query_ipv6_numeric),
+			 ztest_unit_test(dns_query_shared),
+			 ztest_unit_test(dns_query_cached),
+			 ztest_unit_test(dns_cache_answers));
 
 	ztest_run_test_suite(dns_tests);
 }
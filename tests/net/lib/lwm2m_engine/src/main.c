@@ -0,0 +1,531 @@
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#include <ztest.h>
+
+#include <net/socket.h>
+#include <net/lwm2m.h>
+
+#include "lwm2m_object.h"
+#include "lwm2m_engine.h"
+
+#define TEST_OBJ_ID		32769
+
+#define TEST_RES_S32		0
+#define TEST_RES_STRING		1
+
+#define TEST_MAX_ID		2
+#define MAX_INSTANCE_COUNT	2
+
+#define STRING_LEN		16
+
+/* The test acts as the LwM2M server, on the same address as the client */
+#define SERVER_PORT		5683
+#define MY_IPV6_ADDR		"2001:db8::1"
+
+#define COAP_GET		0x01
+#define COAP_PUT		0x03
+#define COAP_CHANGED		0x44
+#define COAP_CONTENT		0x45
+
+#define OPT_OBSERVE		6
+#define OPT_URI_PATH		11
+#define OPT_URI_QUERY		15
+#define OPT_ACCEPT		17
+
+#define REQUEST_TOKEN		0x7f
+#define NOTIFY_WAIT		K_SECONDS(6)
+
+/* allowed distance of a notification from its pmin/pmax */
+#define MARGIN			K_MSEC(300)
+
+struct notification {
+	s64_t time;
+	u8_t token;
+	char value[8];
+};
+
+static struct lwm2m_ctx client;
+static int server_sock;
+static struct sockaddr_in6 client_addr;
+static u16_t next_mid;
+
+static struct notification notified[8];
+static int notified_count;
+
+struct test_data {
+	s32_t s32;
+	char string[STRING_LEN];
+};
+
+static struct test_data data[MAX_INSTANCE_COUNT];
+
+static struct lwm2m_engine_obj test_obj;
+static struct lwm2m_engine_obj_field fields[] = {
+	OBJ_FIELD_DATA(TEST_RES_S32, RW, S32),
+	OBJ_FIELD_DATA(TEST_RES_STRING, RW, STRING),
+};
+
+static struct lwm2m_engine_obj_inst inst[MAX_INSTANCE_COUNT];
+static struct lwm2m_engine_res_inst res[MAX_INSTANCE_COUNT][TEST_MAX_ID];
+
+static struct lwm2m_engine_obj_inst *test_obj_create(u16_t obj_inst_id)
+{
+	int index, i = 0;
+
+	for (index = 0; index < MAX_INSTANCE_COUNT; index++) {
+		if (!inst[index].obj) {
+			break;
+		}
+	}
+
+	if (index >= MAX_INSTANCE_COUNT) {
+		return NULL;
+	}
+
+	memset(&data[index], 0, sizeof(data[index]));
+
+	INIT_OBJ_RES_DATA(res[index], i, TEST_RES_S32,
+			  &data[index].s32, sizeof(data[index].s32));
+	INIT_OBJ_RES_DATA(res[index], i, TEST_RES_STRING,
+			  data[index].string, STRING_LEN);
+
+	inst[index].resources = res[index];
+	inst[index].resource_count = i;
+
+	return &inst[index];
+}
+
+static void test_register(void)
+{
+	struct lwm2m_engine_obj_inst *obj_inst = NULL;
+	int ret;
+
+	test_obj.obj_id = TEST_OBJ_ID;
+	test_obj.fields = fields;
+	test_obj.field_count = ARRAY_SIZE(fields);
+	test_obj.max_instance_count = MAX_INSTANCE_COUNT;
+	test_obj.create_cb = test_obj_create;
+	lwm2m_register_obj(&test_obj);
+
+	ret = lwm2m_create_obj_inst(TEST_OBJ_ID, 0, &obj_inst);
+	zassert_equal(ret, 0, "Cannot create instance 0");
+}
+
+static void test_handle_get(void)
+{
+	struct lwm2m_engine_res_handle handle;
+	int ret;
+
+	ret = lwm2m_engine_res_handle_get("32769/0/0", &handle);
+	zassert_equal(ret, 0, "Cannot resolve handle");
+	zassert_equal_ptr(handle.obj_inst, &inst[0], "Wrong instance");
+	zassert_equal_ptr(handle.res, &res[0][TEST_RES_S32],
+			  "Wrong resource");
+
+	ret = lwm2m_engine_res_handle_get("32769/0", &handle);
+	zassert_equal(ret, -EINVAL, "Resolved an instance path");
+
+	ret = lwm2m_engine_res_handle_get("32769/1/0", &handle);
+	zassert_equal(ret, -ENOENT, "Resolved a missing instance");
+
+	ret = lwm2m_engine_res_handle_get("32769/0/5", &handle);
+	zassert_equal(ret, -ENOENT, "Resolved a missing resource");
+}
+
+static void test_handle_set_get(void)
+{
+	struct lwm2m_engine_res_handle s32_handle, string_handle;
+	char string[STRING_LEN];
+	s32_t value;
+	int ret;
+
+	ret = lwm2m_engine_res_handle_get("32769/0/0", &s32_handle);
+	zassert_equal(ret, 0, "Cannot resolve handle");
+	ret = lwm2m_engine_res_handle_get("32769/0/1", &string_handle);
+	zassert_equal(ret, 0, "Cannot resolve handle");
+
+	/* written through the handle, read through the path and back */
+	ret = lwm2m_engine_res_handle_set_s32(&s32_handle, -1234);
+	zassert_equal(ret, 0, "Cannot set through handle");
+	zassert_equal(data[0].s32, -1234, "Wrong resource data");
+
+	ret = lwm2m_engine_get_s32("32769/0/0", &value);
+	zassert_equal(ret, 0, "Cannot get through path");
+	zassert_equal(value, -1234, "Wrong value through path");
+
+	ret = lwm2m_engine_set_s32("32769/0/0", 5678);
+	zassert_equal(ret, 0, "Cannot set through path");
+
+	ret = lwm2m_engine_res_handle_get_s32(&s32_handle, &value);
+	zassert_equal(ret, 0, "Cannot get through handle");
+	zassert_equal(value, 5678, "Wrong value through handle");
+
+	ret = lwm2m_engine_res_handle_set_string(&string_handle, "hello");
+	zassert_equal(ret, 0, "Cannot set string through handle");
+
+	memset(string, 0, sizeof(string));
+	ret = lwm2m_engine_res_handle_get_string(&string_handle, string,
+						 sizeof(string));
+	zassert_equal(ret, 0, "Cannot get string through handle");
+	zassert_equal(strcmp(string, "hello"), 0, "Wrong string");
+}
+
+static void test_handle_deleted(void)
+{
+	struct lwm2m_engine_obj_inst *obj_inst = NULL;
+	struct lwm2m_engine_res_handle handle;
+	s32_t value;
+	int ret;
+
+	ret = lwm2m_engine_res_handle_get("32769/0/0", &handle);
+	zassert_equal(ret, 0, "Cannot resolve handle");
+
+	ret = lwm2m_delete_obj_inst(TEST_OBJ_ID, 0);
+	zassert_equal(ret, 0, "Cannot delete instance 0");
+
+	ret = lwm2m_engine_res_handle_get_s32(&handle, &value);
+	zassert_equal(ret, -ENOENT, "Handle of a deleted instance works");
+
+	/* the new instance takes the same slot and id as the old one */
+	ret = lwm2m_create_obj_inst(TEST_OBJ_ID, 0, &obj_inst);
+	zassert_equal(ret, 0, "Cannot create instance 0");
+	zassert_equal_ptr(obj_inst, handle.obj_inst, "Slot not reused");
+
+	ret = lwm2m_engine_res_handle_get_s32(&handle, &value);
+	zassert_equal(ret, -ENOENT, "Handle of a re-created instance works");
+	ret = lwm2m_engine_res_handle_set_s32(&handle, 1);
+	zassert_equal(ret, -ENOENT, "Handle of a re-created instance works");
+	zassert_equal(data[0].s32, 0, "Stale handle wrote the data");
+
+	ret = lwm2m_engine_res_handle_get("32769/0/0", &handle);
+	zassert_equal(ret, 0, "Cannot resolve handle");
+
+	ret = lwm2m_engine_res_handle_set_s32(&handle, 1);
+	zassert_equal(ret, 0, "Cannot set through new handle");
+}
+
+static void test_handle_unregister(void)
+{
+	struct lwm2m_engine_res_handle handle;
+	s32_t value;
+	int ret;
+
+	ret = lwm2m_engine_res_handle_get("32769/0/0", &handle);
+	zassert_equal(ret, 0, "Cannot resolve handle");
+
+	lwm2m_unregister_obj(&test_obj);
+
+	ret = lwm2m_engine_res_handle_get_s32(&handle, &value);
+	zassert_equal(ret, -ENOENT, "Handle of an unregistered object works");
+
+	ret = lwm2m_engine_res_handle_get("32769/0/0", &handle);
+	zassert_equal(ret, -ENOENT, "Resolved an unregistered object");
+
+	lwm2m_register_obj(&test_obj);
+
+	ret = lwm2m_engine_res_handle_get("32769/0/0", &handle);
+	zassert_equal(ret, 0, "Cannot resolve handle");
+}
+
+static u8_t *put_option(u8_t *p, u16_t *last, u16_t num,
+			const char *value, size_t len)
+{
+	/* small deltas and lengths only, no extended fields */
+	*p++ = ((num - *last) << 4) | len;
+	memcpy(p, value, len);
+	*last = num;
+
+	return p + len;
+}
+
+static u8_t *put_options(u8_t *p, u16_t *last, u16_t num,
+			 const char *str, char sep)
+{
+	const char *end;
+
+	while (str && *str) {
+		end = strchr(str, sep);
+		if (!end) {
+			end = str + strlen(str);
+		}
+
+		p = put_option(p, last, num, str, end - str);
+		str = *end ? end + 1 : end;
+	}
+
+	return p;
+}
+
+/* Returns the response code to the request with the given id, 0 after
+ * acknowledging and logging a notification, or -EAGAIN on timeout.
+ */
+static int recv_msg(s32_t timeout, u16_t mid)
+{
+	struct pollfd fds = {
+		.fd = server_sock,
+		.events = POLLIN,
+	};
+	struct notification *n;
+	u8_t buf[64], ack[4];
+	u8_t *p, *end;
+	ssize_t len;
+
+	if (poll(&fds, 1, timeout) <= 0) {
+		return -EAGAIN;
+	}
+
+	len = recv(server_sock, buf, sizeof(buf), 0);
+	zassert_true(len >= 4, "Short message");
+
+	/* piggybacked response */
+	if ((buf[0] & 0x30) == 0x20) {
+		zassert_equal((buf[2] << 8) | buf[3], mid, "Unexpected ack");
+		return buf[1];
+	}
+
+	zassert_equal(buf[0] & 0x3f, 0x01, "Not a confirmable notification");
+	zassert_equal(buf[1], COAP_CONTENT, "Not a notification");
+
+	ack[0] = 0x60;
+	ack[1] = 0x00;
+	ack[2] = buf[2];
+	ack[3] = buf[3];
+	zassert_equal(sendto(server_sock, ack, sizeof(ack), 0,
+			     (struct sockaddr *)&client_addr,
+			     sizeof(client_addr)), sizeof(ack),
+		      "Cannot send ack");
+
+	zassert_true(notified_count < ARRAY_SIZE(notified),
+		     "Too many notifications");
+	n = &notified[notified_count++];
+	memset(n, 0, sizeof(*n));
+	n->time = k_uptime_get();
+	n->token = buf[4];
+
+	/* skip the options to the payload */
+	p = buf + 5;
+	end = buf + len;
+	while (p < end && *p != 0xff) {
+		p += 1 + (*p & 0x0f);
+	}
+
+	if (p < end) {
+		p++;
+		memcpy(n->value, p, min(end - p, sizeof(n->value) - 1));
+	}
+
+	return 0;
+}
+
+static int request(u8_t code, u8_t token, int observe,
+		   const char *path, const char *query)
+{
+	u8_t buf[64], *p = buf;
+	u16_t mid = ++next_mid;
+	u16_t last = 0;
+	int ret;
+
+	*p++ = 0x41;
+	*p++ = code;
+	*p++ = mid >> 8;
+	*p++ = mid;
+	*p++ = token;
+
+	if (observe >= 0) {
+		u8_t value = observe;
+
+		p = put_option(p, &last, OPT_OBSERVE, (char *)&value,
+			       observe ? 1 : 0);
+	}
+
+	p = put_options(p, &last, OPT_URI_PATH, path, '/');
+	p = put_options(p, &last, OPT_URI_QUERY, query, '&');
+
+	if (code == COAP_GET) {
+		/* plain text */
+		p = put_option(p, &last, OPT_ACCEPT, "", 0);
+	}
+
+	zassert_equal(sendto(server_sock, buf, p - buf, 0,
+			     (struct sockaddr *)&client_addr,
+			     sizeof(client_addr)), p - buf,
+		      "Cannot send request");
+
+	do {
+		ret = recv_msg(K_SECONDS(2), mid);
+	} while (!ret);
+
+	return ret;
+}
+
+/* Returns the index of the next notification in the log */
+static int wait_notification(s32_t timeout)
+{
+	s64_t end = k_uptime_get() + timeout;
+	int count = notified_count;
+	s64_t left;
+
+	while (notified_count == count) {
+		left = end - k_uptime_get();
+		zassert_true(left > 0, "No notification");
+		zassert_true(recv_msg(left, 0) >= 0, "No notification");
+	}
+
+	return count;
+}
+
+static void test_start(void)
+{
+	struct lwm2m_engine_obj_inst *obj_inst = NULL;
+	struct sockaddr_in6 addr;
+	int ret;
+
+	ret = lwm2m_create_obj_inst(TEST_OBJ_ID, 1, &obj_inst);
+	zassert_equal(ret, 0, "Cannot create instance 1");
+
+	server_sock = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(server_sock >= 0, "Cannot create socket");
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin6_family = AF_INET6;
+	addr.sin6_port = htons(SERVER_PORT);
+	ret = bind(server_sock, (struct sockaddr *)&addr, sizeof(addr));
+	zassert_equal(ret, 0, "Cannot bind");
+
+	memset(&client_addr, 0, sizeof(client_addr));
+	client_addr.sin6_family = AF_INET6;
+	client_addr.sin6_port = htons(CONFIG_LWM2M_LOCAL_PORT);
+	ret = inet_pton(AF_INET6, MY_IPV6_ADDR, &client_addr.sin6_addr);
+	zassert_equal(ret, 1, "inet_pton failed");
+
+	memset(&client, 0, sizeof(client));
+	client.net_init_timeout = K_SECONDS(1);
+	client.net_timeout = K_SECONDS(1);
+
+	ret = lwm2m_engine_start(&client, MY_IPV6_ADDR, SERVER_PORT);
+	zassert_equal(ret, 0, "Cannot start the engine");
+}
+
+static void test_observe_pmax(void)
+{
+	s64_t start;
+	int i, ret;
+
+	notified_count = 0;
+
+	ret = request(COAP_PUT, REQUEST_TOKEN, -1, "32769/0/0",
+		      "pmin=1&pmax=2");
+	zassert_equal(ret, COAP_CHANGED, "Cannot write attributes");
+
+	start = k_uptime_get();
+	ret = request(COAP_GET, 1, 0, "32769/0/0", NULL);
+	zassert_equal(ret, COAP_CONTENT, "Cannot observe");
+
+	/* nothing changes, so the notification waits for pmax */
+	i = wait_notification(NOTIFY_WAIT);
+	zassert_equal(notified[i].token, 1, "Wrong observer");
+	zassert_true(notified[i].time - start >= K_SECONDS(2) - MARGIN,
+		     "Notified before pmax");
+	zassert_true(notified[i].time - start <= K_SECONDS(2) + MARGIN,
+		     "Notified after pmax");
+}
+
+static void test_observe_pmin(void)
+{
+	s64_t last;
+	int i, ret;
+
+	notified_count = 0;
+
+	i = wait_notification(NOTIFY_WAIT);
+	last = notified[i].time;
+
+	/* the change is held back until pmin has passed */
+	ret = lwm2m_engine_set_s32("32769/0/0", 4321);
+	zassert_equal(ret, 0, "Cannot set value");
+
+	i = wait_notification(NOTIFY_WAIT);
+	zassert_equal(notified[i].token, 1, "Wrong observer");
+	zassert_true(notified[i].time - last >= K_SECONDS(1) - MARGIN,
+		     "Notified before pmin");
+	zassert_true(notified[i].time - last <= K_SECONDS(1) + MARGIN,
+		     "Notified after pmin");
+	zassert_equal(strcmp(notified[i].value, "4321"), 0,
+		      "Wrong notified value");
+}
+
+static void test_observer_heap(void)
+{
+	static const u8_t order[] = { 3, 3, 2 };
+	s64_t start;
+	int i, ret;
+
+	/* a removed observer is not notified any more */
+	ret = request(COAP_GET, 1, 1, "32769/0/0", NULL);
+	zassert_equal(ret, COAP_CONTENT, "Cannot cancel observe");
+
+	ret = request(COAP_PUT, REQUEST_TOKEN, -1, "32769/0/1",
+		      "pmin=0&pmax=5");
+	zassert_equal(ret, COAP_CHANGED, "Cannot write attributes");
+	ret = request(COAP_PUT, REQUEST_TOKEN, -1, "32769/1/0",
+		      "pmin=0&pmax=10");
+	zassert_equal(ret, COAP_CHANGED, "Cannot write attributes");
+
+	notified_count = 0;
+	start = k_uptime_get();
+
+	ret = request(COAP_GET, 2, 0, "32769/0/1", NULL);
+	zassert_equal(ret, COAP_CONTENT, "Cannot observe");
+	ret = request(COAP_GET, 3, 0, "32769/1/0", NULL);
+	zassert_equal(ret, COAP_CONTENT, "Cannot observe");
+
+	/* the update moves the last observer to the top of the heap */
+	ret = request(COAP_PUT, REQUEST_TOKEN, -1, "32769/1/0",
+		      "pmin=0&pmax=2");
+	zassert_equal(ret, COAP_CHANGED, "Cannot write attributes");
+
+	for (i = 0; i < ARRAY_SIZE(order); i++) {
+		zassert_equal(wait_notification(NOTIFY_WAIT), i,
+			      "Lost a notification");
+		zassert_equal(notified[i].token, order[i],
+			      "Notified out of order");
+	}
+
+	zassert_true(notified[0].time - start <= K_SECONDS(2) + MARGIN,
+		     "Updated pmax not applied");
+
+	/* removing the top of the heap leaves the other observer due */
+	ret = request(COAP_GET, 3, 1, "32769/1/0", NULL);
+	zassert_equal(ret, COAP_CONTENT, "Cannot cancel observe");
+
+	i = wait_notification(NOTIFY_WAIT);
+	zassert_equal(notified[i].token, 2, "Wrong observer");
+	zassert_true(notified[i].time - start >= K_SECONDS(10) - MARGIN,
+		     "Notified before pmax");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(lwm2m_engine,
+			 ztest_unit_test(test_register),
+			 ztest_unit_test(test_handle_get),
+			 ztest_unit_test(test_handle_set_get),
+			 ztest_unit_test(test_handle_deleted),
+			 ztest_unit_test(test_handle_unregister),
+			 ztest_unit_test(test_start),
+			 ztest_unit_test(test_observe_pmax),
+			 ztest_unit_test(test_observe_pmin),
+			 ztest_unit_test(test_observer_heap));
+
+	ztest_run_test_suite(lwm2m_engine);
+}
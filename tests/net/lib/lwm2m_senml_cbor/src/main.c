@@ -0,0 +1,799 @@
+/*
+ * Copyright (c) 2018 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#include <ztest.h>
+
+#include <net/net_pkt.h>
+#include <net/coap.h>
+#include <net/lwm2m.h>
+
+#include "lwm2m_object.h"
+#include "lwm2m_engine.h"
+#include "lwm2m_rw_senml_cbor.h"
+
+#define TEST_OBJ_ID		32769
+
+#define TEST_RES_S32		0
+#define TEST_RES_S64		1
+#define TEST_RES_STRING		2
+#define TEST_RES_BOOL		3
+#define TEST_RES_OPAQUE		4
+#define TEST_RES_FLOAT32	5
+#define TEST_RES_FLOAT64	6
+#define TEST_RES_MULTI		7
+
+#define TEST_MAX_ID		8
+#define MAX_INSTANCE_COUNT	2
+
+#define STRING_LEN		16
+#define OPAQUE_LEN		8
+#define MULTI_LEN		2
+
+/* coap header and payload marker */
+#define PAYLOAD_OFFSET		5
+
+#define MAX_PACK_LEN		128
+
+/* base name "/32769/0/" of the first record */
+#define BN 0x21, 0x69, '/', '3', '2', '7', '6', '9', '/', '0', '/'
+
+struct test_data {
+	s32_t s32;
+	s64_t s64;
+	char string[STRING_LEN];
+	bool flag;
+	u8_t opaque[OPAQUE_LEN];
+	float32_value_t f32;
+	float64_value_t f64;
+	s32_t multi[MULTI_LEN];
+	u8_t multi_count;
+};
+
+static struct test_data data[MAX_INSTANCE_COUNT];
+
+static struct lwm2m_engine_obj test_obj;
+static struct lwm2m_engine_obj_field fields[] = {
+	OBJ_FIELD_DATA(TEST_RES_S32, RW, S32),
+	OBJ_FIELD_DATA(TEST_RES_S64, RW, S64),
+	OBJ_FIELD_DATA(TEST_RES_STRING, RW, STRING),
+	OBJ_FIELD_DATA(TEST_RES_BOOL, RW, BOOL),
+	OBJ_FIELD_DATA(TEST_RES_OPAQUE, RW, OPAQUE),
+	OBJ_FIELD_DATA(TEST_RES_FLOAT32, RW, FLOAT32),
+	OBJ_FIELD_DATA(TEST_RES_FLOAT64, RW, FLOAT64),
+	OBJ_FIELD(TEST_RES_MULTI, RW, S32, MULTI_LEN),
+};
+
+static struct lwm2m_engine_obj_inst inst[MAX_INSTANCE_COUNT];
+static struct lwm2m_engine_res_inst res[MAX_INSTANCE_COUNT][TEST_MAX_ID];
+
+static struct lwm2m_engine_obj_inst *test_obj_create(u16_t obj_inst_id)
+{
+	int index, i = 0;
+
+	for (index = 0; index < MAX_INSTANCE_COUNT; index++) {
+		if (!inst[index].obj) {
+			break;
+		}
+	}
+
+	if (index >= MAX_INSTANCE_COUNT) {
+		return NULL;
+	}
+
+	memset(&data[index], 0, sizeof(data[index]));
+
+	INIT_OBJ_RES_DATA(res[index], i, TEST_RES_S32,
+			  &data[index].s32, sizeof(data[index].s32));
+	INIT_OBJ_RES_DATA(res[index], i, TEST_RES_S64,
+			  &data[index].s64, sizeof(data[index].s64));
+	INIT_OBJ_RES_DATA(res[index], i, TEST_RES_STRING,
+			  data[index].string, STRING_LEN);
+	INIT_OBJ_RES_DATA(res[index], i, TEST_RES_BOOL,
+			  &data[index].flag, sizeof(data[index].flag));
+	INIT_OBJ_RES_DATA(res[index], i, TEST_RES_OPAQUE,
+			  data[index].opaque, OPAQUE_LEN);
+	INIT_OBJ_RES_DATA(res[index], i, TEST_RES_FLOAT32,
+			  &data[index].f32, sizeof(data[index].f32));
+	INIT_OBJ_RES_DATA(res[index], i, TEST_RES_FLOAT64,
+			  &data[index].f64, sizeof(data[index].f64));
+	INIT_OBJ_RES_MULTI_DATA(res[index], i, TEST_RES_MULTI,
+				&data[index].multi_count, data[index].multi,
+				sizeof(data[index].multi));
+
+	inst[index].resources = res[index];
+	inst[index].resource_count = i;
+
+	return &inst[index];
+}
+
+static struct net_pkt *alloc_pkt(struct coap_packet *cpkt, u8_t type,
+				 u8_t code)
+{
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	int ret;
+
+	pkt = net_pkt_get_reserve_tx(0, K_FOREVER);
+	zassert_not_null(pkt, "Cannot allocate pkt");
+
+	frag = net_pkt_get_frag(pkt, K_FOREVER);
+	zassert_not_null(frag, "Cannot allocate frag");
+
+	net_pkt_frag_add(pkt, frag);
+
+	ret = coap_packet_init(cpkt, pkt, 1, type, 0, NULL, code, 1);
+	zassert_equal(ret, 0, "Cannot init coap packet");
+
+	ret = coap_packet_append_payload_marker(cpkt);
+	zassert_equal(ret, 0, "Cannot append payload marker");
+
+	return pkt;
+}
+
+/* Encode the resources of instance 0 as a read of the instance would */
+static size_t put_instance(struct lwm2m_output_context *out, bool multi)
+{
+	const struct lwm2m_writer *w = out->writer;
+	struct test_data *d = &data[0];
+	struct lwm2m_obj_path path = {
+		.obj_id = TEST_OBJ_ID,
+		.obj_inst_id = 0,
+		.level = 2,
+	};
+	size_t len;
+	int i;
+
+	len = w->put_begin(out, &path);
+
+	path.res_id = TEST_RES_S32;
+	len += w->put_s32(out, &path, d->s32);
+	path.res_id = TEST_RES_S64;
+	len += w->put_s64(out, &path, d->s64);
+	path.res_id = TEST_RES_STRING;
+	len += w->put_string(out, &path, d->string, strlen(d->string));
+	path.res_id = TEST_RES_BOOL;
+	len += w->put_bool(out, &path, d->flag);
+
+	if (multi) {
+		path.res_id = TEST_RES_MULTI;
+		len += w->put_begin_ri(out, &path);
+
+		for (i = 0; i < d->multi_count; i++) {
+			path.res_inst_id = i;
+			len += w->put_s32(out, &path, d->multi[i]);
+		}
+
+		len += w->put_end_ri(out, &path);
+	}
+
+	path.res_id = TEST_RES_OPAQUE;
+	len += w->put_opaque(out, &path, (char *)d->opaque, 3);
+	path.res_id = TEST_RES_FLOAT32;
+	len += w->put_float32fix(out, &path, &d->f32);
+	path.res_id = TEST_RES_FLOAT64;
+	len += w->put_float64fix(out, &path, &d->f64);
+
+	len += w->put_end(out, &path);
+
+	return len;
+}
+
+static void set_instance(void)
+{
+	struct test_data *d = &data[0];
+
+	memset(d, 0, sizeof(*d));
+
+	d->s32 = -100;
+	d->s64 = 5000000000LL;
+	strcpy(d->string, "hello");
+	d->flag = true;
+	d->multi[0] = 10;
+	d->multi[1] = 20;
+	d->multi_count = 2;
+	d->opaque[0] = 1;
+	d->opaque[1] = 2;
+	d->opaque[2] = 3;
+	d->f32.val1 = 1;
+	d->f32.val2 = 500000;
+	d->f64.val1 = 0;
+	d->f64.val2 = 100000000;
+}
+
+static size_t encode(size_t (*put)(struct lwm2m_output_context *out,
+				   bool multi),
+		     bool multi, u8_t *buf, size_t buflen)
+{
+	struct lwm2m_output_context out;
+	struct coap_packet cpkt;
+	struct net_pkt *pkt;
+	u16_t temp_len;
+	size_t len;
+	int ret;
+
+	pkt = alloc_pkt(&cpkt, COAP_TYPE_ACK, COAP_RESPONSE_CODE_CONTENT);
+
+	memset(&out, 0, sizeof(out));
+	out.writer = &senml_cbor_writer;
+	out.out_cpkt = &cpkt;
+	out.frag = coap_packet_get_payload(&cpkt, &out.offset, &temp_len);
+	out.offset++;
+
+	len = put(&out, multi);
+	zassert_true(len <= buflen, "Pack too long (%zu)", len);
+	zassert_equal(net_pkt_get_len(pkt), PAYLOAD_OFFSET + len,
+		      "Length does not match the written data");
+
+	ret = net_frag_linearize(buf, buflen, pkt, PAYLOAD_OFFSET, len);
+	zassert_equal(ret, len, "Cannot read the pack");
+
+	net_pkt_unref(pkt);
+
+	return len;
+}
+
+static int decode(const u8_t *pack, u16_t len, u16_t obj_inst_id,
+		  u8_t level)
+{
+	struct lwm2m_engine_context context;
+	struct lwm2m_input_context in;
+	struct lwm2m_obj_path path = {
+		.obj_id = TEST_OBJ_ID,
+		.obj_inst_id = obj_inst_id,
+		.level = level,
+	};
+	struct coap_packet cpkt;
+	struct net_pkt *pkt;
+	int ret;
+
+	pkt = alloc_pkt(&cpkt, COAP_TYPE_CON, COAP_METHOD_PUT);
+
+	if (len) {
+		ret = coap_packet_append_payload(&cpkt, (u8_t *)pack, len);
+		zassert_equal(ret, 0, "Cannot append payload");
+	}
+
+	memset(&in, 0, sizeof(in));
+	in.reader = &senml_cbor_reader;
+	in.in_cpkt = &cpkt;
+	in.frag = coap_packet_get_payload(&cpkt, &in.offset, &in.payload_len);
+	in.offset++;
+
+	memset(&context, 0, sizeof(context));
+	context.in = &in;
+	context.path = &path;
+	context.operation = LWM2M_OP_WRITE;
+
+	ret = do_write_op_senml_cbor(&test_obj, &context);
+
+	net_pkt_unref(pkt);
+
+	return ret;
+}
+
+static void test_register(void)
+{
+	struct lwm2m_engine_obj_inst *obj_inst = NULL;
+	int ret;
+
+	test_obj.obj_id = TEST_OBJ_ID;
+	test_obj.fields = fields;
+	test_obj.field_count = ARRAY_SIZE(fields);
+	test_obj.max_instance_count = MAX_INSTANCE_COUNT;
+	test_obj.create_cb = test_obj_create;
+	lwm2m_register_obj(&test_obj);
+
+	ret = lwm2m_create_obj_inst(TEST_OBJ_ID, 0, &obj_inst);
+	zassert_equal(ret, 0, "Cannot create instance 0");
+}
+
+static void test_put_instance(void)
+{
+	static const u8_t expected[] = {
+		0x9f,
+		0xa3, BN, 0x00, 0x61, '0', 0x02, 0x38, 0x63,
+		0xa2, 0x00, 0x61, '1', 0x02,
+		0x1b, 0x00, 0x00, 0x00, 0x01, 0x2a, 0x05, 0xf2, 0x00,
+		0xa2, 0x00, 0x61, '2', 0x03,
+		0x65, 'h', 'e', 'l', 'l', 'o',
+		0xa2, 0x00, 0x61, '3', 0x04, 0xf5,
+		0xa2, 0x00, 0x63, '7', '/', '0', 0x02, 0x0a,
+		0xa2, 0x00, 0x63, '7', '/', '1', 0x02, 0x14,
+		0xa2, 0x00, 0x61, '4', 0x08, 0x43, 0x01, 0x02, 0x03,
+		0xa2, 0x00, 0x61, '5', 0x02, 0xfa, 0x3f, 0xc0, 0x00, 0x00,
+		0xa2, 0x00, 0x61, '6', 0x02,
+		0xfb, 0x3f, 0xb9, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a,
+		0xff
+	};
+	u8_t buf[MAX_PACK_LEN];
+	size_t len;
+
+	set_instance();
+
+	len = encode(put_instance, true, buf, sizeof(buf));
+	zassert_equal(len, sizeof(expected), "Wrong pack length %zu", len);
+	zassert_false(memcmp(buf, expected, len), "Wrong pack");
+}
+
+static size_t put_value(struct lwm2m_output_context *out, bool multi)
+{
+	static const float32_value_t f32_int = { 3, 0 };
+	static const float32_value_t f32_neg = { -2, -750000 };
+	static const s32_t values[] = {
+		0, 23, 24, 255, 256, 65535, 65536, -1, -24, -25, -257,
+	};
+	const struct lwm2m_writer *w = out->writer;
+	struct lwm2m_obj_path path = {
+		.obj_id = TEST_OBJ_ID,
+		.obj_inst_id = 0,
+		.res_id = TEST_RES_S32,
+		.level = 3,
+	};
+	float32_value_t f32;
+	size_t len;
+	int i;
+
+	len = w->put_begin(out, &path);
+
+	for (i = 0; i < ARRAY_SIZE(values); i++) {
+		len += w->put_s32(out, &path, values[i]);
+	}
+
+	len += w->put_s64(out, &path, -5000000000LL);
+	len += w->put_s8(out, &path, -128);
+	len += w->put_s16(out, &path, 32767);
+
+	f32 = f32_int;
+	len += w->put_float32fix(out, &path, &f32);
+	f32 = f32_neg;
+	len += w->put_float32fix(out, &path, &f32);
+
+	len += w->put_bool(out, &path, false);
+	len += w->put_string(out, &path, "", 0);
+
+	len += w->put_end(out, &path);
+
+	return len;
+}
+
+static void test_put_numbers(void)
+{
+	/* every record after the first one is "0" with a value */
+#define R(label) 0xa2, 0x00, 0x61, '0', label
+	static const u8_t expected[] = {
+		0x9f,
+		0xa3, BN, 0x00, 0x61, '0', 0x02, 0x00,
+		R(0x02), 0x17,
+		R(0x02), 0x18, 0x18,
+		R(0x02), 0x18, 0xff,
+		R(0x02), 0x19, 0x01, 0x00,
+		R(0x02), 0x19, 0xff, 0xff,
+		R(0x02), 0x1a, 0x00, 0x01, 0x00, 0x00,
+		R(0x02), 0x20,
+		R(0x02), 0x37,
+		R(0x02), 0x38, 0x18,
+		R(0x02), 0x39, 0x01, 0x00,
+		R(0x02), 0x3b, 0x00, 0x00, 0x00, 0x01, 0x2a, 0x05, 0xf1, 0xff,
+		R(0x02), 0x38, 0x7f,
+		R(0x02), 0x19, 0x7f, 0xff,
+		R(0x02), 0x03,
+		R(0x02), 0xfa, 0xc0, 0x30, 0x00, 0x00,
+		R(0x04), 0xf4,
+		R(0x03), 0x60,
+		0xff
+	};
+#undef R
+	u8_t buf[MAX_PACK_LEN + 64];
+	size_t len;
+
+	len = encode(put_value, false, buf, sizeof(buf));
+	zassert_equal(len, sizeof(expected), "Wrong pack length %zu", len);
+	zassert_false(memcmp(buf, expected, len), "Wrong pack");
+}
+
+static void test_round_trip(void)
+{
+	struct test_data *d = &data[0];
+	u8_t buf[MAX_PACK_LEN];
+	size_t len;
+	int ret;
+
+	set_instance();
+	len = encode(put_instance, false, buf, sizeof(buf));
+
+	memset(d, 0, sizeof(*d));
+
+	ret = decode(buf, len, 0, 2);
+	zassert_equal(ret, 0, "Decode failed (%d)", ret);
+
+	zassert_equal(d->s32, -100, "Wrong s32");
+	zassert_equal(d->s64, 5000000000LL, "Wrong s64");
+	zassert_false(strcmp(d->string, "hello"), "Wrong string");
+	zassert_true(d->flag, "Wrong bool");
+	zassert_equal(d->opaque[0], 1, "Wrong opaque");
+	zassert_equal(d->opaque[1], 2, "Wrong opaque");
+	zassert_equal(d->opaque[2], 3, "Wrong opaque");
+	zassert_equal(d->f32.val1, 1, "Wrong float32");
+	zassert_equal(d->f32.val2, 500000, "Wrong float32");
+	zassert_equal(d->f64.val1, 0, "Wrong float64");
+	zassert_equal(d->f64.val2, 100000000, "Wrong float64");
+
+	/* the whole instance can also be written to the object */
+	memset(d, 0, sizeof(*d));
+
+	ret = decode(buf, len, 0, 1);
+	zassert_equal(ret, 0, "Decode of object failed (%d)", ret);
+	zassert_equal(d->s32, -100, "Wrong s32");
+	zassert_equal(d->f64.val2, 100000000, "Wrong float64");
+}
+
+static void test_multi_instance(void)
+{
+	struct test_data *d = &data[0];
+	u8_t buf[MAX_PACK_LEN];
+	size_t len;
+	int ret;
+
+	set_instance();
+	len = encode(put_instance, true, buf, sizeof(buf));
+
+	memset(d, 0, sizeof(*d));
+
+	/* writing resource instances is not supported */
+	ret = decode(buf, len, 0, 2);
+	zassert_equal(ret, -ENOTSUP, "Multi instance accepted (%d)", ret);
+
+	zassert_equal(d->s32, -100, "Record before multi not written");
+	zassert_true(d->flag, "Record before multi not written");
+	zassert_equal(d->multi[0], 0, "Resource instance written");
+	zassert_equal(d->opaque[0], 0, "Record after multi written");
+}
+
+static void test_get_names(void)
+{
+	static const u8_t full_name[] = {
+		0x81,
+		0xa2, 0x00, 0x6a,
+		'/', '3', '2', '7', '6', '9', '/', '0', '/', '0',
+		0x02, 0x07,
+	};
+	static const u8_t base_names[] = {
+		0x82,
+		0xa3, BN, 0x00, 0x61, '0', 0x02, 0x01,
+		0xa3, 0x21, 0x69, '/', '3', '2', '7', '6', '9', '/', '1', '/',
+		0x00, 0x61, '0', 0x02, 0x02,
+	};
+	static const u8_t label_order[] = {
+		0x81,
+		0xa3, 0x02, 0x09, 0x00, 0x61, '0', BN,
+	};
+	int ret;
+
+	memset(&data[0], 0, sizeof(data[0]));
+
+	ret = decode(full_name, sizeof(full_name), 0, 2);
+	zassert_equal(ret, 0, "Full name failed (%d)", ret);
+	zassert_equal(data[0].s32, 7, "Wrong value for full name");
+
+	/* the base name changes the instance, instance 1 is created */
+	ret = decode(base_names, sizeof(base_names), 0, 1);
+	zassert_equal(ret, 0, "Base names failed (%d)", ret);
+	zassert_equal(data[0].s32, 1, "Wrong value for instance 0");
+	zassert_equal(data[1].s32, 2, "Wrong value for instance 1");
+
+	/* the value comes before the name */
+	ret = decode(label_order, sizeof(label_order), 0, 2);
+	zassert_equal(ret, 0, "Label order failed (%d)", ret);
+	zassert_equal(data[0].s32, 9, "Wrong value for label order");
+}
+
+static void test_get_base_time(void)
+{
+	static const u8_t pack[] = {
+		0x83,
+		/* base name and base time only */
+		0xa2, BN, 0x22, 0x19, 0x03, 0xe8,
+		/* time before the value */
+		0xa3, 0x00, 0x61, '0', 0x06, 0x0a, 0x02, 0x05,
+		/* float base time */
+		0xa3, 0x22, 0xfa, 0x3f, 0xc0, 0x00, 0x00,
+		0x00, 0x61, '2', 0x03, 0x62, 'h', 'i',
+	};
+	int ret;
+
+	memset(&data[0], 0, sizeof(data[0]));
+
+	ret = decode(pack, sizeof(pack), 0, 2);
+	zassert_equal(ret, 0, "Base time failed (%d)", ret);
+	zassert_equal(data[0].s32, 5, "Wrong value");
+	zassert_false(strcmp(data[0].string, "hi"), "Wrong string");
+}
+
+static void test_get_numbers(void)
+{
+	static const u8_t pack[] = {
+		0x85,
+		/* float16 1.5 */
+		0xa3, BN, 0x00, 0x61, '5', 0x02, 0xf9, 0x3e, 0x00,
+		/* float32 -2.25 */
+		0xa2, 0x00, 0x61, '6', 0x02, 0xfa, 0xc0, 0x10, 0x00, 0x00,
+		/* float64 pi to an integer */
+		0xa2, 0x00, 0x61, '0', 0x02,
+		0xfb, 0x40, 0x09, 0x21, 0xfb, 0x54, 0x44, 0x2d, 0x18,
+		/* -5000000000 */
+		0xa2, 0x00, 0x61, '1', 0x02,
+		0x3b, 0x00, 0x00, 0x00, 0x01, 0x2a, 0x05, 0xf1, 0xff,
+		0xa2, 0x00, 0x61, '3', 0x04, 0xf4,
+	};
+	static const u8_t int_to_float[] = {
+		0x81,
+		0xa3, BN, 0x00, 0x61, '5', 0x02, 0x18, 0x2a,
+	};
+	struct test_data *d = &data[0];
+	int ret;
+
+	memset(d, 0, sizeof(*d));
+	d->flag = true;
+
+	ret = decode(pack, sizeof(pack), 0, 2);
+	zassert_equal(ret, 0, "Numbers failed (%d)", ret);
+	zassert_equal(d->f32.val1, 1, "Wrong float16");
+	zassert_equal(d->f32.val2, 500000, "Wrong float16");
+	zassert_equal(d->f64.val1, -2, "Wrong float32");
+	zassert_equal(d->f64.val2, -250000000, "Wrong float32");
+	zassert_equal(d->s32, 3, "Wrong float64");
+	zassert_equal(d->s64, -5000000000LL, "Wrong negative s64");
+	zassert_false(d->flag, "Wrong bool");
+
+	ret = decode(int_to_float, sizeof(int_to_float), 0, 2);
+	zassert_equal(ret, 0, "Integer float failed (%d)", ret);
+	zassert_equal(d->f32.val1, 42, "Wrong integer float");
+	zassert_equal(d->f32.val2, 0, "Wrong integer float");
+}
+
+static void test_get_indefinite(void)
+{
+	static const u8_t pack[] = {
+		0x9f,
+		0xbf, BN, 0x00, 0x61, '0', 0x02, 0x0b, 0xff,
+		0xbf, 0x00, 0x61, '3', 0x04, 0xf5, 0xff,
+		0xff,
+	};
+	int ret;
+
+	memset(&data[0], 0, sizeof(data[0]));
+
+	ret = decode(pack, sizeof(pack), 0, 2);
+	zassert_equal(ret, 0, "Indefinite pack failed (%d)", ret);
+	zassert_equal(data[0].s32, 11, "Wrong value");
+	zassert_true(data[0].flag, "Wrong bool");
+}
+
+static void test_get_nested(void)
+{
+	static const u8_t pack[] = {
+		0x81,
+		0xa6, BN,
+		/* "x": [1, {"a": [_ 2]}] */
+		0x61, 'x', 0x82, 0x01, 0xa1, 0x61, 'a', 0x9f, 0x02, 0xff,
+		/* 23: tag 1 (1000) */
+		0x17, 0xc1, 0x19, 0x03, 0xe8,
+		/* 22: (_ "ab" "c") */
+		0x16, 0x7f, 0x62, 'a', 'b', 0x61, 'c', 0xff,
+		0x00, 0x61, '0', 0x02, 0x0c,
+	};
+	static const u8_t too_deep[] = {
+		0x81,
+		0xa4, BN,
+		0x61, 'x', 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x01,
+		0x00, 0x61, '0', 0x02, 0x01,
+	};
+	int ret;
+
+	memset(&data[0], 0, sizeof(data[0]));
+
+	ret = decode(pack, sizeof(pack), 0, 2);
+	zassert_equal(ret, 0, "Nested values failed (%d)", ret);
+	zassert_equal(data[0].s32, 12, "Wrong value");
+
+	ret = decode(too_deep, sizeof(too_deep), 0, 2);
+	zassert_equal(ret, -EINVAL, "Deep nesting accepted (%d)", ret);
+	zassert_equal(data[0].s32, 12, "Value written");
+}
+
+static void test_get_long_strings(void)
+{
+	u8_t pack[MAX_PACK_LEN];
+	u16_t len = 0;
+	int ret;
+
+	memset(&data[0], 0, sizeof(data[0]));
+	strcpy(data[0].string, "keep");
+
+	/* a string value longer than the resource is not written */
+	pack[len++] = 0x82;
+	pack[len++] = 0xa3;
+	memcpy(&pack[len], (u8_t []){ BN }, 11);
+	len += 11;
+	pack[len++] = 0x00;
+	pack[len++] = 0x61;
+	pack[len++] = '2';
+	pack[len++] = 0x03;
+	pack[len++] = 0x60 + 20;
+	memset(&pack[len], 'a', 20);
+	len += 20;
+	/* the parser stays in sync for the next record */
+	pack[len++] = 0xa2;
+	pack[len++] = 0x00;
+	pack[len++] = 0x61;
+	pack[len++] = '0';
+	pack[len++] = 0x02;
+	pack[len++] = 0x0d;
+
+	ret = decode(pack, len, 0, 2);
+	zassert_equal(ret, 0, "Long string value failed (%d)", ret);
+	zassert_false(strcmp(data[0].string, "keep"), "String overwritten");
+	zassert_equal(data[0].s32, 13, "Next record not written");
+
+	/* a name longer than any path */
+	len = 0;
+	pack[len++] = 0x81;
+	pack[len++] = 0xa2;
+	pack[len++] = 0x00;
+	pack[len++] = 0x78;
+	pack[len++] = 32;
+	memset(&pack[len], '0', 32);
+	len += 32;
+	pack[len++] = 0x02;
+	pack[len++] = 0x01;
+
+	ret = decode(pack, len, 0, 2);
+	zassert_equal(ret, -EINVAL, "Long name accepted (%d)", ret);
+	zassert_equal(data[0].s32, 13, "Value written");
+}
+
+static const u8_t truncated_name[] = {
+	0x81, 0xa2, 0x00, 0x6a, '/', '3', '2',
+};
+
+static const u8_t truncated_value[] = {
+	0x81, 0xa3, BN, 0x00, 0x61, '0', 0x02, 0x1a, 0x00, 0x01,
+};
+
+static const u8_t truncated_head[] = {
+	0x81, 0xa3, BN, 0x00, 0x61, '0', 0x02, 0x1b,
+};
+
+static const u8_t missing_break[] = {
+	0x9f, 0xa3, BN, 0x00, 0x61, '0', 0x02, 0x01,
+};
+
+static const u8_t missing_record[] = {
+	0x82, 0xa3, BN, 0x00, 0x61, '0', 0x02, 0x01,
+};
+
+static const u8_t missing_pair[] = {
+	0x81, 0xa4, BN, 0x00, 0x61, '0', 0x02, 0x01,
+};
+
+static const u8_t not_array[] = {
+	0xa2, 0x00, 0x61, '0', 0x02, 0x01,
+};
+
+static const u8_t not_map[] = {
+	0x81, 0x01,
+};
+
+static const u8_t indefinite_name[] = {
+	0x81, 0xa3, BN, 0x00, 0x7f, 0x61, '0', 0xff, 0x02, 0x01,
+};
+
+static const u8_t indefinite_int[] = {
+	0x81, 0xa3, BN, 0x00, 0x61, '0', 0x02, 0x1f,
+};
+
+static const u8_t indefinite_tag[] = {
+	0x81, 0xa3, BN, 0x00, 0x61, '0', 0x17, 0xdf, 0x01,
+};
+
+static const u8_t bad_chunk[] = {
+	0x81, 0xa3, BN, 0x17, 0x7f, 0x41, 'a', 0xff, 0x00, 0x61, '0',
+};
+
+static const u8_t reserved_info[] = {
+	0x81, 0xa3, BN, 0x00, 0x61, '0', 0x02, 0x1c,
+};
+
+static const u8_t huge_string[] = {
+	0x81, 0xa3, BN, 0x61, 'x', 0x7a, 0x00, 0x01, 0x00, 0x00,
+};
+
+static const u8_t bad_name[] = {
+	0x81, 0xa2, 0x00, 0x6a,
+	'/', '3', '2', '7', '6', '9', '/', '0', '/', 'x',
+	0x02, 0x01,
+};
+
+static const u8_t other_object[] = {
+	0x81, 0xa2, 0x00, 0x6a,
+	'/', '3', '2', '7', '7', '0', '/', '0', '/', '0',
+	0x02, 0x01,
+};
+
+static const u8_t other_instance[] = {
+	0x81, 0xa2, 0x00, 0x6a,
+	'/', '3', '2', '7', '6', '9', '/', '1', '/', '0',
+	0x02, 0x01,
+};
+
+static const u8_t short_name[] = {
+	0x81, 0xa3, 0x21, 0x67, '/', '3', '2', '7', '6', '9', '/',
+	0x00, 0x60, 0x02, 0x01,
+};
+
+#define MALFORMED(name) { #name, name, sizeof(name) }
+
+static const struct {
+	const char *name;
+	const u8_t *pack;
+	u16_t len;
+} malformed[] = {
+	{ "empty", NULL, 0 },
+	MALFORMED(truncated_name),
+	MALFORMED(truncated_value),
+	MALFORMED(truncated_head),
+	MALFORMED(missing_break),
+	MALFORMED(missing_record),
+	MALFORMED(missing_pair),
+	MALFORMED(not_array),
+	MALFORMED(not_map),
+	MALFORMED(indefinite_name),
+	MALFORMED(indefinite_int),
+	MALFORMED(indefinite_tag),
+	MALFORMED(bad_chunk),
+	MALFORMED(reserved_info),
+	MALFORMED(huge_string),
+	MALFORMED(bad_name),
+	MALFORMED(other_object),
+	MALFORMED(other_instance),
+	MALFORMED(short_name),
+};
+
+static void test_get_malformed(void)
+{
+	int ret, i;
+
+	for (i = 0; i < ARRAY_SIZE(malformed); i++) {
+		ret = decode(malformed[i].pack, malformed[i].len, 0, 2);
+		zassert_true(ret < 0, "Malformed pack %s accepted",
+			     malformed[i].name);
+	}
+}
+
+void test_main(void)
+{
+	ztest_test_suite(lwm2m_senml_cbor,
+			 ztest_unit_test(test_register),
+			 ztest_unit_test(test_put_instance),
+			 ztest_unit_test(test_put_numbers),
+			 ztest_unit_test(test_round_trip),
+			 ztest_unit_test(test_multi_instance),
+			 ztest_unit_test(test_get_names),
+			 ztest_unit_test(test_get_base_time),
+			 ztest_unit_test(test_get_numbers),
+			 ztest_unit_test(test_get_indefinite),
+			 ztest_unit_test(test_get_nested),
+			 ztest_unit_test(test_get_long_strings),
+			 ztest_unit_test(test_get_malformed));
+
+	ztest_run_test_suite(lwm2m_senml_cbor);
+}
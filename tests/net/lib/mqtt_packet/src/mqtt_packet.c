@@ -6,6 +6,8 @@
 
 #include <tc_util.h>
 #include <mqtt_pkt.h>
+#include <net/mqtt.h>
+#include <net/net_pkt.h>
 #include <misc/util.h>	/* for ARRAY_SIZE */
 #include <ztest.h>
 
@@ -1030,9 +1032,404 @@ void test_mqtt_packet(void)
 }
 
 
+/* Payload of the MQTT PUBLISH msg decoded from the stream, larger than
+ * CONFIG_MQTT_MSG_MAX_SIZE.
+ */
+#define STREAM_PAYLOAD_LEN	300
+/* Bytes of the stream put in each network buffer */
+#define STREAM_FRAG_LEN		37
+
+static struct mqtt_ctx stream_ctx;
+static u8_t stream_payload[STREAM_PAYLOAD_LEN];
+static u32_t stream_payload_len;
+static int stream_published;
+static int stream_malformed;
+
+static int stream_publish_rx_payload(struct mqtt_ctx *ctx,
+				     struct mqtt_publish_msg *msg,
+				     u32_t offset, const u8_t *data,
+				     u16_t len, u32_t total)
+{
+	if (msg->topic_len != TOPIC_LEN ||
+	    memcmp(msg->topic, TOPIC, TOPIC_LEN) ||
+	    total != STREAM_PAYLOAD_LEN || offset != stream_payload_len ||
+	    offset + len > total) {
+		return -EINVAL;
+	}
+
+	memcpy(stream_payload + offset, data, len);
+	stream_payload_len += len;
+
+	return 0;
+}
+
+static int stream_publish_rx(struct mqtt_ctx *ctx,
+			     struct mqtt_publish_msg *msg,
+			     u16_t pkt_id, enum mqtt_packet type)
+{
+	if (type == MQTT_PUBLISH && stream_payload_len == STREAM_PAYLOAD_LEN) {
+		stream_published++;
+	}
+
+	return 0;
+}
+
+static void stream_malformed_cb(struct mqtt_ctx *ctx, u16_t pkt_type)
+{
+	stream_malformed++;
+}
+
+/* Puts len bytes of data in a RX packet, STREAM_FRAG_LEN bytes per
+ * network buffer.
+ */
+static struct net_pkt *stream_pkt(const u8_t *data, u16_t len)
+{
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	u16_t count;
+
+	pkt = net_pkt_get_reserve_rx(0, K_NO_WAIT);
+	zassert_not_null(pkt, "no packet");
+
+	while (len > 0) {
+		frag = net_pkt_get_frag(pkt, K_NO_WAIT);
+		zassert_not_null(frag, "no buffer");
+
+		count = min(len, STREAM_FRAG_LEN);
+		net_buf_add_mem(frag, data, count);
+		net_pkt_frag_add(pkt, frag);
+		data += count;
+		len -= count;
+	}
+
+	net_pkt_set_appdatalen(pkt, net_pkt_get_len(pkt));
+
+	return pkt;
+}
+
+void test_mqtt_rx_stream(void)
+{
+	u8_t stream[4 + 2 + TOPIC_LEN + STREAM_PAYLOAD_LEN + 2];
+	struct net_pkt *pkt;
+	u16_t len = 0;
+	u16_t split;
+	int i;
+
+	/* PUBLISH QoS 0, Remaining Length takes 2 bytes */
+	stream[len++] = MQTT_PUBLISH << 4;
+	stream[len++] = ((2 + TOPIC_LEN + STREAM_PAYLOAD_LEN) & 0x7f) | 0x80;
+	stream[len++] = (2 + TOPIC_LEN + STREAM_PAYLOAD_LEN) >> 7;
+	stream[len++] = 0;
+	stream[len++] = TOPIC_LEN;
+	memcpy(stream + len, TOPIC, TOPIC_LEN);
+	len += TOPIC_LEN;
+
+	for (i = 0; i < STREAM_PAYLOAD_LEN; i++) {
+		stream[len++] = i;
+	}
+
+	/* PINGRESP, in the same packet as the end of the PUBLISH msg */
+	stream[len++] = MQTT_PINGRESP << 4;
+	stream[len++] = 0;
+
+	mqtt_init(&stream_ctx, MQTT_APP_SUBSCRIBER);
+	stream_ctx.publish_rx = stream_publish_rx;
+	stream_ctx.publish_rx_payload = stream_publish_rx_payload;
+	stream_ctx.malformed = stream_malformed_cb;
+
+	/* split the stream in two TCP segments, in the Remaining Length
+	 * and in the payload
+	 */
+	for (split = 2; split < len; split += len / 2) {
+		stream_payload_len = 0;
+		stream_published = 0;
+		stream_malformed = 0;
+
+		pkt = stream_pkt(stream, split);
+		stream_ctx.rcv(&stream_ctx, pkt);
+		net_pkt_unref(pkt);
+
+		pkt = stream_pkt(stream + split, len - split);
+		stream_ctx.rcv(&stream_ctx, pkt);
+		net_pkt_unref(pkt);
+
+		/**TESTPOINT: Check the decoded PUBLISH msg*/
+		zassert_equal(stream_published, 1, "PUBLISH msg not decoded");
+		zassert_false(memcmp(stream_payload, stream + 4 + 2 + TOPIC_LEN,
+				     STREAM_PAYLOAD_LEN), "payload mismatch");
+		zassert_equal(stream_malformed, 0, "malformed msg");
+	}
+
+	mqtt_close(&stream_ctx);
+}
+
+/* MQTT PUBLISH QoS 0 msg with a 3 bytes payload */
+static const u8_t small_publish[] = {
+	MQTT_PUBLISH << 4, 2 + TOPIC_LEN + 3,
+	0, TOPIC_LEN, 's', 'e', 'n', 's', 'o', 'r', 's',
+	'a', 'b', 'c'
+};
+
+static struct mqtt_ctx busy_ctx;
+static int small_published;
+
+static int small_publish_rx(struct mqtt_ctx *ctx,
+			    struct mqtt_publish_msg *msg,
+			    u16_t pkt_id, enum mqtt_packet type)
+{
+	if (type == MQTT_PUBLISH && msg->msg_len == 3 &&
+	    !memcmp(msg->msg, "abc", 3)) {
+		small_published++;
+	}
+
+	return 0;
+}
+
+static int stream_rcv(struct mqtt_ctx *ctx, const u8_t *data, u16_t len)
+{
+	struct net_pkt *pkt;
+	int rc;
+
+	pkt = stream_pkt(data, len);
+	rc = ctx->rcv(ctx, pkt);
+	net_pkt_unref(pkt);
+
+	return rc;
+}
+
+void test_mqtt_rx_errors(void)
+{
+	u8_t stream[6 + 2 * sizeof(small_publish)];
+	u16_t split = 5;
+	int rc;
+
+	mqtt_init(&stream_ctx, MQTT_APP_SUBSCRIBER);
+	stream_ctx.publish_rx = small_publish_rx;
+	stream_ctx.malformed = stream_malformed_cb;
+	small_published = 0;
+	stream_malformed = 0;
+
+	/* busy_ctx holds the only buffer of the pool while it waits for
+	 * the rest of its msg
+	 */
+	mqtt_init(&busy_ctx, MQTT_APP_SUBSCRIBER);
+	rc = stream_rcv(&busy_ctx, small_publish, split);
+	zassert_equal(rc, 0, "partial msg not accepted");
+
+	/* the msg that cannot be buffered is skipped, across segments */
+	rc = stream_rcv(&stream_ctx, small_publish, split);
+	zassert_equal(rc, -ENOMEM, "msg not dropped");
+
+	mqtt_close(&busy_ctx);
+
+	memcpy(stream, small_publish + split, sizeof(small_publish) - split);
+	memcpy(stream + sizeof(small_publish) - split, small_publish,
+	       sizeof(small_publish));
+	rc = stream_rcv(&stream_ctx, stream,
+			2 * sizeof(small_publish) - split);
+
+	/**TESTPOINT: Check that the stream is decoded after the drop*/
+	zassert_equal(rc, 0, "stream not decoded");
+	zassert_equal(small_published, 1, "PUBLISH msg not decoded");
+	zassert_equal(stream_malformed, 0, "malformed msg");
+
+	/* Remaining Length in 5 bytes, followed by a valid msg */
+	stream[0] = MQTT_PUBLISH << 4;
+	memset(stream + 1, 0xff, 4);
+	stream[5] = 0x7f;
+	memcpy(stream + 6, small_publish, sizeof(small_publish));
+	rc = stream_rcv(&stream_ctx, stream, 6 + sizeof(small_publish));
+
+	/**TESTPOINT: Check that the stream is not decoded anymore*/
+	zassert_equal(rc, -EINVAL, "invalid Remaining Length accepted");
+	zassert_equal(stream_malformed, 1, "malformed msg not reported");
+
+	rc = stream_rcv(&stream_ctx, small_publish, sizeof(small_publish));
+	zassert_equal(rc, -EINVAL, "stream decoded after the error");
+	zassert_equal(small_published, 1, "PUBLISH msg decoded");
+
+	/* a new connection starts a new stream */
+	mqtt_close(&stream_ctx);
+	rc = stream_rcv(&stream_ctx, small_publish, sizeof(small_publish));
+	zassert_equal(rc, 0, "stream not decoded");
+	zassert_equal(small_published, 2, "PUBLISH msg not decoded");
+
+	mqtt_close(&stream_ctx);
+}
+
+#if defined(CONFIG_MQTT_TX_BATCH) && CONFIG_MQTT_INFLIGHT_WINDOW > 0
+#define WINDOW		CONFIG_MQTT_INFLIGHT_WINDOW
+/* Two MQTT PUBLISH msgs with this payload fit in the batch, not three */
+#define BATCH_PAYLOAD_LEN	(CONFIG_MQTT_TX_BATCH_SIZE / 2 - 16)
+
+static u8_t batch_payload[BATCH_PAYLOAD_LEN];
+static int batch_acked;
+
+static int batch_publish_tx(struct mqtt_ctx *ctx, u16_t pkt_id,
+			    enum mqtt_packet type)
+{
+	if (type == MQTT_PUBACK) {
+		batch_acked++;
+	}
+
+	return 0;
+}
+
+static void batch_msg(struct mqtt_publish_msg *msg, enum mqtt_qos qos,
+		      u16_t pkt_id, u16_t len)
+{
+	memset(msg, 0, sizeof(*msg));
+	msg->qos = qos;
+	msg->pkt_id = pkt_id;
+	msg->topic = TOPIC;
+	msg->topic_len = TOPIC_LEN;
+	msg->msg = batch_payload;
+	msg->msg_len = len;
+}
+
+/* The test has no network, so the batches cannot be sent */
+void test_mqtt_tx_window(void)
+{
+	const u8_t puback[] = { MQTT_PUBACK << 4, 2, 0, 1 };
+	struct mqtt_publish_msg msg;
+	int rc;
+	int i;
+
+	mqtt_init(&stream_ctx, MQTT_APP_PUBLISHER);
+	stream_ctx.publish_tx = batch_publish_tx;
+	batch_acked = 0;
+
+#if defined(CONFIG_MQTT_STATS)
+	/* the counters are only reset by mqtt_connect() */
+	memset(&stream_ctx.stats, 0, sizeof(stream_ctx.stats));
+#endif
+
+	for (i = 0; i < WINDOW; i++) {
+		batch_msg(&msg, MQTT_QoS1, i + 1, 3);
+		rc = mqtt_tx_publish(&stream_ctx, &msg);
+		zassert_equal(rc, 0, "msg not queued");
+		zassert_true(stream_ctx.inflight[i].queued, "msg not queued");
+	}
+
+	/**TESTPOINT: Check that the window is full*/
+	batch_msg(&msg, MQTT_QoS1, WINDOW + 1, 3);
+	rc = mqtt_tx_publish(&stream_ctx, &msg);
+	zassert_equal(rc, -EAGAIN, "window not full");
+	zassert_equal(stream_ctx.inflight_count, WINDOW, "wrong window");
+
+	/* a msg sent again does not take another entry */
+	batch_msg(&msg, MQTT_QoS1, 1, 3);
+	msg.dup = 1;
+	rc = mqtt_tx_publish(&stream_ctx, &msg);
+	zassert_equal(rc, 0, "msg not queued");
+	zassert_equal(stream_ctx.inflight_count, WINDOW, "wrong window");
+	zassert_equal(stream_ctx.tx_batch_msgs, WINDOW + 1, "wrong batch");
+
+	/**TESTPOINT: Check that the MQTT PUBACK msg releases the entry*/
+	rc = stream_rcv(&stream_ctx, puback, sizeof(puback));
+	zassert_equal(rc, 0, "MQTT PUBACK msg not decoded");
+	zassert_equal(batch_acked, 1, "MQTT PUBACK msg not received");
+	zassert_equal(stream_ctx.inflight_count, WINDOW - 1, "wrong window");
+
+	/**TESTPOINT: Check that the entries of a dropped batch are released*/
+	rc = mqtt_tx_flush(&stream_ctx);
+	zassert_equal(rc, -ENOMEM, "batch sent");
+	zassert_equal(stream_ctx.inflight_count, 0, "entries not released");
+	zassert_equal(stream_ctx.tx_batch_len, 0, "batch not emptied");
+
+#if defined(CONFIG_MQTT_STATS)
+	zassert_equal(stream_ctx.stats.tx_errors, WINDOW + 1, "wrong errors");
+	zassert_equal(stream_ctx.stats.tx_sends, 0, "wrong sends");
+	zassert_equal(stream_ctx.stats.rx_msgs, 1, "wrong rx msgs");
+	zassert_equal(stream_ctx.stats.rx_bytes, sizeof(puback),
+		      "wrong rx bytes");
+	/* the acked msg was never sent, its RTT is meaningless */
+	zassert_equal(stream_ctx.stats.rtt_count, 0, "wrong RTT samples");
+#endif
+
+	/* the window is available again */
+	batch_msg(&msg, MQTT_QoS1, WINDOW + 1, 3);
+	rc = mqtt_tx_publish(&stream_ctx, &msg);
+	zassert_equal(rc, 0, "msg not queued");
+	zassert_equal(stream_ctx.inflight_count, 1, "wrong window");
+
+	mqtt_close(&stream_ctx);
+	zassert_equal(stream_ctx.inflight_count, 0, "window not reset");
+	zassert_equal(stream_ctx.tx_batch_len, 0, "batch not reset");
+}
+
+void test_mqtt_tx_batch(void)
+{
+	struct mqtt_publish_msg msg;
+	u16_t len;
+	int rc;
+
+	mqtt_init(&stream_ctx, MQTT_APP_PUBLISHER);
+
+#if defined(CONFIG_MQTT_STATS)
+	memset(&stream_ctx.stats, 0, sizeof(stream_ctx.stats));
+#endif
+
+	batch_msg(&msg, MQTT_QoS0, 0, BATCH_PAYLOAD_LEN);
+	rc = mqtt_tx_publish(&stream_ctx, &msg);
+	zassert_equal(rc, 0, "msg not queued");
+	len = stream_ctx.tx_batch_len;
+
+	rc = mqtt_tx_publish(&stream_ctx, &msg);
+	zassert_equal(rc, 0, "msg not queued");
+
+	/**TESTPOINT: Check that the msgs are queued back to back*/
+	zassert_equal(stream_ctx.tx_batch_msgs, 2, "wrong batch");
+	zassert_equal(stream_ctx.tx_batch_len, 2 * len, "wrong batch");
+
+	/**TESTPOINT: Check that a full batch is sent before the next msg,
+	 * which is still queued when the batch is dropped
+	 */
+	batch_msg(&msg, MQTT_QoS1, 1, BATCH_PAYLOAD_LEN);
+	rc = mqtt_tx_publish(&stream_ctx, &msg);
+	zassert_equal(rc, 0, "msg not queued");
+	zassert_equal(stream_ctx.tx_batch_msgs, 1, "batch not emptied");
+	zassert_equal(stream_ctx.inflight_count, 1, "entry not taken");
+
+#if defined(CONFIG_MQTT_STATS)
+	zassert_equal(stream_ctx.stats.tx_errors, 2, "wrong errors");
+	zassert_equal(stream_ctx.stats.tx_msgs, 0, "wrong msgs");
+	zassert_equal(stream_ctx.stats.tx_bytes, 0, "wrong bytes");
+#endif
+
+	/* the queued msgs are sent after the delay */
+	batch_msg(&msg, MQTT_QoS1, 2, 3);
+	rc = mqtt_tx_publish(&stream_ctx, &msg);
+	zassert_equal(rc, 0, "msg not queued");
+	zassert_equal(stream_ctx.tx_batch_msgs, 2, "wrong batch");
+	zassert_equal(stream_ctx.inflight_count, 2, "entry not taken");
+
+	k_sleep(CONFIG_MQTT_TX_BATCH_DELAY_MS + 10);
+
+	zassert_equal(stream_ctx.tx_batch_msgs, 0, "batch not sent");
+	zassert_equal(stream_ctx.inflight_count, 0, "entry not released");
+
+	mqtt_close(&stream_ctx);
+}
+#else
+void test_mqtt_tx_window(void)
+{
+	ztest_test_skip();
+}
+
+void test_mqtt_tx_batch(void)
+{
+	ztest_test_skip();
+}
+#endif
+
 void test_main(void)
 {
 	ztest_test_suite(test_mqtt_packet_fn,
-		ztest_unit_test(test_mqtt_packet));
+		ztest_unit_test(test_mqtt_packet),
+		ztest_unit_test(test_mqtt_rx_stream),
+		ztest_unit_test(test_mqtt_rx_errors),
+		ztest_unit_test(test_mqtt_tx_window),
+		ztest_unit_test(test_mqtt_tx_batch));
 	ztest_run_test_suite(test_mqtt_packet_fn);
 }
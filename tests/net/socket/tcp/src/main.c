@@ -6,6 +6,7 @@
 
 #include <ztest_assert.h>
 #include <net/socket.h>
+#include <net/net_pkt.h>
 
 #define TEST_STR_SMALL "test"
 
@@ -390,6 +391,170 @@ void test_v6_sendto_recvfrom_null_dest(void)
 	k_sleep(TCP_TEARDOWN_TIMEOUT);
 }
 
+void test_v4_nodelay_cork(void)
+{
+	/* Test TCP_NODELAY and TCP_CORK options on a ipv4 stream socket.
+	 * Data written while corked must only be sent once uncorked.
+	 */
+	int c_sock;
+	int s_sock;
+	int new_sock;
+	struct sockaddr_in c_saddr;
+	struct sockaddr_in s_saddr;
+	struct sockaddr addr;
+	socklen_t addrlen = sizeof(addr);
+	socklen_t optlen;
+	char rx_buf[30] = {0};
+	ssize_t recved = 0;
+	int optval;
+
+	prepare_sock_v4(CONFIG_NET_APP_MY_IPV4_ADDR,
+			ANY_PORT,
+			&c_sock,
+			&c_saddr);
+
+	prepare_sock_v4(CONFIG_NET_APP_MY_IPV4_ADDR,
+			SERVER_PORT,
+			&s_sock,
+			&s_saddr);
+
+	optval = 1;
+	zassert_equal(setsockopt(c_sock, IPPROTO_TCP, TCP_NODELAY,
+				 &optval, sizeof(optval)),
+		      0,
+		      "setsockopt failed");
+
+	optval = 0;
+	optlen = sizeof(optval);
+	zassert_equal(getsockopt(c_sock, IPPROTO_TCP, TCP_NODELAY,
+				 &optval, &optlen),
+		      0,
+		      "getsockopt failed");
+	zassert_equal(optval, 1, "TCP_NODELAY not set");
+	zassert_equal(optlen, sizeof(optval), "wrong optlen");
+
+	zassert_equal(setsockopt(c_sock, IPPROTO_UDP, TCP_NODELAY,
+				 &optval, sizeof(optval)),
+		      -1,
+		      "setsockopt with wrong level succeeded");
+	zassert_equal(errno, ENOPROTOOPT, "wrong errno");
+
+	test_bind(s_sock, (struct sockaddr *)&s_saddr, sizeof(s_saddr));
+	test_listen(s_sock);
+
+	test_connect(c_sock, (struct sockaddr *)&s_saddr, sizeof(s_saddr));
+
+	test_accept(s_sock, &new_sock, &addr, &addrlen);
+	zassert_equal(addrlen, sizeof(struct sockaddr_in), "wrong addrlen");
+
+	optval = 1;
+	zassert_equal(setsockopt(c_sock, IPPROTO_TCP, TCP_CORK,
+				 &optval, sizeof(optval)),
+		      0,
+		      "setsockopt failed");
+
+	test_send(c_sock, TEST_STR_SMALL, 2, 0);
+	test_send(c_sock, TEST_STR_SMALL + 2, strlen(TEST_STR_SMALL) - 2, 0);
+
+	k_sleep(K_MSEC(100));
+	zassert_equal(recv(new_sock, rx_buf, sizeof(rx_buf), MSG_DONTWAIT),
+		      -1,
+		      "corked data was sent");
+
+	optval = 0;
+	zassert_equal(setsockopt(c_sock, IPPROTO_TCP, TCP_CORK,
+				 &optval, sizeof(optval)),
+		      0,
+		      "setsockopt failed");
+
+	while (recved < strlen(TEST_STR_SMALL)) {
+		ssize_t len = recv(new_sock, rx_buf + recved,
+				   sizeof(rx_buf) - recved, 0);
+
+		zassert_true(len > 0, "recv failed");
+		recved += len;
+	}
+
+	zassert_equal(recved,
+		      strlen(TEST_STR_SMALL),
+		      "unexpected received bytes");
+	zassert_equal(strncmp(rx_buf, TEST_STR_SMALL, strlen(TEST_STR_SMALL)),
+		      0,
+		      "unexpected data");
+
+	test_close(new_sock);
+	test_close(c_sock);
+	test_close(s_sock);
+
+	k_sleep(TCP_TEARDOWN_TIMEOUT);
+}
+
+void test_v4_send_recv_pkt(void)
+{
+	/* Test if zsock_send_pkt() and zsock_recv_pkt() work on a ipv4
+	 * stream socket.
+	 */
+	int c_sock;
+	int s_sock;
+	int new_sock;
+	struct sockaddr_in c_saddr;
+	struct sockaddr_in s_saddr;
+	struct sockaddr addr;
+	socklen_t addrlen = sizeof(addr);
+	struct net_pkt *pkt;
+	char rx_buf[30] = {0};
+
+	prepare_sock_v4(CONFIG_NET_APP_MY_IPV4_ADDR,
+			ANY_PORT,
+			&c_sock,
+			&c_saddr);
+
+	prepare_sock_v4(CONFIG_NET_APP_MY_IPV4_ADDR,
+			SERVER_PORT,
+			&s_sock,
+			&s_saddr);
+
+	test_bind(s_sock, (struct sockaddr *)&s_saddr, sizeof(s_saddr));
+	test_listen(s_sock);
+
+	test_connect(c_sock, (struct sockaddr *)&s_saddr, sizeof(s_saddr));
+
+	pkt = zsock_pkt_alloc(c_sock, 0);
+	zassert_not_null(pkt, "zsock_pkt_alloc failed");
+	zassert_true(net_pkt_append_all(pkt, strlen(TEST_STR_SMALL),
+					TEST_STR_SMALL, K_FOREVER),
+		     "net_pkt_append_all failed");
+	zassert_equal(zsock_send_pkt(c_sock, pkt, 0),
+		      strlen(TEST_STR_SMALL),
+		      "zsock_send_pkt failed");
+
+	test_accept(s_sock, &new_sock, &addr, &addrlen);
+	zassert_equal(addrlen, sizeof(struct sockaddr_in), "wrong addrlen");
+
+	zassert_equal(zsock_recv_pkt(new_sock, &pkt, ZSOCK_MSG_PEEK),
+		      -1,
+		      "zsock_recv_pkt with MSG_PEEK succeeded");
+
+	zassert_equal(zsock_recv_pkt(new_sock, &pkt, 0),
+		      strlen(TEST_STR_SMALL),
+		      "unexpected received bytes");
+	zassert_not_null(pkt, "no pkt received");
+	zassert_equal(net_frag_linearize(rx_buf, sizeof(rx_buf), pkt, 0,
+					 strlen(TEST_STR_SMALL)),
+		      strlen(TEST_STR_SMALL),
+		      "net_frag_linearize failed");
+	zassert_equal(strncmp(rx_buf, TEST_STR_SMALL, strlen(TEST_STR_SMALL)),
+		      0,
+		      "unexpected data");
+	net_pkt_unref(pkt);
+
+	test_close(new_sock);
+	test_close(c_sock);
+	test_close(s_sock);
+
+	k_sleep(TCP_TEARDOWN_TIMEOUT);
+}
+
 void test_main(void)
 {
 	ztest_test_suite(socket_tcp,
@@ -398,7 +563,9 @@ void test_main(void)
 			 ztest_unit_test(test_v4_sendto_recvfrom),
 			 ztest_unit_test(test_v6_sendto_recvfrom),
 			 ztest_unit_test(test_v4_sendto_recvfrom_null_dest),
-			 ztest_unit_test(test_v6_sendto_recvfrom_null_dest));
+			 ztest_unit_test(test_v6_sendto_recvfrom_null_dest),
+			 ztest_unit_test(test_v4_nodelay_cork),
+			 ztest_unit_test(test_v4_send_recv_pkt));
 
 	ztest_run_test_suite(socket_tcp);
 }
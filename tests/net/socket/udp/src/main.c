@@ -322,6 +322,153 @@ void test_send_recv_2_sock(void)
 	zassert_equal(rv, 0, "close failed");
 }
 
+void test_sendmmsg_recvmmsg(void)
+{
+	int sock1, sock2;
+	struct sockaddr_in bind_addr, conn_addr, src_addr;
+	struct iovec tx_iov[2][2], rx_iov[3];
+	struct zsock_mmsghdr tx_msgs[2], rx_msgs[3];
+	char buf[3][10];
+	int i, rv;
+
+	sock1 = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	sock2 = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(sock1 >= 0, "cannot create sock1");
+	zassert_true(sock2 >= 0, "cannot create sock2");
+
+	bind_addr.sin_family = AF_INET;
+	bind_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	bind_addr.sin_port = htons(55556);
+	rv = bind(sock1, (struct sockaddr *)&bind_addr, sizeof(bind_addr));
+	zassert_equal(rv, 0, "bind failed");
+
+	conn_addr.sin_family = AF_INET;
+	conn_addr.sin_addr.s_addr = htonl(0xc0000201);
+	conn_addr.sin_port = htons(55556);
+	rv = connect(sock2, (struct sockaddr *)&conn_addr, sizeof(conn_addr));
+	zassert_equal(rv, 0, "connect failed");
+
+	/* Each datagram is gathered from two buffers */
+	memset(tx_msgs, 0, sizeof(tx_msgs));
+	for (i = 0; i < ARRAY_SIZE(tx_msgs); i++) {
+		tx_iov[i][0].iov_base = TEST_STR_SMALL;
+		tx_iov[i][0].iov_len = 2;
+		tx_iov[i][1].iov_base = TEST_STR_SMALL + 2;
+		tx_iov[i][1].iov_len = STRLEN(TEST_STR_SMALL) - 2;
+		tx_msgs[i].msg_hdr.msg_iov = tx_iov[i];
+		tx_msgs[i].msg_hdr.msg_iovlen = ARRAY_SIZE(tx_iov[i]);
+	}
+
+	rv = zsock_sendmmsg(sock2, tx_msgs, ARRAY_SIZE(tx_msgs), 0);
+	zassert_equal(rv, ARRAY_SIZE(tx_msgs), "sendmmsg failed");
+	zassert_equal(tx_msgs[1].msg_len, STRLEN(TEST_STR_SMALL),
+		      "invalid send len");
+
+	memset(rx_msgs, 0, sizeof(rx_msgs));
+	for (i = 0; i < ARRAY_SIZE(rx_msgs); i++) {
+		rx_iov[i].iov_base = buf[i];
+		rx_iov[i].iov_len = sizeof(buf[i]);
+		rx_msgs[i].msg_hdr.msg_iov = &rx_iov[i];
+		rx_msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	rx_msgs[0].msg_hdr.msg_name = &src_addr;
+	rx_msgs[0].msg_hdr.msg_namelen = sizeof(src_addr);
+
+	/* Let both datagrams get queued, only those two are returned */
+	k_sleep(K_MSEC(100));
+
+	rv = zsock_recvmmsg(sock1, rx_msgs, ARRAY_SIZE(rx_msgs), 0);
+	zassert_equal(rv, ARRAY_SIZE(tx_msgs), "recvmmsg failed");
+	zassert_equal(rx_msgs[0].msg_hdr.msg_namelen, sizeof(src_addr),
+		      "invalid address length");
+	zassert_equal(src_addr.sin_family, AF_INET, "invalid address");
+
+	for (i = 0; i < rv; i++) {
+		zassert_equal(rx_msgs[i].msg_len, STRLEN(TEST_STR_SMALL),
+			      "Invalid recv len");
+		zassert_equal(memcmp(buf[i], TEST_STR_SMALL,
+				     STRLEN(TEST_STR_SMALL)),
+			      0,
+			      "Invalid recv data");
+	}
+
+	rv = close(sock1);
+	zassert_equal(rv, 0, "close failed");
+
+	rv = close(sock2);
+	zassert_equal(rv, 0, "close failed");
+}
+
+/* More datagrams than zsock_recvmmsg() takes from the queue at once */
+#define MMSG_QUEUED 10
+
+void test_recvmmsg_batches(void)
+{
+	int sock1, sock2;
+	struct sockaddr_in bind_addr, conn_addr;
+	struct iovec rx_iov[MMSG_QUEUED + 2];
+	struct zsock_mmsghdr rx_msgs[MMSG_QUEUED + 2];
+	char buf[MMSG_QUEUED + 2];
+	ssize_t len;
+	int i, rv;
+
+	sock1 = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	sock2 = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(sock1 >= 0, "cannot create sock1");
+	zassert_true(sock2 >= 0, "cannot create sock2");
+
+	bind_addr.sin_family = AF_INET;
+	bind_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	bind_addr.sin_port = htons(55557);
+	rv = bind(sock1, (struct sockaddr *)&bind_addr, sizeof(bind_addr));
+	zassert_equal(rv, 0, "bind failed");
+
+	conn_addr.sin_family = AF_INET;
+	conn_addr.sin_addr.s_addr = htonl(0xc0000201);
+	conn_addr.sin_port = htons(55557);
+	rv = connect(sock2, (struct sockaddr *)&conn_addr, sizeof(conn_addr));
+	zassert_equal(rv, 0, "connect failed");
+
+	/* Each datagram carries its own index */
+	for (i = 0; i < MMSG_QUEUED; i++) {
+		char c = i;
+
+		len = send(sock2, &c, 1, 0);
+		zassert_equal(len, 1, "send failed");
+	}
+
+	memset(rx_msgs, 0, sizeof(rx_msgs));
+	for (i = 0; i < ARRAY_SIZE(rx_msgs); i++) {
+		rx_iov[i].iov_base = &buf[i];
+		rx_iov[i].iov_len = 1;
+		rx_msgs[i].msg_hdr.msg_iov = &rx_iov[i];
+		rx_msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	k_sleep(K_MSEC(100));
+
+	rv = zsock_recvmmsg(sock1, rx_msgs, ARRAY_SIZE(rx_msgs), 0);
+	zassert_equal(rv, MMSG_QUEUED, "recvmmsg failed");
+
+	for (i = 0; i < rv; i++) {
+		zassert_equal(rx_msgs[i].msg_len, 1, "Invalid recv len");
+		zassert_equal(buf[i], i, "Invalid recv order");
+	}
+
+	/* The queue is empty now */
+	rv = zsock_recvmmsg(sock1, rx_msgs, ARRAY_SIZE(rx_msgs),
+			    ZSOCK_MSG_DONTWAIT);
+	zassert_equal(rv, -1, "recvmmsg should fail");
+	zassert_equal(errno, EAGAIN, "invalid errno");
+
+	rv = close(sock1);
+	zassert_equal(rv, 0, "close failed");
+
+	rv = close(sock2);
+	zassert_equal(rv, 0, "close failed");
+}
+
 void test_main(void)
 {
 	ztest_test_suite(socket_udp,
@@ -329,7 +476,9 @@ void test_main(void)
 			 ztest_unit_test(test_v4_sendto_recvfrom),
 			 ztest_unit_test(test_v6_sendto_recvfrom),
 			 ztest_unit_test(test_v4_bind_sendto),
-			 ztest_unit_test(test_v6_bind_sendto));
+			 ztest_unit_test(test_v6_bind_sendto),
+			 ztest_unit_test(test_sendmmsg_recvmmsg),
+			 ztest_unit_test(test_recvmmsg_batches));
 
 	ztest_run_test_suite(socket_udp);
 }
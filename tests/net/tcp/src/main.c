@@ -1418,10 +1418,9 @@ static inline u32_t get_recv_wnd(struct net_tcp *tcp)
 	/* We don't queue received data inside the stack, we hand off
 	 * packets to synchronous callbacks (who can queue if they
 	 * want, but it's not our business).  So the available window
-	 * size is always the same.  There are two configurables to
-	 * check though.
+	 * size is always the initial one, sized from the RX buffers.
 	 */
-	return min(NET_TCP_MAX_WIN, NET_TCP_BUF_MAX_LEN);
+	return NET_TCP_INIT_RECV_WND;
 }
 
 static bool test_tcp_seq_validity(void)
@@ -1472,6 +1471,47 @@ static bool test_tcp_seq_validity(void)
 	return true;
 }
 
+#if defined(CONFIG_NET_QUOTA)
+#define QUOTA_SEGMENTS (CONFIG_NET_QUOTA_CONTEXT_TX + 2)
+
+static bool test_segments_under_quota(void)
+{
+	struct net_pkt *pkts[QUOTA_SEGMENTS];
+	struct net_tcp *tcp = v6_ctx->tcp;
+	bool ok = true;
+	int ret, i;
+
+	/* Control segments are built from the RX path, so they must
+	 * not be limited by the TX quota of the context.
+	 */
+	for (i = 0; i < QUOTA_SEGMENTS; i++) {
+		pkts[i] = NULL;
+
+		ret = net_tcp_prepare_segment(tcp, NET_TCP_ACK, NULL, 0,
+					      NULL,
+					      (struct sockaddr *)&peer_v6_addr,
+					      &pkts[i]);
+		if (ret) {
+			DBG("Prepare segment %d failed (%d)\n", i, ret);
+			ok = false;
+			break;
+		}
+	}
+
+	if (ok && atomic_get(&v6_ctx->quota.tx)) {
+		DBG("Segments charged to TX quota (%d)\n",
+		    (int)atomic_get(&v6_ctx->quota.tx));
+		ok = false;
+	}
+
+	for (i = 0; i < QUOTA_SEGMENTS && pkts[i]; i++) {
+		net_pkt_unref(pkts[i]);
+	}
+
+	return ok;
+}
+#endif /* CONFIG_NET_QUOTA */
+
 static bool test_init_tcp_reply_context(void)
 {
 	struct net_if *iface = net_if_get_default() + 1;
@@ -1735,6 +1775,9 @@ static const struct {
 	{ "test IPv6 TCP seq check", test_v6_seq_check },
 	{ "test IPv4 TCP seq check", test_v4_seq_check },
 	{ "test TCP seq validity", test_tcp_seq_validity },
+#if defined(CONFIG_NET_QUOTA)
+	{ "test TCP segments under a quota", test_segments_under_quota },
+#endif
 	{ "test TCP reply context init", test_init_tcp_reply_context },
 	{ "test TCP accept init", test_init_tcp_accept },
 #if 0
@@ -15,6 +15,7 @@
 
 #include <net/net_ip.h>
 #include <net/net_app.h>
+#include <net/http.h>
 #include <net/websocket.h>
 
 static struct net_app_ctx app_ctx_v6;
@@ -569,6 +570,396 @@ void test_v4_send_multi_msg(void)
 	test_send_multi_msg(&app_ctx_v4);
 }
 
+static struct http_root_url *url_find(struct http_ctx *ctx, const char *url,
+				      enum http_url_flags flags)
+{
+	ctx->http.url = url;
+	ctx->http.url_len = strlen(url);
+
+	return http_url_find(ctx, flags);
+}
+
+static void test_url_router(void)
+{
+	static struct http_server_urls urls;
+	static struct http_ctx ctx;
+	struct http_root_url *root, *images, *png, *index, *ws;
+
+	ctx.http.urls = &urls;
+
+	root = http_server_add_url(&urls, "/", HTTP_URL_STANDARD);
+	images = http_server_add_url(&urls, "/images", HTTP_URL_STANDARD);
+	png = http_server_add_url(&urls, "/images/png/", HTTP_URL_STANDARD);
+	index = http_server_add_url(&urls, "/index.html", HTTP_URL_STANDARD);
+	ws = http_server_add_url(&urls, "/images", HTTP_URL_WEBSOCKET);
+
+	zassert_not_null(ws, "Cannot add URL");
+
+	zassert_equal(url_find(&ctx, "/", HTTP_URL_STANDARD), root,
+		      "Root URL not found");
+	zassert_equal(url_find(&ctx, "/index.html", HTTP_URL_STANDARD), index,
+		      "Index URL not found");
+	zassert_is_null(url_find(&ctx, "/index.htm", HTTP_URL_STANDARD),
+			"Partial URL found");
+	zassert_equal(url_find(&ctx, "/images", HTTP_URL_STANDARD), images,
+		      "Images URL not found");
+	zassert_equal(url_find(&ctx, "/images", HTTP_URL_WEBSOCKET), ws,
+		      "Websocket URL not found");
+	zassert_equal(url_find(&ctx, "/images/a.png", HTTP_URL_STANDARD),
+		      images, "Images sub URL not found");
+	zassert_equal(url_find(&ctx, "/images/png", HTTP_URL_STANDARD),
+		      images, "Images sub URL not found");
+	zassert_equal(url_find(&ctx, "/images/png/a.png", HTTP_URL_STANDARD),
+		      png, "Longest URL not found");
+	zassert_is_null(url_find(&ctx, "/imagesfoo", HTTP_URL_STANDARD),
+			"URL matched in the middle of a path element");
+	zassert_is_null(url_find(&ctx, "/foo", HTTP_URL_STANDARD),
+			"Unknown URL found");
+
+	zassert_equal(http_server_del_url(&urls, "/"), 0,
+		      "Cannot delete URL");
+	zassert_is_null(url_find(&ctx, "/", HTTP_URL_STANDARD),
+			"Deleted URL found");
+	zassert_equal(url_find(&ctx, "/images/png/a.png", HTTP_URL_STANDARD),
+		      png, "URL lost when deleting another one");
+}
+
+/* The request parser is tested by giving packets directly to the receive
+ * callback of a server that is not listening. The replies cannot be sent,
+ * only the callbacks are checked.
+ */
+#define PARSE_PORT 8081
+
+static struct http_ctx parse_ctx;
+static struct http_server_urls parse_urls;
+static struct sockaddr parse_addr;
+static u8_t parse_request_buf[128];
+static char parse_out[128];
+static char parse_body[32];
+static int parse_finals;
+static int parse_closed;
+
+/* Binary websocket frame with "abc" as payload, masked with a zero key */
+static const char ws_frame[] = {
+	0x82, 0x83, 0x00, 0x00, 0x00, 0x00, 'a', 'b', 'c',
+};
+
+static void parse_log(const char *str, size_t len)
+{
+	size_t pos = strlen(parse_out);
+
+	zassert_true(pos + len < sizeof(parse_out), "Log overflow");
+
+	memcpy(parse_out + pos, str, len);
+	parse_out[pos + len] = '\0';
+}
+
+static enum http_verdict parse_default(struct http_ctx *ctx,
+				       enum http_connection_type type,
+				       const struct sockaddr *dst)
+{
+	return HTTP_VERDICT_ACCEPT;
+}
+
+static void parse_connect(struct http_ctx *ctx,
+			  enum http_connection_type type,
+			  const struct sockaddr *dst,
+			  void *user_data)
+{
+	struct http_field_value *kv;
+	int i;
+
+	zassert_equal(type, HTTP_CONNECTION, "Not a HTTP connection");
+
+	parse_log("[", 1);
+	parse_log(ctx->http.url, ctx->http.url_len);
+
+	for (i = 0; i < ctx->http.field_values_ctr; i++) {
+		kv = &ctx->http.field_values[i];
+
+		parse_log(" ", 1);
+		parse_log(kv->key, kv->key_len);
+		parse_log("=", 1);
+		parse_log(kv->value, kv->value_len);
+	}
+
+	parse_log("]", 1);
+}
+
+static void parse_recv(struct http_ctx *ctx,
+		       struct net_pkt *pkt,
+		       int status,
+		       u32_t flags,
+		       const struct sockaddr *dst,
+		       void *user_data)
+{
+	u16_t len = net_pkt_appdatalen(pkt);
+	char data[16];
+
+	zassert_true(len <= sizeof(data), "Too much data");
+	zassert_equal(net_frag_linearize(data, sizeof(data), pkt, 0, len),
+		      len, "Cannot read data");
+
+	parse_log("{", 1);
+	parse_log(data, len);
+	parse_log("}", 1);
+
+	net_pkt_unref(pkt);
+}
+
+static void parse_close(struct http_ctx *ctx, int status, void *user_data)
+{
+	parse_closed++;
+}
+
+static void parse_body_cb(struct http_ctx *ctx,
+			  const u8_t *data,
+			  size_t len,
+			  enum http_final_call final_data,
+			  const struct sockaddr *dst,
+			  void *user_data)
+{
+	size_t pos = strlen(parse_body);
+
+	if (final_data == HTTP_DATA_FINAL) {
+		zassert_is_null(data, "Data in the final call");
+		parse_finals++;
+		return;
+	}
+
+	zassert_true(pos + len < sizeof(parse_body), "Body overflow");
+
+	memcpy(parse_body + pos, data, len);
+	parse_body[pos + len] = '\0';
+}
+
+/* Give the data to the server as one packet, in fragments of frag_len
+ * bytes.
+ */
+static void parse_feed(const char *data, size_t len, size_t frag_len)
+{
+	struct net_buf *frag;
+	struct net_pkt *pkt;
+	size_t copy;
+
+	pkt = net_pkt_get_reserve_rx(0, K_FOREVER);
+
+	while (len) {
+		frag = net_pkt_get_frag(pkt, K_FOREVER);
+
+		copy = min(len, min(frag_len, net_buf_tailroom(frag)));
+		net_buf_add_mem(frag, data, copy);
+		net_pkt_frag_add(pkt, frag);
+
+		data += copy;
+		len -= copy;
+	}
+
+	net_pkt_set_appdata(pkt, pkt->frags->data);
+	net_pkt_set_appdatalen(pkt, net_pkt_get_len(pkt));
+
+	parse_ctx.app_ctx.cb.recv(&parse_ctx.app_ctx, pkt, 0,
+				  parse_ctx.app_ctx.user_data);
+}
+
+static void parse_feed_str(const char *str, size_t frag_len)
+{
+	parse_feed(str, strlen(str), frag_len);
+}
+
+/* Start from a new connection */
+static void parse_reset(void)
+{
+	if (parse_ctx.state != HTTP_STATE_CLOSED) {
+		http_close(&parse_ctx);
+	}
+
+	parse_out[0] = '\0';
+	parse_body[0] = '\0';
+	parse_finals = 0;
+	parse_closed = 0;
+}
+
+static void test_http_parse_init(void)
+{
+	int ret;
+
+	parse_addr.sa_family = AF_INET;
+	net_sin(&parse_addr)->sin_port = htons(PARSE_PORT);
+
+	zassert_not_null(http_server_add_default(&parse_urls, parse_default),
+			 "Cannot add default URL");
+
+	ret = http_server_init(&parse_ctx, &parse_urls, &parse_addr,
+			       parse_request_buf, sizeof(parse_request_buf),
+			       NULL, NULL);
+	zassert_equal(ret, 0, "Cannot init server (%d)", ret);
+
+	http_set_cb(&parse_ctx, parse_connect, parse_recv, NULL, parse_close);
+	http_server_set_body_cb(&parse_ctx, parse_body_cb);
+}
+
+static void test_http_parse_body(void)
+{
+	static const char req[] =
+		"POST /post HTTP/1.1\r\nContent-Length: 10\r\n\r\n"
+		"0123456789";
+
+	parse_reset();
+	parse_feed_str(req, 8);
+
+	zassert_false(strcmp(parse_out, "[/post Content-Length=10]"),
+		      "Request not dispatched (%s)", parse_out);
+	zassert_false(strcmp(parse_body, "0123456789"),
+		      "Wrong body (%s)", parse_body);
+	zassert_equal(parse_finals, 1, "Request not finished");
+
+	/* The chunks of the body arrive in separate packets */
+	parse_reset();
+	parse_feed_str("PUT /c HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+		       "3\r\nab", 7);
+
+	zassert_false(strcmp(parse_body, "ab"), "Body not streamed (%s)",
+		      parse_body);
+	zassert_equal(parse_finals, 0, "Request finished too early");
+
+	parse_feed_str("c\r\n2\r\nde", 3);
+	parse_feed_str("\r\n0\r\n\r\n", 3);
+
+	zassert_false(strcmp(parse_body, "abcde"), "Wrong body (%s)",
+		      parse_body);
+	zassert_equal(parse_finals, 1, "Request not finished");
+}
+
+static void test_http_parse_split_header(void)
+{
+	parse_reset();
+	parse_feed_str("GE", 1);
+	parse_feed_str("T /a HT", 4);
+	parse_feed_str("TP/1.1\r\nX-Te", 4);
+	parse_feed_str("st: val", 4);
+
+	zassert_false(strcmp(parse_out, ""), "Request dispatched too early");
+
+	parse_feed_str("ue\r\nHost: x\r\n\r\n", 4);
+
+	zassert_false(strcmp(parse_out, "[/a X-Test=value Host=x]"),
+		      "Header fields not joined (%s)", parse_out);
+	zassert_equal(parse_finals, 1, "Request not finished");
+}
+
+static void test_http_parse_leftover(void)
+{
+	static const char req[] =
+		"GET /a HTTP/1.1\r\nConnection: close\r\n\r\n";
+	char data[sizeof(req) - 1 + sizeof(ws_frame)];
+	size_t frag_len[] = { sizeof(req) - 1, sizeof(data) };
+	int i;
+
+	memcpy(data, req, sizeof(req) - 1);
+	memcpy(data + sizeof(req) - 1, ws_frame, sizeof(ws_frame));
+
+	/* The data after the request goes to the receive callback whether
+	 * it starts a new fragment or not.
+	 */
+	for (i = 0; i < ARRAY_SIZE(frag_len); i++) {
+		parse_reset();
+		parse_feed(data, sizeof(data), frag_len[i]);
+
+		zassert_false(strcmp(parse_out, "[/a Connection=close]{abc}"),
+			      "Data after the request lost (%s)", parse_out);
+		zassert_equal(parse_closed, 0, "Connection closed");
+	}
+}
+
+static void test_http_parse_pipeline(void)
+{
+#if defined(CONFIG_HTTP_SERVER_KEEPALIVE)
+	static const char req[] =
+		"GET /a HTTP/1.1\r\n\r\n"
+		"POST /b HTTP/1.1\r\nContent-Length: 3\r\n\r\nxyz"
+		"GET /c HTTP/1.1\r\nConnection: close\r\n\r\n";
+	size_t frag_len[] = { 16, sizeof(req) };
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(frag_len); i++) {
+		parse_reset();
+		parse_feed_str(req, frag_len[i]);
+
+		zassert_false(strcmp(parse_out, "[/a][/b Content-Length=3]"
+				     "[/c Connection=close]"),
+			      "Pipelined requests lost (%s)", parse_out);
+		zassert_false(strcmp(parse_body, "xyz"), "Wrong body (%s)",
+			      parse_body);
+		zassert_equal(parse_finals, 3, "Requests not finished");
+	}
+
+	/* A kept connection serves the next request in a new packet */
+	parse_reset();
+	parse_feed_str("GET /a HTTP/1.1\r\n\r\n", 8);
+	parse_feed_str("GET /b HTTP/1.1\r\n\r\n", 8);
+
+	zassert_false(strcmp(parse_out, "[/a][/b]"),
+		      "Request after keep-alive lost (%s)", parse_out);
+	zassert_equal(parse_finals, 2, "Requests not finished");
+#else
+	ztest_test_skip();
+#endif
+}
+
+static void test_http_parse_bad_request(void)
+{
+	static const char end[] = " HTTP/1.1\r\n\r\n";
+	char req[sizeof(parse_request_buf) + 32];
+
+	/* The header does not fit in the request buffer */
+	memset(req, 'a', sizeof(req));
+	memcpy(req, "GET /", 5);
+	memcpy(req + sizeof(req) - (sizeof(end) - 1), end, sizeof(end) - 1);
+
+	parse_reset();
+	parse_feed(req, sizeof(req), 64);
+
+	zassert_equal(parse_closed, 1, "Connection not closed");
+	zassert_equal(parse_ctx.state, HTTP_STATE_CLOSED, "Wrong state");
+	zassert_false(strcmp(parse_out, ""), "Request dispatched");
+
+	parse_reset();
+	parse_feed_str("GARBAGE\r\n\r\n", 4);
+
+	zassert_equal(parse_closed, 1, "Connection not closed");
+	zassert_false(strcmp(parse_out, ""), "Request dispatched");
+}
+
+static void test_http_send_chunk(void)
+{
+	static const char chunks[] = "3\r\nabc\r\n0\r\n\r\n";
+	char data[sizeof(chunks)];
+	u16_t len;
+
+	/* Collect the chunks to a packet that is not sent */
+	parse_ctx.pending = net_pkt_get_reserve_tx(0, K_FOREVER);
+
+	zassert_equal(http_send_chunk(&parse_ctx, "abc", 3, NULL, NULL), 0,
+		      "Cannot send chunk");
+	zassert_equal(http_send_chunk(&parse_ctx, NULL, 0, NULL, NULL), 0,
+		      "Cannot send last chunk");
+
+	len = net_pkt_get_len(parse_ctx.pending);
+	zassert_equal(len, sizeof(chunks) - 1, "Wrong length %u", len);
+
+	net_frag_linearize(data, sizeof(data), parse_ctx.pending, 0, len);
+	zassert_false(memcmp(data, chunks, len), "Wrong chunk data");
+
+	net_pkt_unref(parse_ctx.pending);
+	parse_ctx.pending = NULL;
+}
+
+static void test_http_parse_cleanup(void)
+{
+	http_release(&parse_ctx);
+}
+
 static void test_setup(void)
 {
 	return;
@@ -576,6 +967,15 @@ static void test_setup(void)
 void test_main(void)
 {
 	ztest_test_suite(websocket,
+			 ztest_unit_test(test_url_router),
+			 ztest_unit_test(test_http_parse_init),
+			 ztest_unit_test(test_http_parse_body),
+			 ztest_unit_test(test_http_parse_split_header),
+			 ztest_unit_test(test_http_parse_leftover),
+			 ztest_unit_test(test_http_parse_pipeline),
+			 ztest_unit_test(test_http_parse_bad_request),
+			 ztest_unit_test(test_http_send_chunk),
+			 ztest_unit_test(test_http_parse_cleanup),
 			 ztest_unit_test(test_websocket_init_server),
 			 ztest_unit_test(test_init),
 			 ztest_unit_test(test_v6_init),